@@ -0,0 +1,109 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+// Compares completing requests through std::future with completion
+// callbacks. Reports throughput, and the number of operator new calls
+// per request (the response itself accounts for some of them).
+//
+// Usage: completion_benchmark [url] [requests] [batch]
+// The default url is the mock server at http://127.0.0.1:5000
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <express/client.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+    std::atomic<std::size_t> allocations {0};
+}
+
+auto operator new(std::size_t size) -> void* {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* ptr = std::malloc(size)) return ptr;
+    throw std::bad_alloc {};
+}
+
+auto operator delete(void* ptr) noexcept -> void {
+    std::free(ptr);
+}
+
+auto operator delete(void* ptr, std::size_t) noexcept -> void {
+    std::free(ptr);
+}
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    auto BatchWithFutures(const Express::Client& client, const Express::Config& config, int batch) {
+        std::vector<std::future<Express::Response>> futures;
+        futures.reserve(batch);
+        for (auto i = 0; i < batch; ++i) futures.emplace_back(client.Request(config));
+        for (auto& future : futures) future.get();
+    }
+
+    auto BatchWithCallbacks(const Express::Client& client, const Express::Config& config, int batch) {
+        std::atomic<int> pending {batch};
+        std::atomic<bool> failed {false};
+        for (auto i = 0; i < batch; ++i) {
+            client.Request(config, [&](Express::Expected<Express::Response> result) {
+                if (!result) failed = true;
+                if (pending.fetch_sub(1) == 1) pending.notify_one();
+            });
+        }
+        for (auto value = pending.load(); value != 0; value = pending.load()) {
+            pending.wait(value);
+        }
+        if (failed) throw std::runtime_error("Request failed");
+    }
+
+    template <class Function>
+    auto Measure(const char* name, int requests, int batch, Function function) {
+        function(); // warm up the arenas, frames and connections
+
+        const auto rounds = std::max(requests / batch, 1);
+        const auto allocations_before = allocations.load();
+        const auto start = Clock::now();
+        for (auto i = 0; i < rounds; ++i) function();
+        const auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+        const auto total = rounds * batch;
+
+        std::cout << name << ": "
+                  << total / elapsed.count() << " requests/s, "
+                  << static_cast<double>(allocations.load() - allocations_before) / total
+                  << " allocations per request\n";
+    }
+}
+
+auto main(int argc, char* argv[]) -> int {
+    const std::string url = argc > 1 ? argv[1] : "http://127.0.0.1:5000";
+    const auto requests = argc > 2 ? std::atoi(argv[2]) : 2000;
+    const auto batch = argc > 3 ? std::atoi(argv[3]) : 16;
+
+    std::cout << requests << " requests to " << url
+              << " in batches of " << batch << "\n";
+
+    const Express::Client client;
+    const Express::Config config {.url = url, .timeout = 5s};
+
+    try {
+        Measure("futures  ", requests, batch, [&] {
+            BatchWithFutures(client, config, batch);
+        });
+        Measure("callbacks", requests, batch, [&] {
+            BatchWithCallbacks(client, config, batch);
+        });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+// Downloads a JSON document of the given size, uncompressed and with
+// every content coding the client decodes, and reports the throughput of
+// decoded data.
+//
+// Usage: decompression_benchmark [url] [size] [requests] [rounds]
+// The default url is the mock server's /json route at http://127.0.0.1:5000
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <express/client.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    auto Download(const Express::Client& client, const Express::Config& config, int requests) {
+        std::vector<Express::Task<Express::Response>> tasks;
+        tasks.reserve(requests);
+        for (auto i = 0; i < requests; ++i) tasks.emplace_back(client.RequestAsync(config));
+
+        std::size_t bytes {0};
+        for (const auto& response : Express::SyncWait(Express::WhenAll(std::move(tasks)))) {
+            bytes += response.data.size();
+        }
+        return bytes;
+    }
+
+    auto Measure(const char* name, int rounds, int requests, const Express::Client& client, const Express::Config& config) {
+        Download(client, config, requests); // warm up
+
+        std::size_t bytes {0};
+        const auto start = Clock::now();
+        for (auto i = 0; i < rounds; ++i) bytes += Download(client, config, requests);
+        const auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+
+        std::cout << name << ": "
+                  << (rounds * requests) / elapsed.count() << " requests/s, "
+                  << bytes / elapsed.count() / (1024 * 1024) << " MiB/s decoded\n";
+    }
+}
+
+auto main(int argc, char* argv[]) -> int {
+    const std::string base = argc > 1 ? argv[1] : "http://127.0.0.1:5000";
+    const auto size = argc > 2 ? std::atoi(argv[2]) : 1024 * 1024;
+    const auto requests = argc > 3 ? std::atoi(argv[3]) : 16;
+    const auto rounds = argc > 4 ? std::atoi(argv[4]) : 10;
+
+    const auto url = base + "/json?size=" + std::to_string(size);
+    std::cout << requests << " concurrent downloads of " << url
+              << ", " << rounds << " rounds\n";
+
+    Express::Client client;
+
+    // The mock server compresses with the first coding it supports
+    const auto with = [&url](std::string_view coding) {
+        return Express::Config {
+            .url = url,
+            .headers = {{{"Accept-Encoding", std::string {coding}}}},
+            .timeout = 30s
+        };
+    };
+
+    try {
+        Measure("identity", rounds, requests, client, with("identity"));
+        Measure("gzip    ", rounds, requests, client, with("gzip"));
+        Measure("deflate ", rounds, requests, client, with("deflate"));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
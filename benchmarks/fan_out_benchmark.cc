@@ -0,0 +1,79 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+// Fans out a batch of concurrent requests and waits for all of them,
+// once with futures and once with coroutines.
+//
+// Usage: fan_out_benchmark [url] [requests] [rounds]
+// The default url is the mock server at http://127.0.0.1:5000
+
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <express/client.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    auto FanOutWithFutures(const Express::Client& client, const std::string& url, int requests) {
+        std::vector<std::future<Express::Response>> futures;
+        futures.reserve(requests);
+        for (auto i = 0; i < requests; ++i) {
+            futures.emplace_back(client.Request({.url = url, .timeout = 5s}));
+        }
+        for (auto& future : futures) future.get();
+    }
+
+    auto FanOutWithCoroutines(const Express::Client& client, const std::string& url, int requests) {
+        std::vector<Express::Task<Express::Response>> tasks;
+        tasks.reserve(requests);
+        for (auto i = 0; i < requests; ++i) {
+            tasks.emplace_back(client.RequestAsync({.url = url, .timeout = 5s}));
+        }
+        Express::SyncWait(Express::WhenAll(std::move(tasks)));
+    }
+
+    template <class Function>
+    auto Measure(const char* name, int rounds, int requests, Function function) {
+        function(); // warm up
+
+        const auto start = Clock::now();
+        for (auto i = 0; i < rounds; ++i) function();
+        const auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start);
+
+        std::cout << name << ": "
+                  << elapsed.count() / rounds << " ms per round, "
+                  << (rounds * requests) / (elapsed.count() / 1000) << " requests/s\n";
+    }
+}
+
+auto main(int argc, char* argv[]) -> int {
+    const std::string url = argc > 1 ? argv[1] : "http://127.0.0.1:5000";
+    const auto requests = argc > 2 ? std::atoi(argv[2]) : 64;
+    const auto rounds = argc > 3 ? std::atoi(argv[3]) : 20;
+
+    std::cout << "Fan-out of " << requests << " requests to " << url
+              << ", " << rounds << " rounds\n";
+
+    Express::Client client;
+
+    try {
+        Measure("futures   ", rounds, requests, [&] {
+            FanOutWithFutures(client, url, requests);
+        });
+        Measure("coroutines", rounds, requests, [&] {
+            FanOutWithCoroutines(client, url, requests);
+        });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
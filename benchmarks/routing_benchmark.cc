@@ -0,0 +1,112 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+// Measures how upstream groups of different sizes pick their members:
+// the cost of a pick, how evenly the keys are spread (the most loaded
+// member's share relative to an even share), and for the hashing
+// policies, the share of keys that move when a member is added.
+//
+// Usage: routing_benchmark [keys]
+// No server is needed; the members are never connected to.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <express/upstream.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    auto Addresses(std::size_t count) {
+        std::vector<std::string> addresses;
+        for (std::size_t i = 0; i < count; ++i) {
+            addresses.push_back("10.0." + std::to_string(i / 250) + "." + std::to_string(i % 250 + 1) + ":8080");
+        }
+        return addresses;
+    }
+
+    auto MakeUpstream(const std::vector<std::string>& addresses, Express::Balancing balancing) {
+        const std::vector<std::string_view> views(addresses.begin(), addresses.end());
+        return std::make_unique<Express::Upstream>(views, Express::UpstreamOptions {.balancing = balancing});
+    }
+
+    // The member every key is routed to
+    auto Route(Express::Upstream& upstream, const std::vector<std::string>& keys) {
+        const Express::Expected<Express::Response> success {Express::Response {.status_code = 200}};
+
+        std::vector<std::size_t> routes;
+        routes.reserve(keys.size());
+        for (const auto& key : keys) {
+            const auto member = upstream.Pick(key);
+            upstream.Record(member, success, std::chrono::milliseconds {1});
+            routes.push_back(member);
+        }
+        return routes;
+    }
+
+    auto Measure(const char* name, Express::Balancing balancing, std::size_t members, const std::vector<std::string>& keys) {
+        const auto addresses = Addresses(members);
+        auto upstream = MakeUpstream(addresses, balancing);
+        Route(*upstream, keys); // warm up, and builds the ring or table
+
+        const auto start = Clock::now();
+        const auto routes = Route(*upstream, keys);
+        const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start);
+
+        std::vector<std::size_t> counts(members);
+        for (const auto route : routes) ++counts[route];
+        const auto even = static_cast<double>(keys.size()) / static_cast<double>(members);
+        const auto peak = static_cast<double>(*std::max_element(counts.begin(), counts.end())) / even;
+
+        std::cout << name << " " << members << " members: "
+                  << elapsed.count() / static_cast<double>(keys.size()) << " ns per pick, "
+                  << "peak load " << peak << "x";
+
+        if (balancing == Express::Balancing::RingHash || balancing == Express::Balancing::Maglev) {
+            auto grown = MakeUpstream(Addresses(members + 1), balancing);
+            const auto regrown = Route(*grown, keys);
+
+            // Members keep their positions, since the new member is the last one
+            std::size_t moved {0};
+            for (std::size_t i = 0; i < keys.size(); ++i) moved += routes[i] != regrown[i];
+            std::cout << ", " << 100.0 * static_cast<double>(moved) / static_cast<double>(keys.size())
+                      << "% moved when adding a member (ideal " << 100.0 / static_cast<double>(members + 1) << "%)";
+        }
+        std::cout << '\n';
+    }
+}
+
+auto main(int argc, char* argv[]) -> int {
+    const auto count = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (auto i = 0; i < count; ++i) keys.push_back("/users/" + std::to_string(i));
+
+    std::cout << count << " keys\n";
+
+    const std::pair<const char*, Express::Balancing> policies[] {
+        {"round robin   ", Express::Balancing::RoundRobin},
+        {"least requests", Express::Balancing::LeastRequests},
+        {"peak EWMA     ", Express::Balancing::PeakEwma},
+        {"ring hash     ", Express::Balancing::RingHash},
+        {"maglev        ", Express::Balancing::Maglev},
+    };
+
+    try {
+        for (const auto members : {3, 10, 100}) {
+            for (const auto& [name, balancing] : policies) Measure(name, balancing, members, keys);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,265 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+// Echoes WebSocket messages over loopback, and reports the messages per
+// second one at a time (round trips) and pipelined, with and without
+// permessage-deflate. The echo server runs in the benchmark, on its own
+// thread, so that it doesn't limit the client. Also reports the rate at
+// which payloads are masked, vectorized and a byte at a time.
+//
+// Usage: websocket_benchmark [size] [messages] [rounds]
+// The echo server uses POSIX sockets.
+
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <express/client.h>
+
+#include "websocket/deflate.h"
+#include "websocket/frame.h"
+#include "websocket/handshake.h"
+#include "websocket/mask.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    /*
+        Accepts connections one after the other, and echoes every message
+        until the client closes the connection.
+    */
+    class EchoServer {
+    public:
+        EchoServer() {
+            listener_ = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t length = sizeof(address);
+            if (bind(listener_, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+                listen(listener_, 8) != 0 ||
+                getsockname(listener_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+                std::cerr << "Can't listen on loopback\n";
+                std::exit(EXIT_FAILURE);
+            }
+            port_ = ntohs(address.sin_port);
+            thread_ = std::thread {[this] { Run(); }};
+        }
+
+        [[nodiscard]] auto url() const { return "ws://127.0.0.1:" + std::to_string(port_) + "/echo"; }
+
+        ~EchoServer() {
+            shutdown(listener_, SHUT_RDWR);
+            close(listener_);
+            thread_.join();
+        }
+
+    private:
+        int listener_ {-1};
+        int port_ {0};
+        std::thread thread_;
+
+        auto Run() -> void {
+            while (true) {
+                const auto connection = accept(listener_, nullptr, nullptr);
+                if (connection < 0) return;
+                Echo(connection);
+                close(connection);
+            }
+        }
+
+        static auto SendAll(int connection, std::string_view data) -> bool {
+            while (!data.empty()) {
+                const auto sent = send(connection, data.data(), data.size(), MSG_NOSIGNAL);
+                if (sent <= 0) return false;
+                data.remove_prefix(static_cast<std::size_t>(sent));
+            }
+            return true;
+        }
+
+        static auto Echo(int connection) -> void {
+            using namespace Express::Ws;
+
+            // The upgrade request, which nothing follows until it's answered
+            std::string request;
+            char chunk[4096];
+            while (request.find("\r\n\r\n") == std::string::npos) {
+                const auto size = recv(connection, chunk, sizeof(chunk), 0);
+                if (size <= 0) return;
+                request.append(chunk, static_cast<std::size_t>(size));
+            }
+            const auto start = request.find("Sec-WebSocket-Key: ") + 19;
+            const auto key = request.substr(start, request.find("\r\n", start) - start);
+            const auto deflate = request.find("permessage-deflate") != std::string::npos;
+
+            std::string response {"HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"};
+            response.append("Sec-WebSocket-Accept: ").append(AcceptKey(key)).append("\r\n");
+            if (deflate) response.append("Sec-WebSocket-Extensions: permessage-deflate\r\n");
+            response.append("\r\n");
+            if (!SendAll(connection, response)) return;
+
+            // Both directions are raw deflate streams, so the server's
+            // side is the same as the client's
+            PerMessageDeflate codec {{}};
+            FrameReader reader {64 * 1024 * 1024};
+            std::string message;
+            std::string inflated;
+            std::string output;
+            std::error_code ec;
+            auto compressed = false;
+            auto opcode = Opcode::kText;
+
+            while (true) {
+                auto space = reader.Prepare(64 * 1024);
+                const auto size = recv(connection, space.data(), space.size(), 0);
+                if (size <= 0) return;
+                reader.Commit(static_cast<std::size_t>(size));
+
+                // Every message that arrived is echoed with a single send
+                output.clear();
+                Frame frame;
+                while (reader.Next(frame, ec)) {
+                    const std::string_view payload {reinterpret_cast<const char*>(frame.payload.data()), frame.payload.size()};
+                    if (frame.header.opcode == Opcode::kClose) {
+                        WriteFrame(Opcode::kClose, payload.substr(0, 2), true, false, {}, output);
+                        SendAll(connection, output);
+                        return;
+                    }
+                    if (IsControl(frame.header.opcode)) continue;
+
+                    if (frame.header.opcode != Opcode::kContinuation) {
+                        opcode = frame.header.opcode;
+                        compressed = frame.header.compressed;
+                        message.clear();
+                    }
+                    message.append(payload);
+                    if (!frame.header.fin) continue;
+
+                    if (compressed) {
+                        codec.Decompress(message, 64 * 1024 * 1024, inflated, ec);
+                        codec.Compress(inflated, message, ec);
+                    }
+                    WriteFrame(opcode, message, true, compressed, {}, output);
+                }
+                if (ec || !SendAll(connection, output)) return;
+            }
+        }
+    };
+
+    auto RoundTrips(Express::WebSocket& websocket, std::string_view payload, int messages) -> Express::Task<void> {
+        for (auto i = 0; i < messages; ++i) {
+            if (co_await websocket.SendAsync(payload)) throw std::runtime_error {"Send failed"};
+            auto message = co_await websocket.ReceiveAsync();
+            if (!message || message->data.size() != payload.size()) throw std::runtime_error {"Receive failed"};
+        }
+    }
+
+    auto ReceiveAll(Express::WebSocket& websocket, std::size_t size, int messages) -> Express::Task<void> {
+        for (auto i = 0; i < messages; ++i) {
+            auto message = co_await websocket.ReceiveAsync();
+            if (!message || message->data.size() != size) throw std::runtime_error {"Receive failed"};
+        }
+    }
+
+    // Queues every message at once, and receives the echoes as they arrive.
+    // The sends are waited for here, since they complete on the executor
+    // the receiving coroutine runs on.
+    auto Pipelined(Express::WebSocket& websocket, std::string_view payload, int messages) -> void {
+        std::vector<std::future<std::error_code>> sends;
+        sends.reserve(static_cast<std::size_t>(messages));
+        for (auto i = 0; i < messages; ++i) sends.push_back(websocket.Send(payload));
+
+        Express::SyncWait(ReceiveAll(websocket, payload.size(), messages));
+        for (auto& send : sends) {
+            if (send.get()) throw std::runtime_error {"Send failed"};
+        }
+    }
+
+    template <class Run>
+    auto Measure(const std::string& name, int rounds, int messages, Run run) {
+        run(messages / 10); // warm up
+
+        const auto start = Clock::now();
+        for (auto i = 0; i < rounds; ++i) run(messages);
+        const auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+
+        std::cout << name << ": " << rounds * messages / elapsed.count() << " messages/s" << std::endl;
+    }
+
+    auto MeasureMasking() {
+        std::vector<unsigned char> payload(1024 * 1024, 'x');
+        std::vector<unsigned char> output(payload.size());
+        const Express::Ws::MaskingKey key {0x37, 0xFA, 0x21, 0x3D};
+        constexpr auto kRounds = 200;
+
+        // Every round starts at another offset, so that the key is rotated
+        const auto measure = [&](const char* name, auto mask) {
+            const auto start = Clock::now();
+            for (auto i = 0; i < kRounds; ++i) {
+                mask(payload.data(), output.data(), payload.size(), key, static_cast<std::size_t>(i));
+            }
+            const auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+
+            // The output is read, so the masking isn't optimized away
+            auto checksum = 0U;
+            for (const auto byte : output) checksum += byte;
+            std::cout << name << ": " << kRounds * payload.size() / elapsed.count() / 1e9
+                      << " GB/s (checksum " << checksum << ")" << std::endl;
+        };
+
+        measure("masking, vectorized", [](auto... args) { Express::Ws::Mask(args...); });
+        measure("masking, bytewise  ", [](auto... args) { Express::Ws::MaskBytewise(args...); });
+    }
+}
+
+auto main(int argc, char* argv[]) -> int {
+    const auto size = argc > 1 ? std::atoi(argv[1]) : 1024;
+    const auto messages = argc > 2 ? std::atoi(argv[2]) : 20000;
+    const auto rounds = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    // A JSON-like payload, so that compressing it is realistic
+    std::string payload;
+    for (auto i = 0; payload.size() < static_cast<std::size_t>(size); ++i) {
+        payload.append(R"({"id":)").append(std::to_string(i)).append(R"(,"name":"item"},)");
+    }
+    payload.resize(static_cast<std::size_t>(size));
+
+    std::cout << messages << " messages of " << size << " bytes over loopback, " << rounds << " rounds\n";
+
+    EchoServer server;
+    Express::Client client;
+
+    try {
+        for (const auto deflate : {false, true}) {
+            auto websocket = client.ConnectWebSocket({.url = server.url()}, {.deflate = deflate}).get();
+            if (!websocket) throw std::runtime_error {websocket.error().message()};
+
+            auto& connection = **websocket;
+            const std::string suffix = deflate ? " (deflate)" : "";
+            Measure("round trips" + suffix, rounds, messages, [&](int count) {
+                Express::SyncWait(RoundTrips(connection, payload, count));
+            });
+            Measure("pipelined  " + suffix, rounds, messages, [&](int count) {
+                Pipelined(connection, payload, count);
+            });
+            connection.Close().get();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    MeasureMasking();
+    return EXIT_SUCCESS;
+}
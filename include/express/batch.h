@@ -0,0 +1,31 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "express_client_export.h"
+
+#include "express/expected.h"
+#include "express/response.h"
+
+namespace Express {
+    struct EXPRESS_CLIENT_EXPORT BatchOptions {
+        // The number of connections a batch opens to the same host at once
+        std::size_t max_connections_per_host {6};
+    };
+
+    struct EXPRESS_CLIENT_EXPORT BatchResult {
+        // One result per request, in the order of the requests
+        std::vector<Expected<Response>> responses;
+
+        // The time it took to complete the whole batch
+        std::chrono::nanoseconds elapsed {0};
+
+        std::size_t connections_opened {0};
+        std::size_t connections_reused {0};
+    };
+}
@@ -0,0 +1,291 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "express_client_export.h"
+
+#include "express/headers.h"
+#include "express/response.h"
+
+namespace Express {
+    class SharedMemory;
+
+    enum class EXPRESS_CLIENT_EXPORT CacheOutcome {
+        // Served from the cache without a request
+        Hit,
+        // Served stale, while it's revalidated or because the server failed
+        StaleHit,
+        // Served from the cache after the server confirmed it (304)
+        Revalidated,
+        // Fetched from the server
+        Miss
+    };
+
+    struct EXPRESS_CLIENT_EXPORT CacheStats {
+        std::size_t hits {0};
+        std::size_t stale_hits {0};
+        std::size_t revalidations {0};
+        std::size_t misses {0};
+
+        std::size_t entries {0};
+        std::size_t bytes {0};
+        std::size_t evictions {0};
+    };
+
+    struct EXPRESS_CLIENT_EXPORT CachedResponse {
+        Response response;
+
+        // When the request was sent and the response was received, which
+        // are used to calculate the age of the response
+        std::chrono::system_clock::time_point request_time {};
+        std::chrono::system_clock::time_point response_time {};
+
+        // The request's values of the headers listed in the response's Vary
+        // header, by lower case name. A request only matches the response if
+        // it has the same values.
+        std::vector<string_pair> vary {};
+    };
+
+    /*
+        Storage for the responses of an HTTP cache (RFC 9111). The client
+        decides what's stored and when it's fresh, the storage decides what
+        to evict. Implementations must be thread-safe.
+    */
+    class EXPRESS_CLIENT_EXPORT Cache {
+    public:
+        Cache() = default;
+
+        Cache(const Cache&) = delete;
+        auto operator=(const Cache&) -> Cache& = delete;
+
+        [[nodiscard]] virtual auto Find(std::string_view key) -> std::optional<CachedResponse> = 0;
+        virtual auto Store(std::string_view key, CachedResponse entry) -> void = 0;
+        virtual auto Remove(std::string_view key) -> void = 0;
+
+        // The counters of the outcomes, plus the usage of the storage
+        [[nodiscard]] virtual auto stats() const -> CacheStats;
+
+        // Called by the client for every request that goes through the cache
+        auto Record(CacheOutcome outcome) -> void;
+
+        // Called by the client to revalidate a stale response in the
+        // background at most once at a time. Returns false if the response
+        // is already being revalidated.
+        [[nodiscard]] virtual auto ClaimRevalidation(std::string_view key) -> bool;
+        virtual auto ReleaseRevalidation(std::string_view key) -> void;
+
+        // Called by the client before it fetches a response that's missing
+        // or stale. Returns false if another process is already fetching
+        // it, in which case the client waits for it to be stored. Caches
+        // that aren't shared between processes always return true.
+        [[nodiscard]] virtual auto ClaimFill(std::string_view key) -> bool;
+        virtual auto ReleaseFill(std::string_view key) -> void;
+
+        // Whether the cache serves its responses to more than one user, like
+        // a cache shared between processes. The client then follows the
+        // rules of a shared cache: responses marked private aren't stored,
+        // and s-maxage takes the place of max-age.
+        [[nodiscard]] virtual auto shared() const -> bool;
+
+        virtual ~Cache() = default;
+
+    private:
+        std::atomic<std::size_t> hits_ {0};
+        std::atomic<std::size_t> stale_hits_ {0};
+        std::atomic<std::size_t> revalidations_ {0};
+        std::atomic<std::size_t> misses_ {0};
+
+        std::mutex mutex_;
+        std::set<std::string, std::less<>> revalidating_;
+    };
+
+    /*
+        An in-memory cache bounded by the size of its responses. The least
+        recently used responses are evicted first.
+    */
+    class EXPRESS_CLIENT_EXPORT MemoryCache : public Cache {
+    public:
+        explicit MemoryCache(std::size_t max_bytes);
+
+        [[nodiscard]] auto Find(std::string_view key) -> std::optional<CachedResponse> override;
+        auto Store(std::string_view key, CachedResponse entry) -> void override;
+        auto Remove(std::string_view key) -> void override;
+
+        [[nodiscard]] auto stats() const -> CacheStats override;
+
+    private:
+        struct Entry {
+            std::string key;
+            CachedResponse value;
+            std::size_t size;
+        };
+
+        using Entries = std::list<Entry>;
+
+        std::size_t max_bytes_;
+
+        mutable std::mutex mutex_;
+        Entries entries_;
+        std::map<std::string, Entries::iterator, std::less<>> index_;
+        std::size_t bytes_ {0};
+        std::size_t evictions_ {0};
+
+        auto Erase(Entries::iterator iter) -> void;
+    };
+
+    struct EXPRESS_CLIENT_EXPORT DiskCacheOptions {
+        // The directory of the segment files, created if it doesn't exist
+        std::filesystem::path directory;
+
+        // The space the segment files take on the disk
+        std::size_t max_bytes {256 * 1024 * 1024};
+
+        // Responses are appended to the newest segment file, and the space
+        // is reclaimed a segment at a time
+        std::size_t segment_bytes {16 * 1024 * 1024};
+
+        // Larger responses aren't stored
+        std::size_t max_object_bytes {1024 * 1024};
+    };
+
+    /*
+        A cache that keeps responses in memory-mapped segment files, so that
+        they survive the process. Responses are appended to the newest
+        segment and read straight from the mapping. When the files reach
+        max_bytes, the oldest segment is compacted into the newest one if
+        most of it has been replaced, or its responses are evicted.
+
+        The index is rebuilt from the segments when the cache is opened, up
+        to the first record that was only partly written. A directory must
+        only be used by one cache at a time.
+    */
+    class EXPRESS_CLIENT_EXPORT DiskCache : public Cache {
+    public:
+        explicit DiskCache(DiskCacheOptions options);
+
+        [[nodiscard]] auto Find(std::string_view key) -> std::optional<CachedResponse> override;
+        auto Store(std::string_view key, CachedResponse entry) -> void override;
+        auto Remove(std::string_view key) -> void override;
+
+        [[nodiscard]] auto stats() const -> CacheStats override;
+
+        ~DiskCache() override;
+
+    private:
+        struct Segment;
+
+        struct Location {
+            std::uint32_t segment;
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+
+        DiskCacheOptions options_;
+
+        mutable std::shared_mutex mutex_;
+        std::map<std::uint32_t, std::unique_ptr<Segment>> segments_;
+        std::unordered_map<std::size_t, Location> index_;
+        std::size_t bytes_ {0};
+        std::size_t evictions_ {0};
+
+        auto Recover() -> void;
+        auto Scan(std::uint32_t sequence, Segment& segment) -> void;
+
+        auto Append(std::string_view key, std::string_view value) -> std::optional<Location>;
+        auto Roll(std::size_t reserve) -> std::error_code;
+        auto Reclaim(std::size_t reserve) -> void;
+
+        auto Index(std::string_view key, Location location) -> void;
+        auto Unindex(std::string_view key) -> bool;
+        [[nodiscard]] auto KeyAt(Location location) const -> std::string_view;
+    };
+
+    struct EXPRESS_CLIENT_EXPORT SharedCacheOptions {
+        // The name of the shared memory segment. Processes that use the same
+        // name and options share the cache.
+        std::string name;
+
+        // The size of the shared memory segment
+        std::size_t max_bytes {64 * 1024 * 1024};
+
+        // Every response takes a slot, so larger responses aren't stored
+        std::size_t slot_bytes {16 * 1024};
+
+        // How long other processes wait for the process that's fetching a
+        // missing response, before they fetch it themselves
+        std::chrono::milliseconds fill_timeout {5000};
+    };
+
+    /*
+        A cache in a shared memory segment, for processes on the same host
+        that fetch the same responses, like the workers of a prefork server.
+        Responses are kept in fixed-size slots, four to a set, and a full
+        set replaces its oldest response. Readers don't take locks: a slot
+        has a sequence number that's odd while it's written, and a read
+        that overlaps a write is retried.
+
+        Only one process fetches a response that's missing or stale, while
+        the others wait for it to be stored. The hit and miss counters are
+        per process, the usage of the segment is shared.
+    */
+    class EXPRESS_CLIENT_EXPORT SharedCache : public Cache {
+    public:
+        explicit SharedCache(SharedCacheOptions options);
+
+        [[nodiscard]] auto Find(std::string_view key) -> std::optional<CachedResponse> override;
+        auto Store(std::string_view key, CachedResponse entry) -> void override;
+        auto Remove(std::string_view key) -> void override;
+
+        [[nodiscard]] auto stats() const -> CacheStats override;
+
+        [[nodiscard]] auto ClaimRevalidation(std::string_view key) -> bool override;
+        auto ReleaseRevalidation(std::string_view key) -> void override;
+        [[nodiscard]] auto ClaimFill(std::string_view key) -> bool override;
+        auto ReleaseFill(std::string_view key) -> void override;
+
+        [[nodiscard]] auto shared() const -> bool override;
+
+        // Removes the segment's name once no process needs to open it.
+        // Processes that have it open keep using it.
+        static auto Unlink(std::string_view name) -> void;
+
+        ~SharedCache() override;
+
+    private:
+        SharedCacheOptions options_;
+        std::unique_ptr<SharedMemory> memory_;
+
+        std::uint64_t* header_ {nullptr};
+        std::uint64_t* leases_ {nullptr};
+        std::uint64_t* slots_ {nullptr};
+        std::size_t slot_words_ {0};
+        std::size_t slot_count_ {0};
+
+        [[nodiscard]] auto Slot(std::size_t index) const -> std::uint64_t*;
+        [[nodiscard]] auto Read(std::uint64_t* slot, std::uint64_t hash, std::string_view key) const
+            -> std::optional<std::string>;
+        auto Write(std::uint64_t* slot, std::uint64_t hash, std::string_view key, std::string_view value) -> bool;
+
+        [[nodiscard]] auto Claim(std::string_view key) -> bool;
+        auto Release(std::string_view key) -> void;
+    };
+}
@@ -3,15 +3,123 @@
 
 #pragma once
 
+#include <concepts>
 #include <future>
+#include <memory>
+#include <memory_resource>
+#include <span>
 
 #include "express_client_export.h"
+#include "express/batch.h"
 #include "express/config.h"
+#include "express/event_stream.h"
+#include "express/executor.h"
+#include "express/expected.h"
 #include "express/response.h"
+#include "express/scheduler.h"
+#include "express/task.h"
+#include "express/websocket.h"
+
+namespace Express::Net {
+    class EventLoop;
+}
 
 namespace Express {
+    class ArenaPool;
+    class CircuitBreakers;
+    class Coalescer;
+    class Hedger;
+    class Retrier;
+    class Scheduler;
+
     class EXPRESS_CLIENT_EXPORT Client {
     public:
+        Client();
+        explicit Client(std::pmr::memory_resource* resource);
+
+        // Requests run on the executor instead of the default thread pool,
+        // including the parsing and decoding of their responses
+        explicit Client(
+            std::shared_ptr<Executor> executor,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+        );
+
+        // Limits the number of requests that are processed at once, and the
+        // number of requests that can wait for their turn
+        explicit Client(const SchedulerOptions& scheduler);
+        Client(
+            std::shared_ptr<Executor> executor,
+            const SchedulerOptions& scheduler,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+        );
+
         auto Request(const Config& config) const -> std::future<Response>;
+        auto TryRequest(const Config& config) const -> std::future<Expected<Response>>;
+
+        // Invokes the callback with the result on the client's executor.
+        // The callback is stored in a pooled coroutine frame rather than in
+        // a shared state, so completing a request doesn't allocate. The
+        // callback must not throw.
+        template <class Callback>
+        requires std::invocable<Callback&, Expected<Response>>
+        auto Request(const Config& config, Callback&& callback) const -> void {
+            Detail::Complete(TryRequestAsync(config), std::forward<Callback>(callback));
+        }
+
+        // Coroutine API. The request starts when the task is awaited, and the
+        // awaiting coroutine is resumed on the client's executor.
+        auto RequestAsync(Config config) const -> Task<Response>;
+        auto TryRequestAsync(Config config) const -> Task<Expected<Response>>;
+
+        // Processes the requests concurrently, with up to max_connections_per_host
+        // connections to each host. Connections are kept alive and reused by
+        // the batch's requests. Failures are reported per request, in order.
+        auto RequestBatch(
+            std::span<const Config> configs,
+            const BatchOptions& options = {}
+        ) const -> std::future<BatchResult>;
+
+        auto RequestBatchAsync(
+            std::span<const Config> configs,
+            BatchOptions options = {}
+        ) const -> Task<BatchResult>;
+
+        // Receives a Server-Sent Events stream, and calls options.on_event
+        // for every event as it arrives. The stream reconnects whenever the
+        // connection ends, and resumes with Last-Event-ID. It ends once a
+        // stop is requested through the config's stop token, or the server
+        // answers with anything but an event stream (e.g. 204 No Content).
+        auto Subscribe(
+            const Config& config,
+            EventStreamOptions options
+        ) const -> std::future<Expected<EventStreamResult>>;
+
+        auto SubscribeAsync(
+            Config config,
+            EventStreamOptions options
+        ) const -> Task<Expected<EventStreamResult>>;
+
+        // Opens a WebSocket connection to a ws, wss, http or https URL, with
+        // the config's headers, auth and timeouts. The connection isn't
+        // tied to the client, and stays open until it's destroyed.
+        auto ConnectWebSocket(
+            const Config& config,
+            WebSocketOptions options = {}
+        ) const -> std::future<Expected<std::unique_ptr<WebSocket>>>;
+
+        auto ConnectWebSocketAsync(
+            Config config,
+            WebSocketOptions options = {}
+        ) const -> Task<Expected<std::unique_ptr<WebSocket>>>;
+
+    private:
+        std::shared_ptr<Executor> executor_;
+        std::shared_ptr<ArenaPool> arenas_;
+        std::shared_ptr<Net::EventLoop> loop_;
+        std::shared_ptr<Scheduler> scheduler_;
+        std::shared_ptr<CircuitBreakers> breakers_;
+        std::shared_ptr<Coalescer> coalescer_;
+        std::shared_ptr<Hedger> hedger_;
+        std::shared_ptr<Retrier> retrier_;
     };
-}
\ No newline at end of file
+}
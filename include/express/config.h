@@ -4,7 +4,13 @@
 #pragma once
 
 #include <string_view>
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stop_token>
 
 #include "express_client_export.h"
 
@@ -13,6 +19,182 @@
 #include "express/user_auth.h"
 
 namespace Express {
+    class Cache;
+    class Dictionaries;
+    class Proxy;
+    class Upstream;
+
+    // Requests with a higher priority are processed first when the client is busy
+    enum class EXPRESS_CLIENT_EXPORT Priority {
+        Interactive,
+        Normal,
+        Background
+    };
+
+    /*
+        Budgets for the phases of a request. Every budget starts when its
+        phase starts, and a budget of zero disables it. Config::timeout
+        still caps the request as a whole.
+    */
+    struct EXPRESS_CLIENT_EXPORT Timeouts {
+        // Resolving the host name, which can't be interrupted. A resolution
+        // that takes longer fails the request once it returns.
+        std::chrono::milliseconds resolve {0};
+
+        // Establishing the connection
+        std::chrono::milliseconds connect {0};
+
+        // From sending the request until the first byte of the response
+        std::chrono::milliseconds first_byte {0};
+
+        // Between two reads of the response
+        std::chrono::milliseconds idle {0};
+
+        // Fails a response that arrives slower than min_bytes_per_second over
+        // a window of min_speed_window, which guards against servers that
+        // trickle data just often enough to avoid the idle timeout
+        std::size_t min_bytes_per_second {0};
+        std::chrono::milliseconds min_speed_window {std::chrono::seconds {5}};
+    };
+
+    /*
+        Sends a second copy of a GET or HEAD request when the first copy
+        hasn't completed within a delay, and keeps whichever response
+        arrives first. The other copy is cancelled. Hedging is enabled
+        when either delay or percentile is set.
+    */
+    struct EXPRESS_CLIENT_EXPORT HedgePolicy {
+        // A fixed delay, or the delay to use until the host has enough
+        // samples when percentile is set
+        std::chrono::milliseconds delay {0};
+
+        // Tracks the delay as a percentile (e.g. 0.95) of the host's recent
+        // response times
+        double percentile {0.0};
+
+        // The share of hedged requests that may send a second copy, which
+        // caps the extra load on the servers
+        double budget {0.1};
+    };
+
+    inline constexpr std::array kRetryableStatusCodes {408, 429, 502, 503, 504};
+
+    /*
+        Retries failed requests with decorrelated jitter backoff. GET, HEAD,
+        OPTIONS, PUT and DELETE requests are retried after connection errors,
+        timeouts, incomplete responses, and retryable status codes. Other
+        methods are only retried when the connection couldn't be established,
+        since the server may have processed the request. Retries are disabled
+        when max_retries is zero.
+    */
+    struct EXPRESS_CLIENT_EXPORT RetryPolicy {
+        std::size_t max_retries {0};
+
+        // Every delay is picked at random between base_delay and three times
+        // the previous delay, up to max_delay. A Retry-After header longer
+        // than max_delay ends the retries.
+        std::chrono::milliseconds base_delay {100};
+        std::chrono::milliseconds max_delay {std::chrono::seconds {10}};
+
+        std::span<const int> status_codes {kRetryableStatusCodes};
+
+        // The share of requests the client may retry. Every request earns a
+        // share of a retry, and a retry spends a whole one.
+        double budget {0.1};
+    };
+
+    enum class EXPRESS_CLIENT_EXPORT BreakerState {
+        Closed,
+        Open,
+        HalfOpen
+    };
+
+    /*
+        Stops sending requests to a host that keeps failing. The host's
+        breaker opens when the share of failed or slow requests within the
+        window reaches failure_rate, and requests then fail immediately
+        with ErrorCode::kCircuitOpen. After open_duration the breaker lets
+        a few probe requests through (half-open); it closes once they all
+        succeed, and opens again when one fails. Failures are errors other
+        than cancellations, and 5xx responses. The breaker is enabled when
+        failure_rate is set.
+    */
+    struct EXPRESS_CLIENT_EXPORT BreakerPolicy {
+        double failure_rate {0.0};
+
+        // Requests that take longer count as failures. Zero disables it.
+        std::chrono::milliseconds slow_request {0};
+
+        // The breaker doesn't open until the window holds this many requests
+        std::size_t min_requests {20};
+        std::chrono::milliseconds window {std::chrono::seconds {10}};
+
+        std::chrono::milliseconds open_duration {std::chrono::seconds {5}};
+        std::size_t probes {1};
+
+        // Called with the host (host:port) whenever its breaker changes
+        // state, on the thread that caused the change. It must not throw.
+        std::function<void(std::string_view host, BreakerState from, BreakerState to)> on_state_change {};
+    };
+
+    /*
+        Shares a single request between concurrent identical GET and HEAD
+        requests, e.g. when many threads miss the same cache entry at
+        once. Requests are identical when they have the same method, URL,
+        credentials, and values for the vary headers. The credentials are
+        the Cookie header and the Authorization header, including the one
+        made from auth. The shared request runs with the settings of the
+        request that started it, and is cancelled once every request
+        waiting for it has been cancelled.
+    */
+    struct EXPRESS_CLIENT_EXPORT CoalescePolicy {
+        bool enabled {false};
+
+        // Headers that distinguish otherwise identical requests, e.g.
+        // Accept or Accept-Language
+        std::span<const std::string_view> vary {};
+    };
+
+    enum class EXPRESS_CLIENT_EXPORT Compression {
+        None,
+        // Gzip and zstd are only available when the client was built with
+        // zlib and libzstd. Requests fail with
+        // ErrorCode::kUnsupportedCompression otherwise.
+        Gzip,
+        Zstd
+    };
+
+    /*
+        Compresses request bodies, and sets their Content-Encoding. The
+        server must accept the coding. Bodies that already have a
+        Content-Encoding or Content-Length header are sent as they are,
+        and so are bodies that compressing doesn't make smaller.
+    */
+    struct EXPRESS_CLIENT_EXPORT CompressionPolicy {
+        Compression algorithm {Compression::None};
+
+        // 1 (fastest) to 9 for gzip, and 1 to 22 for zstd. Zero uses the
+        // library's default.
+        int level {0};
+
+        // Smaller bodies aren't worth compressing
+        std::size_t min_bytes {1024};
+    };
+
+    /*
+        Asks the server to accept a large request body before it's sent,
+        with Expect: 100-continue. The body is sent once the server answers
+        with 100 Continue, or after the timeout, since some servers never
+        answer. A server that rejects the request (e.g. 401 or 413) answers
+        with its final response instead, and the body isn't sent at all.
+    */
+    struct EXPRESS_CLIENT_EXPORT ExpectContinuePolicy {
+        // Bodies of at least this size wait for the server. Zero disables it.
+        std::size_t min_bytes {0};
+
+        std::chrono::milliseconds timeout {std::chrono::seconds {1}};
+    };
+
     struct EXPRESS_CLIENT_EXPORT Config {
         std::string_view url;
         Method method {Method::Get};
@@ -20,5 +202,48 @@ namespace Express {
         std::string_view data;
         UserAuth auth {};
         std::chrono::milliseconds timeout {0};
+        Timeouts timeouts {};
+        Priority priority {Priority::Normal};
+        HedgePolicy hedge {};
+        RetryPolicy retry {};
+        BreakerPolicy breaker {};
+        CoalescePolicy coalesce {};
+        CompressionPolicy compress {};
+        ExpectContinuePolicy expect_continue {};
+
+        // Serves GET requests from the cache when its response is fresh,
+        // and stores cacheable responses in it
+        std::shared_ptr<Cache> cache {};
+
+        // Asks for compressed responses with Accept-Encoding, and decodes
+        // them as they're received. The Content-Encoding and Content-Length
+        // headers are removed from decoded responses.
+        bool decompress {true};
+
+        // A decoded body that grows larger, e.g. from a few KB of gzip that
+        // expand to gigabytes, fails the request with
+        // ErrorCode::kDecodedBodyTooLarge. The events of a stream count
+        // only until they're delivered.
+        std::size_t max_decoded_bytes {64 * 1024 * 1024};
+
+        // Dictionaries for responses that were compressed against one
+        std::shared_ptr<const Dictionaries> dictionaries {};
+
+        // Sends the request to a member of the group instead of the host of
+        // the URL, which is still used for the Host header
+        std::shared_ptr<Upstream> upstream {};
+
+        // The key a hashing upstream routes the request on, so that the
+        // requests with the same key go to the same member. The upstream
+        // hashes a part of the URL when it's empty.
+        std::string_view routing_key {};
+
+        // Sends the request through the proxy, unless its host is on the
+        // proxy's no-proxy list or the request has an upstream
+        std::shared_ptr<Proxy> proxy {};
+
+        // Requesting a stop cancels the request, which then fails with
+        // std::errc::operation_canceled
+        std::stop_token stop_token {};
     };
 }
\ No newline at end of file
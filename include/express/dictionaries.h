@@ -0,0 +1,51 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+
+#include "express_client_export.h"
+
+namespace Express {
+    namespace Http {
+        struct Dictionary;
+    }
+
+    /*
+        Dictionaries shared with a server that compresses small, similar
+        responses against them with zstd or brotli. A response names its
+        dictionary with a Dictionary-ID header. Dictionaries are prepared
+        when they're added, so decoding a response doesn't load them
+        again. The registry is safe to use from multiple threads, and can
+        be shared between requests and clients.
+    */
+    class EXPRESS_CLIENT_EXPORT Dictionaries {
+    public:
+        Dictionaries();
+
+        Dictionaries(const Dictionaries&) = delete;
+        auto operator=(const Dictionaries&) -> Dictionaries& = delete;
+
+        // Adds the dictionary, or replaces the one with the same ID.
+        // Responses that are being decoded keep the one they started with.
+        auto Add(std::string id, std::string data) -> void;
+
+        auto Remove(std::string_view id) -> void;
+
+        [[nodiscard]] auto Find(std::string_view id) const -> std::shared_ptr<const Http::Dictionary>;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+
+        ~Dictionaries();
+
+    private:
+        mutable std::shared_mutex mutex_;
+        std::map<std::string, std::shared_ptr<const Http::Dictionary>, std::less<>> dictionaries_;
+    };
+}
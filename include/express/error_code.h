@@ -0,0 +1,93 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <system_error>
+#include <type_traits>
+
+#include "express_client_export.h"
+
+namespace Express {
+    /*
+        Structured error codes reported by the exception-free API. Every code
+        maps to the exception (and message) thrown by the throwing API.
+    */
+    enum class ErrorCode {
+        // Request errors (Express::RequestError)
+        kMissingUrlScheme = 1,
+        kUnsupportedUrlScheme,
+        kInvalidHeaderName,
+        kInvalidHeaderValue,
+        kDataNotAllowed,
+        kUnsupportedCompression,
+
+        // Timeout errors (Express::ResponseError)
+        kResolveTimeout,
+        kConnectTimeout,
+        kSendTimeout,
+        kFirstByteTimeout,
+        kRecvTimeout,
+        kIdleTimeout,
+        kTransferTooSlow,
+        kQueueTimeout,
+
+        // Response errors (Express::ResponseError)
+        kMalformedStatusLine,
+        kUnsupportedVersion,
+        kInvalidStatusCode,
+        kInvalidReasonPhrase,
+        kInvalidHeader,
+        kConflictingContentLength,
+        kUnsupportedTransferEncoding,
+        kInvalidContentLength,
+        kMissingChunkDelimiter,
+        kInvalidChunkSize,
+        kIncompleteResponse,
+        kInvalidContentEncoding,
+        kDecodedBodyTooLarge,
+
+        // Load shedding errors (Express::ResponseError)
+        kQueueFull,
+        kCircuitOpen,
+
+        // Proxy errors (Express::ResponseError)
+        kTunnelRefused,
+
+        // Event stream errors (Express::ResponseError)
+        kNotEventStream,
+        kEventTooLarge,
+
+        // WebSocket errors (Express::ResponseError)
+        kHandshakeFailed,
+        kWebSocketProtocolError,
+        kMessageTooLarge,
+        kWebSocketClosed,
+
+        // System errors (std::system_error)
+        kResolveFailed,
+    };
+
+    /*
+        Error conditions for matching groups of error codes, e.g.
+        error == Express::ErrorCondition::kTimeoutError.
+    */
+    enum class ErrorCondition {
+        kRequestError = 1,
+        kResponseError,
+        kTimeoutError,
+        kSystemError,
+    };
+
+    EXPRESS_CLIENT_EXPORT auto ErrorCategory() noexcept -> const std::error_category&;
+    EXPRESS_CLIENT_EXPORT auto ErrorConditionCategory() noexcept -> const std::error_category&;
+
+    EXPRESS_CLIENT_EXPORT auto make_error_code(ErrorCode code) noexcept -> std::error_code;
+    EXPRESS_CLIENT_EXPORT auto make_error_condition(ErrorCondition condition) noexcept -> std::error_condition;
+}
+
+template <>
+struct std::is_error_code_enum<Express::ErrorCode> : std::true_type {};
+
+template <>
+struct std::is_error_condition_enum<Express::ErrorCondition> : std::true_type {};
@@ -0,0 +1,62 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "express_client_export.h"
+
+#include "express/response.h"
+
+namespace Express {
+    // An event of a Server-Sent Events stream. The views are only valid
+    // while the callback runs.
+    struct EXPRESS_CLIENT_EXPORT Event {
+        // "message", unless the event names its type
+        std::string_view type;
+        std::string_view data;
+
+        // The last event ID the stream received, which later events keep
+        // until one sets another
+        std::string_view id;
+    };
+
+    struct EXPRESS_CLIENT_EXPORT EventStreamOptions {
+        // Called for every event, in order, on the client's executor. It
+        // must not block or throw.
+        std::function<void(const Event&)> on_event {};
+
+        // The delay before reconnecting, until the server sets another one
+        std::chrono::milliseconds retry {std::chrono::seconds {3}};
+
+        // The connections in a row that may end without an event before the
+        // stream fails
+        std::size_t max_reconnects {10};
+
+        // An event (or line) that's larger fails the stream with
+        // ErrorCode::kEventTooLarge, so memory stays bounded however long
+        // the stream is open
+        std::size_t max_event_size {1024 * 1024};
+
+        // Sent as Last-Event-ID by the first connection, to resume a stream.
+        // When it's empty, the request's own Last-Event-ID header is sent. An
+        // ID that isn't a valid header value fails the stream with
+        // ErrorCode::kInvalidHeaderValue.
+        std::string last_event_id {};
+    };
+
+    struct EXPRESS_CLIENT_EXPORT EventStreamResult {
+        // The last response. Its data is empty for an event stream, and is
+        // the body of any other response.
+        Response response;
+
+        std::size_t events {0};
+        std::size_t connections {0};
+        std::string last_event_id;
+    };
+}
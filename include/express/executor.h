@@ -0,0 +1,80 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <coroutine>
+
+namespace Express {
+    /*
+        A unit of work submitted to an executor. Work items are intrusive so
+        that submitting them doesn't allocate. The submitter keeps the item
+        alive until it runs, and an executor must run every item it accepts
+        exactly once.
+    */
+    class Work {
+    public:
+        explicit Work(void (*run)(Work* work)) : run_(run) {}
+
+        auto Run() { run_(this); }
+
+        // Reserved for the executor that holds the item, e.g. for intrusive queues
+        Work* next {nullptr};
+
+    private:
+        void (*run_)(Work* work);
+    };
+
+    /*
+        Runs the library's request work. Implement this interface to run
+        requests on an existing thread pool, for example:
+
+            auto Execute(Express::Work* work) -> void override {
+                pool.post([work] { work->Run(); });
+            }
+    */
+    class Executor {
+    public:
+        virtual auto Execute(Work* work) -> void = 0;
+
+        virtual ~Executor() = default;
+    };
+
+    /*
+        Runs work immediately on the thread that submits it.
+    */
+    class InlineExecutor : public Executor {
+    public:
+        auto Execute(Work* work) -> void override { work->Run(); }
+    };
+
+    /*
+        An awaitable that resumes the awaiting coroutine on an executor.
+    */
+    class ScheduleAwaiter : public Work {
+    public:
+        explicit ScheduleAwaiter(Executor& executor)
+          : Work(&ScheduleAwaiter::Resume), executor_(executor) {}
+
+        auto await_ready() const noexcept { return false; }
+
+        auto await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            executor_.Execute(this);
+        }
+
+        auto await_resume() const noexcept {}
+
+    private:
+        Executor& executor_;
+        std::coroutine_handle<> handle_;
+
+        static auto Resume(Work* work) -> void {
+            static_cast<ScheduleAwaiter*>(work)->handle_.resume();
+        }
+    };
+
+    [[nodiscard]] inline auto Schedule(Executor& executor) {
+        return ScheduleAwaiter {executor};
+    }
+}
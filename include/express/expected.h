@@ -0,0 +1,72 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <system_error>
+#include <utility>
+#include <variant>
+
+#include "express/error_code.h"
+
+namespace Express {
+    /*
+        A minimal stand-in for std::expected<T, std::error_code>. It's used
+        whatever the standard library provides, so that the library and its
+        users agree on the type whichever standard they're built with.
+        value() throws std::system_error in place of std::bad_expected_access.
+    */
+    class Unexpected {
+    public:
+        explicit Unexpected(std::error_code error) noexcept : error_(error) {}
+
+        [[nodiscard]] auto error() const noexcept { return error_; }
+
+    private:
+        std::error_code error_;
+    };
+
+    template <class T>
+    class Expected {
+    public:
+        using value_type = T;
+        using error_type = std::error_code;
+
+        Expected(const T& value) : storage_(std::in_place_index<0>, value) {}
+        Expected(T&& value) : storage_(std::in_place_index<0>, std::move(value)) {}
+        Expected(const Unexpected& error) : storage_(std::in_place_index<1>, error.error()) {}
+
+        [[nodiscard]] auto has_value() const noexcept { return storage_.index() == 0; }
+        explicit operator bool() const noexcept { return has_value(); }
+
+        [[nodiscard]] auto value() & -> T& { Check(); return std::get<0>(storage_); }
+        [[nodiscard]] auto value() const& -> const T& { Check(); return std::get<0>(storage_); }
+        [[nodiscard]] auto value() && -> T&& { Check(); return std::get<0>(std::move(storage_)); }
+
+        [[nodiscard]] auto error() const -> const std::error_code& { return std::get<1>(storage_); }
+
+        auto operator*() & -> T& { return std::get<0>(storage_); }
+        auto operator*() const& -> const T& { return std::get<0>(storage_); }
+        auto operator*() && -> T&& { return std::get<0>(std::move(storage_)); }
+
+        auto operator->() -> T* { return &std::get<0>(storage_); }
+        auto operator->() const -> const T* { return &std::get<0>(storage_); }
+
+        template <class U>
+        [[nodiscard]] auto value_or(U&& value) const& -> T {
+            return has_value() ? **this : static_cast<T>(std::forward<U>(value));
+        }
+
+        template <class U>
+        [[nodiscard]] auto value_or(U&& value) && -> T {
+            return has_value() ? std::move(**this) : static_cast<T>(std::forward<U>(value));
+        }
+
+    private:
+        std::variant<T, std::error_code> storage_;
+
+        auto Check() const -> void {
+            if (!has_value()) throw std::system_error {error()};
+        }
+    };
+}
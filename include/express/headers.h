@@ -23,6 +23,8 @@ namespace Express {
 
         [[nodiscard]] auto begin() { return headers_.begin(); }
         [[nodiscard]] auto end() { return headers_.end(); }
+        [[nodiscard]] auto begin() const { return headers_.cbegin(); }
+        [[nodiscard]] auto end() const { return headers_.cend(); }
 
     private:
         std::map<std::string, string_pair, std::less<>> headers_;
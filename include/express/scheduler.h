@@ -0,0 +1,20 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstddef>
+
+#include "express_client_export.h"
+
+namespace Express {
+    struct EXPRESS_CLIENT_EXPORT SchedulerOptions {
+        // The number of requests a client processes at once. Requests beyond
+        // this limit wait in the client's queue.
+        std::size_t max_active_requests {256};
+
+        // The number of requests that can wait in the queue. Requests beyond
+        // this limit fail immediately with ErrorCode::kQueueFull.
+        std::size_t max_queue_depth {1024};
+    };
+}
@@ -0,0 +1,262 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace Express {
+    template <class T>
+    class Task;
+
+    namespace Detail {
+        /*
+            Coroutine frames are recycled through a pool, so starting a task
+            doesn't allocate in steady state. The pool is never destroyed
+            because frames may still be released while the program exits.
+        */
+        inline auto FrameResource() -> std::pmr::memory_resource* {
+            static auto* resource = new std::pmr::synchronized_pool_resource {
+                std::pmr::pool_options {.largest_required_pool_block = 16 * 1024}
+            };
+            return resource;
+        }
+
+        struct PooledFrame {
+            static auto operator new(std::size_t size) -> void* {
+                return FrameResource()->allocate(size);
+            }
+
+            static auto operator delete(void* ptr, std::size_t size) -> void {
+                FrameResource()->deallocate(ptr, size);
+            }
+        };
+
+        struct TaskPromiseBase : PooledFrame {
+            std::coroutine_handle<> continuation {std::noop_coroutine()};
+
+            struct FinalAwaiter {
+                auto await_ready() const noexcept { return false; }
+
+                template <class Promise>
+                auto await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                    return handle.promise().continuation;
+                }
+
+                auto await_resume() const noexcept {}
+            };
+
+            auto initial_suspend() const noexcept { return std::suspend_always {}; }
+            auto final_suspend() const noexcept { return FinalAwaiter {}; }
+        };
+
+        template <class T>
+        struct TaskPromise : TaskPromiseBase {
+            std::variant<std::monostate, T, std::exception_ptr> result;
+
+            auto get_return_object() noexcept -> Task<T>;
+
+            auto return_value(T value) { result.template emplace<1>(std::move(value)); }
+            auto unhandled_exception() { result.template emplace<2>(std::current_exception()); }
+
+            auto Take() -> T {
+                if (result.index() == 2) std::rethrow_exception(std::get<2>(result));
+                return std::move(std::get<1>(result));
+            }
+        };
+
+        template <>
+        struct TaskPromise<void> : TaskPromiseBase {
+            std::exception_ptr exception;
+
+            auto get_return_object() noexcept -> Task<void>;
+
+            auto return_void() const noexcept {}
+            auto unhandled_exception() { exception = std::current_exception(); }
+
+            auto Take() const -> void {
+                if (exception) std::rethrow_exception(exception);
+            }
+        };
+
+        /*
+            A coroutine that starts eagerly and destroys itself on completion.
+        */
+        struct DetachedTask {
+            struct promise_type : PooledFrame {
+                auto get_return_object() const noexcept { return DetachedTask {}; }
+                auto initial_suspend() const noexcept { return std::suspend_never {}; }
+                auto final_suspend() const noexcept { return std::suspend_never {}; }
+                auto return_void() const noexcept {}
+                auto unhandled_exception() const noexcept { std::terminate(); }
+            };
+        };
+    }
+
+    /*
+        A lazily started coroutine that produces a value of type T. The task
+        starts when it's awaited, and resumes the awaiting coroutine on the
+        thread that completes it.
+    */
+    template <class T>
+    class [[nodiscard]] Task {
+    public:
+        using promise_type = Detail::TaskPromise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        explicit Task(handle_type handle) noexcept : handle_(handle) {}
+
+        Task(Task&& src) noexcept : handle_(std::exchange(src.handle_, nullptr)) {}
+        auto operator=(Task&& rhs) noexcept -> Task& {
+            if (this != &rhs) {
+                if (handle_) handle_.destroy();
+                handle_ = std::exchange(rhs.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        auto operator=(const Task&) -> Task& = delete;
+
+        auto operator co_await() && noexcept {
+            struct Awaiter {
+                handle_type handle;
+
+                auto await_ready() const noexcept { return !handle || handle.done(); }
+
+                auto await_suspend(std::coroutine_handle<> continuation) noexcept {
+                    handle.promise().continuation = continuation;
+                    return handle;
+                }
+
+                auto await_resume() -> T { return handle.promise().Take(); }
+            };
+            return Awaiter {handle_};
+        }
+
+        ~Task() {
+            if (handle_) handle_.destroy();
+        }
+
+    private:
+        handle_type handle_;
+    };
+
+    namespace Detail {
+        template <class T>
+        auto TaskPromise<T>::get_return_object() noexcept -> Task<T> {
+            return Task<T> {std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+        }
+
+        inline auto TaskPromise<void>::get_return_object() noexcept -> Task<void> {
+            return Task<void> {std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+        }
+
+        // Starts the task and fulfils the promise with its result
+        template <class T>
+        auto Fulfil(Task<T> task, std::promise<T> promise) -> DetachedTask {
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    co_await std::move(task);
+                    promise.set_value();
+                } else {
+                    promise.set_value(co_await std::move(task));
+                }
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+        }
+
+        // Starts the task and invokes the callback with its result
+        template <class T, class Callback>
+        auto Complete(Task<T> task, Callback callback) -> DetachedTask {
+            callback(co_await std::move(task));
+        }
+
+        template <class T>
+        struct WhenAllState {
+            std::vector<std::optional<T>> results;
+            std::exception_ptr exception;
+            std::atomic<bool> failed {false};
+            std::atomic<std::size_t> pending;
+            std::coroutine_handle<> continuation;
+
+            explicit WhenAllState(std::size_t size) : results(size), pending(size + 1) {}
+
+            auto Arrive() {
+                if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    continuation.resume();
+                }
+            }
+        };
+
+        template <class T>
+        auto WhenAllImpl(Task<T> task, WhenAllState<T>& state, std::size_t index) -> DetachedTask {
+            try {
+                state.results[index].emplace(co_await std::move(task));
+            } catch (...) {
+                if (!state.failed.exchange(true)) {
+                    state.exception = std::current_exception();
+                }
+            }
+            state.Arrive();
+        }
+    }
+
+    /*
+        Blocks the calling thread until the task completes, and returns its
+        result. Use it to wait for a task from code that isn't a coroutine.
+    */
+    template <class T>
+    auto SyncWait(Task<T> task) -> T {
+        std::promise<T> promise;
+        auto future = promise.get_future();
+        Detail::Fulfil(std::move(task), std::move(promise));
+        return future.get();
+    }
+
+    /*
+        Starts every task concurrently and completes when all of them have
+        completed. Results are returned in the order of the input tasks. If a
+        task throws, one of the exceptions is rethrown once all tasks are done.
+    */
+    template <class T>
+    auto WhenAll(std::vector<Task<T>> tasks) -> Task<std::vector<T>> {
+        Detail::WhenAllState<T> state {tasks.size()};
+
+        struct Awaiter {
+            std::vector<Task<T>>& tasks;
+            Detail::WhenAllState<T>& state;
+
+            auto await_ready() const noexcept { return false; }
+
+            auto await_suspend(std::coroutine_handle<> continuation) {
+                state.continuation = continuation;
+                for (std::size_t i = 0; i < tasks.size(); ++i) {
+                    Detail::WhenAllImpl(std::move(tasks[i]), state, i);
+                }
+                return state.pending.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+
+            auto await_resume() const noexcept {}
+        };
+
+        co_await Awaiter {tasks, state};
+
+        if (state.exception) std::rethrow_exception(state.exception);
+
+        std::vector<T> output;
+        output.reserve(state.results.size());
+        for (auto& result : state.results) output.emplace_back(std::move(*result));
+        co_return output;
+    }
+}
@@ -0,0 +1,54 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "express_client_export.h"
+#include "express/executor.h"
+
+namespace Express {
+    /*
+        A fixed-size pool of worker threads. Every worker owns a bounded
+        queue; idle workers steal from the front of other workers' queues.
+        When all queues are full, Execute blocks the calling thread until
+        there's room (back-pressure). Work submitted from a worker whose
+        queue is full runs inline, so nested submissions can't deadlock.
+        Queued work is drained before the workers exit.
+    */
+    class EXPRESS_CLIENT_EXPORT ThreadPool : public Executor {
+    public:
+        static constexpr std::size_t kDefaultCapacity = 1024;
+
+        explicit ThreadPool(
+            std::size_t threads = std::thread::hardware_concurrency(),
+            std::size_t capacity = kDefaultCapacity
+        );
+
+        ThreadPool(const ThreadPool&) = delete;
+        auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+        auto Execute(Work* work) -> void override;
+
+        [[nodiscard]] auto size() const { return workers_.size(); }
+
+        // A process-wide pool that's shared by clients that don't specify an executor
+        [[nodiscard]] static auto Default() -> std::shared_ptr<ThreadPool>;
+
+        ~ThreadPool() override;
+
+    private:
+        struct State;
+
+        // Workers share ownership of the state, so the pool can be destroyed
+        // by work that runs on one of its own workers.
+        std::shared_ptr<State> state_;
+        std::vector<std::thread> workers_;
+
+        static auto Run(std::shared_ptr<State> state, std::size_t index) -> void;
+    };
+}
@@ -0,0 +1,178 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "express_client_export.h"
+
+#include "express/expected.h"
+#include "express/response.h"
+
+namespace Express {
+    namespace Net {
+        class Endpoint;
+    }
+
+    enum class EXPRESS_CLIENT_EXPORT Balancing {
+        // Takes the members in turn
+        RoundRobin,
+
+        // Takes the member with the fewest requests in flight
+        LeastRequests,
+
+        // Takes the cheaper of two members picked at random, where a
+        // member's cost is its peak-EWMA latency times its requests in
+        // flight (power of two choices)
+        PeakEwma,
+
+        // Sends the requests with the same key to the same member, with a
+        // consistent hash ring of virtual_nodes points per member
+        RingHash,
+
+        // Like RingHash, with a Maglev lookup table of table_size entries.
+        // Lookups are faster and the keys are spread more evenly, but a
+        // change of members moves a few more keys.
+        Maglev
+    };
+
+    // The part of the URL that hashing policies route on, when the request has no routing key
+    enum class EXPRESS_CLIENT_EXPORT HashKey {
+        Url,
+        Path,
+        Host
+    };
+
+    /*
+        Passive outlier detection. A member that fails consecutive_failures
+        requests in a row is ejected from the group, and gets no requests
+        until its ejection ends. Every ejection in a row lasts longer, up to
+        max_ejection. Failures are errors other than cancellations, 5xx
+        responses, and requests slower than slow_request. Detection is
+        disabled when consecutive_failures is zero.
+    */
+    struct EXPRESS_CLIENT_EXPORT OutlierPolicy {
+        std::size_t consecutive_failures {5};
+
+        // Requests that take longer count as failures. Zero disables it.
+        std::chrono::milliseconds slow_request {0};
+
+        std::chrono::milliseconds ejection {std::chrono::seconds {30}};
+        std::chrono::milliseconds max_ejection {std::chrono::minutes {5}};
+
+        // The share of members that may be ejected at once. At least one
+        // member always stays in the group.
+        double max_ejected {0.5};
+    };
+
+    struct EXPRESS_CLIENT_EXPORT UpstreamOptions {
+        Balancing balancing {Balancing::RoundRobin};
+        OutlierPolicy outliers {};
+
+        // How quickly the peak-EWMA latency forgets older responses
+        std::chrono::milliseconds decay {std::chrono::seconds {10}};
+
+        HashKey hash_key {HashKey::Path};
+        std::size_t virtual_nodes {160};
+
+        // Rounded up to a prime, and kept well above the number of members
+        std::size_t table_size {65537};
+    };
+
+    struct EXPRESS_CLIENT_EXPORT UpstreamMember {
+        // The numeric address of the member, e.g. 10.0.0.1:8080
+        std::string address;
+
+        std::size_t outstanding {0};
+        std::chrono::nanoseconds latency {0};
+        bool ejected {false};
+    };
+
+    /*
+        A group of servers that serve the same requests. A request whose
+        Config::upstream is set is sent to a member the group picks,
+        rather than to the host of its URL, which is still used for the
+        Host header. The group is safe to use from multiple threads, and
+        can be shared between requests and clients.
+    */
+    class EXPRESS_CLIENT_EXPORT Upstream {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Resolves the addresses (host:port) into the group's members. A
+        // host that resolves to several addresses adds all of them.
+        explicit Upstream(std::span<const std::string_view> addresses, UpstreamOptions options = {});
+        Upstream(std::span<const std::string_view> addresses, UpstreamOptions options, std::error_code& ec);
+
+        Upstream(const Upstream&) = delete;
+        auto operator=(const Upstream&) -> Upstream& = delete;
+
+        // Picks the member for a request, and counts the request as in
+        // flight until its outcome is recorded. Hashing policies route on
+        // the key, and skip the members that are ejected.
+        [[nodiscard]] auto Pick(Clock::time_point now = Clock::now()) -> std::size_t;
+        [[nodiscard]] auto Pick(std::string_view key, Clock::time_point now = Clock::now()) -> std::size_t;
+
+        // Counts another request to the member, unless it's ejected
+        [[nodiscard]] auto Reuse(std::size_t member, Clock::time_point now = Clock::now()) -> bool;
+
+        // Every picked or reused request must record its outcome
+        auto Record(
+            std::size_t member,
+            const Expected<Response>& result,
+            std::chrono::nanoseconds latency,
+            Clock::time_point now = Clock::now()
+        ) -> void;
+
+        [[nodiscard]] auto endpoint(std::size_t member) const -> const Net::Endpoint&;
+        [[nodiscard]] auto members(Clock::time_point now = Clock::now()) const -> std::vector<UpstreamMember>;
+        [[nodiscard]] auto size() const -> std::size_t;
+        [[nodiscard]] auto options() const -> const UpstreamOptions& { return options_; }
+
+        // Whether requests are routed on their key
+        [[nodiscard]] auto hashed() const -> bool {
+            return options_.balancing == Balancing::RingHash || options_.balancing == Balancing::Maglev;
+        }
+
+        ~Upstream();
+
+    private:
+        struct Member;
+
+        UpstreamOptions options_;
+        std::vector<std::unique_ptr<Member>> members_;
+
+        mutable std::mutex mutex_;
+        std::size_t next_ {0};
+
+        // The members that aren't ejected are counted again when one is
+        // ejected, or once the next ejection ends
+        std::size_t available_ {0};
+        Clock::time_point refresh_ {Clock::time_point::min()};
+
+        // The members the hash ring or lookup table was built with. It's
+        // built again when a member is ejected or returns.
+        std::vector<bool> routed_;
+        std::vector<std::pair<std::uint64_t, std::size_t>> ring_;
+        std::vector<std::size_t> lookup_;
+
+        auto Add(std::string_view address) -> std::error_code;
+        auto Refresh(Clock::time_point now) -> void;
+        auto Route(std::uint64_t hash) const -> std::size_t;
+        auto BuildRing() -> void;
+        auto BuildTable() -> void;
+        auto Cost(const Member& member, Clock::time_point now) const -> double;
+        auto Eject(Member& member, Clock::time_point now) -> void;
+    };
+}
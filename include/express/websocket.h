@@ -0,0 +1,119 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "express_client_export.h"
+
+#include "express/executor.h"
+#include "express/expected.h"
+#include "express/response.h"
+#include "express/task.h"
+
+namespace Express {
+    namespace Ws {
+        class Connection;
+    }
+
+    enum class EXPRESS_CLIENT_EXPORT MessageType {
+        Text,
+        Binary,
+        // The server closed the connection
+        Close
+    };
+
+    struct EXPRESS_CLIENT_EXPORT WebSocketOptions {
+        // Subprotocols offered with Sec-WebSocket-Protocol, in order of
+        // preference. The server picks one of them, or none.
+        std::vector<std::string> protocols {};
+
+        // Offers permessage-deflate, which compresses the messages the
+        // server agrees to, in both directions. It isn't offered when the
+        // client was built without zlib.
+        bool deflate {false};
+
+        // Smaller messages are sent uncompressed, since compressing them
+        // costs more than it saves
+        std::size_t min_deflate_size {128};
+
+        // A receive that waits this long pings the server, and fails with
+        // ErrorCode::kIdleTimeout if nothing arrives within another
+        // interval. Zero disables it.
+        std::chrono::milliseconds ping_interval {std::chrono::seconds {30}};
+
+        // Messages are sent in frames of up to this size. Zero sends every
+        // message in a single frame.
+        std::size_t max_frame_size {0};
+
+        // A larger message, once reassembled and decompressed, fails the
+        // connection with ErrorCode::kMessageTooLarge
+        std::size_t max_message_size {16 * 1024 * 1024};
+    };
+
+    struct EXPRESS_CLIENT_EXPORT WebSocketMessage {
+        MessageType type {MessageType::Text};
+
+        // The payload, or the reason of a Close message. It's only valid
+        // until the next receive, which reuses its memory.
+        std::string_view data;
+
+        // The status code of a Close message, or 1005 if it had none
+        std::uint16_t close_code {0};
+    };
+
+    /*
+        A WebSocket (RFC 6455) connection, opened with
+        Client::ConnectWebSocket. Frames are read straight into a buffer the
+        connection keeps, and a message that arrives in a single frame is
+        returned where it is. A send may run at the same time as a receive,
+        and sends are queued behind each other, but only one receive may run
+        at a time. Pings are answered while a receive runs. Tasks resume the
+        awaiting coroutine on the client's executor.
+    */
+    class EXPRESS_CLIENT_EXPORT WebSocket {
+    public:
+        WebSocket(std::shared_ptr<Ws::Connection> connection, std::shared_ptr<Executor> executor);
+
+        WebSocket(const WebSocket&) = delete;
+        auto operator=(const WebSocket&) -> WebSocket& = delete;
+
+        // The data must stay valid until the send completes
+        auto Send(std::string_view data, MessageType type = MessageType::Text) -> std::future<std::error_code>;
+        auto Receive() -> std::future<Expected<WebSocketMessage>>;
+
+        // Sends a Close frame. Receive returns the server's Close message
+        // once it answers, and the server then closes the connection.
+        auto Close(std::uint16_t code = 1000, std::string_view reason = {}) -> std::future<std::error_code>;
+
+        auto SendAsync(std::string_view data, MessageType type = MessageType::Text) -> Task<std::error_code>;
+        auto ReceiveAsync() -> Task<Expected<WebSocketMessage>>;
+        auto PingAsync(std::string_view data = {}) -> Task<std::error_code>;
+        auto CloseAsync(std::uint16_t code = 1000, std::string_view reason = {}) -> Task<std::error_code>;
+
+        // The subprotocol the server picked, if any
+        [[nodiscard]] auto protocol() const -> std::string_view;
+
+        // Whether the server agreed to permessage-deflate
+        [[nodiscard]] auto compressed() const -> bool;
+
+        // The server's 101 Switching Protocols response
+        [[nodiscard]] auto response() const -> const Response&;
+
+        // Cancels the operations that are waiting for the socket
+        ~WebSocket();
+
+    private:
+        std::shared_ptr<Ws::Connection> connection_;
+        std::shared_ptr<Executor> executor_;
+    };
+}
@@ -0,0 +1,292 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <optional>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "express/error_code.h"
+#include "express/proxy.h"
+#include "express/upstream.h"
+
+#include "client/routing.h"
+#include "client/timeout.h"
+#include "client/transfer.h"
+#include "http/request_builder.h"
+#include "http/response_parser.h"
+#include "net/endpoint.h"
+#include "net/socket.h"
+#include "net/url.h"
+
+#if defined(_WIN32)
+    #include "net/winsock.h"
+#endif
+
+namespace Express {
+    namespace {
+        struct HostGroup {
+            std::optional<Net::Endpoint> endpoint;
+
+            // The requests of an upstream group go to its members instead
+            Upstream* upstream {nullptr};
+
+            // The requests of a proxy group go to the proxy, and those to an
+            // https host go through a tunnel to the destination
+            Proxy* proxy {nullptr};
+            std::string destination;
+
+            std::error_code resolve_error;
+            std::vector<std::size_t> requests;
+            std::atomic<std::size_t> next {0};
+        };
+
+        struct BatchState {
+            std::vector<Config> configs;
+            std::vector<std::optional<Expected<Response>>> results;
+            std::atomic<std::size_t> connections_opened {0};
+            std::atomic<std::size_t> connections_reused {0};
+            ArenaPool& arenas;
+            Net::EventLoop& loop;
+            Scheduler& scheduler;
+            Executor& executor;
+        };
+
+        /*
+            Sends a request over the lane's connection, and opens a new
+            connection if there's none. A reused connection may have been
+            closed by the server while it was idle. If it fails before any
+            part of the response arrives, the request is sent once more
+            over a new connection.
+        */
+        auto Exchange(
+            BatchState& state,
+            const HostGroup& group,
+            const Config& config,
+            const Net::Endpoint& endpoint,
+            std::unique_ptr<Net::Socket>& connection
+        ) -> Task<Expected<Response>> {
+            const auto arena = state.arenas.Acquire();
+            std::error_code ec;
+
+            const Limits limits {config};
+            const Http::RequestBuilder request {
+                config, arena.resource(), ec, Http::Connection::kKeepAlive
+            };
+            if (ec) co_return Unexpected {ec};
+
+            const auto slot = co_await state.scheduler.Admit(config.priority, limits.total, limits.stop);
+            if (!slot) co_return Unexpected {slot.error()};
+
+            auto* buffer = static_cast<unsigned char*>(arena.resource()->allocate(BUFSIZ));
+            const auto decoding = config.decompress ? Http::Decoding::kDecode : Http::Decoding::kRaw;
+
+            while (true) {
+                const auto reused = connection != nullptr;
+                if (!reused) {
+                    connection = std::make_unique<Net::Socket>(endpoint, ec);
+                    if (!ec) ec = co_await ConnectAsync(*connection, state.loop, limits);
+                    if (!ec && !group.destination.empty()) {
+                        ec = co_await OpenTunnelAsync(
+                            *connection,
+                            group.destination,
+                            group.proxy->authorization(),
+                            {buffer, BUFSIZ},
+                            arena.resource(),
+                            state.loop,
+                            limits
+                        );
+                    }
+                    if (ec) {
+                        connection.reset();
+                        co_return Unexpected {ec};
+                    }
+                    ++state.connections_opened;
+                } else {
+                    ++state.connections_reused;
+                }
+
+                Http::ResponseParser parser {
+                    arena.resource(), decoding, config.dictionaries.get(), config.max_decoded_bytes
+                };
+                std::size_t interim = 0;
+                std::size_t received = 0;
+
+                ec = co_await SendRequestAsync(
+                    *connection,
+                    request,
+                    parser,
+                    {buffer, BUFSIZ},
+                    state.loop,
+                    limits,
+                    config.expect_continue.timeout,
+                    interim
+                );
+
+                // A server that answered before the body was sent may still
+                // read the body as the next request, so the connection isn't reused
+                const auto withheld = parser.headers_complete();
+                if (!ec) {
+                    ec = co_await ReceiveAsync(
+                        *connection, parser, {buffer, BUFSIZ}, state.loop, state.executor, limits, received
+                    );
+                }
+                received += interim;
+
+                if (reused && received == 0 && !IsFinal(ec)) {
+                    connection.reset();
+                    continue;
+                }
+
+                if (ec || withheld || !parser.keep_alive()) connection.reset();
+                if (ec) co_return Unexpected {ec};
+
+                auto response = std::move(parser).response(ec);
+                if (ec) co_return Unexpected {ec};
+
+                co_return response;
+            }
+        }
+
+        // Processes the requests of a host, one at a time, over one connection
+        auto RunLane(BatchState& state, HostGroup& group) -> Task<bool> {
+            // A proxy group's lanes start with the connections the proxy
+            // kept, and hand theirs back once they're done
+            std::unique_ptr<Net::Socket> connection;
+            if (group.proxy) connection = group.proxy->Acquire(group.destination);
+            std::size_t member = 0;
+
+            for (auto i = group.next++; i < group.requests.size(); i = group.next++) {
+                const auto index = group.requests[i];
+                if (group.resolve_error) {
+                    state.results[index].emplace(Unexpected {group.resolve_error});
+                    continue;
+                }
+
+                if (!group.upstream) {
+                    state.results[index].emplace(
+                        co_await Exchange(state, group, state.configs[index], *group.endpoint, connection)
+                    );
+                    continue;
+                }
+
+                // The lane's connection stays with its member until the
+                // member is ejected, or a request is routed elsewhere
+                const auto& config = state.configs[index];
+                auto& upstream = *group.upstream;
+                if (upstream.hashed()) {
+                    const Net::Url url {config.url};
+                    const auto picked = upstream.Pick(RoutingKey(config, url));
+                    if (picked != member) connection.reset();
+                    member = picked;
+                } else if (!connection || !upstream.Reuse(member)) {
+                    connection.reset();
+                    member = upstream.Pick();
+                }
+
+                const auto start = Upstream::Clock::now();
+                auto result = co_await Exchange(state, group, config, upstream.endpoint(member), connection);
+                upstream.Record(member, result, Upstream::Clock::now() - start);
+                state.results[index].emplace(std::move(result));
+            }
+
+            if (group.proxy) group.proxy->Release(group.destination, std::move(connection));
+            co_return true;
+        }
+    }
+
+    auto PerformBatchAsync(
+        std::vector<Config> configs,
+        BatchOptions options,
+        std::shared_ptr<ArenaPool> arenas,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Scheduler> scheduler,
+        std::shared_ptr<Executor> executor
+    ) -> Task<BatchResult> {
+        #if defined(_WIN32)
+            Net::WinSock winsock;
+        #endif
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto size = configs.size();
+
+        BatchState state {
+            .configs = std::move(configs),
+            .results = std::vector<std::optional<Expected<Response>>>(size),
+            .arenas = *arenas,
+            .loop = *loop,
+            .scheduler = *scheduler,
+            .executor = *executor
+        };
+
+        // Every host is resolved once for the whole batch
+        std::map<std::string, HostGroup, std::less<>> groups;
+        for (std::size_t i = 0; i < size; ++i) {
+            std::error_code ec;
+            const Net::Url url {state.configs[i].url, std::pmr::get_default_resource(), ec};
+            if (ec) {
+                state.results[i].emplace(Unexpected {ec});
+                continue;
+            }
+
+            // The requests of an upstream group share their members'
+            // connections, and the requests through a proxy share the
+            // connections to the proxy, or their tunnels
+            const auto& upstream = state.configs[i].upstream;
+            auto* proxy = ProxyFor(state.configs[i], url);
+            auto key = std::string {url.scheme()};
+            if (upstream) {
+                key.append("://upstream/").append(std::to_string(reinterpret_cast<std::uintptr_t>(upstream.get())));
+            } else if (proxy) {
+                key.append("://proxy/").append(std::to_string(reinterpret_cast<std::uintptr_t>(proxy)));
+                if (url.scheme() == "https") key.append("/").append(url.host()).append(":").append(url.port());
+            } else {
+                key.append("://").append(url.host()).append(":").append(url.port());
+            }
+
+            auto [iter, inserted] = groups.try_emplace(std::move(key));
+            auto& group = iter->second;
+            if (inserted && upstream) {
+                group.upstream = upstream.get();
+            } else if (inserted && proxy) {
+                group.proxy = proxy;
+                group.endpoint.emplace(proxy->endpoint());
+                if (url.scheme() == "https") {
+                    group.destination.append(url.host()).append(":").append(url.port());
+                }
+            } else if (inserted) {
+                // The host is resolved within the limits of its first request
+                group.endpoint.emplace(
+                    Resolve(url.host(), url.port(), Limits {state.configs[i]}, group.resolve_error)
+                );
+            }
+            group.requests.push_back(i);
+        }
+
+        const auto lanes_per_host = std::max<std::size_t>(options.max_connections_per_host, 1);
+        std::vector<Task<bool>> lanes;
+        for (auto& [key, group] : groups) {
+            // Every member of an upstream group counts as a host
+            const auto hosts = group.upstream ? group.upstream->size() : 1;
+            const auto count = std::min(lanes_per_host * hosts, group.requests.size());
+            for (std::size_t i = 0; i < count; ++i) {
+                lanes.emplace_back(RunLane(state, group));
+            }
+        }
+        co_await WhenAll(std::move(lanes));
+
+        BatchResult output;
+        output.responses.reserve(size);
+        for (auto& result : state.results) output.responses.emplace_back(std::move(*result));
+        output.elapsed = std::chrono::steady_clock::now() - start;
+        output.connections_opened = state.connections_opened;
+        output.connections_reused = state.connections_reused;
+
+        co_return output;
+    }
+}
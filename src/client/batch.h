@@ -0,0 +1,34 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "express/batch.h"
+#include "express/config.h"
+#include "express/executor.h"
+#include "express/task.h"
+
+#include "client/scheduler.h"
+#include "net/event_loop.h"
+#include "utils/arena_pool.h"
+
+namespace Express {
+    /*
+        Processes a batch of requests. Requests are grouped by host, and
+        every host gets up to max_connections_per_host connections. Each
+        connection takes the next request of its host once the previous
+        response is read, so connections are reused within the batch.
+        Every request is admitted by the scheduler before it's sent.
+    */
+    [[nodiscard]] auto PerformBatchAsync(
+        std::vector<Config> configs,
+        BatchOptions options,
+        std::shared_ptr<ArenaPool> arenas,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Scheduler> scheduler,
+        std::shared_ptr<Executor> executor
+    ) -> Task<BatchResult>;
+}
@@ -0,0 +1,195 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/breaker.h"
+
+#include <algorithm>
+#include <memory_resource>
+#include <optional>
+#include <system_error>
+#include <utility>
+
+#include "express/error_code.h"
+#include "net/url.h"
+
+namespace Express {
+    namespace {
+        struct Transition {
+            BreakerState from;
+            BreakerState to;
+        };
+
+        auto Notify(
+            const BreakerPolicy& policy,
+            std::string_view host,
+            const std::optional<Transition>& transition
+        ) {
+            if (transition && policy.on_state_change) {
+                policy.on_state_change(host, transition->from, transition->to);
+            }
+        }
+
+        // The window is split into buckets, and every bucket covers a slot of time
+        auto Slot(const BreakerPolicy& policy, CircuitBreakers::Clock::time_point now) -> std::int64_t {
+            const auto width = std::max(
+                std::chrono::duration_cast<CircuitBreakers::Clock::duration>(policy.window) /
+                    static_cast<std::int64_t>(CircuitBreakers::kBuckets),
+                CircuitBreakers::Clock::duration {1}
+            );
+            return now.time_since_epoch() / width;
+        }
+    }
+
+    auto CircuitBreakers::Find(std::string_view host) -> Breaker& {
+        auto iter = hosts_.find(host);
+        if (iter == hosts_.end()) iter = hosts_.try_emplace(std::string {host}).first;
+        return iter->second;
+    }
+
+    auto CircuitBreakers::Admit(
+        const BreakerPolicy& policy,
+        std::string_view host,
+        Clock::time_point now
+    ) -> Admission {
+        std::optional<Transition> transition;
+        auto admission = Admission::kAllowed;
+        {
+            std::lock_guard lock {mutex_};
+            auto& breaker = Find(host);
+
+            if (breaker.state == BreakerState::Open && now - breaker.opened >= policy.open_duration) {
+                transition = {BreakerState::Open, BreakerState::HalfOpen};
+                breaker.state = BreakerState::HalfOpen;
+                breaker.probes = 0;
+                breaker.passed = 0;
+            }
+
+            if (breaker.state == BreakerState::Open) {
+                admission = Admission::kRejected;
+            } else if (breaker.state == BreakerState::HalfOpen) {
+                if (breaker.probes < std::max<std::size_t>(policy.probes, 1)) {
+                    ++breaker.probes;
+                    admission = Admission::kProbe;
+                } else {
+                    admission = Admission::kRejected;
+                }
+            }
+        }
+
+        Notify(policy, host, transition);
+        return admission;
+    }
+
+    auto CircuitBreakers::Record(
+        const BreakerPolicy& policy,
+        std::string_view host,
+        Admission admission,
+        Outcome outcome,
+        Clock::time_point now
+    ) -> void {
+        std::optional<Transition> transition;
+        {
+            std::lock_guard lock {mutex_};
+            auto& breaker = Find(host);
+
+            if (admission == Admission::kProbe) {
+                if (breaker.state != BreakerState::HalfOpen) return;
+
+                if (outcome == Outcome::kIgnored) {
+                    // Another request can take the probe's place
+                    --breaker.probes;
+                } else if (outcome == Outcome::kFailure) {
+                    transition = {BreakerState::HalfOpen, BreakerState::Open};
+                    breaker.state = BreakerState::Open;
+                    breaker.opened = now;
+                } else if (++breaker.passed >= std::max<std::size_t>(policy.probes, 1)) {
+                    transition = {BreakerState::HalfOpen, BreakerState::Closed};
+                    breaker = Breaker {};
+                }
+            } else if (breaker.state == BreakerState::Closed && outcome != Outcome::kIgnored) {
+                // Requests that were sent before the breaker opened are only
+                // counted if it has closed again
+                const auto slot = Slot(policy, now);
+                auto& bucket = breaker.buckets[static_cast<std::size_t>(slot) % kBuckets];
+                if (bucket.slot != slot) bucket = {slot, 0, 0};
+                ++bucket.requests;
+                if (outcome == Outcome::kFailure) ++bucket.failures;
+
+                std::size_t requests = 0;
+                std::size_t failures = 0;
+                for (const auto& counts : breaker.buckets) {
+                    if (counts.slot <= slot - static_cast<std::int64_t>(kBuckets)) continue;
+                    requests += counts.requests;
+                    failures += counts.failures;
+                }
+
+                const auto rate = static_cast<double>(failures) / static_cast<double>(requests);
+                if (requests >= policy.min_requests && rate >= policy.failure_rate) {
+                    transition = {BreakerState::Closed, BreakerState::Open};
+                    breaker.state = BreakerState::Open;
+                    breaker.opened = now;
+                }
+            }
+        }
+
+        Notify(policy, host, transition);
+    }
+
+    auto CircuitBreakers::state(std::string_view host) -> BreakerState {
+        std::lock_guard lock {mutex_};
+        const auto iter = hosts_.find(host);
+        return iter == hosts_.end() ? BreakerState::Closed : iter->second.state;
+    }
+
+    auto IsGuarded(const Config& config) -> bool {
+        return config.breaker.failure_rate > 0.0;
+    }
+
+    auto Classify(
+        const BreakerPolicy& policy,
+        const Expected<Response>& result,
+        std::chrono::nanoseconds elapsed
+    ) -> CircuitBreakers::Outcome {
+        using enum CircuitBreakers::Outcome;
+
+        if (!result) {
+            // Errors that say nothing about the host's health
+            const auto& ec = result.error();
+            if (ec == std::errc::operation_canceled || ec == ErrorCondition::kRequestError) return kIgnored;
+            if (ec == ErrorCode::kQueueFull || ec == ErrorCode::kQueueTimeout) return kIgnored;
+            return kFailure;
+        }
+
+        if (result->status_code >= 500) return kFailure;
+        if (policy.slow_request > std::chrono::milliseconds::zero() && elapsed > policy.slow_request) {
+            return kFailure;
+        }
+        return kSuccess;
+    }
+
+    auto GuardedAsync(
+        Config config,
+        std::shared_ptr<CircuitBreakers> breakers,
+        Task<Expected<Response>> attempt
+    ) -> Task<Expected<Response>> {
+        std::error_code ec;
+        const Net::Url url {config.url, std::pmr::get_default_resource(), ec};
+        if (ec) co_return Unexpected {ec};
+
+        auto host = std::string {url.host()};
+        host.append(":").append(url.port());
+
+        const auto& policy = config.breaker;
+        const auto admission = breakers->Admit(policy, host);
+        if (admission == CircuitBreakers::Admission::kRejected) {
+            co_return Unexpected {make_error_code(ErrorCode::kCircuitOpen)};
+        }
+
+        const auto start = CircuitBreakers::Clock::now();
+        auto result = co_await std::move(attempt);
+
+        const auto outcome = Classify(policy, result, CircuitBreakers::Clock::now() - start);
+        breakers->Record(policy, host, admission, outcome);
+        co_return result;
+    }
+}
@@ -0,0 +1,94 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "express/config.h"
+#include "express/expected.h"
+#include "express/response.h"
+#include "express/task.h"
+
+namespace Express {
+    /*
+        The circuit breakers of a client's hosts. A request asks for
+        admission before it's sent, and reports its outcome once it
+        completes. Failures are counted in a sliding window of buckets.
+    */
+    class CircuitBreakers {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr std::size_t kBuckets = 10;
+
+        enum class Admission {kRejected, kAllowed, kProbe};
+        enum class Outcome {kSuccess, kFailure, kIgnored};
+
+        [[nodiscard]] auto Admit(
+            const BreakerPolicy& policy,
+            std::string_view host,
+            Clock::time_point now = Clock::now()
+        ) -> Admission;
+
+        // Every admitted request must report its outcome
+        auto Record(
+            const BreakerPolicy& policy,
+            std::string_view host,
+            Admission admission,
+            Outcome outcome,
+            Clock::time_point now = Clock::now()
+        ) -> void;
+
+        [[nodiscard]] auto state(std::string_view host) -> BreakerState;
+
+    private:
+        struct Bucket {
+            std::int64_t slot {-1};
+            std::size_t requests {0};
+            std::size_t failures {0};
+        };
+
+        struct Breaker {
+            BreakerState state {BreakerState::Closed};
+            std::array<Bucket, kBuckets> buckets {};
+            Clock::time_point opened {};
+
+            // Probes sent and succeeded since the breaker became half-open
+            std::size_t probes {0};
+            std::size_t passed {0};
+        };
+
+        std::mutex mutex_;
+        std::map<std::string, Breaker, std::less<>> hosts_;
+
+        auto Find(std::string_view host) -> Breaker&;
+    };
+
+    // Whether the request goes through its host's breaker
+    [[nodiscard]] auto IsGuarded(const Config& config) -> bool;
+
+    // Whether the result counts as a failure of the host under the policy
+    [[nodiscard]] auto Classify(
+        const BreakerPolicy& policy,
+        const Expected<Response>& result,
+        std::chrono::nanoseconds elapsed
+    ) -> CircuitBreakers::Outcome;
+
+    /*
+        Runs the attempt if the host's breaker admits it, and fails with
+        ErrorCode::kCircuitOpen otherwise.
+    */
+    [[nodiscard]] auto GuardedAsync(
+        Config config,
+        std::shared_ptr<CircuitBreakers> breakers,
+        Task<Expected<Response>> attempt
+    ) -> Task<Expected<Response>>;
+}
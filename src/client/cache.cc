@@ -0,0 +1,112 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/cache.h"
+
+#include <utility>
+
+namespace Express {
+    namespace {
+        // An estimate of the memory the entry holds
+        auto SizeOf(std::string_view key, const CachedResponse& entry) {
+            auto size = sizeof(CachedResponse) + key.size() + entry.response.status_text.size() +
+                        entry.response.data.size();
+            for (const auto& [name, header] : entry.response.headers) {
+                size += name.size() + header.first.size() + header.second.size();
+            }
+            for (const auto& [name, value] : entry.vary) size += name.size() + value.size();
+            return size;
+        }
+    }
+
+    auto Cache::stats() const -> CacheStats {
+        return {
+            .hits = hits_.load(std::memory_order_relaxed),
+            .stale_hits = stale_hits_.load(std::memory_order_relaxed),
+            .revalidations = revalidations_.load(std::memory_order_relaxed),
+            .misses = misses_.load(std::memory_order_relaxed),
+        };
+    }
+
+    auto Cache::Record(CacheOutcome outcome) -> void {
+        switch (outcome) {
+            case CacheOutcome::Hit: ++hits_; break;
+            case CacheOutcome::StaleHit: ++stale_hits_; break;
+            case CacheOutcome::Revalidated: ++revalidations_; break;
+            case CacheOutcome::Miss: ++misses_; break;
+        }
+    }
+
+    auto Cache::ClaimRevalidation(std::string_view key) -> bool {
+        std::lock_guard lock {mutex_};
+        return revalidating_.emplace(key).second;
+    }
+
+    auto Cache::ReleaseRevalidation(std::string_view key) -> void {
+        std::lock_guard lock {mutex_};
+        if (const auto iter = revalidating_.find(key); iter != revalidating_.end()) {
+            revalidating_.erase(iter);
+        }
+    }
+
+    auto Cache::ClaimFill(std::string_view) -> bool {
+        return true;
+    }
+
+    auto Cache::ReleaseFill(std::string_view) -> void {}
+
+    auto Cache::shared() const -> bool {
+        return false;
+    }
+
+    MemoryCache::MemoryCache(std::size_t max_bytes) : max_bytes_(max_bytes) {}
+
+    auto MemoryCache::Find(std::string_view key) -> std::optional<CachedResponse> {
+        std::lock_guard lock {mutex_};
+        const auto iter = index_.find(key);
+        if (iter == index_.end()) return std::nullopt;
+
+        entries_.splice(entries_.begin(), entries_, iter->second);
+        return iter->second->value;
+    }
+
+    auto MemoryCache::Store(std::string_view key, CachedResponse entry) -> void {
+        const auto size = SizeOf(key, entry);
+
+        std::lock_guard lock {mutex_};
+        if (const auto iter = index_.find(key); iter != index_.end()) Erase(iter->second);
+
+        // A response that doesn't fit isn't stored, rather than evicting everything else
+        if (size > max_bytes_) return;
+
+        while (bytes_ + size > max_bytes_ && !entries_.empty()) {
+            Erase(std::prev(entries_.end()));
+            ++evictions_;
+        }
+
+        entries_.push_front({std::string {key}, std::move(entry), size});
+        index_.emplace(entries_.front().key, entries_.begin());
+        bytes_ += size;
+    }
+
+    auto MemoryCache::Remove(std::string_view key) -> void {
+        std::lock_guard lock {mutex_};
+        if (const auto iter = index_.find(key); iter != index_.end()) Erase(iter->second);
+    }
+
+    auto MemoryCache::stats() const -> CacheStats {
+        auto stats = Cache::stats();
+
+        std::lock_guard lock {mutex_};
+        stats.entries = entries_.size();
+        stats.bytes = bytes_;
+        stats.evictions = evictions_;
+        return stats;
+    }
+
+    auto MemoryCache::Erase(Entries::iterator iter) -> void {
+        bytes_ -= iter->size;
+        index_.erase(iter->key);
+        entries_.erase(iter);
+    }
+}
@@ -0,0 +1,122 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/cache_codec.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace Express {
+    namespace {
+        template <class T>
+        auto Put(std::string& buffer, T value) {
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        auto PutString(std::string& buffer, std::string_view value) {
+            Put(buffer, static_cast<std::uint32_t>(value.size()));
+            buffer.append(value);
+        }
+
+        class Reader {
+        public:
+            explicit Reader(std::string_view data) : data_(data) {}
+
+            template <class T>
+            auto Get(T& value) {
+                if (data_.size() < sizeof(value)) return false;
+                std::memcpy(&value, data_.data(), sizeof(value));
+                data_.remove_prefix(sizeof(value));
+                return true;
+            }
+
+            auto GetString(std::string& value) {
+                std::uint32_t size {0};
+                if (!Get(size) || data_.size() < size) return false;
+                value.assign(data_.substr(0, size));
+                data_.remove_prefix(size);
+                return true;
+            }
+
+        private:
+            std::string_view data_;
+        };
+
+        auto Nanoseconds(std::chrono::system_clock::time_point time) -> std::int64_t {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        }
+    }
+
+    auto EncodeEntry(const CachedResponse& entry) -> std::string {
+        const auto& response = entry.response;
+
+        std::string buffer;
+        buffer.reserve(response.data.size() + 256);
+        Put(buffer, Nanoseconds(entry.request_time));
+        Put(buffer, Nanoseconds(entry.response_time));
+        Put(buffer, static_cast<std::int32_t>(response.status_code));
+        PutString(buffer, response.status_text);
+
+        Put(buffer, static_cast<std::uint32_t>(std::distance(response.headers.begin(), response.headers.end())));
+        for (const auto& [key, header] : response.headers) {
+            PutString(buffer, header.first);
+            PutString(buffer, header.second);
+        }
+
+        Put(buffer, static_cast<std::uint32_t>(entry.vary.size()));
+        for (const auto& [name, value] : entry.vary) {
+            PutString(buffer, name);
+            PutString(buffer, value);
+        }
+
+        PutString(buffer, response.data);
+        return buffer;
+    }
+
+    auto DecodeEntry(std::string_view data) -> std::optional<CachedResponse> {
+        using std::chrono::system_clock;
+
+        Reader reader {data};
+        std::int64_t request_time {0};
+        std::int64_t response_time {0};
+        std::int32_t status_code {0};
+
+        CachedResponse entry {.response = {}};
+        auto& response = entry.response;
+        if (!reader.Get(request_time) || !reader.Get(response_time) || !reader.Get(status_code) ||
+            !reader.GetString(response.status_text)) {
+            return std::nullopt;
+        }
+
+        entry.request_time = system_clock::time_point {
+            std::chrono::duration_cast<system_clock::duration>(std::chrono::nanoseconds {request_time})
+        };
+        entry.response_time = system_clock::time_point {
+            std::chrono::duration_cast<system_clock::duration>(std::chrono::nanoseconds {response_time})
+        };
+        response.status_code = status_code;
+
+        std::uint32_t count {0};
+        if (!reader.Get(count)) return std::nullopt;
+        for (std::uint32_t i = 0; i < count; ++i) {
+            std::string name;
+            std::string value;
+            if (!reader.GetString(name) || !reader.GetString(value)) return std::nullopt;
+            response.headers.Add(name, std::move(value));
+        }
+
+        if (!reader.Get(count)) return std::nullopt;
+        for (std::uint32_t i = 0; i < count; ++i) {
+            std::string name;
+            std::string value;
+            if (!reader.GetString(name) || !reader.GetString(value)) return std::nullopt;
+            entry.vary.emplace_back(std::move(name), std::move(value));
+        }
+
+        if (!reader.GetString(response.data)) return std::nullopt;
+        return entry;
+    }
+}
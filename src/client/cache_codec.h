@@ -0,0 +1,22 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "express/cache.h"
+
+namespace Express {
+    /*
+        The binary encoding of the responses that caches keep outside the
+        process. Integers are written in the byte order of the machine, so
+        the encoding isn't portable between architectures.
+    */
+    [[nodiscard]] auto EncodeEntry(const CachedResponse& entry) -> std::string;
+
+    // Returns nothing if the data is truncated
+    [[nodiscard]] auto DecodeEntry(std::string_view data) -> std::optional<CachedResponse>;
+}
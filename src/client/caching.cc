@@ -0,0 +1,246 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/caching.h"
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+#include "http/cache_control.h"
+#include "http/date.h"
+#include "http/request_builder.h"
+#include "utils/string_transformers.h"
+
+namespace Express {
+    namespace {
+        using Clock = std::chrono::system_clock;
+        using std::chrono::seconds;
+
+        // Responses with these status codes may be cached with a heuristic
+        // lifetime (RFC 9110, section 15.1)
+        constexpr std::array kHeuristicallyCacheable {200, 203, 204, 300, 301, 308, 404, 405, 410, 414, 501};
+
+        // A heuristic lifetime is capped so that a resource that hasn't
+        // changed in years isn't cached for months
+        constexpr seconds kMaxHeuristicLifetime {24 * 60 * 60};
+
+        auto Find(const Headers& headers, std::string_view name) -> std::optional<std::string_view> {
+            for (const auto& [key, header] : headers) {
+                if (key == name) return std::string_view {header.second};
+            }
+            return std::nullopt;
+        }
+
+        auto Value(const Headers& headers, std::string_view name) {
+            return Find(headers, name).value_or(std::string_view {});
+        }
+
+        auto RequestDirectives(const Config& config) {
+            return Http::ParseCacheControl(Value(config.headers, "cache-control"));
+        }
+
+        auto IsShared(const Config& config) {
+            return config.cache && config.cache->shared();
+        }
+
+        // A shared cache uses s-maxage in place of max-age, and must
+        // revalidate the responses that have it (RFC 9111, section 5.2.2.10)
+        auto ResponseDirectives(const Response& response, bool shared) {
+            auto directives = Http::ParseCacheControl(Value(response.headers, "cache-control"));
+            if (shared && directives.s_maxage) {
+                directives.max_age = directives.s_maxage;
+                directives.must_revalidate = true;
+            }
+            return directives;
+        }
+
+        auto IsHeuristicallyCacheable(int status_code) {
+            return std::find(kHeuristicallyCacheable.begin(), kHeuristicallyCacheable.end(), status_code) !=
+                   kHeuristicallyCacheable.end();
+        }
+
+        // Splits a list header, like Vary, into lower case names
+        auto SplitNames(std::string_view value) {
+            std::vector<std::string> names;
+            while (!value.empty()) {
+                const auto comma = value.find(',');
+                auto name = value.substr(0, comma);
+                value = comma == std::string_view::npos ? std::string_view {} : value.substr(comma + 1);
+
+                const auto first = name.find_first_not_of(" \t");
+                if (first == std::string_view::npos) continue;
+                name = name.substr(first, name.find_last_not_of(" \t") - first + 1);
+                names.push_back(StringTransformers::StringToLowerCase(std::string {name}));
+            }
+            return names;
+        }
+
+        // The response's age (RFC 9111, section 4.2.3)
+        auto Age(const CachedResponse& entry, Clock::time_point now) -> Clock::duration {
+            const auto& headers = entry.response.headers;
+            const auto date = Http::ParseHttpDate(Value(headers, "date")).value_or(entry.response_time);
+            const auto age = Http::ParseDeltaSeconds(Value(headers, "age")).value_or(seconds {0});
+
+            const auto apparent_age = std::max(entry.response_time - date, Clock::duration::zero());
+            const auto corrected_age = age + (entry.response_time - entry.request_time);
+            const auto initial_age = std::max<Clock::duration>(apparent_age, corrected_age);
+            return initial_age + (now - entry.response_time);
+        }
+
+        // The response's freshness lifetime (RFC 9111, section 4.2.1)
+        auto Lifetime(const CachedResponse& entry, const Http::CacheControl& directives) -> Clock::duration {
+            if (directives.max_age) return *directives.max_age;
+
+            const auto& headers = entry.response.headers;
+            const auto date = Http::ParseHttpDate(Value(headers, "date")).value_or(entry.response_time);
+            if (const auto expires = Find(headers, "expires")) {
+                // An invalid date, like "0", means the response has already expired
+                const auto time = Http::ParseHttpDate(*expires);
+                return time ? std::max(*time - date, Clock::duration::zero()) : Clock::duration::zero();
+            }
+
+            // A tenth of the time since the resource was last modified (section 4.2.2)
+            const auto last_modified = Http::ParseHttpDate(Value(headers, "last-modified"));
+            if (last_modified && IsHeuristicallyCacheable(entry.response.status_code) && *last_modified < date) {
+                return std::min<Clock::duration>((date - *last_modified) / 10, kMaxHeuristicLifetime);
+            }
+            return Clock::duration::zero();
+        }
+    }
+
+    auto IsCached(const Config& config) -> bool {
+        if (!config.cache || config.method != Method::Get) return false;
+
+        // Requests with their own validators or ranges are passed through,
+        // since their responses don't answer a plain request
+        const auto& headers = config.headers;
+        if (headers.Contains("if-none-match") || headers.Contains("if-modified-since") ||
+            headers.Contains("range")) {
+            return false;
+        }
+        return !RequestDirectives(config).no_store;
+    }
+
+    auto CacheKey(const Config& config) -> std::string {
+        const auto fragment = config.url.find('#');
+        return std::string {config.url.substr(0, fragment)};
+    }
+
+    auto IsServable(const Config& config) -> bool {
+        return !RequestDirectives(config).no_cache;
+    }
+
+    auto IsStorable(const Config& config, const Response& response) -> bool {
+        const auto shared = IsShared(config);
+        const auto directives = ResponseDirectives(response, shared);
+        if (directives.no_store || RequestDirectives(config).no_store) return false;
+
+        // Responses for a single user are kept out of shared caches (section 5.2.2.7)
+        if (shared && directives.is_private) return false;
+
+        // A response to a request with credentials is only stored when the
+        // server allows it explicitly (RFC 9111, section 3.5)
+        if (!Http::RequestHeader(config, "authorization").empty() &&
+            !directives.is_public && !directives.s_maxage && !directives.must_revalidate) {
+            return false;
+        }
+
+        const auto vary = SplitNames(Value(response.headers, "vary"));
+        if (std::find(vary.begin(), vary.end(), "*") != vary.end()) return false;
+
+        // Partial and interim responses aren't stored
+        if (response.status_code < 200 || response.status_code == 206 || response.status_code == 304) {
+            return false;
+        }
+
+        return directives.max_age || directives.no_cache || directives.is_public ||
+               response.headers.Contains("expires") || IsHeuristicallyCacheable(response.status_code);
+    }
+
+    auto MakeEntry(
+        const Config& config,
+        Response response,
+        Clock::time_point request_time,
+        Clock::time_point response_time
+    ) -> CachedResponse {
+        CachedResponse entry {
+            .response = std::move(response),
+            .request_time = request_time,
+            .response_time = response_time
+        };
+
+        // The values are the ones the request sent, including the
+        // Authorization header made from the config's credentials
+        for (auto& name : SplitNames(Value(entry.response.headers, "vary"))) {
+            auto value = Http::RequestHeader(config, name);
+            entry.vary.emplace_back(std::move(name), std::move(value));
+        }
+        return entry;
+    }
+
+    auto Matches(const CachedResponse& entry, const Config& config) -> bool {
+        return std::all_of(entry.vary.begin(), entry.vary.end(), [&config](const auto& field) {
+            return Http::RequestHeader(config, field.first) == field.second;
+        });
+    }
+
+    auto Assess(const CachedResponse& entry, const Config& config, Clock::time_point now) -> Freshness {
+        const auto response = ResponseDirectives(entry.response, IsShared(config));
+        const auto request = RequestDirectives(config);
+        if (response.no_cache || request.no_cache) return Freshness::kStale;
+
+        const auto age = Age(entry, now);
+        if (request.max_age && age > *request.max_age) return Freshness::kStale;
+
+        const auto lifetime = Lifetime(entry, response);
+        if (age < lifetime) return Freshness::kFresh;
+
+        if (!response.must_revalidate && response.stale_while_revalidate &&
+            age - lifetime <= *response.stale_while_revalidate) {
+            return Freshness::kStaleWhileRevalidate;
+        }
+        return Freshness::kStale;
+    }
+
+    auto IsUsableOnError(const CachedResponse& entry, const Config& config, Clock::time_point now) -> bool {
+        const auto response = ResponseDirectives(entry.response, IsShared(config));
+        if (response.must_revalidate) return false;
+
+        // Either side may allow stale responses on errors
+        const auto window = response.stale_if_error ? response.stale_if_error : RequestDirectives(config).stale_if_error;
+        if (!window) return false;
+
+        return Age(entry, now) - Lifetime(entry, response) <= *window;
+    }
+
+    auto MakeConditional(Config config, const CachedResponse& entry) -> Config {
+        const auto& headers = entry.response.headers;
+        if (const auto etag = Find(headers, "etag")) {
+            config.headers.Add("If-None-Match", std::string {*etag});
+        }
+        if (const auto last_modified = Find(headers, "last-modified")) {
+            config.headers.Add("If-Modified-Since", std::string {*last_modified});
+        }
+        return config;
+    }
+
+    auto Refresh(
+        CachedResponse entry,
+        const Response& not_modified,
+        Clock::time_point request_time,
+        Clock::time_point response_time
+    ) -> CachedResponse {
+        auto& headers = entry.response.headers;
+        for (const auto& [key, header] : not_modified.headers) {
+            // The 304 doesn't describe the stored body
+            if (key == "content-length" || key == "transfer-encoding") continue;
+            if (headers.Contains(key)) headers.Remove(key);
+            headers.Add(header.first, header.second);
+        }
+
+        entry.request_time = request_time;
+        entry.response_time = response_time;
+        return entry;
+    }
+}
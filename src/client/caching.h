@@ -0,0 +1,210 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "express/cache.h"
+#include "express/config.h"
+#include "express/executor.h"
+#include "express/expected.h"
+#include "express/response.h"
+#include "express/task.h"
+
+#include "client/detached.h"
+#include "client/timeout.h"
+#include "net/event_loop.h"
+
+namespace Express {
+    // How often a request checks for a response that another process is fetching
+    constexpr std::chrono::milliseconds kFillInterval {10};
+
+    enum class Freshness {kFresh, kStaleWhileRevalidate, kStale};
+
+    // Whether the request goes through its cache
+    [[nodiscard]] auto IsCached(const Config& config) -> bool;
+
+    [[nodiscard]] auto CacheKey(const Config& config) -> std::string;
+
+    // Whether a stored response may answer the request without being
+    // validated first, which `no-cache` in the request rules out
+    [[nodiscard]] auto IsServable(const Config& config) -> bool;
+
+    // Whether the response to the request may be stored (RFC 9111, section 3)
+    [[nodiscard]] auto IsStorable(const Config& config, const Response& response) -> bool;
+
+    [[nodiscard]] auto MakeEntry(
+        const Config& config,
+        Response response,
+        std::chrono::system_clock::time_point request_time,
+        std::chrono::system_clock::time_point response_time
+    ) -> CachedResponse;
+
+    // Whether the request has the values the stored response varies on
+    [[nodiscard]] auto Matches(const CachedResponse& entry, const Config& config) -> bool;
+
+    [[nodiscard]] auto Assess(
+        const CachedResponse& entry,
+        const Config& config,
+        std::chrono::system_clock::time_point now
+    ) -> Freshness;
+
+    // Whether the stale response may be served when the server fails
+    [[nodiscard]] auto IsUsableOnError(
+        const CachedResponse& entry,
+        const Config& config,
+        std::chrono::system_clock::time_point now
+    ) -> bool;
+
+    // Adds the stored response's validators to the request
+    [[nodiscard]] auto MakeConditional(Config config, const CachedResponse& entry) -> Config;
+
+    // Updates the stored response with the headers of a 304 response
+    [[nodiscard]] auto Refresh(
+        CachedResponse entry,
+        const Response& not_modified,
+        std::chrono::system_clock::time_point request_time,
+        std::chrono::system_clock::time_point response_time
+    ) -> CachedResponse;
+
+    /*
+        Sends the request, conditionally if there's a stored response,
+        and updates the cache with the result.
+    */
+    template <class Send>
+    auto RevalidateAsync(
+        Config config,
+        std::string key,
+        std::optional<CachedResponse> entry,
+        Send send,
+        bool record
+    ) -> Task<Expected<Response>> {
+        using Clock = std::chrono::system_clock;
+
+        const auto cache = config.cache;
+        const auto count = [&cache, record](CacheOutcome outcome) {
+            if (record) cache->Record(outcome);
+        };
+
+        auto request = config;
+        if (entry) request = MakeConditional(std::move(request), *entry);
+
+        const auto request_time = Clock::now();
+        auto result = co_await send(std::move(request));
+        const auto response_time = Clock::now();
+
+        if (entry && result && result->status_code == 304) {
+            auto refreshed = Refresh(std::move(*entry), *result, request_time, response_time);
+            auto response = refreshed.response;
+            cache->Store(key, std::move(refreshed));
+            count(CacheOutcome::Revalidated);
+            co_return response;
+        }
+
+        const auto failed = !result || result->status_code >= 500;
+        if (entry && failed && IsUsableOnError(*entry, config, response_time)) {
+            count(CacheOutcome::StaleHit);
+            co_return std::move(entry->response);
+        }
+
+        if (result && IsStorable(config, *result)) {
+            cache->Store(key, MakeEntry(config, *result, request_time, response_time));
+        } else if (entry && !failed) {
+            cache->Remove(key);
+        }
+
+        count(CacheOutcome::Miss);
+        co_return result;
+    }
+
+    /*
+        Serves the request from its cache when the stored response is
+        fresh. A stale response is revalidated, in the background if it's
+        within its stale-while-revalidate window. When another process is
+        fetching the response into a shared cache, the request waits for it,
+        unless it can't be served from the cache anyway. If the fetch ends
+        without storing a fresh response, the waiting requests send their
+        own at once instead of taking turns.
+    */
+    template <class Send>
+    auto CachedAsync(
+        Config config,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Executor> executor,
+        Send send
+    ) -> Task<Expected<Response>> {
+        const auto cache = config.cache;
+        auto key = CacheKey(config);
+
+        auto entry = cache->Find(key);
+        if (entry && !Matches(*entry, config)) entry.reset();
+
+        const auto now = std::chrono::system_clock::now();
+        const auto freshness = entry ? Assess(*entry, config, now) : Freshness::kStale;
+
+        if (freshness == Freshness::kFresh) {
+            cache->Record(CacheOutcome::Hit);
+            co_return std::move(entry->response);
+        }
+
+        if (freshness == Freshness::kStaleWhileRevalidate) {
+            cache->Record(CacheOutcome::StaleHit);
+
+            // The revalidation isn't cancelled with the request that started it
+            if (cache->ClaimRevalidation(key)) {
+                auto background = config;
+                background.stop_token = {};
+                Detail::Complete(
+                    DetachedAsync(std::move(background), [key, entry, send](Config config) {
+                        return RevalidateAsync(std::move(config), key, entry, send, false);
+                    }),
+                    [cache, key](const Expected<Response>&) { cache->ReleaseRevalidation(key); }
+                );
+            }
+            co_return std::move(entry->response);
+        }
+
+        // Requests that can't use what's stored don't hold the others off
+        const auto servable = IsServable(config);
+        auto waited = false;
+        while (servable && !cache->ClaimFill(key)) {
+            waited = true;
+            const auto wait = co_await loop->Sleep(Timeout {kFillInterval}, config.stop_token);
+            if (wait != Net::WaitResult::kTimeout) {
+                co_return Unexpected {std::make_error_code(std::errc::operation_canceled)};
+            }
+
+            // Waits end on the I/O thread, and the cache and the request
+            // that fills it are used from the executor
+            co_await Schedule(*executor);
+
+            auto stored = cache->Find(key);
+            if (stored && Matches(*stored, config) &&
+                Assess(*stored, config, std::chrono::system_clock::now()) == Freshness::kFresh) {
+                cache->Record(CacheOutcome::Hit);
+                co_return std::move(stored->response);
+            }
+        }
+
+        // The fetch that was waited for didn't store a response, so this one
+        // likely won't either, and the other waiting requests go ahead too
+        const auto filling = servable && !waited;
+        if (waited) cache->ReleaseFill(key);
+
+        std::optional<Expected<Response>> result;
+        try {
+            result = co_await RevalidateAsync(std::move(config), key, std::move(entry), std::move(send), true);
+        } catch (...) {
+            if (filling) cache->ReleaseFill(key);
+            throw;
+        }
+        if (filling) cache->ReleaseFill(key);
+        co_return std::move(*result);
+    }
+}
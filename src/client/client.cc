@@ -3,50 +3,361 @@
 
 #include "client.h"
 
-#include <array>
+#include <future>
 #include <string>
+#include <vector>
 
+#include "express/proxy.h"
+#include "express/thread_pool.h"
+#include "express/upstream.h"
+#include "client/batch.h"
+#include "client/breaker.h"
+#include "client/caching.h"
+#include "client/coalesce.h"
+#include "client/error.h"
+#include "client/event_stream.h"
+#include "client/hedge.h"
+#include "client/perform.h"
+#include "client/retry.h"
+#include "client/routing.h"
+#include "client/scheduler.h"
 #include "client/timeout.h"
+#include "client/transfer.h"
+#include "client/websocket.h"
 #include "http/request_builder.h"
 #include "http/response_parser.h"
+#include "net/endpoint.h"
+#include "net/event_loop.h"
 #include "net/socket.h"
 #include "net/url.h"
+#include "utils/arena_pool.h"
 
 #if defined(_WIN32)
     #include "net/winsock.h"
 #endif
 
 namespace Express {
-    auto Client::Request(const Config& config) const -> std::future<Response> {
-        return std::async(std::launch::async, [config](){
-            #if defined(_WIN32)
-                Net::WinSock winsock;
-            #endif
-
-            const Timeout timeout {config.timeout};
-            const Net::Url url {config.url};
-            const Net::Socket socket {{url.host(), url.port()}};
-            const Http::RequestBuilder request(config);
-
-            socket.Connect(timeout);
-            socket.Send(request.GetData(), timeout);
-
-            std::array<unsigned char, BUFSIZ> buffer;
-            Http::ResponseParser parser;
-
-            while (true) {
-                auto size = socket.Recv(
-                    buffer.data(),
-                    buffer.size(),
-                    timeout
-                );
-                if (size == 0 || parser.done_reading_data()) {
-                    break;
+    // Connects to the endpoint, sends the request and reads the response
+    auto ExchangeAsync(
+        const Config& config,
+        const Http::RequestBuilder& request,
+        Net::Endpoint endpoint,
+        std::pmr::memory_resource* resource,
+        Net::EventLoop& loop,
+        Executor& executor,
+        const Limits& limits
+    ) -> Task<Expected<Response>> {
+        std::error_code ec;
+        const Net::Socket socket {std::move(endpoint), ec};
+        if (ec) co_return Unexpected {ec};
+
+        // Resolving the host can't be interrupted, so a stop requested in
+        // the meantime is checked before connecting
+        if (limits.stop.stop_requested()) {
+            co_return Unexpected {std::make_error_code(std::errc::operation_canceled)};
+        }
+
+        ec = co_await ConnectAsync(socket, loop, limits);
+        if (ec) co_return Unexpected {ec};
+
+        // The receive buffer lives in the arena to keep the coroutine frame small
+        auto* buffer = static_cast<unsigned char*>(resource->allocate(BUFSIZ));
+        const auto decoding = config.decompress ? Http::Decoding::kDecode : Http::Decoding::kRaw;
+        Http::ResponseParser parser {
+            resource, decoding, config.dictionaries.get(), config.max_decoded_bytes
+        };
+
+        std::size_t received = 0;
+        ec = co_await SendRequestAsync(
+            socket, request, parser, {buffer, BUFSIZ}, loop, limits, config.expect_continue.timeout, received
+        );
+        if (ec) co_return Unexpected {ec};
+
+        ec = co_await ReceiveAsync(socket, parser, {buffer, BUFSIZ}, loop, executor, limits, received);
+        if (ec) co_return Unexpected {ec};
+
+        auto response = std::move(parser).response(ec);
+        if (ec) co_return Unexpected {ec};
+
+        co_return response;
+    }
+
+    /*
+        Sends the request through the proxy, over a connection the proxy
+        kept idle when there is one. http requests share the connections
+        to the proxy, and https requests share the tunnels to their host.
+    */
+    auto ProxiedAsync(
+        const Config& config,
+        const Http::RequestBuilder& request,
+        const Net::Url& url,
+        Proxy& proxy,
+        std::pmr::memory_resource* resource,
+        Net::EventLoop& loop,
+        Executor& executor,
+        const Limits& limits
+    ) -> Task<Expected<Response>> {
+        const auto tunnel = url.scheme() == "https";
+        std::pmr::string destination {resource};
+        if (tunnel) destination.append(url.host()).append(":").append(url.port());
+
+        auto* buffer = static_cast<unsigned char*>(resource->allocate(BUFSIZ));
+        const auto decoding = config.decompress ? Http::Decoding::kDecode : Http::Decoding::kRaw;
+
+        while (true) {
+            std::error_code ec;
+            auto connection = proxy.Acquire(destination);
+            const auto reused = connection != nullptr;
+            if (!reused) {
+                connection = std::make_unique<Net::Socket>(proxy.endpoint(), ec);
+                if (!ec && limits.stop.stop_requested()) ec = std::make_error_code(std::errc::operation_canceled);
+                if (!ec) ec = co_await ConnectAsync(*connection, loop, limits);
+                if (!ec && tunnel) {
+                    ec = co_await OpenTunnelAsync(
+                        *connection, destination, proxy.authorization(), {buffer, BUFSIZ}, resource, loop, limits
+                    );
                 }
-                parser.Feed(buffer.data(), size);
+                if (ec) co_return Unexpected {ec};
             }
 
-            return parser.response();
-        });
+            Http::ResponseParser parser {
+                resource, decoding, config.dictionaries.get(), config.max_decoded_bytes
+            };
+            std::size_t interim = 0;
+            std::size_t received = 0;
+
+            ec = co_await SendRequestAsync(
+                *connection, request, parser, {buffer, BUFSIZ}, loop, limits, config.expect_continue.timeout, interim
+            );
+            const auto withheld = parser.headers_complete();
+            if (!ec) {
+                ec = co_await ReceiveAsync(*connection, parser, {buffer, BUFSIZ}, loop, executor, limits, received);
+            }
+            received += interim;
+
+            // A kept connection may have been closed while it was idle
+            if (reused && received == 0 && !IsFinal(ec)) continue;
+            if (ec) co_return Unexpected {ec};
+
+            const auto keep_alive = !withheld && parser.keep_alive();
+            auto response = std::move(parser).response(ec);
+            if (ec) co_return Unexpected {ec};
+
+            if (keep_alive) proxy.Release(destination, std::move(connection));
+            co_return response;
+        }
+    }
+
+    auto PerformAsync(
+        Config config,
+        std::shared_ptr<ArenaPool> arenas,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Scheduler> scheduler,
+        std::shared_ptr<Executor> executor
+    ) -> Task<Expected<Response>> {
+        #if defined(_WIN32)
+            Net::WinSock winsock;
+        #endif
+
+        // Every allocation made while processing the request comes from
+        // an arena that's recycled once the response is returned.
+        const auto arena = arenas->Acquire();
+        std::error_code ec;
+
+        const Limits limits {config};
+        const Net::Url url {config.url, arena.resource(), ec};
+        if (ec) co_return Unexpected {ec};
+
+        // Connections to a proxy are kept for later requests
+        auto* proxy = ProxyFor(config, url);
+        const auto connection = proxy ? Http::Connection::kKeepAlive : Http::Connection::kClose;
+
+        const Http::RequestBuilder request {config, arena.resource(), ec, connection};
+        if (ec) co_return Unexpected {ec};
+
+        // The slot is held until the response is read
+        const auto slot = co_await scheduler->Admit(config.priority, limits.total, limits.stop);
+        if (!slot) co_return Unexpected {slot.error()};
+
+        if (proxy) {
+            co_return co_await ProxiedAsync(
+                config, request, url, *proxy, arena.resource(), *loop, *executor, limits
+            );
+        }
+
+        if (!config.upstream) {
+            auto endpoint = Resolve(url.host(), url.port(), limits, ec);
+            if (ec) co_return Unexpected {ec};
+
+            co_return co_await ExchangeAsync(
+                config, request, std::move(endpoint), arena.resource(), *loop, *executor, limits
+            );
+        }
+
+        // The member is picked once the request is admitted, so that its
+        // latency doesn't include the time spent in the queue
+        auto& upstream = *config.upstream;
+        const auto member = upstream.Pick(RoutingKey(config, url));
+        const auto start = Upstream::Clock::now();
+
+        auto result = co_await ExchangeAsync(
+            config, request, upstream.endpoint(member), arena.resource(), *loop, *executor, limits
+        );
+        upstream.Record(member, result, Upstream::Clock::now() - start);
+        co_return result;
+    }
+
+    /*
+        Runs the task on the executor, and resumes the awaiting coroutine
+        on the executor rather than on the I/O thread.
+    */
+    template <class T>
+    auto RunOn(std::shared_ptr<Executor> executor, Task<T> task) -> Task<T> {
+        co_await Schedule(*executor);
+        auto result = co_await std::move(task);
+        co_await Schedule(*executor);
+        co_return result;
+    }
+
+    // Sends a single attempt of the request, which may be hedged, unless
+    // the host's circuit breaker is open
+    auto AttemptAsync(
+        Config config,
+        const std::shared_ptr<CircuitBreakers>& breakers,
+        const std::shared_ptr<Hedger>& hedger,
+        const std::shared_ptr<ArenaPool>& arenas,
+        const std::shared_ptr<Net::EventLoop>& loop,
+        const std::shared_ptr<Scheduler>& scheduler,
+        const std::shared_ptr<Executor>& executor
+    ) -> Task<Expected<Response>> {
+        auto attempt = IsHedged(config)
+            ? HedgedAsync(config, hedger, arenas, loop, scheduler, executor)
+            : PerformAsync(config, arenas, loop, scheduler, executor);
+        if (!IsGuarded(config)) return attempt;
+        return GuardedAsync(std::move(config), breakers, std::move(attempt));
+    }
+
+    auto Unwrap(Task<Expected<Response>> task) -> Task<Response> {
+        auto result = co_await std::move(task);
+        if (!result) Error::Throw(result.error());
+        co_return std::move(*result);
+    }
+
+    Client::Client() : Client(ThreadPool::Default()) {}
+
+    Client::Client(std::pmr::memory_resource* resource)
+      : Client(ThreadPool::Default(), resource) {}
+
+    Client::Client(const SchedulerOptions& scheduler)
+      : Client(ThreadPool::Default(), scheduler) {}
+
+    Client::Client(std::shared_ptr<Executor> executor, std::pmr::memory_resource* resource)
+      : Client(std::move(executor), SchedulerOptions {}, resource) {}
+
+    Client::Client(
+        std::shared_ptr<Executor> executor,
+        const SchedulerOptions& scheduler,
+        std::pmr::memory_resource* resource
+    ) : executor_(std::move(executor)),
+        arenas_(std::make_shared<ArenaPool>(resource)),
+        loop_(std::make_shared<Net::EventLoop>()),
+        scheduler_(std::make_shared<Scheduler>(executor_, scheduler)),
+        breakers_(std::make_shared<CircuitBreakers>()),
+        coalescer_(std::make_shared<Coalescer>()),
+        hedger_(std::make_shared<Hedger>()),
+        retrier_(std::make_shared<Retrier>()) {}
+
+    auto Client::Request(const Config& config) const -> std::future<Response> {
+        std::promise<Response> promise;
+        auto future = promise.get_future();
+        Detail::Fulfil(RequestAsync(config), std::move(promise));
+        return future;
+    }
+
+    auto Client::TryRequest(const Config& config) const -> std::future<Expected<Response>> {
+        std::promise<Expected<Response>> promise;
+        auto future = promise.get_future();
+        Detail::Fulfil(TryRequestAsync(config), std::move(promise));
+        return future;
+    }
+
+    auto Client::RequestAsync(Config config) const -> Task<Response> {
+        return Unwrap(TryRequestAsync(std::move(config)));
+    }
+
+    auto Client::TryRequestAsync(Config config) const -> Task<Expected<Response>> {
+        auto request = [breakers = breakers_, hedger = hedger_, retrier = retrier_, arenas = arenas_,
+                        loop = loop_, scheduler = scheduler_, executor = executor_](Config config) {
+            auto attempt = [=](Config attempt) {
+                return AttemptAsync(std::move(attempt), breakers, hedger, arenas, loop, scheduler, executor);
+            };
+            if (config.retry.max_retries == 0) return attempt(std::move(config));
+            return RetryAsync(std::move(config), retrier, loop, executor, std::move(attempt));
+        };
+
+        // Requests that miss the cache may share a request
+        auto send = [request, coalescer = coalescer_](Config config) -> Task<Expected<Response>> {
+            if (IsCoalesced(config)) return CoalescedAsync(std::move(config), coalescer, request);
+            return request(std::move(config));
+        };
+
+        if (IsCached(config)) {
+            return RunOn(executor_, CachedAsync(std::move(config), loop_, executor_, std::move(send)));
+        }
+        return RunOn(executor_, send(std::move(config)));
+    }
+
+    auto Client::RequestBatch(
+        std::span<const Config> configs,
+        const BatchOptions& options
+    ) const -> std::future<BatchResult> {
+        std::promise<BatchResult> promise;
+        auto future = promise.get_future();
+        Detail::Fulfil(RequestBatchAsync(configs, options), std::move(promise));
+        return future;
+    }
+
+    auto Client::RequestBatchAsync(
+        std::span<const Config> configs,
+        BatchOptions options
+    ) const -> Task<BatchResult> {
+        // The task is lazy, so the configs are copied before the span can dangle
+        return RunOn(executor_, PerformBatchAsync(
+            std::vector<Config>(configs.begin(), configs.end()), options, arenas_, loop_, scheduler_, executor_
+        ));
+    }
+
+    auto Client::Subscribe(
+        const Config& config,
+        EventStreamOptions options
+    ) const -> std::future<Expected<EventStreamResult>> {
+        std::promise<Expected<EventStreamResult>> promise;
+        auto future = promise.get_future();
+        Detail::Fulfil(SubscribeAsync(config, std::move(options)), std::move(promise));
+        return future;
+    }
+
+    auto Client::SubscribeAsync(
+        Config config,
+        EventStreamOptions options
+    ) const -> Task<Expected<EventStreamResult>> {
+        return RunOn(executor_, StreamEventsAsync(std::move(config), std::move(options), loop_, executor_));
+    }
+
+    auto Client::ConnectWebSocket(
+        const Config& config,
+        WebSocketOptions options
+    ) const -> std::future<Expected<std::unique_ptr<WebSocket>>> {
+        std::promise<Expected<std::unique_ptr<WebSocket>>> promise;
+        auto future = promise.get_future();
+        Detail::Fulfil(ConnectWebSocketAsync(config, std::move(options)), std::move(promise));
+        return future;
+    }
+
+    auto Client::ConnectWebSocketAsync(
+        Config config,
+        WebSocketOptions options
+    ) const -> Task<Expected<std::unique_ptr<WebSocket>>> {
+        return RunOn(executor_, Express::ConnectWebSocketAsync(std::move(config), std::move(options), loop_, executor_));
     }
-}
\ No newline at end of file
+}
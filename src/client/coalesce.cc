@@ -0,0 +1,145 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/coalesce.h"
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <system_error>
+
+#include "express/method.h"
+#include "http/request_builder.h"
+#include "utils/string_transformers.h"
+
+namespace Express {
+    namespace {
+        constexpr std::array<std::string_view, 2> kCredentials {"authorization", "cookie"};
+    }
+
+    auto Flight::Awaiter::await_ready() -> bool {
+        cancelled_ = stop_.stop_requested();
+        return cancelled_;
+    }
+
+    auto Flight::Awaiter::await_suspend(std::coroutine_handle<> handle) -> bool {
+        handle_ = handle;
+
+        // The callback is registered first, since a stop requested once the
+        // awaiter is suspended must find it. A stop requested in between
+        // sets the cancelled flag, which is checked below.
+        if (stop_.stop_possible()) on_stop_.emplace(stop_, Canceller {this});
+
+        std::lock_guard lock {flight_.mutex_};
+        if (cancelled_ || flight_.result_) return false;
+        suspended_ = true;
+        flight_.suspended_.push_back(this);
+        return true;
+    }
+
+    auto Flight::Awaiter::await_resume() -> Expected<Response> {
+        on_stop_.reset();
+
+        auto abandoned = false;
+        std::optional<Expected<Response>> result;
+        {
+            std::lock_guard lock {flight_.mutex_};
+            const auto last = --flight_.waiters_ == 0;
+            if (cancelled_) {
+                abandoned = last && !flight_.result_;
+            } else if (last) {
+                // No one else reads the result, so it's moved rather than copied
+                result.emplace(std::move(*flight_.result_));
+            } else {
+                result.emplace(*flight_.result_);
+            }
+        }
+
+        if (abandoned) flight_.stop_.request_stop();
+        if (!result) return Unexpected {std::make_error_code(std::errc::operation_canceled)};
+        return std::move(*result);
+    }
+
+    auto Flight::Awaiter::Canceller::operator()() const -> void {
+        auto& flight = awaiter->flight_;
+        {
+            std::lock_guard lock {flight.mutex_};
+            if (!awaiter->suspended_) {
+                awaiter->cancelled_ = true;
+                return;
+            }
+
+            // A flight that has landed resumes the awaiter itself
+            const auto iter = std::find(flight.suspended_.begin(), flight.suspended_.end(), awaiter);
+            if (iter == flight.suspended_.end()) return;
+            flight.suspended_.erase(iter);
+            awaiter->cancelled_ = true;
+        }
+        awaiter->handle_.resume();
+    }
+
+    auto Flight::Land(Expected<Response> result) -> void {
+        std::vector<Awaiter*> suspended;
+        {
+            std::lock_guard lock {mutex_};
+            result_.emplace(std::move(result));
+            std::swap(suspended, suspended_);
+        }
+        for (auto* awaiter : suspended) awaiter->handle_.resume();
+    }
+
+    auto Coalescer::Join(const std::string& key) -> std::pair<std::shared_ptr<Flight>, bool> {
+        std::lock_guard lock {mutex_};
+        auto& flight = flights_[key];
+
+        if (flight) {
+            // A flight that every request has abandoned is about to be cancelled
+            std::lock_guard flight_lock {flight->mutex_};
+            if (flight->waiters_ > 0) {
+                ++flight->waiters_;
+                return {flight, false};
+            }
+        }
+
+        flight = std::make_shared<Flight>();
+        flight->waiters_ = 1;
+        return {flight, true};
+    }
+
+    auto Coalescer::Land(
+        const std::string& key,
+        const std::shared_ptr<Flight>& flight,
+        Expected<Response> result
+    ) -> void {
+        {
+            // No request joins the flight once it's removed, so the number
+            // of waiters is final when the result is set
+            std::lock_guard lock {mutex_};
+            const auto iter = flights_.find(key);
+            if (iter != flights_.end() && iter->second == flight) flights_.erase(iter);
+        }
+        flight->Land(std::move(result));
+    }
+
+    auto IsCoalesced(const Config& config) -> bool {
+        return config.coalesce.enabled && (config.method == Method::Get || config.method == Method::Head);
+    }
+
+    auto CoalesceKey(const Config& config) -> std::string {
+        std::string key {MethodToString(config.method)};
+        key.append(" ").append(config.url);
+
+        // Requests made with different credentials never share a response,
+        // whether or not they vary on them
+        for (const auto name : kCredentials) {
+            key.append("\n").append(name).append(":").append(Http::RequestHeader(config, name));
+        }
+
+        for (const auto name : config.coalesce.vary) {
+            auto lower = StringTransformers::StringToLowerCase(std::string {name});
+            key.append("\n").append(lower).append(":").append(Http::RequestHeader(config, lower));
+        }
+
+        return key;
+    }
+}
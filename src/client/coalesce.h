@@ -0,0 +1,123 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <coroutine>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "express/config.h"
+#include "express/expected.h"
+#include "express/response.h"
+#include "express/task.h"
+
+#include "client/detached.h"
+
+namespace Express {
+    /*
+        A request that's shared by identical requests. Every request that
+        joins the flight waits for its result, and receives a copy of it.
+    */
+    class Flight {
+    public:
+        class Awaiter {
+        public:
+            Awaiter(Flight& flight, std::stop_token stop) : flight_(flight), stop_(std::move(stop)) {}
+
+            auto await_ready() -> bool;
+            auto await_suspend(std::coroutine_handle<> handle) -> bool;
+            auto await_resume() -> Expected<Response>;
+
+        private:
+            friend class Flight;
+
+            struct Canceller {
+                Awaiter* awaiter;
+                auto operator()() const -> void;
+            };
+
+            Flight& flight_;
+            std::coroutine_handle<> handle_;
+            bool suspended_ {false};
+            bool cancelled_ {false};
+
+            std::stop_token stop_;
+            std::optional<std::stop_callback<Canceller>> on_stop_;
+        };
+
+        // Stopped once every request waiting for the flight has been cancelled
+        [[nodiscard]] auto token() const { return stop_.get_token(); }
+
+        // Waits for the result. A stop requested through the token cancels
+        // the wait, but not the flight.
+        [[nodiscard]] auto Result(std::stop_token stop) { return Awaiter {*this, std::move(stop)}; }
+
+    private:
+        friend class Coalescer;
+
+        std::mutex mutex_;
+        std::size_t waiters_ {0};
+        std::vector<Awaiter*> suspended_;
+        std::optional<Expected<Response>> result_;
+        std::stop_source stop_;
+
+        auto Land(Expected<Response> result) -> void;
+    };
+
+    /*
+        The flights of a client, by request key.
+    */
+    class Coalescer {
+    public:
+        // Returns the key's flight, and whether the caller started it and
+        // must send its request
+        [[nodiscard]] auto Join(const std::string& key) -> std::pair<std::shared_ptr<Flight>, bool>;
+
+        auto Land(const std::string& key, const std::shared_ptr<Flight>& flight, Expected<Response> result) -> void;
+
+    private:
+        std::mutex mutex_;
+        std::map<std::string, std::shared_ptr<Flight>, std::less<>> flights_;
+    };
+
+    // Whether the request can share a flight under its policy
+    [[nodiscard]] auto IsCoalesced(const Config& config) -> bool;
+
+    // Identifies the requests that can share a flight
+    [[nodiscard]] auto CoalesceKey(const Config& config) -> std::string;
+
+    /*
+        Joins the flight of an identical request, or starts a new flight
+        that sends the request.
+    */
+    template <class Request>
+    auto CoalescedAsync(
+        Config config,
+        std::shared_ptr<Coalescer> coalescer,
+        Request request
+    ) -> Task<Expected<Response>> {
+        auto key = CoalesceKey(config);
+        auto [flight, leader] = coalescer->Join(key);
+
+        if (leader) {
+            // The flight is cancelled through its own token, since the
+            // request that started it may be cancelled while others wait
+            auto shared = config;
+            shared.stop_token = flight->token();
+            Detail::Complete(DetachedAsync(std::move(shared), std::move(request)),
+                [coalescer, flight = flight, key = std::move(key)](Expected<Response> result) {
+                    coalescer->Land(key, flight, std::move(result));
+                }
+            );
+        }
+
+        co_return co_await flight->Result(config.stop_token);
+    }
+}
@@ -0,0 +1,40 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "express/config.h"
+#include "express/expected.h"
+#include "express/response.h"
+#include "express/task.h"
+
+namespace Express {
+    /*
+        Sends a request that may outlive the caller. What the config only
+        refers to, like the URL and the headers the request varies on, is
+        copied into the coroutine frame, since the caller's storage may not
+        live as long as the request.
+    */
+    template <class Request>
+    auto DetachedAsync(Config config, Request request) -> Task<Expected<Response>> {
+        const std::string url {config.url};
+        const std::string data {config.data};
+        const std::string routing_key {config.routing_key};
+        config.url = url;
+        config.data = data;
+        config.routing_key = routing_key;
+
+        const std::vector<std::string> names {config.coalesce.vary.begin(), config.coalesce.vary.end()};
+        const std::vector<std::string_view> vary {names.begin(), names.end()};
+        config.coalesce.vary = vary;
+
+        const std::vector<int> status_codes {config.retry.status_codes.begin(), config.retry.status_codes.end()};
+        config.retry.status_codes = status_codes;
+
+        co_return co_await request(std::move(config));
+    }
+}
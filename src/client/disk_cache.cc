@@ -0,0 +1,387 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/cache.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "client/cache_codec.h"
+#include "client/error.h"
+#include "utils/hash.h"
+#include "utils/mapped_file.h"
+
+namespace Express {
+    namespace {
+        constexpr std::uint32_t kSegmentMagic {0x53445845};
+        constexpr std::uint32_t kRecordMagic {0x52445845};
+        constexpr std::uint32_t kVersion {1};
+
+        constexpr auto kExtension = ".segment";
+        constexpr std::size_t kMinSegmentBytes {4096};
+
+        struct SegmentHeader {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint64_t reserved;
+        };
+
+        // The magic is written after the rest of the record, so a record
+        // that was only partly written is never read back
+        struct RecordHeader {
+            std::uint32_t magic;
+            std::uint32_t key_size;
+            // Zero when the record removes the key
+            std::uint32_t value_size;
+            std::uint32_t reserved;
+            std::uint64_t checksum;
+        };
+
+        auto RecordSize(std::size_t key_size, std::size_t value_size) -> std::size_t {
+            // Records are aligned so that their headers are
+            return (sizeof(RecordHeader) + key_size + value_size + 7) & ~std::size_t {7};
+        }
+
+        auto Checksum(std::string_view key, std::string_view value) {
+            return Fnv1a(value, Fnv1a(key));
+        }
+
+        auto Hash(std::string_view key) {
+            return std::hash<std::string_view> {}(key);
+        }
+
+        auto SegmentPath(const std::filesystem::path& directory, std::uint32_t sequence) {
+            std::array<char, 9> name {};
+            std::snprintf(name.data(), name.size(), "%08x", sequence);
+            return directory / (std::string {name.data()} + kExtension);
+        }
+
+        auto ParseSequence(const std::filesystem::path& path) -> std::optional<std::uint32_t> {
+            if (path.extension() != kExtension) return std::nullopt;
+
+            const auto stem = path.stem().string();
+            const auto* end = stem.data() + stem.size();
+
+            std::uint32_t sequence {0};
+            const auto result = std::from_chars(stem.data(), end, sequence, 16);
+            if (stem.size() != 8 || result.ec != std::errc {} || result.ptr != end) return std::nullopt;
+            return sequence;
+        }
+    }
+
+    struct DiskCache::Segment {
+        Segment(std::filesystem::path path, std::size_t size, std::error_code& ec)
+          : path(std::move(path)),
+            file(this->path, size, ec) {}
+
+        std::filesystem::path path;
+        MappedFile file;
+
+        // The end of the last record
+        std::size_t end {sizeof(SegmentHeader)};
+
+        // The size of the records that are still indexed
+        std::size_t live {0};
+
+        // A segment with a damaged record isn't appended to
+        bool sealed {false};
+
+        [[nodiscard]] auto free() const { return file.size() - end; }
+
+        [[nodiscard]] auto HeaderAt(std::size_t offset) const {
+            RecordHeader header {};
+            std::memcpy(&header, file.data() + offset, sizeof(header));
+            return header;
+        }
+
+        [[nodiscard]] auto KeyAt(std::size_t offset, const RecordHeader& header) const {
+            return std::string_view {
+                reinterpret_cast<const char*>(file.data() + offset + sizeof(RecordHeader)),
+                header.key_size
+            };
+        }
+
+        [[nodiscard]] auto ValueAt(std::size_t offset, const RecordHeader& header) const {
+            return std::string_view {
+                reinterpret_cast<const char*>(file.data() + offset + sizeof(RecordHeader) + header.key_size),
+                header.value_size
+            };
+        }
+
+        auto Write(std::string_view key, std::string_view value) {
+            const auto offset = end;
+            auto* record = file.data() + offset;
+
+            const RecordHeader header {
+                .magic = 0,
+                .key_size = static_cast<std::uint32_t>(key.size()),
+                .value_size = static_cast<std::uint32_t>(value.size()),
+                .reserved = 0,
+                .checksum = Checksum(key, value)
+            };
+            std::memcpy(record, &header, sizeof(header));
+            if (!key.empty()) std::memcpy(record + sizeof(header), key.data(), key.size());
+            if (!value.empty()) std::memcpy(record + sizeof(header) + key.size(), value.data(), value.size());
+
+            std::atomic_ref {*reinterpret_cast<std::uint32_t*>(record)}.store(kRecordMagic, std::memory_order_release);
+
+            end += RecordSize(key.size(), value.size());
+            return static_cast<std::uint32_t>(offset);
+        }
+    };
+
+    DiskCache::DiskCache(DiskCacheOptions options) : options_(std::move(options)) {
+        // Offsets within a segment are 32-bit, and the cache holds at least two segments
+        const auto max_segment_bytes = std::max(
+            std::min<std::size_t>(options_.max_bytes / 2, std::numeric_limits<std::uint32_t>::max()),
+            kMinSegmentBytes
+        );
+        options_.segment_bytes = std::clamp(options_.segment_bytes, kMinSegmentBytes, max_segment_bytes);
+
+        Recover();
+    }
+
+    auto DiskCache::Find(std::string_view key) -> std::optional<CachedResponse> {
+        std::shared_lock lock {mutex_};
+        const auto iter = index_.find(Hash(key));
+        if (iter == index_.end()) return std::nullopt;
+
+        const auto& location = iter->second;
+        const auto& segment = *segments_.at(location.segment);
+        const auto header = segment.HeaderAt(location.offset);
+        if (segment.KeyAt(location.offset, header) != key) return std::nullopt;
+
+        return DecodeEntry(segment.ValueAt(location.offset, header));
+    }
+
+    auto DiskCache::Store(std::string_view key, CachedResponse entry) -> void {
+        const auto value = EncodeEntry(entry);
+        const auto too_large = key.size() + value.size() > options_.max_object_bytes ||
+                               RecordSize(key.size(), value.size()) > options_.segment_bytes - sizeof(SegmentHeader);
+
+        std::unique_lock lock {mutex_};
+        if (too_large) {
+            // The stored response is out of date either way
+            if (Unindex(key)) Append(key, {});
+            return;
+        }
+
+        if (const auto location = Append(key, value)) {
+            Index(key, *location);
+        } else {
+            // The new response couldn't be written, and the stored one is out of date
+            Unindex(key);
+        }
+    }
+
+    auto DiskCache::Remove(std::string_view key) -> void {
+        std::unique_lock lock {mutex_};
+        if (Unindex(key)) Append(key, {});
+    }
+
+    auto DiskCache::stats() const -> CacheStats {
+        auto stats = Cache::stats();
+
+        std::shared_lock lock {mutex_};
+        stats.entries = index_.size();
+        stats.bytes = bytes_;
+        stats.evictions = evictions_;
+        return stats;
+    }
+
+    DiskCache::~DiskCache() {
+        for (const auto& [sequence, segment] : segments_) segment->file.Flush();
+    }
+
+    auto DiskCache::Recover() -> void {
+        std::filesystem::create_directories(options_.directory);
+
+        std::vector<std::pair<std::uint32_t, std::filesystem::path>> files;
+        for (const auto& file : std::filesystem::directory_iterator {options_.directory}) {
+            if (!file.is_regular_file()) continue;
+            if (const auto sequence = ParseSequence(file.path())) files.emplace_back(*sequence, file.path());
+        }
+        std::sort(files.begin(), files.end());
+
+        // Later records replace earlier ones, so the segments are scanned from the oldest
+        for (auto& [sequence, path] : files) {
+            const auto size = std::filesystem::file_size(path);
+            if (size < sizeof(SegmentHeader) || size > std::numeric_limits<std::uint32_t>::max()) {
+                std::filesystem::remove(path);
+                continue;
+            }
+
+            std::error_code ec;
+            auto segment = std::make_unique<Segment>(path, size, ec);
+            if (ec) Error::Throw(ec, "Cache error");
+
+            SegmentHeader header {};
+            std::memcpy(&header, segment->file.data(), sizeof(header));
+            if (header.magic != kSegmentMagic || header.version != kVersion) {
+                segment.reset();
+                std::filesystem::remove(path);
+                continue;
+            }
+
+            Scan(sequence, *segments_.emplace(sequence, std::move(segment)).first->second);
+        }
+
+        const auto reusable = !segments_.empty() && !segments_.rbegin()->second->sealed &&
+                              segments_.rbegin()->second->free() >= RecordSize(0, 0);
+        if (reusable) {
+            Reclaim(0);
+        } else if (const auto ec = Roll(0)) {
+            Error::Throw(ec, "Cache error");
+        }
+    }
+
+    auto DiskCache::Scan(std::uint32_t sequence, Segment& segment) -> void {
+        const auto size = segment.file.size();
+
+        auto offset = sizeof(SegmentHeader);
+        while (offset + sizeof(RecordHeader) <= size) {
+            const auto header = segment.HeaderAt(offset);
+
+            // An unused header is the end of the segment. Anything else
+            // that isn't a valid record was damaged while it was written.
+            if (header.magic != kRecordMagic) {
+                segment.sealed = header.magic != 0;
+                break;
+            }
+
+            const auto record = RecordSize(header.key_size, header.value_size);
+            if (record > size - offset ||
+                Checksum(segment.KeyAt(offset, header), segment.ValueAt(offset, header)) != header.checksum) {
+                segment.sealed = true;
+                break;
+            }
+
+            const auto key = segment.KeyAt(offset, header);
+            if (header.value_size == 0) {
+                Unindex(key);
+            } else {
+                Index(key, {sequence, static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(record)});
+            }
+            offset += record;
+        }
+        segment.end = offset;
+    }
+
+    auto DiskCache::Append(std::string_view key, std::string_view value) -> std::optional<Location> {
+        const auto size = RecordSize(key.size(), value.size());
+        // The record isn't written if there's no room for a new segment
+        if (segments_.rbegin()->second->free() < size && Roll(size)) return std::nullopt;
+
+        auto& [sequence, segment] = *segments_.rbegin();
+        return Location {sequence, segment->Write(key, value), static_cast<std::uint32_t>(size)};
+    }
+
+    // The reserved bytes are kept free in the new segment for the record
+    // that didn't fit in the previous one. Fails if the segment's file
+    // can't be created, e.g. when the disk is full.
+    auto DiskCache::Roll(std::size_t reserve) -> std::error_code {
+        const auto sequence = segments_.empty() ? 0 : segments_.rbegin()->first + 1;
+        const auto path = SegmentPath(options_.directory, sequence);
+
+        std::error_code ec;
+        auto segment = std::make_unique<Segment>(path, options_.segment_bytes, ec);
+        if (ec) {
+            segment.reset();
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+            return ec;
+        }
+
+        const SegmentHeader header {.magic = kSegmentMagic, .version = kVersion, .reserved = 0};
+        std::memcpy(segment->file.data(), &header, sizeof(header));
+
+        segments_.emplace(sequence, std::move(segment));
+        Reclaim(reserve);
+        return {};
+    }
+
+    auto DiskCache::Reclaim(std::size_t reserve) -> void {
+        const auto disk_bytes = [this] {
+            std::size_t bytes {0};
+            for (const auto& [sequence, segment] : segments_) bytes += segment->file.size();
+            return bytes;
+        };
+
+        while (segments_.size() > 1 && disk_bytes() > options_.max_bytes) {
+            const auto oldest = segments_.begin();
+            auto& [active_sequence, active] = *segments_.rbegin();
+
+            // A segment that's mostly replaced responses is compacted into
+            // the newest segment, if that leaves room for the reserved
+            // bytes. Otherwise its responses are evicted.
+            auto& segment = *oldest->second;
+            const auto compact = segment.live <= segment.file.size() / 2 && segment.live + reserve <= active->free();
+
+            for (auto iter = index_.begin(); iter != index_.end();) {
+                auto& location = iter->second;
+                if (location.segment != oldest->first) {
+                    ++iter;
+                    continue;
+                }
+
+                if (compact) {
+                    const auto header = segment.HeaderAt(location.offset);
+                    const auto offset = active->Write(
+                        segment.KeyAt(location.offset, header),
+                        segment.ValueAt(location.offset, header)
+                    );
+                    active->live += location.size;
+                    location = {active_sequence, offset, location.size};
+                    ++iter;
+                } else {
+                    bytes_ -= location.size;
+                    ++evictions_;
+                    iter = index_.erase(iter);
+                }
+            }
+
+            const auto path = segment.path;
+            segments_.erase(oldest);
+
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    auto DiskCache::Index(std::string_view key, Location location) -> void {
+        const auto [iter, inserted] = index_.try_emplace(Hash(key), location);
+        if (!inserted) {
+            // Replaces the older response, or one whose key has the same hash
+            const auto& previous = iter->second;
+            segments_.at(previous.segment)->live -= previous.size;
+            bytes_ -= previous.size;
+            iter->second = location;
+        }
+
+        segments_.at(location.segment)->live += location.size;
+        bytes_ += location.size;
+    }
+
+    auto DiskCache::Unindex(std::string_view key) -> bool {
+        const auto iter = index_.find(Hash(key));
+        if (iter == index_.end() || KeyAt(iter->second) != key) return false;
+
+        const auto& location = iter->second;
+        segments_.at(location.segment)->live -= location.size;
+        bytes_ -= location.size;
+        index_.erase(iter);
+        return true;
+    }
+
+    auto DiskCache::KeyAt(Location location) const -> std::string_view {
+        const auto& segment = *segments_.at(location.segment);
+        return segment.KeyAt(location.offset, segment.HeaderAt(location.offset));
+    }
+}
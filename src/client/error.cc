@@ -5,10 +5,163 @@
 
 #include <cerrno>
 #include <sstream>
+#include <string>
 #include <system_error>
 
+#if defined(_WIN32)
+    #include <winsock2.h>
+#endif
+
 #include "exception.h"
 
+namespace Express {
+    class ErrorCategoryImpl : public std::error_category {
+    public:
+        auto name() const noexcept -> const char* override { return "express"; }
+
+        auto message(int code) const -> std::string override {
+            using enum ErrorCode;
+            switch (static_cast<ErrorCode>(code)) {
+                case kMissingUrlScheme:
+                    return "URL error: Missing URL scheme. Use 'http://' or 'https://'";
+                case kUnsupportedUrlScheme:
+                    return "URL error: Unsupported URL scheme. Use 'http://' or 'https://'";
+                case kInvalidHeaderName:
+                    return "Header error: Invalid header name";
+                case kInvalidHeaderValue:
+                    return "Header error: Invalid header value";
+                case kDataNotAllowed:
+                    return "Request error: Data can only be added for "
+                           "PUT, POST, DELETE, and PATCH requests";
+                case kUnsupportedCompression:
+                    return "Request error: The client was built without support "
+                           "for this compression";
+                case kResolveTimeout:
+                    return "Timeout error: Failed to resolve host in time";
+                case kConnectTimeout:
+                    return "Timeout error: Failed to connect";
+                case kSendTimeout:
+                    return "Timeout error: Failed to send data to the server";
+                case kFirstByteTimeout:
+                    return "Timeout error: The server didn't start responding in time";
+                case kRecvTimeout:
+                    return "Timeout error: Failed to receive data from the server";
+                case kIdleTimeout:
+                    return "Timeout error: The server stopped sending data";
+                case kTransferTooSlow:
+                    return "Timeout error: The transfer rate fell below the minimum";
+                case kQueueTimeout:
+                    return "Timeout error: Request expired while waiting to be sent";
+                case kMalformedStatusLine:
+                    return "Status line error: Malformed status line";
+                case kUnsupportedVersion:
+                    return "Status line error: Unsupported HTML version";
+                case kInvalidStatusCode:
+                    return "Status line error: Invalid status code";
+                case kInvalidReasonPhrase:
+                    return "Status line error: Invalid characters in reason phrase";
+                case kInvalidHeader:
+                    return "Response error: Failed to process invalid response header";
+                case kConflictingContentLength:
+                    return "Response error: Received multiple content length fields "
+                           "with different values";
+                case kUnsupportedTransferEncoding:
+                    return "Response error: Unsupport transfer encoding";
+                case kInvalidContentLength:
+                    return "Data reader error: Invalid contentlength value";
+                case kMissingChunkDelimiter:
+                    return "Response error: Every chunk must end with a delimiter";
+                case kInvalidChunkSize:
+                    return "Response error: Invalid chunk size";
+                case kIncompleteResponse:
+                    return "Response error: Incomplete data transfer";
+                case kInvalidContentEncoding:
+                    return "Response error: Failed to decode content encoding";
+                case kDecodedBodyTooLarge:
+                    return "Response error: Decoded body exceeds the maximum size";
+                case kQueueFull:
+                    return "Client error: Request queue is full";
+                case kCircuitOpen:
+                    return "Client error: Circuit breaker is open for this host";
+                case kTunnelRefused:
+                    return "Proxy error: The proxy refused to open a tunnel to the host";
+                case kNotEventStream:
+                    return "Event stream error: The response isn't a text/event-stream";
+                case kEventTooLarge:
+                    return "Event stream error: An event exceeded the maximum size";
+                case kHandshakeFailed:
+                    return "WebSocket error: The server didn't accept the upgrade to a WebSocket";
+                case kWebSocketProtocolError:
+                    return "WebSocket error: The server sent a malformed frame";
+                case kMessageTooLarge:
+                    return "WebSocket error: A message exceeded the maximum size";
+                case kWebSocketClosed:
+                    return "WebSocket error: The connection is closed";
+                case kResolveFailed:
+                    return "Failed to resolve host";
+            }
+            return "Unknown error";
+        }
+    };
+
+    class ErrorConditionCategoryImpl : public std::error_category {
+    public:
+        auto name() const noexcept -> const char* override { return "express condition"; }
+
+        auto message(int condition) const -> std::string override {
+            using enum ErrorCondition;
+            switch (static_cast<ErrorCondition>(condition)) {
+                case kRequestError: return "Request error";
+                case kResponseError: return "Response error";
+                case kTimeoutError: return "Timeout error";
+                case kSystemError: return "System error";
+            }
+            return "Unknown error";
+        }
+
+        auto equivalent(const std::error_code& code, int condition) const noexcept -> bool override {
+            using enum ErrorCondition;
+            if (code.category() != ErrorCategory()) {
+                return condition == static_cast<int>(kSystemError) && code.value() != 0;
+            }
+
+            const auto value = code.value();
+            switch (static_cast<ErrorCondition>(condition)) {
+                case kRequestError:
+                    return value >= static_cast<int>(ErrorCode::kMissingUrlScheme) &&
+                           value <= static_cast<int>(ErrorCode::kUnsupportedCompression);
+                case kResponseError:
+                    return value >= static_cast<int>(ErrorCode::kResolveTimeout) &&
+                           value <= static_cast<int>(ErrorCode::kWebSocketClosed);
+                case kTimeoutError:
+                    return value >= static_cast<int>(ErrorCode::kResolveTimeout) &&
+                           value <= static_cast<int>(ErrorCode::kQueueTimeout);
+                case kSystemError:
+                    return value == static_cast<int>(ErrorCode::kResolveFailed);
+            }
+            return false;
+        }
+    };
+
+    auto ErrorCategory() noexcept -> const std::error_category& {
+        static const ErrorCategoryImpl category;
+        return category;
+    }
+
+    auto ErrorConditionCategory() noexcept -> const std::error_category& {
+        static const ErrorConditionCategoryImpl category;
+        return category;
+    }
+
+    auto make_error_code(ErrorCode code) noexcept -> std::error_code {
+        return {static_cast<int>(code), ErrorCategory()};
+    }
+
+    auto make_error_condition(ErrorCondition condition) noexcept -> std::error_condition {
+        return {static_cast<int>(condition), ErrorConditionCategory()};
+    }
+}
+
 namespace Express::Error {
     std::string FormatString(std::string_view type, std::string_view what_arg) {
         std::stringstream output;
@@ -28,4 +181,32 @@ namespace Express::Error {
     void Runtime(std::string_view type, std::string_view what_arg) {
         throw Express::ResponseError { FormatString(type, what_arg) };
     }
-}
\ No newline at end of file
+
+    void Throw(std::error_code error, std::string_view context) {
+        if (error == ErrorCondition::kSystemError) {
+            if (context.empty()) throw std::system_error {error};
+            throw std::system_error {error, std::string {context}};
+        }
+        if (error == ErrorCondition::kRequestError) {
+            throw Express::RequestError {error.message()};
+        }
+        throw Express::ResponseError {error.message()};
+    }
+
+    void ThrowWithDetail(std::error_code error, std::string_view detail) {
+        auto message = error.message();
+        message.append(" (").append(detail).append(")");
+        if (error == ErrorCondition::kRequestError) {
+            throw Express::RequestError {message};
+        }
+        throw Express::ResponseError {message};
+    }
+
+    auto LastSystemError() -> std::error_code {
+        #if defined(_WIN32)
+            return {WSAGetLastError(), std::system_category()};
+        #else
+            return {errno, std::system_category()};
+        #endif
+    }
+}
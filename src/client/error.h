@@ -4,9 +4,29 @@
 #pragma once
 
 #include <string_view>
+#include <system_error>
+
+#include "express/error_code.h"
 
 namespace Express::Error {
     [[noreturn]] void System(std::string_view what_arg);
     [[noreturn]] void Logic(std::string_view type, std::string_view what_arg);
     [[noreturn]] void Runtime(std::string_view type, std::string_view what_arg);
-}
\ No newline at end of file
+
+    /*
+        Throws the exception that corresponds to an error code. The context
+        is used as the what_arg for system errors.
+    */
+    [[noreturn]] void Throw(std::error_code error, std::string_view context = {});
+
+    /*
+        Throws the exception that corresponds to a library error code, and
+        appends the detail to its message, e.g. "Invalid status code (32)".
+    */
+    [[noreturn]] void ThrowWithDetail(std::error_code error, std::string_view detail);
+
+    /*
+        Returns the last error reported by the socket APIs.
+    */
+    [[nodiscard]] auto LastSystemError() -> std::error_code;
+}
@@ -0,0 +1,172 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/event_stream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "express/error_code.h"
+#include "client/timeout.h"
+#include "client/transfer.h"
+#include "http/event_parser.h"
+#include "http/request_builder.h"
+#include "http/response_parser.h"
+#include "http/validators.h"
+#include "net/socket.h"
+#include "net/url.h"
+#include "utils/string_transformers.h"
+
+#if defined(_WIN32)
+    #include "net/winsock.h"
+#endif
+
+namespace Express {
+    namespace {
+        auto IsEventStream(const Headers& headers) -> bool {
+            const auto header = std::find_if(headers.begin(), headers.end(), [](const auto& field) {
+                return field.first == "content-type";
+            });
+            if (header == headers.end()) return false;
+
+            const std::string_view value {header->second.second};
+            constexpr std::string_view kEventStream {"text/event-stream"};
+            return value.size() >= kEventStream.size() &&
+                   StringTransformers::EqualsIgnoreCase(value.substr(0, kEventStream.size()), kEventStream);
+        }
+
+        auto IsStreamError(const std::error_code& ec) {
+            return ec == ErrorCode::kNotEventStream || ec == ErrorCode::kEventTooLarge;
+        }
+
+        /*
+            Opens a connection and delivers its events until it ends. The
+            connection may last for hours, and an arena only gives its
+            memory back once it's recycled, so the connection allocates
+            from the default resource instead.
+        */
+        auto ReadConnectionAsync(
+            const Config& config,
+            const EventStreamOptions& options,
+            Http::EventParser& events,
+            Net::EventLoop& loop,
+            Executor& executor,
+            EventStreamResult& result
+        ) -> Task<std::error_code> {
+            auto* resource = std::pmr::get_default_resource();
+            std::error_code ec;
+
+            const Limits limits {config};
+            const Net::Url url {config.url, resource, ec};
+            if (ec) co_return ec;
+
+            const Http::RequestBuilder request {config, resource, ec};
+            if (ec) co_return ec;
+
+            auto endpoint = Resolve(url.host(), url.port(), limits, ec);
+            if (ec) co_return ec;
+
+            const Net::Socket socket {std::move(endpoint), ec};
+            if (ec) co_return ec;
+            if (limits.stop.stop_requested()) co_return std::make_error_code(std::errc::operation_canceled);
+
+            ec = co_await ConnectAsync(socket, loop, limits);
+            if (!ec) ec = co_await SendAsync(socket, request.GetData(), loop, limits);
+            if (ec) co_return ec;
+            ++result.connections;
+
+            std::pmr::vector<unsigned char> buffer(BUFSIZ, resource);
+            const auto decoding = config.decompress ? Http::Decoding::kDecode : Http::Decoding::kRaw;
+            Http::ResponseParser parser {
+                resource, decoding, config.dictionaries.get(), config.max_decoded_bytes
+            };
+
+            // Other responses are read whole, and the events of a stream are
+            // delivered as they arrive, so its body never grows
+            auto checked = false;
+            const auto on_read = [&]() -> std::error_code {
+                if (!parser.headers_complete() || parser.status_code() != 200) return {};
+                if (!checked && !IsEventStream(parser.headers())) return ErrorCode::kNotEventStream;
+                checked = true;
+
+                std::error_code error;
+                events.Feed(parser.body(), [&](const Event& event) {
+                    ++result.events;
+                    options.on_event(event);
+                }, error);
+                parser.ClearBody();
+                return error;
+            };
+
+            std::size_t received = 0;
+            ec = co_await ReceiveAsync(socket, parser, buffer, loop, executor, limits, received, on_read);
+
+            std::error_code incomplete;
+            result.response = std::move(parser).response(incomplete);
+            events.Reset();
+            co_return ec;
+        }
+    }
+
+    auto StreamEventsAsync(
+        Config config,
+        EventStreamOptions options,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Executor> executor
+    ) -> Task<Expected<EventStreamResult>> {
+        #if defined(_WIN32)
+            Net::WinSock winsock;
+        #endif
+
+        if (!config.headers.Contains("accept")) config.headers.Add("Accept", "text/event-stream");
+        if (!config.headers.Contains("cache-control")) config.headers.Add("Cache-Control", "no-cache");
+        if (!options.on_event) options.on_event = [](const Event&) {};
+
+        // The stream resumes from the request's own Last-Event-ID header
+        // unless the options give one
+        auto last_event_id = std::move(options.last_event_id);
+        if (!Http::Validators::IsValidCharRange(last_event_id)) {
+            co_return Unexpected {make_error_code(ErrorCode::kInvalidHeaderValue)};
+        }
+        if (last_event_id.empty() && config.headers.Contains("last-event-id")) {
+            last_event_id = config.headers.Get("last-event-id");
+        }
+
+        EventStreamResult result;
+        Http::EventParser events {options.max_event_size, std::move(last_event_id)};
+        std::size_t failures = 0;
+
+        while (true) {
+            if (config.headers.Contains("last-event-id")) config.headers.Remove("last-event-id");
+            if (!events.last_event_id().empty()) {
+                config.headers.Add("Last-Event-ID", std::string {events.last_event_id()});
+            }
+
+            const auto delivered = result.events;
+            const auto ec = co_await ReadConnectionAsync(config, options, events, *loop, *executor, result);
+            result.last_event_id = events.last_event_id();
+
+            if (ec == std::errc::operation_canceled) co_return result;
+            if (IsStreamError(ec)) co_return Unexpected {ec};
+
+            // A server that answers with anything but a stream ends it
+            if (!ec && result.response.status_code != 200) co_return result;
+
+            // A connection that delivered events starts the count again
+            failures = result.events > delivered ? 0 : failures + 1;
+            if (failures > options.max_reconnects) {
+                co_return Unexpected {ec ? ec : std::make_error_code(std::errc::connection_reset)};
+            }
+
+            const auto delay = events.retry().value_or(options.retry);
+            if (delay > std::chrono::milliseconds::zero()) {
+                const auto wait = co_await loop->Sleep(Timeout {delay}, config.stop_token);
+                if (wait != Net::WaitResult::kTimeout) co_return result;
+            }
+        }
+    }
+}
@@ -0,0 +1,31 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <memory>
+
+#include "express/config.h"
+#include "express/event_stream.h"
+#include "express/executor.h"
+#include "express/expected.h"
+#include "express/task.h"
+
+#include "net/event_loop.h"
+
+namespace Express {
+    /*
+        Receives a Server-Sent Events stream, and delivers its events as
+        they arrive. When the connection ends, the stream reconnects after
+        the retry delay and resumes with Last-Event-ID. It ends when a stop
+        is requested, or when the server answers with anything but 200 and
+        an event stream, e.g. 204 No Content. The stream stays open for as
+        long as it's needed, so it isn't admitted by the scheduler.
+    */
+    [[nodiscard]] auto StreamEventsAsync(
+        Config config,
+        EventStreamOptions options,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Executor> executor
+    ) -> Task<Expected<EventStreamResult>>;
+}
@@ -0,0 +1,212 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/hedge.h"
+
+#include <algorithm>
+#include <coroutine>
+#include <memory_resource>
+#include <stop_token>
+#include <utility>
+
+#include "client/perform.h"
+#include "client/timeout.h"
+#include "net/url.h"
+
+namespace Express {
+    auto Hedger::Delay(
+        const HedgePolicy& policy,
+        std::string_view host
+    ) -> std::optional<std::chrono::nanoseconds> {
+        if (policy.percentile > 0.0) {
+            std::lock_guard lock {mutex_};
+            const auto iter = hosts_.find(host);
+            if (iter != hosts_.end() && iter->second.count >= kMinSamples) {
+                auto samples = iter->second.samples;
+                const auto count = iter->second.count;
+                const auto rank = std::min(
+                    static_cast<std::size_t>(policy.percentile * static_cast<double>(count)),
+                    count - 1
+                );
+                std::nth_element(samples.begin(), samples.begin() + rank, samples.begin() + count);
+                return samples[rank];
+            }
+        }
+        if (policy.delay > std::chrono::milliseconds::zero()) return policy.delay;
+        return std::nullopt;
+    }
+
+    auto Hedger::Earn(const HedgePolicy& policy) -> void {
+        budget_.Deposit(policy.budget);
+    }
+
+    auto Hedger::Spend() -> bool {
+        return budget_.Withdraw();
+    }
+
+    auto Hedger::Record(std::string_view host, std::chrono::nanoseconds latency) -> void {
+        std::lock_guard lock {mutex_};
+        auto iter = hosts_.find(host);
+        if (iter == hosts_.end()) iter = hosts_.try_emplace(std::string {host}).first;
+
+        auto& latencies = iter->second;
+        latencies.samples[latencies.next] = latency;
+        latencies.next = (latencies.next + 1) % kSamples;
+        latencies.count = std::min(latencies.count + 1, kSamples);
+    }
+
+    auto IsHedged(const Config& config) -> bool {
+        const auto& policy = config.hedge;
+        const auto enabled = policy.delay > std::chrono::milliseconds::zero() || policy.percentile > 0.0;
+        return enabled && (config.method == Method::Get || config.method == Method::Head);
+    }
+
+    namespace {
+        /*
+            The attempts of a hedged request. The first successful response
+            settles the race, as does the failure of every attempt that was
+            started. Attempts that lose are cancelled.
+        */
+        class Race {
+        public:
+            static constexpr std::size_t kAttempts = 2;
+
+            Race(std::shared_ptr<Hedger> hedger, std::string host)
+              : hedger_(std::move(hedger)), host_(std::move(host)) {}
+
+            // Requested once the race is settled, which ends the hedging delay early
+            [[nodiscard]] auto settled() const { return settled_.get_token(); }
+
+            // Returns false if the race is already settled
+            auto Start(
+                const std::shared_ptr<Race>& race,
+                Config config,
+                const std::shared_ptr<ArenaPool>& arenas,
+                const std::shared_ptr<Net::EventLoop>& loop,
+                const std::shared_ptr<Scheduler>& scheduler,
+                const std::shared_ptr<Executor>& executor
+            ) -> bool {
+                std::size_t index = 0;
+                {
+                    std::lock_guard lock {mutex_};
+                    if (done_) return false;
+                    index = started_++;
+                    starts_[index] = std::chrono::steady_clock::now();
+                }
+
+                config.stop_token = attempts_[index].get_token();
+                Detail::Complete(PerformAsync(std::move(config), arenas, loop, scheduler, executor),
+                    [race, index](Expected<Response> result) {
+                        race->Finish(index, std::move(result));
+                    }
+                );
+                return true;
+            }
+
+            auto Cancel() -> void {
+                for (auto& attempt : attempts_) attempt.request_stop();
+                settled_.request_stop();
+            }
+
+            class Awaiter {
+            public:
+                explicit Awaiter(Race& race) : race_(race) {}
+
+                auto await_ready() const noexcept { return false; }
+
+                auto await_suspend(std::coroutine_handle<> handle) -> bool {
+                    std::lock_guard lock {race_.mutex_};
+                    if (race_.done_) return false;
+                    race_.waiter_ = handle;
+                    return true;
+                }
+
+                auto await_resume() -> Expected<Response> { return std::move(*race_.result_); }
+
+            private:
+                Race& race_;
+            };
+
+            [[nodiscard]] auto Result() { return Awaiter {*this}; }
+
+        private:
+            std::shared_ptr<Hedger> hedger_;
+            std::string host_;
+
+            std::array<std::stop_source, kAttempts> attempts_;
+            std::stop_source settled_;
+
+            std::mutex mutex_;
+            std::array<std::chrono::steady_clock::time_point, kAttempts> starts_ {};
+            std::size_t started_ {0};
+            std::size_t failed_ {0};
+            bool done_ {false};
+            std::optional<Expected<Response>> result_;
+            std::coroutine_handle<> waiter_;
+
+            auto Finish(std::size_t index, Expected<Response> result) -> void {
+                std::coroutine_handle<> waiter;
+                {
+                    std::lock_guard lock {mutex_};
+                    if (done_) return;
+
+                    if (result) {
+                        hedger_->Record(host_, std::chrono::steady_clock::now() - starts_[index]);
+                    } else if (++failed_ < started_) {
+                        // Another attempt may still succeed
+                        return;
+                    }
+
+                    result_.emplace(std::move(result));
+                    done_ = true;
+                    waiter = std::exchange(waiter_, nullptr);
+                }
+
+                Cancel();
+                if (waiter) waiter.resume();
+            }
+        };
+    }
+
+    auto HedgedAsync(
+        Config config,
+        std::shared_ptr<Hedger> hedger,
+        std::shared_ptr<ArenaPool> arenas,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Scheduler> scheduler,
+        std::shared_ptr<Executor> executor
+    ) -> Task<Expected<Response>> {
+        std::error_code ec;
+        const Net::Url url {config.url, std::pmr::get_default_resource(), ec};
+        if (ec) co_return Unexpected {ec};
+
+        auto host = std::string {url.host()};
+        host.append(":").append(url.port());
+
+        hedger->Earn(config.hedge);
+        const auto delay = hedger->Delay(config.hedge, host);
+
+        auto race = std::make_shared<Race>(hedger, std::move(host));
+        const std::stop_callback on_stop {config.stop_token, [race] { race->Cancel(); }};
+
+        // The attempts get their own stop tokens, which the caller's token
+        // stops through the callback above
+        race->Start(race, config, arenas, loop, scheduler, executor);
+
+        if (delay) {
+            const auto milliseconds = std::max(
+                std::chrono::ceil<std::chrono::milliseconds>(*delay),
+                std::chrono::milliseconds {1}
+            );
+            const auto result = co_await loop->Sleep(Timeout {milliseconds}, race->settled());
+            if (result == Net::WaitResult::kTimeout && hedger->Spend()) {
+                // The sleep ends on the I/O thread, which mustn't resolve
+                // the host of the second copy
+                co_await Schedule(*executor);
+                race->Start(race, config, arenas, loop, scheduler, executor);
+            }
+        }
+
+        co_return co_await race->Result();
+    }
+}
@@ -0,0 +1,81 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "express/config.h"
+#include "express/executor.h"
+#include "express/expected.h"
+#include "express/response.h"
+#include "express/task.h"
+
+#include "client/scheduler.h"
+#include "client/token_bucket.h"
+#include "net/event_loop.h"
+#include "utils/arena_pool.h"
+
+namespace Express {
+    /*
+        The state hedging shares between the requests of a client: the
+        recent response times of every host, and the budget of extra
+        requests.
+    */
+    class Hedger {
+    public:
+        static constexpr std::size_t kSamples = 64;
+        static constexpr std::size_t kMinSamples = 16;
+
+        // The delay before a hedge is sent, if the policy has one for the host
+        [[nodiscard]] auto Delay(
+            const HedgePolicy& policy,
+            std::string_view host
+        ) -> std::optional<std::chrono::nanoseconds>;
+
+        // Every hedged request earns a share of a hedge, and sending a
+        // hedge spends a whole one
+        auto Earn(const HedgePolicy& policy) -> void;
+        [[nodiscard]] auto Spend() -> bool;
+
+        auto Record(std::string_view host, std::chrono::nanoseconds latency) -> void;
+
+    private:
+        // The budget can't be saved up beyond a burst of this many hedges
+        static constexpr double kBurst = 10.0;
+
+        struct Latencies {
+            std::array<std::chrono::nanoseconds, kSamples> samples {};
+            std::size_t count {0};
+            std::size_t next {0};
+        };
+
+        std::mutex mutex_;
+        std::map<std::string, Latencies, std::less<>> hosts_;
+        TokenBucket budget_ {kBurst, 0.0};
+    };
+
+    // Whether the request can be hedged under its policy
+    [[nodiscard]] auto IsHedged(const Config& config) -> bool;
+
+    /*
+        Processes a request, and sends a second copy over a new connection
+        if the first copy hasn't completed within the hedging delay. The
+        first successful response wins and the other copy is cancelled.
+    */
+    [[nodiscard]] auto HedgedAsync(
+        Config config,
+        std::shared_ptr<Hedger> hedger,
+        std::shared_ptr<ArenaPool> arenas,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Scheduler> scheduler,
+        std::shared_ptr<Executor> executor
+    ) -> Task<Expected<Response>>;
+}
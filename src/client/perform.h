@@ -0,0 +1,32 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <memory>
+
+#include "express/config.h"
+#include "express/executor.h"
+#include "express/expected.h"
+#include "express/response.h"
+#include "express/task.h"
+
+#include "client/scheduler.h"
+#include "net/event_loop.h"
+#include "utils/arena_pool.h"
+
+namespace Express {
+    /*
+        Processes a request without throwing. Instead of blocking a thread,
+        the request suspends on the event loop whenever the socket isn't ready.
+        Failures are reported as error codes so that the error path doesn't
+        pay for unwinding.
+    */
+    [[nodiscard]] auto PerformAsync(
+        Config config,
+        std::shared_ptr<ArenaPool> arenas,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Scheduler> scheduler,
+        std::shared_ptr<Executor> executor
+    ) -> Task<Expected<Response>>;
+}
@@ -0,0 +1,110 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/proxy.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "express/error_code.h"
+#include "client/error.h"
+#include "net/endpoint.h"
+#include "net/socket.h"
+#include "net/url.h"
+#include "utils/string_transformers.h"
+
+namespace Express {
+    Proxy::Proxy(std::string_view url, ProxyOptions options) : options_(std::move(options)) {
+        if (auto ec = Open(url)) Error::Throw(ec, "Proxy error");
+    }
+
+    Proxy::Proxy(std::string_view url, ProxyOptions options, std::error_code& ec)
+      : options_(std::move(options)) {
+        ec = Open(url);
+    }
+
+    Proxy::~Proxy() = default;
+
+    auto Proxy::Open(std::string_view url) -> std::error_code {
+        std::error_code ec;
+        const Net::Url proxy {url, std::pmr::get_default_resource(), ec};
+        if (ec) return ec;
+
+        // Speaking to the proxy itself over TLS isn't supported
+        if (proxy.scheme() != "http") return ErrorCode::kUnsupportedUrlScheme;
+
+        auto endpoint = std::make_unique<Net::Endpoint>(proxy.host(), proxy.port(), ec);
+        if (ec) return ec;
+        endpoint_ = std::move(endpoint);
+
+        std::string credentials;
+        if (!options_.auth.Empty()) {
+            credentials.append(options_.auth.username).append(":").append(options_.auth.password);
+        } else if (proxy.HasUserInformation()) {
+            credentials.append(proxy.user()).append(":").append(proxy.password());
+        }
+        if (!credentials.empty()) {
+            authorization_ = "Basic " + StringTransformers::Base64Encoding(credentials);
+        }
+        return {};
+    }
+
+    auto Proxy::Bypasses(std::string_view host) const -> bool {
+        using StringTransformers::EqualsIgnoreCase;
+
+        return std::any_of(options_.no_proxy.begin(), options_.no_proxy.end(), [host](std::string_view entry) {
+            if (entry == "*") return true;
+            if (entry.starts_with('.')) entry.remove_prefix(1);
+            if (entry.empty() || host.size() < entry.size()) return false;
+            if (host.size() == entry.size()) return EqualsIgnoreCase(host, entry);
+
+            // A subdomain of the entry, but not a host that merely ends like it
+            const auto suffix = host.substr(host.size() - entry.size());
+            return host[host.size() - entry.size() - 1] == '.' && EqualsIgnoreCase(suffix, entry);
+        });
+    }
+
+    auto Proxy::Acquire(std::string_view destination, Clock::time_point now) -> std::unique_ptr<Net::Socket> {
+        std::lock_guard lock {mutex_};
+        const auto iter = idle_.find(destination);
+        if (iter == idle_.end()) return nullptr;
+
+        // The most recent connection is the likeliest to still be open,
+        // and the ones idle for too long are closed
+        auto& connections = iter->second;
+        while (!connections.empty()) {
+            auto connection = std::move(connections.back());
+            connections.pop_back();
+            if (now - connection.idle_since < options_.idle_timeout) return std::move(connection.socket);
+        }
+        return nullptr;
+    }
+
+    auto Proxy::Release(
+        std::string_view destination,
+        std::unique_ptr<Net::Socket> connection,
+        Clock::time_point now
+    ) -> void {
+        if (!connection) return;
+
+        std::lock_guard lock {mutex_};
+        auto iter = idle_.find(destination);
+        if (iter == idle_.end()) iter = idle_.emplace(std::string {destination}, std::vector<Connection> {}).first;
+
+        auto& connections = iter->second;
+        std::erase_if(connections, [&](const auto& idle) { return now - idle.idle_since >= options_.idle_timeout; });
+        if (connections.size() < options_.max_idle_connections) {
+            connections.push_back({std::move(connection), now});
+        }
+    }
+
+    auto Proxy::endpoint() const -> const Net::Endpoint& {
+        return *endpoint_;
+    }
+
+    auto Proxy::idle(std::string_view destination) const -> std::size_t {
+        std::lock_guard lock {mutex_};
+        const auto iter = idle_.find(destination);
+        return iter == idle_.end() ? 0 : iter->second.size();
+    }
+}
@@ -0,0 +1,74 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/retry.h"
+
+#include <algorithm>
+#include <random>
+
+#include "express/error_code.h"
+#include "http/date.h"
+
+namespace Express {
+    namespace {
+        // Errors that leave no doubt the request never reached the server
+        auto IsConnectError(const std::error_code& ec) {
+            return ec == ErrorCode::kResolveFailed ||
+                   ec == ErrorCode::kResolveTimeout ||
+                   ec == ErrorCode::kConnectTimeout ||
+                   ec == std::errc::connection_refused ||
+                   ec == std::errc::network_unreachable ||
+                   ec == std::errc::host_unreachable;
+        }
+
+        auto IsTransientError(const std::error_code& ec) {
+            if (ec == std::errc::operation_canceled) return false;
+            if (ec == ErrorCode::kQueueFull || ec == ErrorCode::kQueueTimeout) return false;
+            return ec == ErrorCondition::kTimeoutError ||
+                   ec == ErrorCondition::kSystemError ||
+                   ec == ErrorCode::kIncompleteResponse;
+        }
+    }
+
+    auto IsIdempotent(Method method) -> bool {
+        using enum Method;
+        return method == Get || method == Head || method == Options || method == Put || method == Delete;
+    }
+
+    auto IsRetryable(const Config& config, const Expected<Response>& result) -> bool {
+        if (!result) {
+            if (IsConnectError(result.error())) return true;
+            return IsIdempotent(config.method) && IsTransientError(result.error());
+        }
+
+        const auto& codes = config.retry.status_codes;
+        return IsIdempotent(config.method) &&
+               std::find(codes.begin(), codes.end(), result->status_code) != codes.end();
+    }
+
+    auto ParseRetryAfter(
+        std::string_view value,
+        std::chrono::system_clock::time_point now
+    ) -> std::optional<std::chrono::milliseconds> {
+        using std::chrono::duration_cast;
+        using std::chrono::milliseconds;
+
+        if (const auto seconds = Http::ParseDeltaSeconds(value)) return *seconds;
+
+        const auto date = Http::ParseHttpDate(value);
+        if (!date) return std::nullopt;
+        return std::max(duration_cast<milliseconds>(*date - now), milliseconds::zero());
+    }
+
+    auto NextDelay(
+        const RetryPolicy& policy,
+        std::chrono::milliseconds previous
+    ) -> std::chrono::milliseconds {
+        thread_local std::minstd_rand generator {std::random_device {}()};
+
+        const auto low = policy.base_delay.count();
+        const auto high = std::max(low, previous.count() * 3);
+        std::uniform_int_distribution<std::chrono::milliseconds::rep> distribution {low, high};
+        return std::min(std::chrono::milliseconds {distribution(generator)}, policy.max_delay);
+    }
+}
@@ -0,0 +1,102 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+#include "express/config.h"
+#include "express/executor.h"
+#include "express/expected.h"
+#include "express/response.h"
+#include "express/task.h"
+
+#include "client/timeout.h"
+#include "client/token_bucket.h"
+#include "net/event_loop.h"
+
+namespace Express {
+    /*
+        The retry budget a client shares between its requests.
+    */
+    class Retrier {
+    public:
+        // A client can retry this many requests before it has earned any
+        // budget, so retries work at low traffic as well
+        static constexpr double kBurst = 10.0;
+
+        auto Earn(const RetryPolicy& policy) -> void { budget_.Deposit(policy.budget); }
+        [[nodiscard]] auto Spend() -> bool { return budget_.Withdraw(); }
+
+    private:
+        TokenBucket budget_ {kBurst, kBurst};
+    };
+
+    // Whether a request with this method can be sent twice without side effects
+    [[nodiscard]] auto IsIdempotent(Method method) -> bool;
+
+    // Whether the result of an attempt should be retried under the policy
+    [[nodiscard]] auto IsRetryable(const Config& config, const Expected<Response>& result) -> bool;
+
+    // Parses a Retry-After value, given in seconds or as an HTTP date
+    [[nodiscard]] auto ParseRetryAfter(
+        std::string_view value,
+        std::chrono::system_clock::time_point now = std::chrono::system_clock::now()
+    ) -> std::optional<std::chrono::milliseconds>;
+
+    // Picks the next delay with decorrelated jitter
+    [[nodiscard]] auto NextDelay(
+        const RetryPolicy& policy,
+        std::chrono::milliseconds previous
+    ) -> std::chrono::milliseconds;
+
+    /*
+        Runs attempts of a request until one succeeds, the result isn't
+        retryable, or the policy, the budget or the request's timeout runs
+        out. The timeout covers every attempt and the delays between them.
+        Attempts after a delay start on the executor, not on the I/O thread.
+    */
+    template <class Attempt>
+    auto RetryAsync(
+        Config config,
+        std::shared_ptr<Retrier> retrier,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Executor> executor,
+        Attempt attempt
+    ) -> Task<Expected<Response>> {
+        const auto& policy = config.retry;
+        const Timeout total {config.timeout};
+        retrier->Earn(policy);
+
+        auto delay = policy.base_delay;
+        for (std::size_t retries = 0;; ++retries) {
+            auto result = co_await attempt(config);
+            if (retries == policy.max_retries || !IsRetryable(config, result)) co_return result;
+
+            delay = NextDelay(policy, delay);
+            if (result && result->headers.Contains("retry-after")) {
+                const auto retry_after = ParseRetryAfter(result->headers.Get("retry-after"));
+                if (retry_after && *retry_after > policy.max_delay) co_return result;
+                if (retry_after) delay = std::max(delay, *retry_after);
+            }
+
+            // Each attempt gets the rest of the request's timeout
+            if (total.has_timeout()) {
+                const auto remaining = std::chrono::milliseconds {total.Get()};
+                if (remaining <= delay) co_return result;
+                config.timeout = remaining - delay;
+            }
+            if (!retrier->Spend()) co_return result;
+
+            const auto wait = co_await loop->Sleep(Timeout {delay}, config.stop_token);
+            if (wait != Net::WaitResult::kTimeout) {
+                co_return Unexpected {std::make_error_code(std::errc::operation_canceled)};
+            }
+            co_await Schedule(*executor);
+        }
+    }
+}
@@ -0,0 +1,28 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/routing.h"
+
+#include "express/proxy.h"
+#include "express/upstream.h"
+
+namespace Express {
+    auto RoutingKey(const Config& config, const Net::Url& url) -> std::string_view {
+        if (!config.routing_key.empty() || !config.upstream) return config.routing_key;
+
+        switch (config.upstream->options().hash_key) {
+            case HashKey::Url:
+                return config.url;
+            case HashKey::Path:
+                return url.path();
+            case HashKey::Host:
+                return url.host();
+        }
+        return config.url;
+    }
+
+    auto ProxyFor(const Config& config, const Net::Url& url) -> Proxy* {
+        if (!config.proxy || config.upstream) return nullptr;
+        return config.proxy->Bypasses(url.host()) ? nullptr : config.proxy.get();
+    }
+}
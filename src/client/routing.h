@@ -0,0 +1,20 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <string_view>
+
+#include "express/config.h"
+
+#include "net/url.h"
+
+namespace Express {
+    // The key the request's upstream routes it on: its routing key, or the
+    // part of its URL that the upstream hashes
+    [[nodiscard]] auto RoutingKey(const Config& config, const Net::Url& url) -> std::string_view;
+
+    // The proxy the request is sent through, or nullptr if it's sent
+    // directly. Requests to an upstream group never use the proxy.
+    [[nodiscard]] auto ProxyFor(const Config& config, const Net::Url& url) -> Proxy*;
+}
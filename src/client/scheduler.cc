@@ -0,0 +1,155 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "scheduler.h"
+
+#include <algorithm>
+#include <system_error>
+
+namespace Express {
+    namespace {
+        // A max-heap comparator, so the request that should run first is at the front
+        auto RunsLater(const AdmitAwaiter* lhs, const AdmitAwaiter* rhs) {
+            return rhs->Before(*lhs);
+        }
+    }
+
+    Slot::~Slot() {
+        if (scheduler_ != nullptr) scheduler_->Release();
+    }
+
+    Scheduler::Scheduler(std::shared_ptr<Executor> executor, const SchedulerOptions& options)
+      : executor_(std::move(executor)), options_(options) {
+        options_.max_active_requests = std::max<std::size_t>(options_.max_active_requests, 1);
+    }
+
+    auto Scheduler::Admit(
+        Priority priority,
+        const Timeout& timeout,
+        std::stop_token stop
+    ) -> AdmitAwaiter {
+        return AdmitAwaiter {*this, priority, timeout, std::move(stop)};
+    }
+
+    auto Scheduler::active() const -> std::size_t {
+        std::lock_guard lock {mutex_};
+        return active_;
+    }
+
+    auto Scheduler::queued() const -> std::size_t {
+        std::lock_guard lock {mutex_};
+        return queue_.size();
+    }
+
+    auto Scheduler::Enqueue(AdmitAwaiter* awaiter) -> bool {
+        std::lock_guard lock {mutex_};
+
+        // A stop requested before the lock was taken found nothing to cancel
+        if (awaiter->stop_.stop_requested()) {
+            awaiter->error_ = std::make_error_code(std::errc::operation_canceled);
+            return false;
+        }
+        if (awaiter->has_deadline_ && awaiter->deadline_ <= steady_clock::now()) {
+            awaiter->error_ = ErrorCode::kQueueTimeout;
+            return false;
+        }
+        if (active_ < options_.max_active_requests && queue_.empty()) {
+            ++active_;
+            return false;
+        }
+        if (queue_.size() >= options_.max_queue_depth) {
+            awaiter->error_ = ErrorCode::kQueueFull;
+            return false;
+        }
+
+        awaiter->sequence_ = sequence_++;
+        queue_.push_back(awaiter);
+        std::push_heap(queue_.begin(), queue_.end(), RunsLater);
+        return true;
+    }
+
+    auto Scheduler::Cancel(AdmitAwaiter* awaiter) -> void {
+        {
+            std::lock_guard lock {mutex_};
+            const auto iter = std::find(queue_.begin(), queue_.end(), awaiter);
+            if (iter == queue_.end()) return;
+
+            queue_.erase(iter);
+            std::make_heap(queue_.begin(), queue_.end(), RunsLater);
+            awaiter->error_ = std::make_error_code(std::errc::operation_canceled);
+        }
+        executor_->Execute(awaiter);
+    }
+
+    auto Scheduler::Release() -> void {
+        // Waiters are resumed outside the lock, since the executor may run
+        // them inline and they may release their own slots.
+        AdmitAwaiter* expired = nullptr;
+        AdmitAwaiter* next = nullptr;
+        {
+            std::lock_guard lock {mutex_};
+            const auto now = steady_clock::now();
+            while (!queue_.empty() && next == nullptr) {
+                std::pop_heap(queue_.begin(), queue_.end(), RunsLater);
+                auto* awaiter = queue_.back();
+                queue_.pop_back();
+
+                if (awaiter->has_deadline_ && awaiter->deadline_ <= now) {
+                    awaiter->error_ = ErrorCode::kQueueTimeout;
+                    awaiter->next = expired;
+                    expired = awaiter;
+                } else {
+                    // The slot passes to the next request, so active_ doesn't change
+                    next = awaiter;
+                }
+            }
+            if (next == nullptr) --active_;
+        }
+
+        while (expired != nullptr) {
+            auto* awaiter = expired;
+            expired = static_cast<AdmitAwaiter*>(awaiter->next);
+            executor_->Execute(awaiter);
+        }
+        if (next != nullptr) executor_->Execute(next);
+    }
+
+    AdmitAwaiter::AdmitAwaiter(
+        Scheduler& scheduler,
+        Priority priority,
+        const Timeout& timeout,
+        std::stop_token stop
+    ) : Work(&AdmitAwaiter::Resume),
+        scheduler_(scheduler),
+        priority_(priority),
+        has_deadline_(timeout.has_timeout()),
+        deadline_(timeout.expiry()),
+        stop_(std::move(stop)) {}
+
+    auto AdmitAwaiter::await_suspend(std::coroutine_handle<> handle) -> bool {
+        handle_ = handle;
+        if (stop_.stop_possible()) on_stop_.emplace(stop_, Canceller {this});
+        return scheduler_.Enqueue(this);
+    }
+
+    auto AdmitAwaiter::await_resume() -> Expected<Slot> {
+        on_stop_.reset();
+        if (error_) return Unexpected {error_};
+        return Slot {&scheduler_};
+    }
+
+    auto AdmitAwaiter::Before(const AdmitAwaiter& other) const -> bool {
+        if (priority_ != other.priority_) return priority_ < other.priority_;
+        if (has_deadline_ != other.has_deadline_) return has_deadline_;
+        if (has_deadline_ && deadline_ != other.deadline_) return deadline_ < other.deadline_;
+        return sequence_ < other.sequence_;
+    }
+
+    auto AdmitAwaiter::Canceller::operator()() const -> void {
+        awaiter->scheduler_.Cancel(awaiter);
+    }
+
+    auto AdmitAwaiter::Resume(Work* work) -> void {
+        static_cast<AdmitAwaiter*>(work)->handle_.resume();
+    }
+}
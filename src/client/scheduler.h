@@ -0,0 +1,125 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <vector>
+
+#include "express/config.h"
+#include "express/executor.h"
+#include "express/expected.h"
+#include "express/scheduler.h"
+
+#include "client/timeout.h"
+
+namespace Express {
+    class Scheduler;
+
+    /*
+        Permission to process a request. The slot is returned to the
+        scheduler when it's destroyed.
+    */
+    class Slot {
+    public:
+        explicit Slot(Scheduler* scheduler) : scheduler_(scheduler) {}
+
+        Slot(Slot&& src) noexcept : scheduler_(src.scheduler_) { src.scheduler_ = nullptr; }
+        auto operator=(Slot&& rhs) = delete;
+        Slot(const Slot&) = delete;
+        auto operator=(const Slot&) -> Slot& = delete;
+
+        ~Slot();
+
+    private:
+        Scheduler* scheduler_;
+    };
+
+    class AdmitAwaiter;
+
+    /*
+        Limits the number of requests that are processed at once. Requests
+        that can't start wait in a queue ordered by priority, then by the
+        earliest deadline, then by arrival. Requests whose deadline passes
+        while they wait are dropped before they're sent, and requests that
+        arrive when the queue is full are rejected immediately. Requests
+        that are cancelled while they wait leave the queue at once.
+    */
+    class Scheduler {
+    public:
+        Scheduler(std::shared_ptr<Executor> executor, const SchedulerOptions& options);
+
+        Scheduler(const Scheduler&) = delete;
+        auto operator=(const Scheduler&) -> Scheduler& = delete;
+
+        // Waiting requests are resumed on the executor
+        [[nodiscard]] auto Admit(
+            Priority priority,
+            const Timeout& timeout,
+            std::stop_token stop = {}
+        ) -> AdmitAwaiter;
+
+        [[nodiscard]] auto active() const -> std::size_t;
+        [[nodiscard]] auto queued() const -> std::size_t;
+
+    private:
+        friend class Slot;
+        friend class AdmitAwaiter;
+
+        std::shared_ptr<Executor> executor_;
+        SchedulerOptions options_;
+
+        mutable std::mutex mutex_;
+        std::vector<AdmitAwaiter*> queue_;
+        std::size_t active_ {0};
+        std::uint64_t sequence_ {0};
+
+        auto Enqueue(AdmitAwaiter* awaiter) -> bool;
+        auto Cancel(AdmitAwaiter* awaiter) -> void;
+        auto Release() -> void;
+    };
+
+    class AdmitAwaiter : public Work {
+    public:
+        AdmitAwaiter(
+            Scheduler& scheduler,
+            Priority priority,
+            const Timeout& timeout,
+            std::stop_token stop
+        );
+
+        auto await_ready() const noexcept { return false; }
+        auto await_suspend(std::coroutine_handle<> handle) -> bool;
+        auto await_resume() -> Expected<Slot>;
+
+        // Whether this request should be admitted before the other request
+        [[nodiscard]] auto Before(const AdmitAwaiter& other) const -> bool;
+
+    private:
+        friend class Scheduler;
+
+        struct Canceller {
+            AdmitAwaiter* awaiter;
+            auto operator()() const -> void;
+        };
+
+        Scheduler& scheduler_;
+        Priority priority_;
+        bool has_deadline_;
+        steady_clock::time_point deadline_;
+        std::uint64_t sequence_ {0};
+
+        std::coroutine_handle<> handle_;
+        std::error_code error_;
+
+        std::stop_token stop_;
+        std::optional<std::stop_callback<Canceller>> on_stop_;
+
+        static auto Resume(Work* work) -> void;
+    };
+}
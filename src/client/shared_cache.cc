@@ -0,0 +1,307 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/cache.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+#include <thread>
+
+#include "client/cache_codec.h"
+#include "utils/hash.h"
+#include "utils/shared_memory.h"
+
+namespace Express {
+    namespace {
+        // The segment is a header, the fill leases, and the slots. It's
+        // accessed as 64-bit words through std::atomic_ref, since other
+        // processes read and write it at the same time.
+        enum HeaderWord : std::size_t {kState, kVersion, kSlotBytes, kSlotCount, kEvictions, kHeaderWords = 8};
+        enum State : std::uint64_t {kUninitialized, kInitializing, kReady};
+
+        // A slot is a seqlock. Its sequence is odd while it's written.
+        enum SlotWord : std::size_t {kSequence, kHash, kStamp, kSizes, kSlotHeaderWords};
+
+        constexpr std::uint64_t kLayoutVersion {1};
+        constexpr std::size_t kWays {4};
+        constexpr std::size_t kLeases {1024};
+
+        // A read that keeps overlapping writes is a miss
+        constexpr auto kReadAttempts = 16;
+
+        constexpr std::size_t kWordBytes {sizeof(std::uint64_t)};
+
+        auto Word(std::uint64_t* words, std::size_t index) {
+            return std::atomic_ref {words[index]};
+        }
+
+        // Zero marks an empty slot
+        auto Hash(std::string_view key) {
+            return std::max<std::uint64_t>(Fnv1a(key), 1);
+        }
+
+        // Leases are compared in milliseconds of the monotonic clock, which
+        // is the same for every process on the host
+        auto NowMilliseconds() {
+            const auto now = std::chrono::steady_clock::now().time_since_epoch();
+            return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+        }
+
+        auto LeaseTag(std::uint64_t hash) {
+            return static_cast<std::uint32_t>(hash >> 32) | 1;
+        }
+    }
+
+    SharedCache::SharedCache(SharedCacheOptions options) : options_(std::move(options)) {
+        const auto slot_bytes = std::max<std::size_t>(
+            (options_.slot_bytes + kWordBytes - 1) / kWordBytes * kWordBytes,
+            (kSlotHeaderWords + 8) * kWordBytes
+        );
+        const auto reserved = (kHeaderWords + kLeases) * kWordBytes;
+        const auto slot_sets = options_.max_bytes > reserved ? (options_.max_bytes - reserved) / slot_bytes / kWays : 0;
+
+        slot_words_ = slot_bytes / kWordBytes;
+        slot_count_ = std::max<std::size_t>(slot_sets, 1) * kWays;
+        memory_ = std::make_unique<SharedMemory>(options_.name, reserved + slot_count_ * slot_bytes);
+
+        header_ = reinterpret_cast<std::uint64_t*>(memory_->data());
+        leases_ = header_ + kHeaderWords;
+        slots_ = leases_ + kLeases;
+
+        // The first process lays out the segment, and the others wait for it
+        auto state = Word(header_, kState);
+        auto expected = std::uint64_t {kUninitialized};
+        if (state.compare_exchange_strong(expected, kInitializing, std::memory_order_acq_rel)) {
+            Word(header_, kVersion).store(kLayoutVersion, std::memory_order_relaxed);
+            Word(header_, kSlotBytes).store(slot_bytes, std::memory_order_relaxed);
+            Word(header_, kSlotCount).store(slot_count_, std::memory_order_relaxed);
+            state.store(kReady, std::memory_order_release);
+        } else {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds {1};
+            while (state.load(std::memory_order_acquire) != kReady) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    throw std::system_error {std::make_error_code(std::errc::device_or_resource_busy), "Cache error"};
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        if (Word(header_, kVersion).load(std::memory_order_relaxed) != kLayoutVersion ||
+            Word(header_, kSlotBytes).load(std::memory_order_relaxed) != slot_bytes ||
+            Word(header_, kSlotCount).load(std::memory_order_relaxed) != slot_count_) {
+            throw std::system_error {
+                std::make_error_code(std::errc::invalid_argument),
+                "Cache error: The shared cache was created with different options"
+            };
+        }
+    }
+
+    auto SharedCache::Find(std::string_view key) -> std::optional<CachedResponse> {
+        const auto hash = Hash(key);
+        const auto set = hash % (slot_count_ / kWays) * kWays;
+
+        for (std::size_t way = 0; way < kWays; ++way) {
+            if (const auto value = Read(Slot(set + way), hash, key)) return DecodeEntry(*value);
+        }
+        return std::nullopt;
+    }
+
+    auto SharedCache::Store(std::string_view key, CachedResponse entry) -> void {
+        const auto value = EncodeEntry(entry);
+        if (key.size() + value.size() > (slot_words_ - kSlotHeaderWords) * kWordBytes) {
+            // The stored response is out of date either way
+            Remove(key);
+            return;
+        }
+
+        const auto hash = Hash(key);
+        const auto set = hash % (slot_count_ / kWays) * kWays;
+
+        // The slot that holds the key, or an empty slot, or the oldest one
+        std::optional<std::size_t> match;
+        std::optional<std::size_t> empty;
+        auto oldest = set;
+        for (auto index = set; index < set + kWays; ++index) {
+            const auto slot_hash = Word(Slot(index), kHash).load(std::memory_order_relaxed);
+            if (slot_hash == hash) {
+                match = index;
+                break;
+            }
+            if (slot_hash == 0) {
+                if (!empty) empty = index;
+            } else if (Word(Slot(index), kStamp).load(std::memory_order_relaxed) <
+                       Word(Slot(oldest), kStamp).load(std::memory_order_relaxed)) {
+                oldest = index;
+            }
+        }
+        const auto target = match.value_or(empty.value_or(oldest));
+
+        const auto previous = Word(Slot(target), kHash).load(std::memory_order_relaxed);
+        if (!Write(Slot(target), hash, key, value)) return;
+        if (previous != 0 && previous != hash) Word(header_, kEvictions).fetch_add(1, std::memory_order_relaxed);
+
+        // Another process may have stored the key in another slot of the set
+        for (auto index = set; index < set + kWays; ++index) {
+            if (index != target && Word(Slot(index), kHash).load(std::memory_order_relaxed) == hash) {
+                Write(Slot(index), 0, {}, {});
+            }
+        }
+    }
+
+    auto SharedCache::Remove(std::string_view key) -> void {
+        const auto hash = Hash(key);
+        const auto set = hash % (slot_count_ / kWays) * kWays;
+
+        for (std::size_t way = 0; way < kWays; ++way) {
+            auto* slot = Slot(set + way);
+            if (Word(slot, kHash).load(std::memory_order_relaxed) == hash) Write(slot, 0, {}, {});
+        }
+    }
+
+    auto SharedCache::stats() const -> CacheStats {
+        auto stats = Cache::stats();
+        for (std::size_t index = 0; index < slot_count_; ++index) {
+            auto* slot = Slot(index);
+            if (Word(slot, kHash).load(std::memory_order_relaxed) == 0) continue;
+
+            const auto sizes = Word(slot, kSizes).load(std::memory_order_relaxed);
+            ++stats.entries;
+            stats.bytes += (sizes >> 32) + (sizes & 0xFFFFFFFF);
+        }
+        stats.evictions = Word(header_, kEvictions).load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    auto SharedCache::ClaimRevalidation(std::string_view key) -> bool {
+        return Claim(key);
+    }
+
+    auto SharedCache::ReleaseRevalidation(std::string_view key) -> void {
+        Release(key);
+    }
+
+    auto SharedCache::ClaimFill(std::string_view key) -> bool {
+        return Claim(key);
+    }
+
+    auto SharedCache::ReleaseFill(std::string_view key) -> void {
+        Release(key);
+    }
+
+    auto SharedCache::shared() const -> bool {
+        return true;
+    }
+
+    auto SharedCache::Unlink(std::string_view name) -> void {
+        SharedMemory::Unlink(name);
+    }
+
+    SharedCache::~SharedCache() = default;
+
+    auto SharedCache::Slot(std::size_t index) const -> std::uint64_t* {
+        return slots_ + index * slot_words_;
+    }
+
+    auto SharedCache::Read(std::uint64_t* slot, std::uint64_t hash, std::string_view key) const
+        -> std::optional<std::string> {
+        std::string buffer;
+        for (auto attempt = 0; attempt < kReadAttempts; ++attempt) {
+            const auto sequence = Word(slot, kSequence).load(std::memory_order_acquire);
+            if (sequence & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (Word(slot, kHash).load(std::memory_order_acquire) != hash) return std::nullopt;
+
+            const auto sizes = Word(slot, kSizes).load(std::memory_order_acquire);
+            const auto key_size = static_cast<std::size_t>(sizes >> 32);
+            const auto value_size = static_cast<std::size_t>(sizes & 0xFFFFFFFF);
+            const auto words = (key_size + value_size + kWordBytes - 1) / kWordBytes;
+
+            if (words <= slot_words_ - kSlotHeaderWords) {
+                buffer.resize(words * kWordBytes);
+                // Acquire loads keep the sequence check below after the copy
+                for (std::size_t i = 0; i < words; ++i) {
+                    const auto word = Word(slot, kSlotHeaderWords + i).load(std::memory_order_acquire);
+                    std::memcpy(buffer.data() + i * kWordBytes, &word, kWordBytes);
+                }
+            }
+
+            // The copy is only valid if no write started in the meantime
+            if (Word(slot, kSequence).load(std::memory_order_relaxed) != sequence) continue;
+            if (words > slot_words_ - kSlotHeaderWords || std::string_view {buffer}.substr(0, key_size) != key) {
+                return std::nullopt;
+            }
+
+            buffer.resize(key_size + value_size);
+            buffer.erase(0, key_size);
+            return buffer;
+        }
+        return std::nullopt;
+    }
+
+    auto SharedCache::Write(std::uint64_t* slot, std::uint64_t hash, std::string_view key, std::string_view value)
+        -> bool {
+        // A slot that another process is writing is left to it
+        auto sequence = Word(slot, kSequence).load(std::memory_order_relaxed);
+        if ((sequence & 1) || !Word(slot, kSequence).compare_exchange_strong(sequence, sequence + 1,
+                                                                             std::memory_order_relaxed)) {
+            return false;
+        }
+
+        // Release stores keep the odd sequence ahead of the slot's contents
+        const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        Word(slot, kHash).store(hash, std::memory_order_release);
+        Word(slot, kStamp).store(static_cast<std::uint64_t>(stamp), std::memory_order_release);
+        Word(slot, kSizes).store((std::uint64_t {key.size()} << 32) | value.size(), std::memory_order_release);
+
+        // The key and the value are packed into the slot's words
+        const auto size = key.size() + value.size();
+        for (std::size_t offset = 0; offset < size; offset += kWordBytes) {
+            std::array<char, kWordBytes> bytes {};
+            for (std::size_t i = 0; i < kWordBytes && offset + i < size; ++i) {
+                const auto position = offset + i;
+                bytes[i] = position < key.size() ? key[position] : value[position - key.size()];
+            }
+
+            std::uint64_t word {0};
+            std::memcpy(&word, bytes.data(), kWordBytes);
+            Word(slot, kSlotHeaderWords + offset / kWordBytes).store(word, std::memory_order_release);
+        }
+
+        Word(slot, kSequence).store(sequence + 2, std::memory_order_release);
+        return true;
+    }
+
+    auto SharedCache::Claim(std::string_view key) -> bool {
+        const auto hash = Hash(key);
+        auto lease = Word(leases_, hash % kLeases);
+
+        const auto now = NowMilliseconds();
+        const auto deadline = now + static_cast<std::uint32_t>(options_.fill_timeout.count());
+        const auto claimed = (std::uint64_t {LeaseTag(hash)} << 32) | deadline;
+
+        auto current = lease.load(std::memory_order_relaxed);
+        while (true) {
+            // A lease is the key's tag and when it expires
+            const auto held = current != 0 && static_cast<std::int32_t>(static_cast<std::uint32_t>(current) - now) > 0;
+            if (held) {
+                // A lease for another key that shares the word doesn't hold this one off
+                return (current >> 32) != LeaseTag(hash);
+            }
+            if (lease.compare_exchange_weak(current, claimed, std::memory_order_acq_rel)) return true;
+        }
+    }
+
+    auto SharedCache::Release(std::string_view key) -> void {
+        const auto hash = Hash(key);
+        auto lease = Word(leases_, hash % kLeases);
+
+        auto current = lease.load(std::memory_order_relaxed);
+        if ((current >> 32) == LeaseTag(hash)) lease.compare_exchange_strong(current, 0, std::memory_order_acq_rel);
+    }
+}
@@ -0,0 +1,205 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace Express {
+    namespace {
+        /*
+            A bounded ring buffer. The owner pushes and pops at the back,
+            thieves take from the front.
+        */
+        class Queue {
+        public:
+            explicit Queue(std::size_t capacity) : items_(capacity) {}
+
+            auto PushBack(Work* work) -> bool {
+                std::lock_guard lock {mutex_};
+                if (size_ == items_.size()) return false;
+                items_[(head_ + size_) % items_.size()] = work;
+                ++size_;
+                return true;
+            }
+
+            auto PopBack() -> Work* {
+                std::lock_guard lock {mutex_};
+                if (size_ == 0) return nullptr;
+                --size_;
+                return items_[(head_ + size_) % items_.size()];
+            }
+
+            auto PopFront() -> Work* {
+                std::lock_guard lock {mutex_};
+                if (size_ == 0) return nullptr;
+                auto* work = items_[head_];
+                head_ = (head_ + 1) % items_.size();
+                --size_;
+                return work;
+            }
+
+        private:
+            std::mutex mutex_;
+            std::vector<Work*> items_;
+            std::size_t head_ {0};
+            std::size_t size_ {0};
+        };
+    }
+
+    struct ThreadPool::State {
+        std::vector<std::unique_ptr<Queue>> queues;
+
+        std::atomic<std::size_t> queued {0};
+        std::atomic<std::size_t> next_queue {0};
+        std::atomic<bool> stopped {false};
+
+        // Sleeping threads wait for these counters to change. Reading the
+        // counter before checking the queues means no wake-up is missed.
+        std::atomic<std::uint32_t> work_epoch {0};
+        std::atomic<std::uint32_t> space_epoch {0};
+
+        State(std::size_t threads, std::size_t capacity) {
+            queues.reserve(threads);
+            for (std::size_t i = 0; i < threads; ++i) {
+                queues.emplace_back(std::make_unique<Queue>(capacity));
+            }
+        }
+
+        auto Push(Work* work) -> bool {
+            // The counter is incremented first so that it never falls behind
+            // the number of queued items, which keeps workers from sleeping
+            // while there's work to do.
+            queued.fetch_add(1);
+
+            const auto start = next_queue.fetch_add(1, std::memory_order_relaxed);
+            for (std::size_t i = 0; i < queues.size(); ++i) {
+                if (queues[(start + i) % queues.size()]->PushBack(work)) {
+                    NotifyWork();
+                    return true;
+                }
+            }
+
+            queued.fetch_sub(1);
+            return false;
+        }
+
+        auto PushLocal(std::size_t index, Work* work) -> bool {
+            queued.fetch_add(1);
+            if (queues[index]->PushBack(work)) {
+                NotifyWork();
+                return true;
+            }
+            queued.fetch_sub(1);
+            return false;
+        }
+
+        auto Take(std::size_t index) -> Work* {
+            auto* work = queues[index]->PopBack();
+            for (std::size_t i = 1; work == nullptr && i < queues.size(); ++i) {
+                work = queues[(index + i) % queues.size()]->PopFront();
+            }
+
+            if (work != nullptr) {
+                queued.fetch_sub(1);
+                space_epoch.fetch_add(1);
+                space_epoch.notify_one();
+            }
+
+            return work;
+        }
+
+        auto NotifyWork() -> void {
+            work_epoch.fetch_add(1);
+            work_epoch.notify_one();
+        }
+
+        auto Stop() -> void {
+            stopped = true;
+            work_epoch.fetch_add(1);
+            work_epoch.notify_all();
+            space_epoch.fetch_add(1);
+            space_epoch.notify_all();
+        }
+    };
+
+    namespace {
+        struct Worker {
+            const void* state {nullptr};
+            std::size_t index {0};
+        };
+
+        thread_local Worker current_worker;
+    }
+
+    ThreadPool::ThreadPool(std::size_t threads, std::size_t capacity) {
+        threads = std::max<std::size_t>(threads, 1);
+        const auto queue_capacity = std::max<std::size_t>((capacity + threads - 1) / threads, 1);
+
+        state_ = std::make_shared<State>(threads, queue_capacity);
+        workers_.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back(&ThreadPool::Run, state_, i);
+        }
+    }
+
+    auto ThreadPool::Default() -> std::shared_ptr<ThreadPool> {
+        static auto pool = std::make_shared<ThreadPool>();
+        return pool;
+    }
+
+    auto ThreadPool::Execute(Work* work) -> void {
+        if (current_worker.state == state_.get()) {
+            // Work submitted by a worker goes to its own queue. Waiting for
+            // room could deadlock the pool, so if the queue is full the work
+            // runs inline instead.
+            if (!state_->PushLocal(current_worker.index, work)) work->Run();
+            return;
+        }
+
+        while (true) {
+            const auto epoch = state_->space_epoch.load();
+            if (state_->Push(work)) return;
+            if (state_->stopped) {
+                work->Run();
+                return;
+            }
+            state_->space_epoch.wait(epoch);
+        }
+    }
+
+    auto ThreadPool::Run(std::shared_ptr<State> state, std::size_t index) -> void {
+        current_worker = {state.get(), index};
+
+        while (true) {
+            const auto epoch = state->work_epoch.load();
+            if (auto* work = state->Take(index)) {
+                work->Run();
+                continue;
+            }
+
+            // Queued work is drained before the worker exits
+            if (state->stopped && state->queued.load() == 0) break;
+            if (state->queued.load() == 0) state->work_epoch.wait(epoch);
+        }
+
+        current_worker = {};
+    }
+
+    ThreadPool::~ThreadPool() {
+        state_->Stop();
+
+        for (auto& worker : workers_) {
+            if (worker.get_id() == std::this_thread::get_id()) {
+                // Destroyed by work running on this worker. It owns the
+                // state and exits once the work returns.
+                worker.detach();
+            } else {
+                worker.join();
+            }
+        }
+    }
+}
@@ -20,6 +20,11 @@ namespace Express {
         }
 
         [[nodiscard]] auto has_timeout() const -> bool { return has_timeout_; }
+        [[nodiscard]] auto expiry() const { return expiry_timestamp_; }
+
+        [[nodiscard]] auto expired() const -> bool {
+            return has_timeout_ && expiry_timestamp_ <= steady_clock::now();
+        }
 
         [[nodiscard]] auto Get() const -> std::int64_t {
             if (!has_timeout_) { return 0; }
@@ -0,0 +1,38 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+
+namespace Express {
+    /*
+        A budget of extra requests, such as hedges or retries. Regular
+        requests deposit a fraction of a token, and every extra request
+        withdraws a whole one, so extra requests stay a fixed share of the
+        traffic. The capacity allows a short burst.
+    */
+    class TokenBucket {
+    public:
+        TokenBucket(double capacity, double tokens)
+          : capacity_(capacity), tokens_(std::min(tokens, capacity)) {}
+
+        auto Deposit(double tokens) -> void {
+            std::lock_guard lock {mutex_};
+            tokens_ = std::min(tokens_ + std::max(tokens, 0.0), capacity_);
+        }
+
+        [[nodiscard]] auto Withdraw() -> bool {
+            std::lock_guard lock {mutex_};
+            if (tokens_ < 1.0) return false;
+            tokens_ -= 1.0;
+            return true;
+        }
+
+    private:
+        std::mutex mutex_;
+        double capacity_;
+        double tokens_;
+    };
+}
@@ -0,0 +1,287 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/transfer.h"
+
+#include <initializer_list>
+#include <string>
+
+#include "express/error_code.h"
+
+namespace Express {
+    namespace {
+        // A deadline that may end a wait, and the error it's reported with
+        struct Deadline {
+            const Timeout* timeout;
+            ErrorCode error;
+        };
+
+        // The deadline that expires first, so the wait reports the right phase
+        auto Earliest(std::initializer_list<Deadline> deadlines) -> Deadline {
+            auto earliest = *deadlines.begin();
+            for (const auto& deadline : deadlines) {
+                if (!deadline.timeout->has_timeout()) continue;
+                if (!earliest.timeout->has_timeout() ||
+                    deadline.timeout->expiry() < earliest.timeout->expiry()) {
+                    earliest = deadline;
+                }
+            }
+            return earliest;
+        }
+
+        auto WaitError(Net::WaitResult result, ErrorCode timeout_error) -> std::error_code {
+            if (result == Net::WaitResult::kTimeout) return timeout_error;
+            return std::make_error_code(std::errc::operation_canceled);
+        }
+    }
+
+    auto ConnectAsync(
+        const Net::Socket& socket,
+        Net::EventLoop& loop,
+        const Limits& limits
+    ) -> Task<std::error_code> {
+        std::error_code ec;
+        socket.BeginConnect(ec);
+        if (ec == std::errc::operation_in_progress) {
+            const Timeout budget {limits.phases.connect};
+            const auto deadline = Earliest({
+                {&limits.total, ErrorCode::kConnectTimeout},
+                {&budget, ErrorCode::kConnectTimeout}
+            });
+
+            auto result = co_await loop.Wait(
+                socket.handle(), Net::EventType::kToWrite, *deadline.timeout, limits.stop
+            );
+            if (result != Net::WaitResult::kReady) {
+                co_return WaitError(result, deadline.error);
+            }
+            socket.FinishConnect(ec);
+        }
+        co_return ec;
+    }
+
+    auto SendAsync(
+        const Net::Socket& socket,
+        std::string_view data,
+        Net::EventLoop& loop,
+        const Limits& limits
+    ) -> Task<std::error_code> {
+        std::error_code ec;
+        while (!data.empty()) {
+            auto size = socket.SendSome(data, ec);
+            if (ec == std::errc::operation_would_block) {
+                auto result = co_await loop.Wait(
+                    socket.handle(), Net::EventType::kToWrite, limits.total, limits.stop
+                );
+                if (result != Net::WaitResult::kReady) {
+                    co_return WaitError(result, ErrorCode::kSendTimeout);
+                }
+                continue;
+            }
+            if (ec) co_return ec;
+            data.remove_prefix(size);
+        }
+        co_return ec;
+    }
+
+    auto SendRequestAsync(
+        const Net::Socket& socket,
+        const Http::RequestBuilder& request,
+        Http::ResponseParser& parser,
+        std::span<unsigned char> buffer,
+        Net::EventLoop& loop,
+        const Limits& limits,
+        std::chrono::milliseconds continue_delay,
+        std::size_t& received
+    ) -> Task<std::error_code> {
+        received = 0;
+        if (!request.expects_continue() || continue_delay <= 0ms) {
+            co_return co_await SendAsync(socket, request.GetData(), loop, limits);
+        }
+
+        auto ec = co_await SendAsync(socket, request.GetHeaders(), loop, limits);
+        if (ec) co_return ec;
+
+        // Servers that don't know Expect never answer, so the body is sent
+        // once the delay passes
+        const Timeout delay {continue_delay};
+        while (!parser.continued() && !parser.headers_complete()) {
+            auto size = socket.RecvSome(buffer.data(), buffer.size(), ec);
+            if (ec == std::errc::operation_would_block) {
+                const auto deadline = Earliest({
+                    {&limits.total, ErrorCode::kSendTimeout},
+                    {&delay, ErrorCode::kSendTimeout}
+                });
+
+                auto result = co_await loop.Wait(
+                    socket.handle(), Net::EventType::kToRead, *deadline.timeout, limits.stop
+                );
+                if (result == Net::WaitResult::kTimeout && deadline.timeout == &delay) {
+                    ec.clear();
+                    break;
+                }
+                if (result != Net::WaitResult::kReady) {
+                    co_return WaitError(result, deadline.error);
+                }
+                continue;
+            }
+            if (ec) co_return ec;
+            if (size == 0) co_return std::make_error_code(std::errc::connection_reset);
+
+            received += size;
+            parser.Feed(buffer.data(), size, ec);
+            if (ec) co_return ec;
+        }
+
+        // The server answered before the body was sent, so it won't read it
+        if (parser.headers_complete()) co_return ec;
+
+        co_return co_await SendAsync(socket, request.GetBody(), loop, limits);
+    }
+
+    auto ReceiveAsync(
+        const Net::Socket& socket,
+        Http::ResponseParser& parser,
+        std::span<unsigned char> buffer,
+        Net::EventLoop& loop,
+        Executor& executor,
+        const Limits& limits,
+        std::size_t& received,
+        const std::function<std::error_code()>& on_read
+    ) -> Task<std::error_code> {
+        using std::chrono::duration_cast;
+
+        const auto& phases = limits.phases;
+        const Timeout first_byte {phases.first_byte};
+        const auto checks_speed = phases.min_bytes_per_second > 0 && phases.min_speed_window > 0ms;
+
+        // The idle budget and the speed window restart as data arrives
+        Timeout idle {0ms};
+        Timeout window {0ms};
+        std::size_t window_bytes = 0;
+
+        // The number of bytes a window must receive to keep up with the minimum rate
+        const auto window_minimum = phases.min_bytes_per_second *
+            static_cast<std::size_t>(duration_cast<milliseconds>(phases.min_speed_window).count()) / 1000;
+
+        std::error_code ec;
+        received = 0;
+        while (!parser.done_reading_data()) {
+            auto size = socket.RecvSome(buffer.data(), buffer.size(), ec);
+            if (ec == std::errc::operation_would_block) {
+                const auto deadline = received == 0
+                    ? Earliest({
+                        {&limits.total, ErrorCode::kRecvTimeout},
+                        {&first_byte, ErrorCode::kFirstByteTimeout}})
+                    : Earliest({
+                        {&limits.total, ErrorCode::kRecvTimeout},
+                        {&idle, ErrorCode::kIdleTimeout},
+                        {&window, ErrorCode::kTransferTooSlow}});
+
+                auto result = co_await loop.Wait(
+                    socket.handle(), Net::EventType::kToRead, *deadline.timeout, limits.stop
+                );
+
+                // Waits end on the I/O thread, and the response is parsed
+                // and decoded on the executor
+                co_await Schedule(executor);
+
+                if (result == Net::WaitResult::kTimeout &&
+                    deadline.error == ErrorCode::kTransferTooSlow &&
+                    window_bytes >= window_minimum) {
+                    window = Timeout {phases.min_speed_window};
+                    window_bytes = 0;
+                    continue;
+                }
+                if (result != Net::WaitResult::kReady) {
+                    co_return WaitError(result, deadline.error);
+                }
+                continue;
+            }
+            if (ec) co_return ec;
+            if (size == 0) break;
+
+            if (checks_speed) {
+                if (received == 0 || window.expired()) {
+                    if (received > 0 && window_bytes < window_minimum) {
+                        co_return ErrorCode::kTransferTooSlow;
+                    }
+                    window = Timeout {phases.min_speed_window};
+                    window_bytes = 0;
+                }
+                window_bytes += size;
+            }
+            if (phases.idle > 0ms) idle = Timeout {phases.idle};
+
+            received += size;
+            parser.Feed(buffer.data(), size, ec);
+            if (!ec && on_read) ec = on_read();
+            if (ec) co_return ec;
+        }
+        co_return ec;
+    }
+
+    auto OpenTunnelAsync(
+        const Net::Socket& socket,
+        std::string_view authority,
+        std::string_view authorization,
+        std::span<unsigned char> buffer,
+        std::pmr::memory_resource* resource,
+        Net::EventLoop& loop,
+        const Limits& limits
+    ) -> Task<std::error_code> {
+        std::pmr::string request {resource};
+        Http::WriteConnectRequest(authority, authorization, request);
+
+        auto ec = co_await SendAsync(socket, request, loop, limits);
+        if (ec) co_return ec;
+
+        // The tunnel is open once the proxy's headers arrive, and anything
+        // after them comes from the host, so the reply's body isn't read
+        Http::ResponseParser parser {resource};
+        const Timeout first_byte {limits.phases.first_byte};
+        while (!parser.headers_complete()) {
+            auto size = socket.RecvSome(buffer.data(), buffer.size(), ec);
+            if (ec == std::errc::operation_would_block) {
+                const auto deadline = Earliest({
+                    {&limits.total, ErrorCode::kRecvTimeout},
+                    {&first_byte, ErrorCode::kFirstByteTimeout}
+                });
+
+                auto result = co_await loop.Wait(
+                    socket.handle(), Net::EventType::kToRead, *deadline.timeout, limits.stop
+                );
+                if (result != Net::WaitResult::kReady) {
+                    co_return WaitError(result, deadline.error);
+                }
+                continue;
+            }
+            if (ec) co_return ec;
+            if (size == 0) co_return std::make_error_code(std::errc::connection_reset);
+
+            parser.Feed(buffer.data(), size, ec);
+            if (ec) co_return ec;
+        }
+
+        if (parser.status_code() < 200 || parser.status_code() >= 300) co_return ErrorCode::kTunnelRefused;
+        co_return ec;
+    }
+
+    auto IsFinal(const std::error_code& ec) -> bool {
+        return ec == ErrorCondition::kTimeoutError || ec == std::errc::operation_canceled;
+    }
+
+    auto Resolve(
+        std::string_view host,
+        std::string_view port,
+        const Limits& limits,
+        std::error_code& ec
+    ) -> Net::Endpoint {
+        const Timeout budget {limits.phases.resolve};
+        Net::Endpoint endpoint {host, port, ec};
+        if (!ec && (budget.expired() || limits.total.expired())) {
+            ec = ErrorCode::kResolveTimeout;
+        }
+        return endpoint;
+    }
+}
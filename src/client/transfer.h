@@ -0,0 +1,121 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <stop_token>
+#include <string_view>
+#include <system_error>
+
+#include "express/config.h"
+#include "express/executor.h"
+#include "express/task.h"
+
+#include "client/timeout.h"
+#include "http/request_builder.h"
+#include "http/response_parser.h"
+#include "net/event_loop.h"
+#include "net/socket.h"
+
+namespace Express {
+    /*
+        The limits of a single request. The total timeout starts when the
+        request starts, and every phase budget starts with its phase.
+    */
+    struct Limits {
+        Timeout total;
+        Timeouts phases;
+        std::stop_token stop;
+
+        explicit Limits(const Config& config)
+          : total(config.timeout), phases(config.timeouts), stop(config.stop_token) {}
+    };
+
+    /*
+        Non-blocking request steps. Each step suspends on the event loop
+        whenever the socket isn't ready, and reports failures as error
+        codes. Timeouts are reported with the code of the phase that expired,
+        and a stop requested through the token is reported as
+        std::errc::operation_canceled.
+    */
+    [[nodiscard]] auto ConnectAsync(
+        const Net::Socket& socket,
+        Net::EventLoop& loop,
+        const Limits& limits
+    ) -> Task<std::error_code>;
+
+    [[nodiscard]] auto SendAsync(
+        const Net::Socket& socket,
+        std::string_view data,
+        Net::EventLoop& loop,
+        const Limits& limits
+    ) -> Task<std::error_code>;
+
+    /*
+        Sends the request. A request that expects 100 Continue sends its
+        headers, and sends its body once the server continues or the delay
+        passes. When the server answers with a final response instead, the
+        body isn't sent, and the parser holds the start of that response.
+        Sets received to the number of bytes that were read while waiting.
+    */
+    [[nodiscard]] auto SendRequestAsync(
+        const Net::Socket& socket,
+        const Http::RequestBuilder& request,
+        Http::ResponseParser& parser,
+        std::span<unsigned char> buffer,
+        Net::EventLoop& loop,
+        const Limits& limits,
+        std::chrono::milliseconds continue_delay,
+        std::size_t& received
+    ) -> Task<std::error_code>;
+
+    // Reads until the parser has a complete response or the server closes
+    // the connection. Sets received to the number of bytes that were read.
+    // A stream can process the response as it arrives with on_read, which
+    // is called after every read, and ends the response with its error.
+    // Once the socket is ready, the response is parsed and decoded on the
+    // executor, so the event loop's thread only waits for readiness.
+    [[nodiscard]] auto ReceiveAsync(
+        const Net::Socket& socket,
+        Http::ResponseParser& parser,
+        std::span<unsigned char> buffer,
+        Net::EventLoop& loop,
+        Executor& executor,
+        const Limits& limits,
+        std::size_t& received,
+        const std::function<std::error_code()>& on_read = {}
+    ) -> Task<std::error_code>;
+
+    /*
+        Asks the proxy on the other end of the socket to open a tunnel to
+        the authority (host:port). Once it has, the socket speaks to the
+        host. A proxy that refuses is reported as ErrorCode::kTunnelRefused.
+    */
+    [[nodiscard]] auto OpenTunnelAsync(
+        const Net::Socket& socket,
+        std::string_view authority,
+        std::string_view authorization,
+        std::span<unsigned char> buffer,
+        std::pmr::memory_resource* resource,
+        Net::EventLoop& loop,
+        const Limits& limits
+    ) -> Task<std::error_code>;
+
+    // Failures that aren't caused by a stale connection. A request that
+    // fails otherwise over a reused connection, before any part of the
+    // response arrives, can be sent again over a new connection.
+    [[nodiscard]] auto IsFinal(const std::error_code& ec) -> bool;
+
+    // Resolves the host. Resolution blocks, so its budgets are checked once it returns.
+    [[nodiscard]] auto Resolve(
+        std::string_view host,
+        std::string_view port,
+        const Limits& limits,
+        std::error_code& ec
+    ) -> Net::Endpoint;
+}
@@ -0,0 +1,375 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/upstream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <utility>
+
+#include "client/breaker.h"
+#include "client/error.h"
+#include "net/endpoint.h"
+#include "utils/hash.h"
+
+namespace Express {
+    namespace {
+        // The cost of a member with requests in flight but no latency yet,
+        // so that a new member isn't flooded before its first response
+        constexpr double kPenalty = 1e9;
+
+        struct Address {
+            std::string host;
+            std::string port;
+        };
+
+        // Splits host:port, where the host of an IPv6 address is in brackets
+        auto Split(std::string_view address) -> Address {
+            if (address.starts_with('[')) {
+                const auto end = address.find(']');
+                if (end == std::string_view::npos) return {std::string {address}, "80"};
+
+                const auto port = address.substr(end + 1);
+                return {
+                    std::string {address.substr(1, end - 1)},
+                    port.starts_with(':') ? std::string {port.substr(1)} : "80"
+                };
+            }
+
+            const auto colon = address.rfind(':');
+            if (colon == std::string_view::npos) return {std::string {address}, "80"};
+            return {std::string {address.substr(0, colon)}, std::string {address.substr(colon + 1)}};
+        }
+
+        // Seeds the second hash of a member's address in a Maglev table
+        constexpr std::uint64_t kSkipSeed {0x9e3779b97f4a7c15ULL};
+
+        auto NextPrime(std::size_t value) {
+            const auto is_prime = [](std::size_t n) {
+                if (n < 2) return false;
+                for (std::size_t d = 2; d * d <= n; ++d) {
+                    if (n % d == 0) return false;
+                }
+                return true;
+            };
+            while (!is_prime(value)) ++value;
+            return value;
+        }
+
+        auto Random(std::size_t bound) -> std::size_t {
+            thread_local std::minstd_rand generator {std::random_device {}()};
+            return std::uniform_int_distribution<std::size_t> {0, bound - 1}(generator);
+        }
+    }
+
+    struct Upstream::Member {
+        explicit Member(Net::Endpoint endpoint)
+          : endpoint(std::move(endpoint)),
+            address(this->endpoint.ToString()) {}
+
+        Net::Endpoint endpoint;
+        std::string address;
+
+        std::size_t outstanding {0};
+
+        // The peak-EWMA latency in nanoseconds, and when it last changed
+        double latency {0.0};
+        Clock::time_point updated {};
+
+        // Failures since the last success or ejection, and ejections in a row
+        std::size_t failures {0};
+        std::size_t ejections {0};
+        Clock::time_point ejected_until {};
+    };
+
+    Upstream::Upstream(std::span<const std::string_view> addresses, UpstreamOptions options)
+      : options_(std::move(options)) {
+        for (const auto address : addresses) {
+            if (auto ec = Add(address)) Error::Throw(ec, "Upstream error");
+        }
+        if (members_.empty()) Error::Throw(std::make_error_code(std::errc::invalid_argument), "Upstream error");
+        routed_.assign(members_.size(), false);
+    }
+
+    Upstream::Upstream(
+        std::span<const std::string_view> addresses,
+        UpstreamOptions options,
+        std::error_code& ec
+    ) : options_(std::move(options)) {
+        for (const auto address : addresses) {
+            if ((ec = Add(address))) return;
+        }
+        if (members_.empty()) ec = std::make_error_code(std::errc::invalid_argument);
+        routed_.assign(members_.size(), false);
+    }
+
+    Upstream::~Upstream() = default;
+
+    auto Upstream::Add(std::string_view address) -> std::error_code {
+        const auto [host, port] = Split(address);
+
+        std::error_code ec;
+        for (auto& endpoint : Net::Endpoint::ResolveAll(host, port, ec)) {
+            members_.push_back(std::make_unique<Member>(std::move(endpoint)));
+        }
+        return ec;
+    }
+
+    auto Upstream::Pick(Clock::time_point now) -> std::size_t {
+        return Pick(std::string_view {}, now);
+    }
+
+    auto Upstream::Pick(std::string_view key, Clock::time_point now) -> std::size_t {
+        std::lock_guard lock {mutex_};
+        const auto size = members_.size();
+
+        // Ejected members are skipped, unless every member is ejected
+        if (now >= refresh_) Refresh(now);
+        const auto any = available_ == 0;
+        const auto available = any ? size : available_;
+
+        const auto is_candidate = [&](std::size_t index) {
+            return any || members_[index]->ejected_until <= now;
+        };
+
+        // The nth candidate, counting from the cursor so that ties are taken in turn
+        const auto nth = [&](std::size_t n) {
+            if (available == size) return (next_ + n) % size;
+            for (std::size_t i = 0; i < size; ++i) {
+                const auto index = (next_ + i) % size;
+                if (is_candidate(index) && n-- == 0) return index;
+            }
+            return next_ % size;
+        };
+
+        auto picked = nth(0);
+        switch (options_.balancing) {
+            case Balancing::RoundRobin:
+                break;
+            case Balancing::LeastRequests:
+                for (std::size_t i = 1; i < size; ++i) {
+                    const auto index = (next_ + i) % size;
+                    if (is_candidate(index) && members_[index]->outstanding < members_[picked]->outstanding) {
+                        picked = index;
+                    }
+                }
+                break;
+            case Balancing::PeakEwma:
+                if (available > 1) {
+                    const auto first = Random(available);
+                    const auto second = (first + 1 + Random(available - 1)) % available;
+                    const auto a = nth(first);
+                    const auto b = nth(second);
+                    picked = Cost(*members_[a], now) <= Cost(*members_[b], now) ? a : b;
+                }
+                break;
+            case Balancing::RingHash:
+            case Balancing::Maglev:
+                picked = Route(Mix(Fnv1a(key)));
+                ++members_[picked]->outstanding;
+                return picked;
+        }
+
+        next_ = (picked + 1) % size;
+        ++members_[picked]->outstanding;
+        return picked;
+    }
+
+    auto Upstream::Refresh(Clock::time_point now) -> void {
+        available_ = 0;
+        refresh_ = Clock::time_point::max();
+        for (const auto& member : members_) {
+            if (member->ejected_until <= now) {
+                ++available_;
+            } else {
+                refresh_ = std::min(refresh_, member->ejected_until);
+            }
+        }
+
+        auto changed = false;
+        for (std::size_t i = 0; i < members_.size(); ++i) {
+            const auto routed = available_ == 0 || members_[i]->ejected_until <= now;
+            if (routed_[i] != routed) {
+                routed_[i] = routed;
+                changed = true;
+            }
+        }
+
+        if (changed && options_.balancing == Balancing::RingHash) BuildRing();
+        if (changed && options_.balancing == Balancing::Maglev) BuildTable();
+    }
+
+    auto Upstream::Route(std::uint64_t hash) const -> std::size_t {
+        if (!lookup_.empty()) return lookup_[hash % lookup_.size()];
+
+        // The first point at or after the hash, going around the ring
+        auto point = std::lower_bound(ring_.begin(), ring_.end(), hash, [](const auto& entry, std::uint64_t value) {
+            return entry.first < value;
+        });
+        if (point == ring_.end()) point = ring_.begin();
+        return point->second;
+    }
+
+    auto Upstream::BuildRing() -> void {
+        ring_.clear();
+        const auto points = std::max<std::size_t>(options_.virtual_nodes, 1);
+        for (std::size_t member = 0; member < members_.size(); ++member) {
+            if (!routed_[member]) continue;
+
+            // The points depend on the member's address rather than its
+            // position, so other members keep theirs as members change
+            const auto base = Fnv1a(members_[member]->address);
+            for (std::size_t i = 0; i < points; ++i) ring_.emplace_back(Mix(base + i), member);
+        }
+        std::sort(ring_.begin(), ring_.end());
+    }
+
+    auto Upstream::BuildTable() -> void {
+        const auto size = NextPrime(std::max(options_.table_size, members_.size() * 100));
+
+        // Every member has its own permutation of the table's entries, and
+        // the members take turns claiming their next entry that's free
+        struct Permutation {
+            std::size_t member;
+            std::uint64_t offset;
+            std::uint64_t skip;
+            std::uint64_t next;
+        };
+
+        std::vector<Permutation> permutations;
+        for (std::size_t member = 0; member < members_.size(); ++member) {
+            if (!routed_[member]) continue;
+
+            const auto hash = Fnv1a(members_[member]->address);
+            permutations.push_back({member, Mix(hash) % size, Mix(hash ^ kSkipSeed) % (size - 1) + 1, 0});
+        }
+
+        constexpr auto kFree = std::numeric_limits<std::size_t>::max();
+        lookup_.assign(size, kFree);
+
+        std::size_t filled = 0;
+        while (filled < size) {
+            for (auto& permutation : permutations) {
+                auto entry = (permutation.offset + permutation.next * permutation.skip) % size;
+                while (lookup_[entry] != kFree) {
+                    ++permutation.next;
+                    entry = (permutation.offset + permutation.next * permutation.skip) % size;
+                }
+
+                lookup_[entry] = permutation.member;
+                ++permutation.next;
+                if (++filled == size) break;
+            }
+        }
+    }
+
+    auto Upstream::Reuse(std::size_t member, Clock::time_point now) -> bool {
+        std::lock_guard lock {mutex_};
+        auto& target = *members_.at(member);
+        if (target.ejected_until > now) return false;
+
+        ++target.outstanding;
+        return true;
+    }
+
+    auto Upstream::Record(
+        std::size_t member,
+        const Expected<Response>& result,
+        std::chrono::nanoseconds latency,
+        Clock::time_point now
+    ) -> void {
+        using enum CircuitBreakers::Outcome;
+
+        // Failures are classified the way the circuit breaker does
+        const auto outcome = Classify(
+            BreakerPolicy {.slow_request = options_.outliers.slow_request}, result, latency
+        );
+
+        std::lock_guard lock {mutex_};
+        auto& target = *members_.at(member);
+        if (target.outstanding > 0) --target.outstanding;
+        if (outcome == kIgnored) return;
+
+        // A slower response replaces the latency at once, and a faster one
+        // pulls it down as time passes. Failures that return quickly, like
+        // refused connections, don't make the member look faster.
+        const auto sample = static_cast<double>(latency.count());
+        if (sample > target.latency) {
+            target.latency = sample;
+        } else if (outcome == kSuccess) {
+            const auto elapsed = std::chrono::duration<double> {now - target.updated};
+            const auto decay = std::chrono::duration<double> {options_.decay};
+            const auto weight = decay.count() > 0.0 ? std::exp(-elapsed / decay) : 0.0;
+            target.latency = target.latency * weight + sample * (1.0 - weight);
+        }
+        target.updated = now;
+
+        if (outcome == kSuccess) {
+            target.failures = 0;
+            target.ejections = 0;
+            return;
+        }
+
+        const auto threshold = options_.outliers.consecutive_failures;
+        if (threshold > 0 && ++target.failures >= threshold && target.ejected_until <= now) {
+            Eject(target, now);
+        }
+    }
+
+    auto Upstream::Eject(Member& member, Clock::time_point now) -> void {
+        const auto& policy = options_.outliers;
+
+        const auto ejected = static_cast<std::size_t>(std::count_if(
+            members_.begin(), members_.end(), [now](const auto& other) { return other->ejected_until > now; }
+        ));
+        const auto limit = std::min(
+            static_cast<std::size_t>(policy.max_ejected * static_cast<double>(members_.size())),
+            members_.size() - 1
+        );
+        if (ejected >= limit) return;
+
+        ++member.ejections;
+        member.failures = 0;
+        member.ejected_until = now + std::min(
+            policy.ejection * static_cast<std::int64_t>(member.ejections),
+            policy.max_ejection
+        );
+        refresh_ = Clock::time_point::min();
+    }
+
+    auto Upstream::Cost(const Member& member, Clock::time_point now) const -> double {
+        if (member.latency == 0.0) return member.outstanding > 0 ? kPenalty * member.outstanding : 0.0;
+
+        // Without new responses, the latency decays towards zero
+        const auto elapsed = std::chrono::duration<double> {now - member.updated};
+        const auto decay = std::chrono::duration<double> {options_.decay};
+        const auto weight = decay.count() > 0.0 ? std::exp(-elapsed / decay) : 1.0;
+        return member.latency * weight * static_cast<double>(member.outstanding + 1);
+    }
+
+    auto Upstream::endpoint(std::size_t member) const -> const Net::Endpoint& {
+        return members_.at(member)->endpoint;
+    }
+
+    auto Upstream::members(Clock::time_point now) const -> std::vector<UpstreamMember> {
+        std::lock_guard lock {mutex_};
+        std::vector<UpstreamMember> output;
+        output.reserve(members_.size());
+        for (const auto& member : members_) {
+            output.push_back({
+                .address = member->address,
+                .outstanding = member->outstanding,
+                .latency = std::chrono::nanoseconds {std::llround(member->latency)},
+                .ejected = member->ejected_until > now
+            });
+        }
+        return output;
+    }
+
+    auto Upstream::size() const -> std::size_t {
+        return members_.size();
+    }
+}
@@ -0,0 +1,204 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/websocket.h"
+
+#include <cstdio>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "express/error_code.h"
+#include "express/proxy.h"
+#include "client/routing.h"
+#include "client/transfer.h"
+#include "http/request_builder.h"
+#include "http/response_parser.h"
+#include "net/socket.h"
+#include "net/url.h"
+#include "websocket/connection.h"
+#include "websocket/handshake.h"
+
+#if defined(_WIN32)
+    #include "net/winsock.h"
+#endif
+
+namespace Express {
+    namespace {
+        auto SendOn(
+            std::shared_ptr<Ws::Connection> connection,
+            std::shared_ptr<Executor> executor,
+            std::string_view data,
+            Ws::Opcode opcode
+        ) -> Task<std::error_code> {
+            auto ec = co_await connection->SendAsync(data, opcode);
+            co_await Schedule(*executor);
+            co_return ec;
+        }
+
+        auto CloseOn(
+            std::shared_ptr<Ws::Connection> connection,
+            std::shared_ptr<Executor> executor,
+            std::uint16_t code,
+            std::string reason
+        ) -> Task<std::error_code> {
+            auto ec = co_await connection->CloseAsync(code, std::move(reason));
+            co_await Schedule(*executor);
+            co_return ec;
+        }
+
+        auto PingOn(
+            std::shared_ptr<Ws::Connection> connection,
+            std::shared_ptr<Executor> executor,
+            std::string data
+        ) -> Task<std::error_code> {
+            auto ec = co_await connection->PingAsync(data);
+            co_await Schedule(*executor);
+            co_return ec;
+        }
+
+        auto ReceiveOn(
+            std::shared_ptr<Ws::Connection> connection,
+            std::shared_ptr<Executor> executor
+        ) -> Task<Expected<WebSocketMessage>> {
+            auto message = co_await connection->ReceiveAsync();
+            co_await Schedule(*executor);
+            co_return message;
+        }
+    }
+
+    WebSocket::WebSocket(std::shared_ptr<Ws::Connection> connection, std::shared_ptr<Executor> executor)
+      : connection_(std::move(connection)), executor_(std::move(executor)) {}
+
+    WebSocket::~WebSocket() {
+        connection_->Stop();
+    }
+
+    auto WebSocket::Send(std::string_view data, MessageType type) -> std::future<std::error_code> {
+        std::promise<std::error_code> promise;
+        auto future = promise.get_future();
+        Detail::Fulfil(SendAsync(data, type), std::move(promise));
+        return future;
+    }
+
+    auto WebSocket::Receive() -> std::future<Expected<WebSocketMessage>> {
+        std::promise<Expected<WebSocketMessage>> promise;
+        auto future = promise.get_future();
+        Detail::Fulfil(ReceiveAsync(), std::move(promise));
+        return future;
+    }
+
+    auto WebSocket::Close(std::uint16_t code, std::string_view reason) -> std::future<std::error_code> {
+        std::promise<std::error_code> promise;
+        auto future = promise.get_future();
+        Detail::Fulfil(CloseAsync(code, reason), std::move(promise));
+        return future;
+    }
+
+    auto WebSocket::SendAsync(std::string_view data, MessageType type) -> Task<std::error_code> {
+        const auto opcode = type == MessageType::Binary ? Ws::Opcode::kBinary : Ws::Opcode::kText;
+        return SendOn(connection_, executor_, data, opcode);
+    }
+
+    auto WebSocket::ReceiveAsync() -> Task<Expected<WebSocketMessage>> {
+        return ReceiveOn(connection_, executor_);
+    }
+
+    auto WebSocket::PingAsync(std::string_view data) -> Task<std::error_code> {
+        return PingOn(connection_, executor_, std::string {data});
+    }
+
+    auto WebSocket::CloseAsync(std::uint16_t code, std::string_view reason) -> Task<std::error_code> {
+        return CloseOn(connection_, executor_, code, std::string {reason});
+    }
+
+    auto WebSocket::protocol() const -> std::string_view {
+        return connection_->protocol();
+    }
+
+    auto WebSocket::compressed() const -> bool {
+        return connection_->compressed();
+    }
+
+    auto WebSocket::response() const -> const Response& {
+        return connection_->response();
+    }
+
+    auto ConnectWebSocketAsync(
+        Config config,
+        WebSocketOptions options,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Executor> executor
+    ) -> Task<Expected<std::unique_ptr<WebSocket>>> {
+        #if defined(_WIN32)
+            Net::WinSock winsock;
+        #endif
+
+        // The connection may stay open for hours, so it allocates from the
+        // default resource rather than from an arena
+        auto* resource = std::pmr::get_default_resource();
+        std::error_code ec;
+
+        const auto address = Ws::UpgradeUrl(config.url);
+        config.url = address;
+
+        const auto key = Ws::MakeKey();
+        ec = Ws::AddUpgradeHeaders(config.headers, key, options);
+        if (ec) co_return Unexpected {ec};
+
+        const Limits limits {config};
+        const Net::Url url {config.url, resource, ec};
+        if (ec) co_return Unexpected {ec};
+
+        // The upgrade can't be forwarded by a proxy, so it always goes
+        // through a tunnel, and is written as if it were sent directly
+        auto* proxy = ProxyFor(config, url);
+        config.proxy = nullptr;
+
+        const Http::RequestBuilder request {config, resource, ec, Http::Connection::kKeepAlive};
+        if (ec) co_return Unexpected {ec};
+
+        auto endpoint = proxy ? proxy->endpoint() : Resolve(url.host(), url.port(), limits, ec);
+        if (ec) co_return Unexpected {ec};
+
+        auto socket = std::make_unique<Net::Socket>(std::move(endpoint), ec);
+        if (ec) co_return Unexpected {ec};
+        if (limits.stop.stop_requested()) {
+            co_return Unexpected {std::make_error_code(std::errc::operation_canceled)};
+        }
+
+        std::vector<unsigned char> buffer(BUFSIZ);
+        ec = co_await ConnectAsync(*socket, *loop, limits);
+        if (!ec && proxy) {
+            std::string destination {url.host()};
+            destination.append(":").append(url.port());
+            ec = co_await OpenTunnelAsync(
+                *socket, destination, proxy->authorization(), buffer, resource, *loop, limits
+            );
+        }
+        if (!ec) ec = co_await SendAsync(*socket, request.GetData(), *loop, limits);
+        if (ec) co_return Unexpected {ec};
+
+        // A 101 response has no body, so the response ends with its headers
+        Http::ResponseParser parser {resource};
+        std::size_t received = 0;
+        ec = co_await ReceiveAsync(*socket, parser, buffer, *loop, *executor, limits, received);
+        if (ec) co_return Unexpected {ec};
+
+        Ws::Handshake handshake;
+        ec = Ws::CheckUpgrade(parser.status_code(), parser.headers(), key, options, handshake);
+        if (ec) co_return Unexpected {ec};
+
+        const std::string unread {parser.unread()};
+        auto response = std::move(parser).response(ec);
+        if (ec) co_return Unexpected {ec};
+
+        auto connection = std::make_shared<Ws::Connection>(
+            std::move(socket), std::move(loop), std::move(options), std::move(handshake),
+            std::move(response), config.stop_token
+        );
+        connection->Buffer(unread);
+        co_return std::make_unique<WebSocket>(std::move(connection), std::move(executor));
+    }
+}
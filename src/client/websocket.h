@@ -0,0 +1,31 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <memory>
+
+#include "express/config.h"
+#include "express/executor.h"
+#include "express/expected.h"
+#include "express/task.h"
+#include "express/websocket.h"
+
+#include "net/event_loop.h"
+
+namespace Express {
+    /*
+        Opens a WebSocket connection with an HTTP/1.1 upgrade request. The
+        request is built and its response parsed like any other request's,
+        and the bytes that follow the response are the first frames. ws and
+        wss URLs are requested as http and https, and the connection goes
+        through the config's proxy with a tunnel. It stays open for as long
+        as it's needed, so it isn't admitted by the scheduler.
+    */
+    [[nodiscard]] auto ConnectWebSocketAsync(
+        Config config,
+        WebSocketOptions options,
+        std::shared_ptr<Net::EventLoop> loop,
+        std::shared_ptr<Executor> executor
+    ) -> Task<Expected<std::unique_ptr<WebSocket>>>;
+}
@@ -0,0 +1,59 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "http/cache_control.h"
+
+#include "http/date.h"
+#include "utils/string_transformers.h"
+
+namespace Express::Http {
+    namespace {
+        auto Trim(std::string_view value) {
+            const auto first = value.find_first_not_of(" \t");
+            if (first == std::string_view::npos) return std::string_view {};
+            const auto last = value.find_last_not_of(" \t");
+            return value.substr(first, last - first + 1);
+        }
+    }
+
+    auto ParseCacheControl(std::string_view value) -> CacheControl {
+        using StringTransformers::EqualsIgnoreCase;
+
+        CacheControl directives;
+        while (!value.empty()) {
+            const auto comma = value.find(',');
+            const auto directive = Trim(value.substr(0, comma));
+            value = comma == std::string_view::npos ? std::string_view {} : value.substr(comma + 1);
+
+            const auto equals = directive.find('=');
+            const auto name = Trim(directive.substr(0, equals));
+            auto argument = equals == std::string_view::npos ? std::string_view {} : Trim(directive.substr(equals + 1));
+            if (argument.size() >= 2 && argument.front() == '"' && argument.back() == '"') {
+                argument = argument.substr(1, argument.size() - 2);
+            }
+
+            // An invalid max-age makes the response stale (RFC 9111, section 4.2.1)
+            if (EqualsIgnoreCase(name, "max-age")) {
+                directives.max_age = ParseDeltaSeconds(argument).value_or(std::chrono::seconds {0});
+            } else if (EqualsIgnoreCase(name, "s-maxage")) {
+                directives.s_maxage = ParseDeltaSeconds(argument).value_or(std::chrono::seconds {0});
+            } else if (EqualsIgnoreCase(name, "public")) {
+                directives.is_public = true;
+            } else if (EqualsIgnoreCase(name, "private")) {
+                directives.is_private = true;
+            } else if (EqualsIgnoreCase(name, "stale-while-revalidate")) {
+                directives.stale_while_revalidate = ParseDeltaSeconds(argument);
+            } else if (EqualsIgnoreCase(name, "stale-if-error")) {
+                directives.stale_if_error = ParseDeltaSeconds(argument);
+            } else if (EqualsIgnoreCase(name, "no-cache")) {
+                directives.no_cache = true;
+            } else if (EqualsIgnoreCase(name, "no-store")) {
+                directives.no_store = true;
+            } else if (EqualsIgnoreCase(name, "must-revalidate") || EqualsIgnoreCase(name, "proxy-revalidate")) {
+                directives.must_revalidate = true;
+            }
+        }
+
+        return directives;
+    }
+}
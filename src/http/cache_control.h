@@ -0,0 +1,28 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string_view>
+
+namespace Express::Http {
+    /*
+        The directives of a Cache-Control header (RFC 9111, section 5.2)
+        that matter to the client's caches. Unknown directives are ignored.
+    */
+    struct CacheControl {
+        std::optional<std::chrono::seconds> max_age;
+        std::optional<std::chrono::seconds> s_maxage;
+        std::optional<std::chrono::seconds> stale_while_revalidate;
+        std::optional<std::chrono::seconds> stale_if_error;
+        bool no_cache {false};
+        bool no_store {false};
+        bool must_revalidate {false};
+        bool is_public {false};
+        bool is_private {false};
+    };
+
+    [[nodiscard]] auto ParseCacheControl(std::string_view value) -> CacheControl;
+}
@@ -0,0 +1,402 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "http/content_decoder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#ifdef EXPRESS_ZLIB
+    #include <zlib.h>
+#endif
+
+#ifdef EXPRESS_BROTLI
+    #include <brotli/decode.h>
+    // Brotli supports shared dictionaries from version 1.1
+    #if __has_include(<brotli/shared_dictionary.h>)
+        #define EXPRESS_BROTLI_DICTIONARIES
+    #endif
+#endif
+
+#ifdef EXPRESS_ZSTD
+    // For ZSTD_createDCtx_advanced, which takes the allocator
+    #define ZSTD_STATIC_LINKING_ONLY
+    #include <zstd.h>
+#endif
+
+#include "express/error_code.h"
+#include "http/dictionary.h"
+#include "utils/string_transformers.h"
+
+namespace Express::Http {
+    namespace {
+        // The output grows by at least this much at a time
+        constexpr std::size_t kMinOutputBytes {16 * 1024};
+
+        /*
+            The libraries allocate their windows and state through the
+            resource. They don't pass the size when they free them, so each
+            allocation keeps it in front.
+        */
+        constexpr std::size_t kSizePrefix {alignof(std::max_align_t)};
+
+        [[maybe_unused]] auto Allocate(void* opaque, std::size_t size) -> void* {
+            auto* resource = static_cast<std::pmr::memory_resource*>(opaque);
+            const auto bytes = size + kSizePrefix;
+            auto* block = static_cast<std::byte*>(resource->allocate(bytes, alignof(std::max_align_t)));
+            *reinterpret_cast<std::size_t*>(block) = bytes;
+            return block + kSizePrefix;
+        }
+
+        [[maybe_unused]] auto Free(void* opaque, void* address) -> void {
+            if (address == nullptr) return;
+            auto* resource = static_cast<std::pmr::memory_resource*>(opaque);
+            auto* block = static_cast<std::byte*>(address) - kSizePrefix;
+            resource->deallocate(block, *reinterpret_cast<std::size_t*>(block), alignof(std::max_align_t));
+        }
+
+        // Zstd responses may not need a window larger than 8 MiB (RFC 9659,
+        // section 3), so a larger one isn't allocated
+        [[maybe_unused]] constexpr int kMaxZstdWindowLog {23};
+
+        struct Step {
+            std::size_t written;
+            // Whether the decoder has more to write
+            bool more;
+        };
+
+        /*
+            Calls `step` with free space at the end of the output until the
+            decoder has nothing more to write, and trims what's left. Returns
+            false once the output grows larger than the limit; the space
+            never goes more than a byte past it, so a small body can't make
+            it allocate much more.
+        */
+        template <class Function>
+        auto Fill(std::string& output, std::size_t input_size, std::size_t limit, Function step) -> bool {
+            auto room = std::max(input_size * 4, kMinOutputBytes);
+            while (true) {
+                const auto offset = output.size();
+                if (offset > limit) return false;
+                room = std::min(room - 1, limit - offset) + 1;
+                output.resize(offset + room);
+                const auto [written, more] = step(output.data() + offset, room);
+                output.resize(offset + written);
+                if (!more) return output.size() <= limit;
+                room = std::max(room, output.size() / 2);
+            }
+        }
+
+        #ifdef EXPRESS_ZLIB
+            /*
+                Decodes gzip, and deflate with or without its zlib wrapper. Some
+                servers send raw deflate, so the wrapper is detected from the
+                first bytes.
+            */
+            class ZlibDecoder : public ContentDecoder {
+            public:
+                enum class Format {kGzip, kDeflate};
+
+                ZlibDecoder(
+                    Format format,
+                    std::shared_ptr<const Dictionary> dictionary,
+                    std::size_t max_size,
+                    std::pmr::memory_resource* resource
+                ) : format_(format), dictionary_(std::move(dictionary)), max_size_(max_size) {
+                    stream_.zalloc = [](void* opaque, uInt items, uInt size) {
+                        return Allocate(opaque, static_cast<std::size_t>(items) * size);
+                    };
+                    stream_.zfree = Free;
+                    stream_.opaque = resource;
+                }
+
+                ZlibDecoder(const ZlibDecoder&) = delete;
+                auto operator=(const ZlibDecoder&) -> ZlibDecoder& = delete;
+
+                auto Decode(std::string_view data, std::string& output, std::error_code& ec) -> void override {
+                    ec.clear();
+                    if (!initialized_ && !Initialize(data, ec)) return;
+
+                    stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+                    stream_.avail_in = static_cast<uInt>(data.size());
+
+                    const auto fits = Fill(output, data.size(), max_size_, [&](char* buffer, std::size_t room) -> Step {
+                        // A gzip body may have several members
+                        if (ended_) {
+                            if (format_ != Format::kGzip || stream_.avail_in == 0) return {0, false};
+                            inflateReset(&stream_);
+                            ended_ = false;
+                        }
+
+                        stream_.next_out = reinterpret_cast<Bytef*>(buffer);
+                        stream_.avail_out = static_cast<uInt>(room);
+                        auto result = inflate(&stream_, Z_NO_FLUSH);
+                        if (result == Z_NEED_DICT && dictionary_ != nullptr) {
+                            result = inflateSetDictionary(
+                                &stream_,
+                                reinterpret_cast<const Bytef*>(dictionary_->data.data()),
+                                static_cast<uInt>(dictionary_->data.size())
+                            );
+                            if (result == Z_OK) result = inflate(&stream_, Z_NO_FLUSH);
+                        }
+
+                        const auto written = room - stream_.avail_out;
+                        if (result == Z_STREAM_END) {
+                            ended_ = true;
+                            return {written, format_ == Format::kGzip && stream_.avail_in > 0};
+                        }
+                        if (result != Z_OK && result != Z_BUF_ERROR) {
+                            ec = ErrorCode::kInvalidContentEncoding;
+                            return {written, false};
+                        }
+                        // Output that didn't fit is still in zlib's window
+                        return {written, stream_.avail_out == 0};
+                    });
+                    if (!fits) ec = ErrorCode::kDecodedBodyTooLarge;
+                }
+
+                auto Finish(std::error_code& ec) const -> void override {
+                    ec.clear();
+                    if (initialized_ && !ended_) ec = ErrorCode::kInvalidContentEncoding;
+                }
+
+                ~ZlibDecoder() override {
+                    if (initialized_) inflateEnd(&stream_);
+                }
+
+            private:
+                Format format_;
+                std::shared_ptr<const Dictionary> dictionary_;
+                std::size_t max_size_;
+                z_stream stream_ {};
+                bool initialized_ {false};
+                bool ended_ {false};
+
+                auto Initialize(std::string_view data, std::error_code& ec) -> bool {
+                    if (data.empty()) return false;
+
+                    auto window_bits = MAX_WBITS + 16;
+                    if (format_ == Format::kDeflate) {
+                        // A zlib header is a multiple of 31, with the deflate method
+                        const auto wrapped = data.size() < 2 || (
+                            (static_cast<unsigned char>(data[0]) & 0x0F) == Z_DEFLATED &&
+                            (static_cast<unsigned char>(data[0]) * 256 + static_cast<unsigned char>(data[1])) % 31 == 0
+                        );
+                        window_bits = wrapped ? MAX_WBITS : -MAX_WBITS;
+                    }
+
+                    if (inflateInit2(&stream_, window_bits) != Z_OK) {
+                        ec = ErrorCode::kInvalidContentEncoding;
+                        return false;
+                    }
+                    initialized_ = true;
+
+                    // Raw deflate doesn't ask for its dictionary
+                    if (window_bits < 0 && dictionary_ != nullptr) {
+                        inflateSetDictionary(
+                            &stream_,
+                            reinterpret_cast<const Bytef*>(dictionary_->data.data()),
+                            static_cast<uInt>(dictionary_->data.size())
+                        );
+                    }
+                    return true;
+                }
+            };
+        #endif
+
+        #ifdef EXPRESS_BROTLI
+            class BrotliDecoder : public ContentDecoder {
+            public:
+                BrotliDecoder(
+                    std::shared_ptr<const Dictionary> dictionary,
+                    std::size_t max_size,
+                    std::pmr::memory_resource* resource
+                ) : dictionary_(std::move(dictionary)),
+                    max_size_(max_size),
+                    state_(BrotliDecoderCreateInstance(Allocate, Free, resource)) {
+                    if (state_ == nullptr) throw std::bad_alloc {};
+
+                    #ifdef EXPRESS_BROTLI_DICTIONARIES
+                        if (dictionary_ != nullptr) {
+                            BrotliDecoderAttachDictionary(
+                                state_,
+                                BROTLI_SHARED_DICTIONARY_RAW,
+                                dictionary_->data.size(),
+                                reinterpret_cast<const std::uint8_t*>(dictionary_->data.data())
+                            );
+                        }
+                    #endif
+                }
+
+                BrotliDecoder(const BrotliDecoder&) = delete;
+                auto operator=(const BrotliDecoder&) -> BrotliDecoder& = delete;
+
+                auto Decode(std::string_view data, std::string& output, std::error_code& ec) -> void override {
+                    ec.clear();
+                    auto available = data.size();
+                    auto next = reinterpret_cast<const std::uint8_t*>(data.data());
+
+                    const auto fits = Fill(output, data.size(), max_size_, [&](char* buffer, std::size_t room) -> Step {
+                        if (BrotliDecoderIsFinished(state_)) return {0, false};
+
+                        auto free = room;
+                        auto* out = reinterpret_cast<std::uint8_t*>(buffer);
+                        const auto result = BrotliDecoderDecompressStream(
+                            state_, &available, &next, &free, &out, nullptr
+                        );
+
+                        const auto written = room - free;
+                        if (result == BROTLI_DECODER_RESULT_ERROR) {
+                            ec = ErrorCode::kInvalidContentEncoding;
+                            return {written, false};
+                        }
+                        return {written, result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT};
+                    });
+                    if (!fits) ec = ErrorCode::kDecodedBodyTooLarge;
+                }
+
+                auto Finish(std::error_code& ec) const -> void override {
+                    ec.clear();
+                    if (!BrotliDecoderIsFinished(state_)) ec = ErrorCode::kInvalidContentEncoding;
+                }
+
+                ~BrotliDecoder() override {
+                    BrotliDecoderDestroyInstance(state_);
+                }
+
+            private:
+                std::shared_ptr<const Dictionary> dictionary_;
+                std::size_t max_size_;
+                BrotliDecoderState* state_;
+            };
+        #endif
+
+        #ifdef EXPRESS_ZSTD
+            class ZstdDecoder : public ContentDecoder {
+            public:
+                ZstdDecoder(
+                    std::shared_ptr<const Dictionary> dictionary,
+                    std::size_t max_size,
+                    std::pmr::memory_resource* resource
+                ) : dictionary_(std::move(dictionary)),
+                    max_size_(max_size),
+                    context_(ZSTD_createDCtx_advanced({Allocate, Free, resource})) {
+                    if (context_ == nullptr) throw std::bad_alloc {};
+                    ZSTD_DCtx_setParameter(context_, ZSTD_d_windowLogMax, kMaxZstdWindowLog);
+                    if (dictionary_ != nullptr) ZSTD_DCtx_refDDict(context_, dictionary_->zstd.get());
+                }
+
+                ZstdDecoder(const ZstdDecoder&) = delete;
+                auto operator=(const ZstdDecoder&) -> ZstdDecoder& = delete;
+
+                auto Decode(std::string_view data, std::string& output, std::error_code& ec) -> void override {
+                    ec.clear();
+                    ZSTD_inBuffer input {data.data(), data.size(), 0};
+
+                    const auto fits = Fill(output, data.size(), max_size_, [&](char* buffer, std::size_t room) -> Step {
+                        ZSTD_outBuffer out {buffer, room, 0};
+                        const auto result = ZSTD_decompressStream(context_, &out, &input);
+                        if (ZSTD_isError(result)) {
+                            ec = ErrorCode::kInvalidContentEncoding;
+                            return {out.pos, false};
+                        }
+
+                        // Zero once a frame is complete, and a body may have several
+                        remaining_ = result;
+                        return {out.pos, input.pos < input.size || out.pos == out.size};
+                    });
+                    if (!fits) ec = ErrorCode::kDecodedBodyTooLarge;
+                }
+
+                auto Finish(std::error_code& ec) const -> void override {
+                    ec.clear();
+                    if (remaining_ != 0) ec = ErrorCode::kInvalidContentEncoding;
+                }
+
+                ~ZstdDecoder() override {
+                    ZSTD_freeDCtx(context_);
+                }
+
+            private:
+                std::shared_ptr<const Dictionary> dictionary_;
+                std::size_t max_size_;
+                ZSTD_DCtx* context_;
+                std::size_t remaining_ {0};
+            };
+        #endif
+
+        template <class T, class... Args>
+        auto Make(std::pmr::memory_resource* resource, Args&&... args) {
+            std::pmr::polymorphic_allocator<T> allocator {resource};
+            auto decoder = allocator.allocate(1);
+            try {
+                allocator.construct(decoder, std::forward<Args>(args)..., resource);
+            } catch (...) {
+                allocator.deallocate(decoder, 1);
+                throw;
+            }
+            return ContentDecoderPtr {decoder, {resource, sizeof(T), alignof(T)}};
+        }
+    }
+
+    auto AcceptEncoding() -> std::string_view {
+        // Every coding is followed by a separator, which is dropped
+        constexpr std::string_view kCodings {""
+            #ifdef EXPRESS_ZLIB
+                "gzip, deflate, "
+            #endif
+            #ifdef EXPRESS_BROTLI
+                "br, "
+            #endif
+            #ifdef EXPRESS_ZSTD
+                "zstd, "
+            #endif
+        };
+        return kCodings.substr(0, kCodings.empty() ? 0 : kCodings.size() - 2);
+    }
+
+    auto MakeContentDecoder(
+        std::string_view content_encoding,
+        std::pmr::memory_resource* resource,
+        [[maybe_unused]] std::shared_ptr<const Dictionary> dictionary,
+        [[maybe_unused]] std::size_t max_size
+    ) -> ContentDecoderPtr {
+        using StringTransformers::EqualsIgnoreCase;
+
+        const auto first = content_encoding.find_first_not_of(" \t");
+        const auto last = content_encoding.find_last_not_of(" \t");
+        [[maybe_unused]] const auto coding = first == std::string_view::npos ?
+            std::string_view {} : content_encoding.substr(first, last - first + 1);
+
+        #ifdef EXPRESS_ZLIB
+            if (EqualsIgnoreCase(coding, "gzip") || EqualsIgnoreCase(coding, "x-gzip")) {
+                return Make<ZlibDecoder>(resource, ZlibDecoder::Format::kGzip, std::move(dictionary), max_size);
+            }
+            if (EqualsIgnoreCase(coding, "deflate")) {
+                return Make<ZlibDecoder>(resource, ZlibDecoder::Format::kDeflate, std::move(dictionary), max_size);
+            }
+        #endif
+
+        #ifdef EXPRESS_BROTLI
+            #ifdef EXPRESS_BROTLI_DICTIONARIES
+                const auto brotli = true;
+            #else
+                const auto brotli = dictionary == nullptr;
+            #endif
+            if (brotli && EqualsIgnoreCase(coding, "br")) {
+                return Make<BrotliDecoder>(resource, std::move(dictionary), max_size);
+            }
+        #endif
+
+        #ifdef EXPRESS_ZSTD
+            if (EqualsIgnoreCase(coding, "zstd")) {
+                return Make<ZstdDecoder>(resource, std::move(dictionary), max_size);
+            }
+        #endif
+
+        return ContentDecoderPtr {nullptr, {resource, 0, 0}};
+    }
+}
@@ -0,0 +1,63 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace Express::Http {
+    struct Dictionary;
+
+    // The codings the client decodes, for the Accept-Encoding header.
+    // Brotli and zstd depend on the libraries the client was built with.
+    [[nodiscard]] auto AcceptEncoding() -> std::string_view;
+
+    /*
+        Decodes a response body that has a content coding, like gzip, as
+        it's received. The body is fed in parts after its framing has been
+        removed, and the decoded data is appended to the output.
+    */
+    class ContentDecoder {
+    public:
+        virtual auto Decode(std::string_view data, std::string& output, std::error_code& ec) -> void = 0;
+
+        // Checked at the end of the body, to report a truncated stream
+        virtual auto Finish(std::error_code& ec) const -> void = 0;
+
+        virtual ~ContentDecoder() = default;
+    };
+
+    struct ContentDecoderDeleter {
+        std::pmr::memory_resource* resource;
+        std::size_t size;
+        std::size_t alignment;
+
+        auto operator()(ContentDecoder* decoder) const -> void {
+            decoder->~ContentDecoder();
+            resource->deallocate(decoder, size, alignment);
+        }
+    };
+
+    using ContentDecoderPtr = std::unique_ptr<ContentDecoder, ContentDecoderDeleter>;
+
+    /*
+        Returns a decoder for the value of a Content-Encoding header, or
+        nothing if the coding isn't supported. The body was compressed
+        against the dictionary, if there's one. Decoding fails with
+        ErrorCode::kDecodedBodyTooLarge once the output grows larger than
+        `max_size`. The decoder and its state are allocated from the memory
+        resource.
+    */
+    [[nodiscard]] auto MakeContentDecoder(
+        std::string_view content_encoding,
+        std::pmr::memory_resource* resource,
+        std::shared_ptr<const Dictionary> dictionary = nullptr,
+        std::size_t max_size = std::numeric_limits<std::size_t>::max()
+    ) -> ContentDecoderPtr;
+}
@@ -0,0 +1,98 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "http/content_encoder.h"
+
+#include <algorithm>
+#include <limits>
+
+#ifdef EXPRESS_ZLIB
+    #include <zlib.h>
+#endif
+
+#ifdef EXPRESS_ZSTD
+    #include <zstd.h>
+#endif
+
+#include "express/error_code.h"
+
+namespace Express::Http {
+    namespace {
+        auto Gzip([[maybe_unused]] int level, std::string_view data, std::pmr::string& output) -> std::error_code {
+            #ifdef EXPRESS_ZLIB
+                // Level zero stores the body without compressing it, so it means the default here
+                level = level == 0 ? Z_DEFAULT_COMPRESSION : std::clamp(level, 1, 9);
+
+                // zlib takes the body in one call, so a larger one is sent as it is
+                if (data.size() > std::numeric_limits<uInt>::max()) return {};
+
+                z_stream stream {};
+                if (deflateInit2(&stream, level, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    return std::make_error_code(std::errc::not_enough_memory);
+                }
+
+                output.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+                stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+                stream.avail_in = static_cast<uInt>(data.size());
+                stream.next_out = reinterpret_cast<Bytef*>(output.data());
+                stream.avail_out = static_cast<uInt>(output.size());
+
+                const auto result = deflate(&stream, Z_FINISH);
+                output.resize(stream.total_out);
+                deflateEnd(&stream);
+
+                if (result != Z_STREAM_END) return std::make_error_code(std::errc::not_enough_memory);
+                return {};
+            #else
+                static_cast<void>(data);
+                static_cast<void>(output);
+                return ErrorCode::kUnsupportedCompression;
+            #endif
+        }
+
+        auto Zstd([[maybe_unused]] int level, std::string_view data, std::pmr::string& output) -> std::error_code {
+            #ifdef EXPRESS_ZSTD
+                level = std::clamp(level, 0, ZSTD_maxCLevel());
+
+                output.resize(ZSTD_compressBound(data.size()));
+                const auto size = ZSTD_compress(output.data(), output.size(), data.data(), data.size(), level);
+                if (ZSTD_isError(size)) return std::make_error_code(std::errc::not_enough_memory);
+
+                output.resize(size);
+                return {};
+            #else
+                static_cast<void>(data);
+                static_cast<void>(output);
+                return ErrorCode::kUnsupportedCompression;
+            #endif
+        }
+    }
+
+    auto ContentCoding(Compression algorithm) -> std::string_view {
+        switch (algorithm) {
+            case Compression::Gzip: return "gzip";
+            case Compression::Zstd: return "zstd";
+            case Compression::None: break;
+        }
+        return {};
+    }
+
+    auto Encode(
+        const CompressionPolicy& policy,
+        std::string_view data,
+        std::pmr::string& output
+    ) -> std::error_code {
+        output.clear();
+        if (policy.algorithm == Compression::None || data.size() < policy.min_bytes) return {};
+
+        const auto ec = policy.algorithm == Compression::Gzip ?
+            Gzip(policy.level, data, output) : Zstd(policy.level, data, output);
+        if (ec) {
+            output.clear();
+            return ec;
+        }
+
+        if (output.size() >= data.size()) output.clear();
+        return {};
+    }
+}
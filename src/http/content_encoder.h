@@ -0,0 +1,27 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "express/config.h"
+
+namespace Express::Http {
+    // The Content-Encoding of a body compressed with the algorithm
+    [[nodiscard]] auto ContentCoding(Compression algorithm) -> std::string_view;
+
+    /*
+        Compresses the request body into the output, which is left empty
+        when the body is sent as it is: below the policy's threshold, or
+        when compressing doesn't make it smaller.
+    */
+    auto Encode(
+        const CompressionPolicy& policy,
+        std::string_view data,
+        std::pmr::string& output
+    ) -> std::error_code;
+}
@@ -4,54 +4,105 @@
 #include "data_readers.h"
 
 #include <algorithm>
+#include <charconv>
 #include <iterator>
-#include <stdexcept>
 
 #include "client/error.h"
 #include "http/validators.h"
 #include "http/defs.h"
 
 namespace Express::Http {
+    /*
+        DataReader
+    */
+    auto DataReader::Feed(std::string_view data) -> void {
+        std::error_code ec;
+        Feed(data, ec);
+        if (ec) Error::Throw(ec);
+    }
+
+    auto DataReader::Append(std::string& body, std::string_view data, std::error_code& ec) -> void {
+        if (decoder_ == nullptr) {
+            body.append(data);
+            return;
+        }
+        decoder_->Decode(data, body, ec);
+    }
+
     /*
         ConnectionClose
     */ 
-    auto ConnectionClose::Feed(std::string_view data) -> void {
-        response_.data.append(data);
-        if (response_.data.back() == '\0') {
-            response_.data.pop_back();
-        }
+    auto ConnectionClose::Feed(std::string_view data, std::error_code& ec) -> void {
+        ec.clear();
+        // A compressed body can end with a zero byte
+        if (!decoding() && !data.empty() && data.back() == '\0') data.remove_suffix(1);
+        Append(response_.data, data, ec);
     }
 
     /*
         ContentLength
     */
     ContentLength::ContentLength(Response& response) : response_(response) {
+        if (auto ec = ReadContentLength()) Error::Throw(ec);
+    }
+
+    ContentLength::ContentLength(Response& response, std::error_code& ec)
+      : response_(response) {
+        ec = ReadContentLength();
+    }
+
+    auto ContentLength::ReadContentLength() -> std::error_code {
+        if (!response_.headers.Contains("content-length")) {
+            return ErrorCode::kInvalidContentLength;
+        }
         auto length_str = response_.headers.Get("content-length");
-        if (!Validators::IsDigitRange(length_str)) {
-            Error::Runtime("Data reader error", "Invalid contentlength value");
+        if (length_str.empty() || !Validators::IsDigitRange(length_str)) {
+            return ErrorCode::kInvalidContentLength;
+        }
+        auto [_, result] = std::from_chars(
+            length_str.data(),
+            length_str.data() + length_str.size(),
+            content_length_
+        );
+        if (result != std::errc {}) {
+            return ErrorCode::kInvalidContentLength;
         }
-        content_length_ = std::stoul(length_str);
         response_.data.reserve(content_length_);
-    };
+        return {};
+    }
 
-    auto ContentLength::Feed(std::string_view data) -> void {
-        response_.data.append(data);
-        if (response_.data.size() >= content_length_) {
-            response_.data.resize(content_length_);
-            setDoneReadingData(true);
-        }
+    auto ContentLength::Feed(std::string_view data, std::error_code& ec) -> void {
+        ec.clear();
+        const auto reading = std::min(data.size(), content_length_ - received_);
+        received_ += reading;
+        Append(response_.data, data.substr(0, reading), ec);
+        if (received_ == content_length_) setDoneReadingData(true);
     }
 
     /*
         ChunkedTransfer
     */
-    auto ChunkedTransfer::Feed(std::string_view data) -> void {
+    auto ChunkedTransfer::Feed(std::string_view data, std::error_code& ec) -> void {
+        ec.clear();
         data_.append(data.cbegin(), data.cend());
 
         while (true) {
-            if (bytes_to_read_ > 0) {
+            // The trailer fields are read and dropped, up to the empty line
+            // that ends the body, so they aren't left on the connection
+            if (reading_trailers_) {
+                const auto iter {std::search(cbegin(data_), cend(data_), cbegin(CRLF), cend(CRLF))};
+                if (iter == data_.end()) break;
+
+                const auto empty = iter == cbegin(data_);
+                data_.erase(cbegin(data_), iter + 2);
+                if (empty) {
+                    setDoneReadingData(true);
+                    break;
+                }
+            } else if (bytes_to_read_ > 0) {
                 const auto reading {std::min(bytes_to_read_, data_.size())};
-                response_.data.append(data_.begin(), data_.begin() + reading);
+                Append(response_.data, {data_.data(), reading}, ec);
+                if (ec) return;
 
                 data_.erase(0, reading);
                 bytes_to_read_ -= reading;
@@ -65,10 +116,8 @@ namespace Express::Http {
                 if (done_reading_chunk_) {
                     if (data_.size() < 2) break;
                     if (data_[0] != CRLF[0] || data_[1] != CRLF[1]) {
-                        Error::Runtime(
-                            "Response error",
-                            "Every chunk must end with a delimiter"
-                        );
+                        ec = ErrorCode::kMissingChunkDelimiter;
+                        return;
                     }
                     data_.erase(cbegin(data_), cbegin(data_) + 2);
                     done_reading_chunk_ = false;
@@ -81,21 +130,22 @@ namespace Express::Http {
 
                 if (iter == data_.end()) break;
 
-                auto chunk_size = std::string(cbegin(data_), iter);
-
-                try {
-                    bytes_to_read_ = std::stoul(chunk_size, nullptr, 16);
-                } catch(const std::invalid_argument& _) {
-                    Error::Runtime("Response error", "Invalid chunk size");
+                // Chunk extensions that follow the chunk size are ignored
+                auto [_, result] = std::from_chars(
+                    data_.data(),
+                    data_.data() + std::distance(cbegin(data_), iter),
+                    bytes_to_read_,
+                    16
+                );
+                if (result != std::errc {}) {
+                    ec = ErrorCode::kInvalidChunkSize;
+                    return;
                 }
 
                 data_.erase(cbegin(data_), iter + 2);
 
-                if (bytes_to_read_ == 0) {
-                    setDoneReadingData(true);
-                    break;
-                }
+                if (bytes_to_read_ == 0) reading_trailers_ = true;
             }
         }
     }
-}
\ No newline at end of file
+}
@@ -3,24 +3,38 @@
 
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
 #include <string_view>
+#include <system_error>
 
 #include "response.h"
+#include "http/content_decoder.h"
 
 namespace Express::Http {
     class DataReader {
     public:
-        virtual auto Feed(std::string_view data) -> void = 0;
+        auto Feed(std::string_view data) -> void;
+        virtual auto Feed(std::string_view data, std::error_code& ec) -> void = 0;
 
         auto done_reading_data() const { return done_reading_data_; }
 
+        // The body is decoded as it's read, once its framing is removed
+        auto setDecoder(ContentDecoder* decoder) { decoder_ = decoder; }
+
         virtual ~DataReader() = default;
 
     protected:
         auto setDoneReadingData(bool is_done) { done_reading_data_ = is_done; }
 
+        auto Append(std::string& body, std::string_view data, std::error_code& ec) -> void;
+        auto decoding() const { return decoder_ != nullptr; }
+
     private:
         bool done_reading_data_ {false};
+        ContentDecoder* decoder_ {nullptr};
     };
 
     /*
@@ -30,7 +44,8 @@ namespace Express::Http {
     public:
         explicit ConnectionClose(Response& response) : response_(response) {};
 
-        auto Feed(std::string_view data) -> void override;
+        using DataReader::Feed;
+        auto Feed(std::string_view data, std::error_code& ec) -> void override;
 
     private:
         Response& response_;
@@ -42,13 +57,18 @@ namespace Express::Http {
     class ContentLength : public DataReader {
     public:
         explicit ContentLength(Response& response);
+        ContentLength(Response& response, std::error_code& ec);
 
-        auto Feed(std::string_view data) -> void override;
+        using DataReader::Feed;
+        auto Feed(std::string_view data, std::error_code& ec) -> void override;
 
     private: 
         size_t content_length_ {0};
+        size_t received_ {0};
 
         Response& response_;
+
+        auto ReadContentLength() -> std::error_code;
     };
 
     /*
@@ -56,16 +76,50 @@ namespace Express::Http {
     */
     class ChunkedTransfer : public DataReader {
     public:
-        explicit ChunkedTransfer(Response& response) : response_(response) {};
+        explicit ChunkedTransfer(
+            Response& response,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+        ) : data_(resource), response_(response) {};
 
-        auto Feed(std::string_view data) -> void override;
+        using DataReader::Feed;
+        auto Feed(std::string_view data, std::error_code& ec) -> void override;
 
     private:
         bool done_reading_chunk_ {false};
+        bool reading_trailers_ {false};
         size_t bytes_to_read_ {0};
 
-        std::string data_; 
+        std::pmr::string data_;
 
         Response& response_;
     };
-}
\ No newline at end of file
+
+    /*
+        Destroys a data reader that was allocated from a memory resource.
+    */
+    struct DataReaderDeleter {
+        std::pmr::memory_resource* resource;
+        std::size_t size;
+        std::size_t alignment;
+
+        auto operator()(DataReader* reader) const -> void {
+            reader->~DataReader();
+            resource->deallocate(reader, size, alignment);
+        }
+    };
+
+    using DataReaderPtr = std::unique_ptr<DataReader, DataReaderDeleter>;
+
+    template <class T, class... Args>
+    [[nodiscard]] auto MakeDataReader(std::pmr::memory_resource* resource, Args&&... args) {
+        std::pmr::polymorphic_allocator<T> allocator {resource};
+        auto reader = allocator.allocate(1);
+        try {
+            allocator.construct(reader, std::forward<Args>(args)...);
+        } catch (...) {
+            allocator.deallocate(reader, 1);
+            throw;
+        }
+        return DataReaderPtr {reader, {resource, sizeof(T), alignof(T)}};
+    }
+}
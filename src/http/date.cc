@@ -0,0 +1,71 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "http/date.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+
+namespace Express::Http {
+    namespace {
+        // Converts a UTC calendar time, like timegm() which isn't standard
+        auto DaysFromCivil(int year, unsigned month, unsigned day) -> std::int64_t {
+            year -= month <= 2;
+            const auto era = (year >= 0 ? year : year - 399) / 400;
+            const auto year_of_era = static_cast<unsigned>(year - era * 400);
+            const auto day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+            const auto day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+            return static_cast<std::int64_t>(era) * 146097 + static_cast<std::int64_t>(day_of_era) - 719468;
+        }
+
+        // Larger delta-seconds are taken as this (RFC 9111, section 1.2.2)
+        constexpr std::int64_t kMaxDeltaSeconds {2147483648};
+
+        template <class T>
+        auto ParseNumber(std::string_view value, T& number) {
+            const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), number);
+            return ec == std::errc {} && end == value.data() + value.size();
+        }
+    }
+
+    auto ParseHttpDate(std::string_view value) -> std::optional<std::chrono::system_clock::time_point> {
+        static constexpr std::array<std::string_view, 12> kMonths {
+            "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+            "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+        };
+
+        if (value.size() != 29 || value.substr(25) != " GMT") return std::nullopt;
+
+        int day = 0, year = 0, hours = 0, minutes = 0, seconds = 0;
+        if (!ParseNumber(value.substr(5, 2), day) ||
+            !ParseNumber(value.substr(12, 4), year) ||
+            !ParseNumber(value.substr(17, 2), hours) ||
+            !ParseNumber(value.substr(20, 2), minutes) ||
+            !ParseNumber(value.substr(23, 2), seconds)) {
+            return std::nullopt;
+        }
+
+        const auto month = std::find(kMonths.begin(), kMonths.end(), value.substr(8, 3));
+        if (month == kMonths.end()) return std::nullopt;
+
+        const auto days = DaysFromCivil(
+            year,
+            static_cast<unsigned>(month - kMonths.begin() + 1),
+            static_cast<unsigned>(day)
+        );
+        return std::chrono::system_clock::time_point {
+            std::chrono::seconds {days * 86400 + hours * 3600 + minutes * 60 + seconds}
+        };
+    }
+
+    auto ParseDeltaSeconds(std::string_view value) -> std::optional<std::chrono::seconds> {
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string_view::npos) return std::nullopt;
+
+        std::int64_t seconds = 0;
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), seconds);
+        if (ec == std::errc::result_out_of_range) seconds = kMaxDeltaSeconds;
+        return std::chrono::seconds {std::min(seconds, kMaxDeltaSeconds)};
+    }
+}
@@ -0,0 +1,17 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string_view>
+
+namespace Express::Http {
+    // Parses an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+    [[nodiscard]] auto ParseHttpDate(std::string_view value) -> std::optional<std::chrono::system_clock::time_point>;
+
+    // Parses a non-negative number of seconds, e.g. the value of an Age
+    // header. Values past 2^31 seconds are capped to it.
+    [[nodiscard]] auto ParseDeltaSeconds(std::string_view value) -> std::optional<std::chrono::seconds>;
+}
@@ -0,0 +1,50 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/dictionaries.h"
+
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include "http/dictionary.h"
+
+namespace Express {
+    Dictionaries::Dictionaries() = default;
+
+    auto Dictionaries::Add(std::string id, std::string data) -> void {
+        auto dictionary = std::make_shared<Http::Dictionary>();
+        dictionary->data = std::move(data);
+
+        #ifdef EXPRESS_ZSTD
+            dictionary->zstd.reset(ZSTD_createDDict(
+                dictionary->data.data(),
+                dictionary->data.size()
+            ));
+            if (dictionary->zstd == nullptr) throw std::bad_alloc {};
+        #endif
+
+        std::unique_lock lock {mutex_};
+        dictionaries_.insert_or_assign(std::move(id), std::move(dictionary));
+    }
+
+    auto Dictionaries::Remove(std::string_view id) -> void {
+        std::unique_lock lock {mutex_};
+        if (const auto iter = dictionaries_.find(id); iter != dictionaries_.end()) {
+            dictionaries_.erase(iter);
+        }
+    }
+
+    auto Dictionaries::Find(std::string_view id) const -> std::shared_ptr<const Http::Dictionary> {
+        std::shared_lock lock {mutex_};
+        const auto iter = dictionaries_.find(id);
+        return iter == dictionaries_.end() ? nullptr : iter->second;
+    }
+
+    auto Dictionaries::size() const -> std::size_t {
+        std::shared_lock lock {mutex_};
+        return dictionaries_.size();
+    }
+
+    Dictionaries::~Dictionaries() = default;
+}
@@ -0,0 +1,33 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#ifdef EXPRESS_ZSTD
+    #include <zstd.h>
+#endif
+
+namespace Express::Http {
+    #ifdef EXPRESS_ZSTD
+        struct ZstdDictionaryDeleter {
+            auto operator()(ZSTD_DDict* dictionary) const { ZSTD_freeDDict(dictionary); }
+        };
+    #endif
+
+    /*
+        A shared dictionary, in the forms the decoders use. Dictionaries
+        are immutable once they're added, and a decoder keeps the one it
+        uses alive until it's destroyed.
+    */
+    struct Dictionary {
+        std::string data;
+
+        #ifdef EXPRESS_ZSTD
+            // Digested once, rather than by every response that uses it
+            std::unique_ptr<ZSTD_DDict, ZstdDictionaryDeleter> zstd;
+        #endif
+    };
+}
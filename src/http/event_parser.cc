@@ -0,0 +1,125 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "event_parser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <utility>
+
+#include "express/error_code.h"
+#include "http/validators.h"
+
+namespace Express::Http {
+    namespace {
+        constexpr std::string_view kByteOrderMark {"\xEF\xBB\xBF"};
+    }
+
+    EventParser::EventParser(std::size_t max_event_size, std::string last_event_id)
+      : max_event_size_(max_event_size),
+        id_(last_event_id),
+        last_event_id_(std::move(last_event_id)) {}
+
+    auto EventParser::Feed(std::string_view chunk, const Callback& callback, std::error_code& ec) -> void {
+        ec.clear();
+
+        // A line may end with CRLF, LF or CR, and a CRLF may be split
+        // between two chunks
+        if (after_cr_ && chunk.starts_with('\n')) chunk.remove_prefix(1);
+        after_cr_ = false;
+
+        while (!chunk.empty()) {
+            const auto end = chunk.find_first_of("\r\n");
+            if (end == std::string_view::npos) {
+                if (line_.size() + chunk.size() > max_event_size_) {
+                    ec = ErrorCode::kEventTooLarge;
+                    return;
+                }
+                line_.append(chunk);
+                return;
+            }
+
+            // The line is parsed where it is, unless it started in an earlier chunk
+            auto line = chunk.substr(0, end);
+            if (!line_.empty()) {
+                if (line_.size() + line.size() > max_event_size_) {
+                    ec = ErrorCode::kEventTooLarge;
+                    return;
+                }
+                line_.append(line);
+                line = line_;
+            }
+
+            ec = ProcessLine(line, callback);
+            line_.clear();
+            if (ec) return;
+
+            if (chunk[end] == '\r' && end + 1 == chunk.size()) after_cr_ = true;
+            const auto next = chunk[end] == '\r' && end + 1 < chunk.size() && chunk[end + 1] == '\n' ? end + 2 : end + 1;
+            chunk.remove_prefix(next);
+        }
+    }
+
+    auto EventParser::ProcessLine(std::string_view line, const Callback& callback) -> std::error_code {
+        if (first_line_ && line.starts_with(kByteOrderMark)) line.remove_prefix(kByteOrderMark.size());
+        first_line_ = false;
+
+        if (line.empty()) {
+            Dispatch(callback);
+            return {};
+        }
+
+        // Comments keep idle connections open
+        if (line.starts_with(':')) return {};
+
+        const auto colon = line.find(':');
+        const auto field = line.substr(0, colon);
+        auto value = colon == std::string_view::npos ? std::string_view {} : line.substr(colon + 1);
+        if (value.starts_with(' ')) value.remove_prefix(1);
+
+        if (field == "data") {
+            if (data_.size() + value.size() + 1 > max_event_size_) return ErrorCode::kEventTooLarge;
+            data_.append(value).append(1, '\n');
+        } else if (field == "event") {
+            type_.assign(value);
+        } else if (field == "id") {
+            // An ID is sent back as a Last-Event-ID header, so one that
+            // can't be, like one with NULL or control characters, is ignored
+            if (Validators::IsValidCharRange(value)) id_.assign(value);
+        } else if (field == "retry") {
+            std::size_t milliseconds = 0;
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), milliseconds);
+            if (error == std::errc {} && end == value.data() + value.size() && !value.empty()) {
+                retry_ = std::chrono::milliseconds {milliseconds};
+            }
+        }
+        return {};
+    }
+
+    auto EventParser::Dispatch(const Callback& callback) -> void {
+        // The ID takes effect even without data, so a server can move the
+        // stream on without sending an event
+        last_event_id_ = id_;
+        if (data_.empty()) {
+            type_.clear();
+            return;
+        }
+
+        data_.pop_back();
+        if (callback) {
+            const auto type = type_.empty() ? std::string_view {"message"} : std::string_view {type_};
+            callback(Event {.type = type, .data = data_, .id = last_event_id_});
+        }
+        type_.clear();
+        data_.clear();
+    }
+
+    auto EventParser::Reset() -> void {
+        line_.clear();
+        type_.clear();
+        data_.clear();
+        id_ = last_event_id_;
+        after_cr_ = false;
+        first_line_ = true;
+    }
+}
@@ -0,0 +1,59 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "express/event_stream.h"
+
+namespace Express::Http {
+    /*
+        An incremental parser of text/event-stream bodies. The body can be
+        fed in chunks of any size, and the lines that fit in a chunk are
+        parsed where they are. Only a line that's split between chunks,
+        and the data of the current event, are copied.
+    */
+    class EventParser {
+    public:
+        using Callback = std::function<void(const Event&)>;
+
+        explicit EventParser(std::size_t max_event_size, std::string last_event_id = {});
+
+        // Parses the chunk, and calls the callback for every event it completes
+        auto Feed(std::string_view chunk, const Callback& callback, std::error_code& ec) -> void;
+
+        // Drops the event that's being received, once the connection ends
+        auto Reset() -> void;
+
+        [[nodiscard]] auto last_event_id() const -> std::string_view { return last_event_id_; }
+
+        // The reconnection delay, if the server set one
+        [[nodiscard]] auto retry() const { return retry_; }
+
+    private:
+        std::size_t max_event_size_;
+
+        // A line that continues in the next chunk
+        std::string line_;
+
+        std::string type_;
+        std::string data_;
+        std::string id_;
+        std::string last_event_id_;
+        std::optional<std::chrono::milliseconds> retry_;
+
+        // Whether the previous chunk ended with CR, whose LF may start the next one
+        bool after_cr_ {false};
+        bool first_line_ {true};
+
+        auto ProcessLine(std::string_view line, const Callback& callback) -> std::error_code;
+        auto Dispatch(const Callback& callback) -> void;
+    };
+}
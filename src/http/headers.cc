@@ -20,14 +20,14 @@ namespace Express {
         TrimTrailingWhiteSpacesInPlace(value);
 
         if (name.empty() || !IsTokenRange(name)) {
-            Error::Logic("Header error", "Invalid header name");
+            Error::Throw(ErrorCode::kInvalidHeaderName);
         }
 
         if (!IsValidCharRange(value)) {
-            Error::Logic("Header error", "Invalid header value");
+            Error::Throw(ErrorCode::kInvalidHeaderValue);
         }
 
-        headers_.try_emplace(StringToLowerCase(name), name, value);
+        headers_.try_emplace(StringToLowerCase(name), name, std::move(value));
     }
 
     auto Headers::Remove(const std::string& name) -> void {
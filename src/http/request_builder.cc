@@ -3,75 +3,195 @@
 
 #include "request_builder.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "client/error.h"
+#include "client/routing.h"
+#include "express/proxy.h"
 #include "express/method.h"
 #include "express/user_auth.h"
 #include "express/version.h"
+#include "http/content_decoder.h"
+#include "http/content_encoder.h"
 #include "http/defs.h"
+#include "http/validators.h"
+#include "net/url.h"
 #include "utils/string_transformers.h"
 
 namespace Express::Http {
-    RequestBuilder::RequestBuilder(const Config& config)
-    : config_(config), url_(config.url) {
-        SetHeaders();
-        WriteToStream();
+    struct HeaderField {
+        std::string_view key;
+        std::string_view name;
+        std::string_view value;
+    };
+
+    RequestBuilder::RequestBuilder(
+        const Config& config,
+        std::pmr::memory_resource* resource
+    ) : data_(resource) {
+        if (auto ec = Build(config, Connection::kClose)) Error::Throw(ec);
     }
 
-    auto RequestBuilder::SetHeaders() -> void {
-        auto version {
-            std::to_string(Version::Major) + "." +
-            std::to_string(Version::Minor)
-        };
+    RequestBuilder::RequestBuilder(
+        const Config& config,
+        std::pmr::memory_resource* resource,
+        std::error_code& ec,
+        Connection connection
+    ) : data_(resource) {
+        ec = Build(config, connection);
+    }
+
+    auto RequestBuilder::Build(const Config& config, Connection connection) -> std::error_code {
+        if (!config.data.empty() && !IsDataAllowed(config.method)) {
+            return ErrorCode::kDataNotAllowed;
+        }
 
-        config_.headers.Add("Host", url_.host());
-        config_.headers.Add("User-Agent", "express/" + version);
+        // A body that's already encoded, or whose length is given, is sent as it is
+        std::pmr::string encoded {data_.get_allocator()};
+        if (!config.headers.Contains("content-encoding") && !config.headers.Contains("content-length")) {
+            if (auto ec = Encode(config.compress, config.data, encoded)) return ec;
+        }
 
-        if (!config_.auth.Empty() || url_.HasUserInformation()) {
-            if (config_.headers.Contains("Authorization")) {
-                config_.headers.Remove("Authorization");
-            }
+        const auto body = encoded.empty() ? config.data : std::string_view {encoded};
+        const auto content_encoding = encoded.empty() ?
+            std::string_view {} : ContentCoding(config.compress.algorithm);
+
+        // Large bodies wait for the server to accept them, as does any
+        // body whose Expect header the user set
+        const auto expect = std::find_if(config.headers.begin(), config.headers.end(), [](const auto& header) {
+            return header.first == "expect";
+        });
+        if (expect != config.headers.end()) {
+            expects_continue_ = !body.empty() &&
+                                StringTransformers::EqualsIgnoreCase(expect->second.second, "100-continue");
+        } else {
+            const auto min_bytes = config.expect_continue.min_bytes;
+            expects_continue_ = min_bytes > 0 && body.size() >= min_bytes;
+        }
+
+        if (auto ec = WriteHeaders(config, connection, body, content_encoding)) {
+            return ec;
+        }
+        header_size_ = data_.size();
+        data_.append(body);
+        return {};
+    }
+
+    auto RequestBuilder::WriteHeaders(
+        const Config& config,
+        Connection connection,
+        std::string_view body,
+        std::string_view content_encoding
+    ) -> std::error_code {
+        auto resource = data_.get_allocator().resource();
+
+        std::error_code ec;
+        const Net::Url url {config.url, resource, ec};
+        if (ec) return ec;
+
+        std::pmr::vector<HeaderField> fields {resource};
+        fields.reserve(std::distance(config.headers.begin(), config.headers.end()) + 8);
+
+        // Generated values are kept in the arena until the headers are written.
+        std::pmr::string user_agent {"express/", resource};
+        user_agent.append(std::to_string(Version::Major)).append(".");
+        user_agent.append(std::to_string(Version::Minor));
+
+        std::pmr::string content_length {resource};
+        std::pmr::string authorization {resource};
+
+        const auto has_auth = !config.auth.Empty() || url.HasUserInformation();
+        for (const auto& [key, header] : config.headers) {
+            if (has_auth && key == "authorization") continue;
+            fields.push_back({key, header.first, header.second});
+        }
 
-            auto auth = config_.auth;
-            if (auth.Empty()) {
-                auth.username = url_.user();
-                auth.password = url_.password();
+        auto add_default = [&](std::string_view key, std::string_view name, std::string_view value) {
+            if (config.headers.Contains(std::string {key})) return;
+            if (!Validators::IsValidCharRange(value)) {
+                ec = ErrorCode::kInvalidHeaderValue;
             }
-            auto encoded_auth = StringTransformers::Base64Encoding(
-                auth.username + ":" + auth.password
-            );
+            fields.push_back({key, name, value});
+        };
+
+        add_default("host", "Host", url.host());
+        if (ec) return ec;
 
-            config_.headers.Add("Authorization", "Basic " + encoded_auth);
+        // A proxy that forwards the request needs the whole URL, and may ask
+        // for credentials. Requests to https hosts go through a tunnel and
+        // are written as if they were sent directly.
+        const auto* proxy = ProxyFor(config, url);
+        const auto absolute = proxy != nullptr && url.scheme() == "http";
+        if (absolute && !proxy->authorization().empty()) {
+            add_default("proxy-authorization", "Proxy-Authorization", proxy->authorization());
         }
+        add_default("user-agent", "User-Agent", user_agent);
+        if (config.decompress && !AcceptEncoding().empty()) add_default("accept-encoding", "Accept-Encoding", AcceptEncoding());
 
-        if (!config_.data.empty()) {
-            if (!IsDataAllowed()) {
-                Error::Logic(
-                    "Request error",
-                    "Data can only be added for "
-                    "PUT, POST, DELETE, and PATCH requests"
-                );
+        if (has_auth) {
+            std::pmr::string credentials {resource};
+            if (!config.auth.Empty()) {
+                credentials.append(config.auth.username).append(":");
+                credentials.append(config.auth.password);
+            } else {
+                credentials.append(url.user()).append(":").append(url.password());
             }
-            config_.headers.Add(
-                "Content-Length",
-                std::to_string(config_.data.size())
-            );
+            authorization.append("Basic ");
+            StringTransformers::Base64Encoding(credentials, authorization);
+            fields.push_back({"authorization", "Authorization", authorization});
         }
 
-        config_.headers.Add("Connection", "close");
-    }
+        if (!body.empty()) {
+            content_length.append(std::to_string(body.size()));
+            add_default("content-length", "Content-Length", content_length);
+        }
+        if (!content_encoding.empty()) {
+            fields.push_back({"content-encoding", "Content-Encoding", content_encoding});
+        }
+        if (expects_continue_) add_default("expect", "Expect", "100-continue");
 
-    auto RequestBuilder::WriteToStream() -> void {
-        stream_ << config_.method << " /" << url_.path() <<  " HTTP/1.1" << crlf;
-        for (const auto& [_, header] : config_.headers) {
-            stream_ << header.first + ": " + header.second << crlf;
+        add_default(
+            "connection",
+            "Connection",
+            connection == Connection::kKeepAlive ? "keep-alive" : "close"
+        );
+
+        // Headers are written in the same order as Express::Headers stores
+        // them, which is sorted by their lower case name.
+        std::sort(begin(fields), end(fields), [](const auto& a, const auto& b) {
+            return a.key < b.key;
+        });
+
+        const auto method = std::string_view {MethodToString(config.method)};
+        auto size = method.size() + url.path().size() + url.query().size() + 17 + body.size();
+        if (absolute) size += url.host().size() + url.port().size() + 8;
+        for (const auto& field : fields) {
+            size += field.name.size() + field.value.size() + 4;
+        }
+        data_.reserve(size);
+
+        data_.append(method).append(" ");
+        if (absolute) {
+            data_.append("http://").append(url.host());
+            if (url.port() != "80") data_.append(":").append(url.port());
+        }
+        data_.append("/").append(url.path());
+        if (!url.query().empty()) data_.append("?").append(url.query());
+        data_.append(" HTTP/1.1");
+        data_.append(cbegin(CRLF), cend(CRLF));
+        for (const auto& field : fields) {
+            data_.append(field.name).append(": ").append(field.value);
+            data_.append(cbegin(CRLF), cend(CRLF));
         }
-        stream_ << crlf;
-        stream_ << config_.data;
+        data_.append(cbegin(CRLF), cend(CRLF));
+
+        return {};
     }
 
-    auto RequestBuilder::IsDataAllowed() const -> bool {
+    auto RequestBuilder::IsDataAllowed(Method method) const -> bool {
         using enum Express::Method;
-        switch (config_.method) {
+        switch (method) {
             case Get:
             case Options:
             case Head:
@@ -80,4 +200,41 @@ namespace Express::Http {
                 return true;
         }
     }
-}
\ No newline at end of file
+
+    auto RequestHeader(const Config& config, std::string_view name) -> std::string {
+        if (name == "authorization") {
+            std::string credentials;
+            if (!config.auth.Empty()) {
+                credentials.append(config.auth.username).append(":").append(config.auth.password);
+            } else {
+                std::error_code ec;
+                const Net::Url url {config.url, std::pmr::get_default_resource(), ec};
+                if (!ec && url.HasUserInformation()) {
+                    credentials.append(url.user()).append(":").append(url.password());
+                }
+            }
+            if (!credentials.empty()) return "Basic " + StringTransformers::Base64Encoding(credentials);
+        }
+
+        for (const auto& [key, header] : config.headers) {
+            if (key == name) return header.second;
+        }
+        return {};
+    }
+
+    auto WriteConnectRequest(
+        std::string_view authority,
+        std::string_view authorization,
+        std::pmr::string& output
+    ) -> void {
+        output.append("CONNECT ").append(authority).append(" HTTP/1.1");
+        output.append(cbegin(CRLF), cend(CRLF));
+        output.append("Host: ").append(authority);
+        output.append(cbegin(CRLF), cend(CRLF));
+        if (!authorization.empty()) {
+            output.append("Proxy-Authorization: ").append(authorization);
+            output.append(cbegin(CRLF), cend(CRLF));
+        }
+        output.append(cbegin(CRLF), cend(CRLF));
+    }
+}
@@ -3,25 +3,62 @@
 
 #pragma once
 
-#include <sstream>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <system_error>
 
 #include "express/config.h"
-#include "net/url.h"
 
 namespace Express::Http {
+    enum class Connection {kClose, kKeepAlive};
+
     class RequestBuilder {
     public:
-        explicit RequestBuilder(const Config& config);
+        explicit RequestBuilder(
+            const Config& config,
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+        );
+
+        RequestBuilder(
+            const Config& config,
+            std::pmr::memory_resource* resource,
+            std::error_code& ec,
+            Connection connection = Connection::kClose
+        );
+
+        [[nodiscard]] auto GetData() const -> std::string_view { return data_; }
+        [[nodiscard]] auto GetHeaders() const { return GetData().substr(0, header_size_); }
+        [[nodiscard]] auto GetBody() const { return GetData().substr(header_size_); }
 
-        [[nodiscard]] auto GetData() const { return stream_.str(); } 
+        // True if the body waits for the server's 100 Continue
+        [[nodiscard]] auto expects_continue() const { return expects_continue_; }
 
     private:
-        Config config_;
-        Net::Url url_;
-        std::stringstream stream_;
+        std::pmr::string data_;
+        std::size_t header_size_ {0};
+        bool expects_continue_ {false};
 
-        auto SetHeaders() -> void;
-        auto WriteToStream() -> void;
-        auto IsDataAllowed() const -> bool;
+        auto Build(const Config& config, Connection connection) -> std::error_code;
+        auto WriteHeaders(
+            const Config& config,
+            Connection connection,
+            std::string_view body,
+            std::string_view content_encoding
+        ) -> std::error_code;
+        auto IsDataAllowed(Method method) const -> bool;
     };
-}
\ No newline at end of file
+
+    // The value the request sends for a header, given its lower case name.
+    // The Authorization header is the one made from the config's
+    // credentials, or from the URL's, when it has them.
+    [[nodiscard]] auto RequestHeader(const Config& config, std::string_view name) -> std::string;
+
+    // Asks a proxy to open a tunnel to the authority (host:port)
+    auto WriteConnectRequest(
+        std::string_view authority,
+        std::string_view authorization,
+        std::pmr::string& output
+    ) -> void;
+}
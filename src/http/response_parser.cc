@@ -3,6 +3,8 @@
 
 #include "response_parser.h"
 
+#include <algorithm>
+
 #include "client/error.h"
 #include "http/data_readers.h"
 #include "http/defs.h"
@@ -11,14 +13,41 @@
 #include "utils/string_transformers.h"
 
 namespace Express::Http {
-    auto ResponseParser::response() const -> Express::Response {
+    ResponseParser::ResponseParser(
+        std::pmr::memory_resource* resource,
+        Decoding decoding,
+        const Dictionaries* dictionaries,
+        std::size_t max_decoded_bytes
+    ) : decoding_(decoding),
+        dictionaries_(dictionaries),
+        max_decoded_bytes_(max_decoded_bytes),
+        resource_(resource), data_(resource), decoder_(nullptr, {resource, 0, 0}) {}
+
+    auto ResponseParser::response() const& -> Express::Response {
+        if (auto ec = CheckResponse()) Error::Throw(ec);
+        return response_;
+    }
+
+    auto ResponseParser::response() && -> Express::Response {
+        if (auto ec = CheckResponse()) Error::Throw(ec);
+        return std::move(response_);
+    }
+
+    auto ResponseParser::response(std::error_code& ec) && -> Express::Response {
+        ec = CheckResponse();
+        return std::move(response_);
+    }
+
+    auto ResponseParser::CheckResponse() const -> std::error_code {
         if (known_body_length_ && !done_reading_data_) {
-            Error::Runtime(
-                "Response error",
-                "Incomplete data transfer"
-            );
+            return ErrorCode::kIncompleteResponse;
         }
-        return response_;
+        if (decoder_ != nullptr) {
+            std::error_code ec;
+            decoder_->Finish(ec);
+            return ec;
+        }
+        return {};
     }
 
     auto ResponseParser::done_reading_data() const -> bool {
@@ -26,32 +55,72 @@ namespace Express::Http {
     }
 
     auto ResponseParser::Feed(unsigned char* buffer, std::size_t size) -> void {
+        std::error_code ec;
+        Feed(buffer, size, ec);
+        if (ec == ErrorCode::kUnsupportedTransferEncoding) {
+            Error::ThrowWithDetail(ec, response_.headers.Get("transfer-encoding"));
+        }
+        if (ec) Error::Throw(ec);
+    }
+
+    auto ResponseParser::Feed(unsigned char* buffer, std::size_t size, std::error_code& ec) -> void {
+        ec.clear();
         data_.append(buffer, buffer + size);
-        if (!parsing_body_) ReadHeaders();
-        if (parsing_body_) ReadBody();
+        if (!parsing_body_) ec = ReadHeaders();
+        if (!ec && parsing_body_) ec = ReadBody();
     }
 
-    auto ResponseParser::ReadHeaders() -> void {
-        auto idx = data_.find({cbegin(HCRLF), cend(HCRLF)});
+    auto ResponseParser::ReadHeaders() -> std::error_code {
+        auto idx = data_.find(string_view {HCRLF.data(), HCRLF.size()});
         if (idx == std::string::npos) {
-            return;
+            return {};
+        }
+        auto headers = Split(string_view {data_}.substr(0, idx + 2));
+        if (headers.empty()) {
+            return ErrorCode::kMalformedStatusLine;
+        }
+
+        std::error_code ec;
+        StatusLine status {headers.front(), ec};
+        if (ec) return ec;
+
+        // Interim responses come before the final one. 100 Continue lets a
+        // request that's waiting for it send its body.
+        if (status.code() >= 100 && status.code() < 200 && status.code() != 101) {
+            continued_ = continued_ || status.code() == 100;
+            data_.erase(begin(data_), begin(data_) + idx + 4);
+            return ReadHeaders();
         }
-        auto headers_data = data_.substr(0, idx + 2);
-        auto headers = Split(headers_data);
 
-        StatusLine status {headers.front()};
         response_.status_code = status.code();
         response_.status_text = status.text();
 
-        ProcessHeaders({headers.begin() + 1, headers.end()});
+        ec = ProcessHeaders(std::span {headers}.subspan(1));
+        if (ec) return ec;
+
+        // HTTP/1.1 connections are persistent unless either side closes
+        // them, HTTP/1.0 connections only if the server opts in.
+        auto connection = response_.headers.Contains("connection") ?
+            StringTransformers::StringToLowerCase(response_.headers.Get("connection")) : "";
+        keep_alive_ = status.minor_version() == 1 ?
+            connection != "close" : connection == "keep-alive";
         data_.erase(begin(data_), begin(data_) + idx + 4);
 
+        // These responses never have a body, whatever their headers say, and
+        // after a 101 the connection speaks another protocol
+        const auto code = response_.status_code;
+        if (code == 101 || code == 204 || code == 304) {
+            known_body_length_ = true;
+            done_reading_data_ = true;
+        }
+
         parsing_body_ = true;
+        return {};
     }
 
-    auto ResponseParser::Split(string_view headers) const -> vector<string> {
-        std::vector<std::string> output;
-        std::string line;
+    auto ResponseParser::Split(string_view headers) const -> std::pmr::vector<std::pmr::string> {
+        std::pmr::vector<std::pmr::string> output {resource_};
+        std::pmr::string line {resource_};
         auto iter = headers.begin();
         while (iter != headers.end()) {
             auto len = headers.end() - iter;
@@ -73,87 +142,128 @@ namespace Express::Http {
         return output;
     }
 
-    auto ResponseParser::IsObsoleteLineFolding(const std::string& str) const -> bool {
+    auto ResponseParser::IsObsoleteLineFolding(string_view str) const -> bool {
         if (str.size() < 3) return false;
         return Validators::IsWhiteSpace(str[2]) &&
                str[1] == 0xA &&
                str[0] == 0xD;
     }
 
-    auto ResponseParser::IsDelimiter(const std::string& str) const -> bool {
+    auto ResponseParser::IsDelimiter(string_view str) const -> bool {
         if (str.size() < 2) return false;
         return str[0] == 0xD && str[1] == 0xA;
     }
 
-    auto ResponseParser::ProcessHeaders(const std::vector<std::string>& headers) -> void {
+    auto ResponseParser::ProcessHeaders(std::span<const std::pmr::string> headers) -> std::error_code {
         using namespace StringTransformers;
 
-        for (const std::string& header : headers) {
+        for (string_view header : headers) {
             auto separator = header.find(":");
             if (separator == std::string::npos) {
-                Error::Runtime(
-                    "Response error",
-                    "Failed to process invalid response header"
-                );
+                return ErrorCode::kInvalidHeader;
             }
 
             auto name = header.substr(0, separator);
-            auto value = TrimLeadingWhiteSpaces(header.substr(separator + 1));
+            auto value = header.substr(separator + 1);
+            value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
 
-            auto lowercase_name = StringToLowerCase(name);
-            if (lowercase_name == "content-length") {
+            // Headers::Add throws for invalid names and values, so they are
+            // validated before the header is added
+            if (name.empty() || !Validators::IsTokenRange(name) ||
+                !Validators::IsValidCharRange(value)) {
+                return ErrorCode::kInvalidHeader;
+            }
+
+            if (EqualsIgnoreCase(name, "content-length")) {
                 if (response_.headers.Contains("content-length") &&
                     response_.headers.Get("content-length") != value
                 ) {
-                    Error::Runtime(
-                        "Response error",
-                        "Received multiple content length fields "
-                        "with different values"
-                    );
+                    return ErrorCode::kConflictingContentLength;
                 }
                 if (response_.headers.Contains("transfer-encoding")) {
                     continue;
                 }
             }
 
-            if (lowercase_name == "transfer-encoding" && value == "chunked" &&
+            if (EqualsIgnoreCase(name, "transfer-encoding") && value == "chunked" &&
                 response_.headers.Contains("content-length")) {
                 response_.headers.Remove("content-length");
             }
 
-            response_.headers.Add(name, value);
+            response_.headers.Add(std::string {name}, std::string {value});
         }
+        return {};
     }
 
-    auto ResponseParser::ReadBody() -> void {
-        if (data_reader_ == nullptr) data_reader_ = DataReaderFactory();
-        if (data_reader_->done_reading_data()) return;
+    auto ResponseParser::ReadBody() -> std::error_code {
+        if (done_reading_data_) return {};
+
+        std::error_code ec;
+        if (data_reader_ == nullptr) {
+            data_reader_ = DataReaderFactory(ec);
+            if (ec) return ec;
+
+            decoder_ = DecoderFactory();
+            data_reader_->setDecoder(decoder_.get());
+        }
+        if (data_reader_->done_reading_data()) return {};
 
-        data_reader_->Feed(data_);
+        data_reader_->Feed(data_, ec);
         data_.clear();
 
         done_reading_data_ = data_reader_->done_reading_data();
+        return ec;
     }
 
-    auto ResponseParser::DataReaderFactory() -> std::unique_ptr<DataReader> {
+    auto ResponseParser::DataReaderFactory(std::error_code& ec) -> DataReaderPtr {
         if (response_.headers.Contains("transfer-encoding")) {
             auto value { response_.headers.Get("transfer-encoding") };
             if (value == "chunked") {
                 known_body_length_ = true;
-                return std::make_unique<ChunkedTransfer>(response_);
-            } else {
-                Error::Runtime(
-                    "Response error",
-                    "Unsupport transfer encoding (" + value + ")"
-                );
+                return MakeDataReader<ChunkedTransfer>(resource_, response_, resource_);
             }
+            ec = ErrorCode::kUnsupportedTransferEncoding;
+            return nullptr;
         }
 
         if (response_.headers.Contains("content-length")) {
             known_body_length_ = true;
-            return std::make_unique<ContentLength>(response_);
+            return MakeDataReader<ContentLength>(resource_, response_, ec);
+        }
+
+        return MakeDataReader<ConnectionClose>(resource_, response_);
+    }
+
+    auto ResponseParser::DecoderFactory() -> ContentDecoderPtr {
+        if (decoding_ == Decoding::kRaw || !response_.headers.Contains("content-encoding")) {
+            return {nullptr, {resource_, 0, 0}};
         }
 
-        return std::make_unique<ConnectionClose>(response_);
+        std::shared_ptr<const Dictionary> dictionary;
+        const auto shared = response_.headers.Contains("dictionary-id");
+        if (shared) {
+            // The ID may be sent as a quoted string
+            auto id = response_.headers.Get("dictionary-id");
+            if (id.size() >= 2 && id.front() == '"' && id.back() == '"') id = id.substr(1, id.size() - 2);
+            if (dictionaries_ != nullptr) dictionary = dictionaries_->Find(id);
+        }
+
+        // Codings the client can't decode, and bodies compressed against a
+        // dictionary it doesn't have, are left to the caller
+        if (shared && dictionary == nullptr) return {nullptr, {resource_, 0, 0}};
+        auto decoder = MakeContentDecoder(
+            response_.headers.Get("content-encoding"),
+            resource_,
+            std::move(dictionary),
+            max_decoded_bytes_
+        );
+
+        if (decoder != nullptr) {
+            // The headers describe the decoded body from here on
+            response_.headers.Remove("content-encoding");
+            if (shared) response_.headers.Remove("dictionary-id");
+            if (response_.headers.Contains("content-length")) response_.headers.Remove("content-length");
+        }
+        return decoder;
     }
-}
\ No newline at end of file
+}
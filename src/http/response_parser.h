@@ -3,45 +3,97 @@
 
 #pragma once
 
+#include <limits>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <string_view>
+#include <system_error>
 #include <vector>
-#include <memory>
 
+#include "express/dictionaries.h"
 #include "express/response.h"
+#include "http/content_decoder.h"
 #include "http/data_readers.h"
 
 namespace Express::Http {
-    using std::vector;
-    using std::string;
     using std::string_view;
 
     using namespace std::string_literals;
 
+    // Whether a body with a supported content coding is decoded
+    enum class Decoding {kRaw, kDecode};
+
     class ResponseParser {
     public:
+        explicit ResponseParser(
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+            Decoding decoding = Decoding::kRaw,
+            const Dictionaries* dictionaries = nullptr,
+            std::size_t max_decoded_bytes = std::numeric_limits<std::size_t>::max()
+        );
+
         auto Feed(unsigned char* buffer, std::size_t size) -> void;
+        auto Feed(unsigned char* buffer, std::size_t size, std::error_code& ec) -> void;
 
-        [[nodiscard]] auto response() const -> Express::Response;
+        [[nodiscard]] auto response() const& -> Express::Response;
+        [[nodiscard]] auto response() && -> Express::Response;
+        [[nodiscard]] auto response(std::error_code& ec) && -> Express::Response;
         [[nodiscard]] auto done_reading_data() const -> bool;
 
+        // The status of the final response, once its headers were read
+        [[nodiscard]] auto status_code() const { return response_.status_code; }
+
+        // The headers of the final response, once they were read
+        [[nodiscard]] auto headers() const -> const Headers& { return response_.headers; }
+
+        // The body read so far. A stream that's processed as it arrives
+        // clears it once it's processed, so it doesn't grow.
+        [[nodiscard]] auto body() const -> std::string_view { return response_.data; }
+        auto ClearBody() -> void { response_.data.clear(); }
+
+        // True once the final response's headers were read
+        [[nodiscard]] auto headers_complete() const { return parsing_body_; }
+
+        // The bytes that followed a 101 Switching Protocols response, which
+        // belong to the protocol the connection switched to
+        [[nodiscard]] auto unread() const -> std::string_view { return data_; }
+
+        // True if the server sent 100 Continue
+        [[nodiscard]] auto continued() const { return continued_; }
+
+        // True if the response was read completely, and the connection
+        // can be reused for another request
+        [[nodiscard]] auto keep_alive() const {
+            return keep_alive_ && known_body_length_ && done_reading_data_;
+        }
+
     private:
         bool done_reading_data_ {false};
         bool parsing_body_ {false};
         bool known_body_length_ {false};
+        bool keep_alive_ {false};
+        bool continued_ {false};
 
-        std::string data_;
-        std::unique_ptr<DataReader> data_reader_;
+        Decoding decoding_;
+        const Dictionaries* dictionaries_;
+        std::size_t max_decoded_bytes_;
+        std::pmr::memory_resource* resource_;
+        std::pmr::string data_;
+        ContentDecoderPtr decoder_;
+        DataReaderPtr data_reader_;
 
         Response response_;
 
-        auto ReadHeaders() -> void;
-        auto ProcessHeaders(const std::vector<std::string>& headers) -> void;
-        auto ReadBody() -> void;
-        auto DataReaderFactory() -> std::unique_ptr<DataReader>;
+        auto ReadHeaders() -> std::error_code;
+        auto ProcessHeaders(std::span<const std::pmr::string> headers) -> std::error_code;
+        auto ReadBody() -> std::error_code;
+        auto DataReaderFactory(std::error_code& ec) -> DataReaderPtr;
+        auto DecoderFactory() -> ContentDecoderPtr;
+        auto CheckResponse() const -> std::error_code;
 
-        [[nodiscard]] auto Split(string_view headers) const -> vector<string>;
-        [[nodiscard]] auto IsObsoleteLineFolding(const std::string& str) const -> bool;
-        [[nodiscard]] auto IsDelimiter(const std::string& str) const -> bool;
+        [[nodiscard]] auto Split(string_view headers) const -> std::pmr::vector<std::pmr::string>;
+        [[nodiscard]] auto IsObsoleteLineFolding(string_view str) const -> bool;
+        [[nodiscard]] auto IsDelimiter(string_view str) const -> bool;
     };
-}
\ No newline at end of file
+}
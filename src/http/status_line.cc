@@ -3,41 +3,57 @@
 
 #include "status_line.h"
 
+#include <algorithm>
+#include <charconv>
+
 #include "client/error.h"
 #include "http/validators.h"
 
 namespace Express::Http {
-    StatusLine::StatusLine(std::string_view status_line)
-    : status_line_(status_line) {
-        using namespace std::string_literals;
+    StatusLine::StatusLine(std::string_view status_line) {
+        std::string_view detail;
+        if (auto ec = Parse(status_line, detail)) {
+            if (detail.data() != nullptr) Error::ThrowWithDetail(ec, detail);
+            Error::Throw(ec);
+        }
+    }
 
-        std::string status {status_line_};
+    StatusLine::StatusLine(std::string_view status_line, std::error_code& ec) {
+        std::string_view detail;
+        ec = Parse(status_line, detail);
+    }
 
-        if (!status.starts_with("HTTP/"s)) {
-            Error::Runtime("Status line error", "Malformed status line");
+    auto StatusLine::Parse(std::string_view status, std::string_view& detail) -> std::error_code {
+        if (!status.starts_with("HTTP/")) {
+            return ErrorCode::kMalformedStatusLine;
         }
 
         // html version
         status = status.substr(status.find('/') + 1);
         auto version = status.substr(0, status.find(0x20));
         if (version != "1.0" && version != "1.1") {
-            Error::Runtime("Status line error", "Unsupported HTML version (" + version + ")");
+            detail = version;
+            return ErrorCode::kUnsupportedVersion;
         }
-        status = status.substr(4);
+        minor_version_ = version[2] - '0';
+        status = status.substr(std::min<std::size_t>(4, status.size()));
 
         // status code
         auto separator = status.find(0x20);
         auto status_code = status.substr(0, separator);
         if (separator != 3 || !Validators::IsDigitRange(status_code)) {
-            Error::Runtime("Status line error", "Invalid status code (" + status_code + ")");
+            detail = status_code;
+            return ErrorCode::kInvalidStatusCode;
         }
-        code_ = std::stoi(status_code);
-        
+        std::from_chars(status_code.data(), status_code.data() + 3, code_);
+
         // reason phrase
         auto response_phrase = status.substr(separator + 1);
         if (!Validators::IsValidCharRange(response_phrase)) {
-            Error::Runtime("Status line error", "Invalid characters in reason phrase");
+            return ErrorCode::kInvalidReasonPhrase;
         }
-        text_ = status.substr(separator + 1);
+        text_ = response_phrase;
+
+        return {};
     }
-}
\ No newline at end of file
+}
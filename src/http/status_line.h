@@ -5,18 +5,23 @@
 
 #include <string>
 #include <string_view>
+#include <system_error>
 
 namespace Express::Http {
     class StatusLine {
     public:
         explicit StatusLine(std::string_view status_line);
+        StatusLine(std::string_view status_line, std::error_code& ec);
 
         [[nodiscard]] auto code() const { return code_; }
         [[nodiscard]] auto text() const { return text_; }
+        [[nodiscard]] auto minor_version() const { return minor_version_; }
 
     private:
-        int code_;
-        std::string status_line_;
+        int code_ {0};
+        int minor_version_ {0};
         std::string text_;
+
+        auto Parse(std::string_view status_line, std::string_view& detail) -> std::error_code;
     };
-}
\ No newline at end of file
+}
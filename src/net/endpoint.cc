@@ -3,6 +3,7 @@
 
 #include "endpoint.h"
 
+#include <array>
 #include <cstring>
 
 #include "client/error.h"
@@ -11,15 +12,55 @@ namespace Express::Net {
     using std::string_view;
 
     Endpoint::Endpoint(string_view host, string_view port) {
+        if (auto ec = Resolve(host, port)) Error::Throw(ec, "Endpoint error");
+    }
+
+    Endpoint::Endpoint(string_view host, string_view port, std::error_code& ec) {
+        ec = Resolve(host, port);
+    }
+
+    auto Endpoint::ResolveAll(
+        string_view host,
+        string_view port,
+        std::error_code& ec
+    ) -> std::vector<Endpoint> {
+        const Endpoint first {host, port, ec};
+        if (ec) return {};
+
+        std::vector<Endpoint> endpoints;
+        for (auto* address = first.address_.get(); address; address = address->ai_next) {
+            endpoints.push_back(Endpoint {std::shared_ptr<addrinfo> {first.address_, address}});
+        }
+        return endpoints;
+    }
+
+    auto Endpoint::ToString() const -> std::string {
+        std::array<char, NI_MAXHOST> host {};
+        std::array<char, NI_MAXSERV> port {};
+        const auto failed = getnameinfo(
+            address(), static_cast<socklen_t>(address_length()),
+            host.data(), static_cast<socklen_t>(host.size()),
+            port.data(), static_cast<socklen_t>(port.size()),
+            NI_NUMERICHOST | NI_NUMERICSERV
+        );
+        if (failed) return {};
+
+        const auto ipv6 = family() == AF_INET6;
+        auto output = std::string {ipv6 ? "[" : ""}.append(host.data());
+        return output.append(ipv6 ? "]:" : ":").append(port.data());
+    }
+
+    auto Endpoint::Resolve(string_view host, string_view port) -> std::error_code {
         addrinfo hints;
         memset(&hints, 0, sizeof(hints));
         hints.ai_socktype = SOCK_STREAM;
 
         addrinfo *address_info;
         if (getaddrinfo(host.data(), port.data(), &hints, &address_info)) {
-            Error::System("Endpoint error");
+            return ErrorCode::kResolveFailed;
         }
 
-        address_.reset(address_info);
+        address_.reset(address_info, addrinfo_deleter {});
+        return {};
     }
 }
\ No newline at end of file
@@ -4,7 +4,10 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <string_view>
+#include <system_error>
+#include <vector>
 
 #if defined(_WIN32)
     #include "net/winsock.h"
@@ -17,9 +20,21 @@ namespace Express::Net {
         void operator()(addrinfo* address) const { freeaddrinfo(address); }
     };
 
+    /*
+        A resolved address. Copies share the address, so a host that's
+        resolved once can be used to open several sockets.
+    */
     class Endpoint {
     public:
         Endpoint(std::string_view host, std::string_view port);
+        Endpoint(std::string_view host, std::string_view port, std::error_code& ec);
+
+        // Every address the host resolves to. The endpoints share the result.
+        [[nodiscard]] static auto ResolveAll(
+            std::string_view host,
+            std::string_view port,
+            std::error_code& ec
+        ) -> std::vector<Endpoint>;
 
         [[nodiscard]] auto family() const { return address_->ai_family; }
         [[nodiscard]] auto socket_type() const { return address_->ai_socktype; }
@@ -27,7 +42,14 @@ namespace Express::Net {
         [[nodiscard]] auto address() const { return address_->ai_addr; }
         [[nodiscard]] auto address_length() const { return address_->ai_addrlen; }
 
+        // The numeric address and port, e.g. 127.0.0.1:80 or [::1]:80
+        [[nodiscard]] auto ToString() const -> std::string;
+
     private:
-        std::unique_ptr<addrinfo, addrinfo_deleter> address_ {nullptr};
+        std::shared_ptr<addrinfo> address_ {nullptr};
+
+        explicit Endpoint(std::shared_ptr<addrinfo> address) : address_(std::move(address)) {}
+
+        auto Resolve(std::string_view host, std::string_view port) -> std::error_code;
     };
 }
\ No newline at end of file
@@ -0,0 +1,330 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "event_loop.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "client/error.h"
+
+#if defined(_WIN32)
+    #include "net/winsock.h"
+#else
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+namespace Express::Net {
+    namespace {
+        constexpr std::size_t kReservedOperations = 64;
+
+        #if defined(_WIN32)
+            auto Poll(pollfd* fds, std::size_t count, int timeout) {
+                return WSAPoll(fds, static_cast<ULONG>(count), timeout);
+            }
+
+            auto Interrupted() { return WSAGetLastError() == WSAEINTR; }
+        #else
+            auto Poll(pollfd* fds, std::size_t count, int timeout) {
+                return poll(fds, static_cast<nfds_t>(count), timeout);
+            }
+
+            auto Interrupted() { return errno == EINTR; }
+        #endif
+    }
+
+    struct EventLoop::State {
+        #if defined(_WIN32)
+            WinSock winsock;
+        #endif
+
+        std::mutex mutex;
+        std::vector<WaitOperation*> submitted;
+        bool started {false};
+        bool stopped {false};
+
+        // A self-pipe that wakes up poll() when operations are submitted.
+        // Windows can't poll pipes, so a loopback UDP socket connected to
+        // itself is used instead.
+        SOCKET wake_read {INVALID_SOCKET};
+        SOCKET wake_write {INVALID_SOCKET};
+
+        auto OpenWakeup() -> void;
+        auto Wake() const -> void;
+        auto Drain() const -> void;
+        auto CloseWakeup() -> void;
+    };
+
+    #if defined(_WIN32)
+        auto EventLoop::State::OpenWakeup() -> void {
+            auto sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (sock == INVALID_SOCKET) Error::Throw(Error::LastSystemError(), "Event loop error");
+
+            sockaddr_in address {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            auto length = static_cast<int>(sizeof(address));
+            u_long mode = 1;
+
+            if (bind(sock, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+                getsockname(sock, reinterpret_cast<sockaddr*>(&address), &length) != 0 ||
+                connect(sock, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+                ioctlsocket(sock, FIONBIO, &mode) != 0) {
+                auto ec = Error::LastSystemError();
+                closesocket(sock);
+                Error::Throw(ec, "Event loop error");
+            }
+
+            wake_read = wake_write = sock;
+        }
+
+        auto EventLoop::State::Wake() const -> void {
+            const char byte = 0;
+            send(wake_write, &byte, 1, 0);
+        }
+
+        auto EventLoop::State::Drain() const -> void {
+            char buffer[64];
+            while (recv(wake_read, buffer, sizeof(buffer), 0) > 0) {}
+        }
+
+        auto EventLoop::State::CloseWakeup() -> void {
+            if (wake_read != INVALID_SOCKET) closesocket(wake_read);
+            wake_read = wake_write = INVALID_SOCKET;
+        }
+    #else
+        auto EventLoop::State::OpenWakeup() -> void {
+            int fds[2];
+            if (pipe(fds) < 0) Error::Throw(Error::LastSystemError(), "Event loop error");
+
+            for (auto fd : fds) {
+                const auto flags = fcntl(fd, F_GETFL, 0);
+                if (flags < 0 ||
+                    fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+                    fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+                    auto ec = Error::LastSystemError();
+                    close(fds[0]);
+                    close(fds[1]);
+                    Error::Throw(ec, "Event loop error");
+                }
+            }
+
+            wake_read = fds[0];
+            wake_write = fds[1];
+        }
+
+        auto EventLoop::State::Wake() const -> void {
+            const char byte = 0;
+            [[maybe_unused]] auto result = write(wake_write, &byte, 1);
+        }
+
+        auto EventLoop::State::Drain() const -> void {
+            char buffer[64];
+            while (read(wake_read, buffer, sizeof(buffer)) > 0) {}
+        }
+
+        auto EventLoop::State::CloseWakeup() -> void {
+            if (wake_read != INVALID_SOCKET) close(wake_read);
+            if (wake_write != INVALID_SOCKET) close(wake_write);
+            wake_read = wake_write = INVALID_SOCKET;
+        }
+    #endif
+
+    EventLoop::EventLoop() : state_(std::make_shared<State>()) {
+        state_->submitted.reserve(kReservedOperations);
+    }
+
+    auto EventLoop::Submit(WaitOperation* operation) -> void {
+        {
+            std::lock_guard lock {state_->mutex};
+            if (!state_->stopped) {
+                if (!state_->started) {
+                    state_->OpenWakeup();
+                    thread_ = std::thread {&EventLoop::Run, state_};
+                    state_->started = true;
+                }
+                state_->submitted.push_back(operation);
+                state_->Wake();
+                return;
+            }
+        }
+        operation->complete(operation, WaitResult::kAborted);
+    }
+
+    auto EventLoop::Cancel(WaitOperation* operation) -> void {
+        operation->cancelled = true;
+
+        std::lock_guard lock {state_->mutex};
+        if (state_->started && !state_->stopped) state_->Wake();
+    }
+
+    auto EventLoop::Wait(
+        SOCKET fd,
+        EventType event,
+        const Timeout& timeout,
+        std::stop_token stop
+    ) -> WaitAwaiter {
+        return WaitAwaiter {*this, fd, event, timeout, std::move(stop)};
+    }
+
+    auto EventLoop::Sleep(const Timeout& timeout, std::stop_token stop) -> WaitAwaiter {
+        return WaitAwaiter {*this, INVALID_SOCKET, EventType::kToRead, timeout, std::move(stop)};
+    }
+
+    auto EventLoop::Run(std::shared_ptr<State> state) -> void {
+        using std::chrono::ceil;
+        using std::chrono::milliseconds;
+
+        // The loop's bookkeeping is reused between iterations, so waiting
+        // doesn't allocate once the vectors have grown to fit the load.
+        std::vector<WaitOperation*> active;
+        std::vector<WaitOperation*> pending;
+        std::vector<std::pair<WaitOperation*, WaitResult>> completed;
+        std::vector<pollfd> fds;
+        active.reserve(kReservedOperations);
+        pending.reserve(kReservedOperations);
+        completed.reserve(kReservedOperations);
+        fds.reserve(kReservedOperations + 1);
+
+        while (true) {
+            {
+                std::lock_guard lock {state->mutex};
+                if (state->stopped) break;
+                std::swap(pending, state->submitted);
+            }
+            active.insert(active.end(), pending.begin(), pending.end());
+            pending.clear();
+
+            fds.clear();
+            fds.push_back({state->wake_read, POLLIN, 0});
+
+            auto now = steady_clock::now();
+            auto timeout = -1;
+            for (const auto* operation : active) {
+                // poll() ignores negative descriptors, so timers never become ready
+                const short events = operation->event == EventType::kToRead ? POLLIN : POLLOUT;
+                fds.push_back({operation->fd, events, 0});
+
+                // The wake-up of a cancellation may have been drained before
+                // the operation arrived, so a cancelled operation doesn't wait
+                if (operation->cancelled) {
+                    timeout = 0;
+                } else if (operation->has_deadline) {
+                    const auto remaining = std::max(
+                        ceil<milliseconds>(operation->deadline - now).count(),
+                        milliseconds::rep {0}
+                    );
+                    if (timeout < 0 || remaining < timeout) {
+                        timeout = static_cast<int>(std::min<milliseconds::rep>(remaining, INT32_MAX));
+                    }
+                }
+            }
+
+            if (Poll(fds.data(), fds.size(), timeout) < 0 && !Interrupted()) break;
+            if (fds[0].revents != 0) state->Drain();
+
+            now = steady_clock::now();
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < active.size(); ++i) {
+                auto* operation = active[i];
+                if (operation->cancelled) {
+                    completed.emplace_back(operation, WaitResult::kCancelled);
+                } else if (fds[i + 1].revents != 0) {
+                    // Errors and hang-ups are reported as ready, the caller
+                    // discovers the failure on its next socket call
+                    completed.emplace_back(operation, WaitResult::kReady);
+                } else if (operation->has_deadline && operation->deadline <= now) {
+                    completed.emplace_back(operation, WaitResult::kTimeout);
+                } else {
+                    active[kept++] = operation;
+                }
+            }
+            active.resize(kept);
+
+            // Completions may resume coroutines that submit new operations
+            // or destroy the loop, so they run after the bookkeeping is done.
+            for (auto [operation, result] : completed) {
+                operation->complete(operation, result);
+            }
+            completed.clear();
+        }
+
+        {
+            std::lock_guard lock {state->mutex};
+            state->stopped = true;
+            std::swap(pending, state->submitted);
+        }
+        active.insert(active.end(), pending.begin(), pending.end());
+        for (auto* operation : active) {
+            operation->complete(operation, WaitResult::kAborted);
+        }
+        state->CloseWakeup();
+    }
+
+    EventLoop::~EventLoop() {
+        {
+            std::lock_guard lock {state_->mutex};
+            state_->stopped = true;
+            if (!state_->started) return;
+            state_->Wake();
+        }
+
+        if (thread_.get_id() == std::this_thread::get_id()) {
+            // Destroyed by a completion running on the loop's thread. The
+            // thread owns the state and exits once the completion returns.
+            thread_.detach();
+        } else {
+            thread_.join();
+        }
+    }
+
+    WaitAwaiter::WaitAwaiter(
+        EventLoop& loop,
+        SOCKET fd,
+        EventType event,
+        const Timeout& timeout,
+        std::stop_token stop
+    ) : loop_(loop), stop_(std::move(stop)) {
+        this->fd = fd;
+        this->event = event;
+        this->has_deadline = timeout.has_timeout();
+        this->deadline = timeout.expiry();
+        this->complete = &WaitAwaiter::Complete;
+    }
+
+    auto WaitAwaiter::await_ready() -> bool {
+        if (!stop_.stop_requested()) return false;
+        result_ = WaitResult::kCancelled;
+        return true;
+    }
+
+    auto WaitAwaiter::await_suspend(std::coroutine_handle<> handle) -> void {
+        handle_ = handle;
+
+        // The callback is registered before the operation is submitted, since
+        // the operation may complete and resume the coroutine at any point
+        // after it's submitted. A stop that was requested in between sets the
+        // cancelled flag, which the loop checks once the operation arrives.
+        if (stop_.stop_possible()) on_stop_.emplace(stop_, Canceller {this});
+        loop_.Submit(this);
+    }
+
+    auto WaitAwaiter::await_resume() -> WaitResult {
+        on_stop_.reset();
+        return result_;
+    }
+
+    auto WaitAwaiter::Canceller::operator()() const -> void {
+        awaiter->loop_.Cancel(awaiter);
+    }
+
+    auto WaitAwaiter::Complete(WaitOperation* operation, WaitResult result) -> void {
+        auto* awaiter = static_cast<WaitAwaiter*>(operation);
+        awaiter->result_ = result;
+        awaiter->handle_.resume();
+    }
+}
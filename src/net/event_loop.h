@@ -0,0 +1,119 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+#include "client/timeout.h"
+#include "net/socket.h"
+
+namespace Express::Net {
+    enum class WaitResult {kReady, kTimeout, kCancelled, kAborted};
+
+    /*
+        A request to be notified once a socket is ready. Operations are
+        intrusive so that submitting them doesn't allocate. The completion
+        function is called on the event loop's thread, and the operation
+        must stay alive until then. An operation without a socket is a
+        timer that completes when its deadline passes.
+    */
+    struct WaitOperation {
+        SOCKET fd {INVALID_SOCKET};
+        EventType event {EventType::kToRead};
+        bool has_deadline {false};
+        std::chrono::steady_clock::time_point deadline {};
+        void (*complete)(WaitOperation* operation, WaitResult result) {nullptr};
+
+        // Set by EventLoop::Cancel, possibly from another thread
+        std::atomic<bool> cancelled {false};
+    };
+
+    class WaitAwaiter;
+
+    /*
+        A single background thread that waits for socket readiness using
+        poll(). The thread is started when the first operation is submitted.
+        Operations that are still pending when the loop is destroyed are
+        completed with WaitResult::kAborted.
+    */
+    class EventLoop {
+    public:
+        EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+        auto operator=(const EventLoop&) -> EventLoop& = delete;
+
+        auto Submit(WaitOperation* operation) -> void;
+
+        // Completes a submitted operation with WaitResult::kCancelled, unless
+        // it has already completed. The caller must ensure that the operation
+        // is still alive.
+        auto Cancel(WaitOperation* operation) -> void;
+
+        // The wait is cancelled when a stop is requested through the token
+        [[nodiscard]] auto Wait(
+            SOCKET fd,
+            EventType event,
+            const Timeout& timeout,
+            std::stop_token stop = {}
+        ) -> WaitAwaiter;
+
+        // Waits until the timeout expires or a stop is requested
+        [[nodiscard]] auto Sleep(const Timeout& timeout, std::stop_token stop = {}) -> WaitAwaiter;
+
+        ~EventLoop();
+
+    private:
+        struct State;
+
+        // The loop's thread shares ownership of the state, so the loop can be
+        // destroyed from a completion that runs on its own thread.
+        std::shared_ptr<State> state_;
+        std::thread thread_;
+
+        static auto Run(std::shared_ptr<State> state) -> void;
+    };
+
+    /*
+        Suspends a coroutine until a socket is ready, the timeout expires,
+        or a stop is requested.
+    */
+    class WaitAwaiter : public WaitOperation {
+    public:
+        WaitAwaiter(
+            EventLoop& loop,
+            SOCKET fd,
+            EventType event,
+            const Timeout& timeout,
+            std::stop_token stop
+        );
+
+        auto await_ready() -> bool;
+        auto await_suspend(std::coroutine_handle<> handle) -> void;
+        auto await_resume() -> WaitResult;
+
+    private:
+        struct Canceller {
+            WaitAwaiter* awaiter;
+            auto operator()() const -> void;
+        };
+
+        EventLoop& loop_;
+        std::coroutine_handle<> handle_;
+        WaitResult result_ {WaitResult::kAborted};
+
+        // Destroying the callback waits for a callback that's running on
+        // another thread, so Cancel never sees a destroyed operation
+        std::stop_token stop_;
+        std::optional<std::stop_callback<Canceller>> on_stop_;
+
+        static auto Complete(WaitOperation* operation, WaitResult result) -> void;
+    };
+}
@@ -3,6 +3,9 @@
 
 #pragma once
 
+#include <string_view>
+#include <system_error>
+
 #include "client/timeout.h"
 #include "net/endpoint.h"
 
@@ -17,6 +20,7 @@ namespace Express::Net {
     class Socket {
     public:
         explicit Socket(Endpoint endpoint);
+        Socket(Endpoint endpoint, std::error_code& ec);
 
         // delete copy/move constructor and assignment
         Socket(Socket&& src) = delete;
@@ -28,7 +32,21 @@ namespace Express::Net {
         auto Send(std::string_view buffer, const Timeout& timeout) const -> size_t;
         auto Recv(unsigned char* buffer, const size_t size, const Timeout& timeout) const -> size_t;
 
+        // Non-throwing overloads report failures through the error code
+        auto Connect(const Timeout& timeout, std::error_code& ec) const -> void;
+        auto Send(std::string_view buffer, const Timeout& timeout, std::error_code& ec) const -> size_t;
+        auto Recv(unsigned char* buffer, const size_t size, const Timeout& timeout, std::error_code& ec) const -> size_t;
+
+        // Non-blocking primitives that never wait for the socket. They report
+        // std::errc::operation_would_block if the socket isn't ready, and
+        // BeginConnect reports std::errc::operation_in_progress.
+        auto BeginConnect(std::error_code& ec) const -> void;
+        auto FinishConnect(std::error_code& ec) const -> void;
+        auto SendSome(std::string_view buffer, std::error_code& ec) const -> size_t;
+        auto RecvSome(unsigned char* buffer, const size_t size, std::error_code& ec) const -> size_t;
+
         [[nodiscard]] int Get() const { return sock_; };
+        [[nodiscard]] auto handle() const { return sock_; }
 
         ~Socket();
 
@@ -36,8 +54,9 @@ namespace Express::Net {
         Endpoint ep_;
         SOCKET sock_ = INVALID_SOCKET;
 
-        auto MakeNonBlocking() const -> void;
-        auto GetPendingError() const -> int;
-        auto Select(EventType event, const Timeout& timeout) const -> int;
+        auto Open() -> std::error_code;
+        auto MakeNonBlocking() const -> std::error_code;
+        auto GetPendingError() const -> std::error_code;
+        auto Select(EventType event, const Timeout& timeout, std::error_code& ec) const -> int;
     };
-}
\ No newline at end of file
+}
@@ -8,86 +8,148 @@
 
 namespace Express::Net {
     Socket::Socket(Endpoint endpoint) : ep_(std::move(endpoint)) {
+        if (auto ec = Open()) Error::Throw(ec, "Socket error");
+    }
+
+    Socket::Socket(Endpoint endpoint, std::error_code& ec) : ep_(std::move(endpoint)) {
+        ec = Open();
+    }
+
+    auto Socket::Open() -> std::error_code {
         sock_ = socket(ep_.family(), ep_.socket_type(), ep_.protocol());
-        if (sock_ == SOCKET_ERROR) {
-            Error::System("Socket error");
+        if (sock_ == INVALID_SOCKET) {
+            return Error::LastSystemError();
         }
-        MakeNonBlocking();
+        if (auto ec = MakeNonBlocking()) {
+            closesocket(sock_);
+            sock_ = INVALID_SOCKET;
+            return ec;
+        }
+        return {};
     }
 
-    auto Socket::MakeNonBlocking() const -> void {
+    auto Socket::MakeNonBlocking() const -> std::error_code {
         u_long mode = 1;
         if (ioctlsocket(sock_, FIONBIO, &mode) != 0) {
-            closesocket(sock_);
-            Error::System("Socket flags error");
+            return Error::LastSystemError();
         }
+        return {};
     }
 
-    auto Socket::GetPendingError() const -> int {
+    auto Socket::GetPendingError() const -> std::error_code {
         auto option_value = 0;
         int option_length = sizeof(option_value);
         if (getsockopt(sock_, SOL_SOCKET, SO_ERROR, (char*)&option_value, &option_length) < 0) {
-           Error::System("Socket options error");
+           return Error::LastSystemError();
         }
-        return option_value;
+        return {option_value, std::system_category()};
     }
 
     auto Socket::Connect(const Timeout& timeout) const -> void {
-        auto result = connect(sock_, ep_.address(), ep_.address_length());
-
-        if (result < 0) {
-            if (WSAGetLastError() == WSAEWOULDBLOCK) {
-                auto select_result = Select(EventType::kToWrite, timeout);
-                if (select_result == 0) {
-                    Error::Runtime("Timeout error", "Failed to connect");
-                }
-
-                // Check for any pending errors.
-                // If there are none, the connection was successful
-                auto pending_error = GetPendingError();
-                 if (pending_error != 0) {
-                    Error::System("Socket connect error");
-                }
-            } else {
-                Error::System("Socket connect error");
-            }
+        std::error_code ec;
+        Connect(timeout, ec);
+        if (ec) Error::Throw(ec, "Socket connect error");
+    }
+
+    auto Socket::Connect(const Timeout& timeout, std::error_code& ec) const -> void {
+        BeginConnect(ec);
+        if (ec != std::errc::operation_in_progress) return;
+        ec.clear();
+
+        auto select_result = Select(EventType::kToWrite, timeout, ec);
+        if (ec) return;
+        if (select_result == 0) {
+            ec = ErrorCode::kConnectTimeout;
+            return;
         }
+
+        FinishConnect(ec);
     }
 
     auto Socket::Send(std::string_view buffer, const Timeout& timeout) const -> size_t {
-        if (Select(EventType::kToWrite, timeout) == 0) {
-            Error::Runtime("Timeout error", "Failed to send data to the server");
-        }
+        std::error_code ec;
+        auto result = Send(buffer, timeout, ec);
+        if (ec) Error::Throw(ec, "Socket send error");
+        return result;
+    }
 
-        auto data_ptr = buffer.data();
-        auto bytes_left = buffer.size();
-        while (bytes_left > 1) {
-            auto bytes_written = send(sock_, data_ptr, bytes_left, 0);
-            if (bytes_written == SOCKET_ERROR) {
-                Error::System("Socket send error");
+    auto Socket::Send(std::string_view buffer, const Timeout& timeout, std::error_code& ec) const -> size_t {
+        ec.clear();
+        auto bytes_sent = size_t {0};
+        while (bytes_sent < buffer.size()) {
+            if (Select(EventType::kToWrite, timeout, ec) == 0) {
+                if (!ec) ec = ErrorCode::kSendTimeout;
+                return bytes_sent;
             }
 
-            bytes_left -= bytes_written;
-            data_ptr += bytes_written;
+            bytes_sent += SendSome(buffer.substr(bytes_sent), ec);
+            if (ec == std::errc::operation_would_block) {
+                ec.clear();
+            } else if (ec) {
+                return bytes_sent;
+            }
         }
 
-        return buffer.size();
+        return bytes_sent;
     }
 
     auto Socket::Recv(unsigned char* buffer, const size_t size, const Timeout& timeout) const -> size_t {
-        if (Select(EventType::kToRead, timeout) == 0) {
-            Error::Runtime("Timeout error", "Failed to receive data from the server");
+        std::error_code ec;
+        auto result = Recv(buffer, size, timeout, ec);
+        if (ec) Error::Throw(ec, "Socket recv error");
+        return result;
+    }
+
+    auto Socket::Recv(unsigned char* buffer, const size_t size, const Timeout& timeout, std::error_code& ec) const -> size_t {
+        ec.clear();
+        if (Select(EventType::kToRead, timeout, ec) == 0) {
+            if (!ec) ec = ErrorCode::kRecvTimeout;
+            return 0;
         }
 
-        auto bytes_read = recv(sock_, (char *)buffer, size, 0);
-        if (bytes_read == SOCKET_ERROR) {
-            Error::System("Socket recv error");
+        return RecvSome(buffer, size, ec);
+    }
+
+    auto Socket::BeginConnect(std::error_code& ec) const -> void {
+        ec.clear();
+        if (connect(sock_, ep_.address(), ep_.address_length()) < 0) {
+            ec = WSAGetLastError() == WSAEWOULDBLOCK ?
+                std::make_error_code(std::errc::operation_in_progress) :
+                Error::LastSystemError();
         }
+    }
 
+    auto Socket::FinishConnect(std::error_code& ec) const -> void {
+        // Check for any pending errors.
+        // If there are none, the connection was successful
+        ec = GetPendingError();
+    }
+
+    auto Socket::SendSome(std::string_view buffer, std::error_code& ec) const -> size_t {
+        ec.clear();
+        auto bytes_written = send(sock_, buffer.data(), static_cast<int>(buffer.size()), 0);
+        if (bytes_written == SOCKET_ERROR) {
+            ec = WSAGetLastError() == WSAEWOULDBLOCK ?
+                std::make_error_code(std::errc::operation_would_block) :
+                Error::LastSystemError();
+            return 0;
+        }
+        return bytes_written;
+    }
+
+    auto Socket::RecvSome(unsigned char* buffer, const size_t size, std::error_code& ec) const -> size_t {
+        ec.clear();
+        auto bytes_read = recv(sock_, (char *)buffer, static_cast<int>(size), 0);
+        if (bytes_read == SOCKET_ERROR) {
+            ec = WSAGetLastError() == WSAEWOULDBLOCK ?
+                std::make_error_code(std::errc::operation_would_block) :
+                Error::LastSystemError();
+            return 0;
+        }
         return bytes_read;
     }
 
-    auto Socket::Select(EventType event, const Timeout& timeout) const -> int {
+    auto Socket::Select(EventType event, const Timeout& timeout, std::error_code& ec) const -> int {
         fd_set fdset;
         FD_ZERO(&fdset);
         FD_SET(sock_, &fdset);
@@ -106,7 +168,8 @@ namespace Express::Net {
         );
 
         if (result == SOCKET_ERROR) {
-            Error::System("Socket select error");
+            ec = Error::LastSystemError();
+            return 0;
         }
 
         return result;
@@ -118,4 +181,4 @@ namespace Express::Net {
             sock_ = INVALID_SOCKET;
         }
     }
-}
\ No newline at end of file
+}
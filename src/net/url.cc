@@ -3,22 +3,46 @@
 
 #include "url.h"
 
+#include <algorithm>
+
 #include "client/error.h"
 
 namespace Express::Net {
-    Url::Url(std::string_view url) : source_(url) {
-        ParseURL(source_);
+    Url::Url(std::string_view url, std::pmr::memory_resource* resource)
+      : Url(resource) {
+        source_ = url;
+        if (auto ec = ParseURL(source_)) Error::Throw(ec);
+    }
+
+    Url::Url(
+        std::string_view url,
+        std::pmr::memory_resource* resource,
+        std::error_code& ec
+    ) : Url(resource) {
+        source_ = url;
+        ec = ParseURL(source_);
     }
 
-    auto Url::ParseURL(std::string_view url) -> void {
+    Url::Url(std::pmr::memory_resource* resource)
+      : authority_(resource),
+        host_(resource),
+        password_(resource),
+        path_(resource),
+        port_(resource),
+        query_(resource),
+        scheme_(resource),
+        source_(resource),
+        user_(resource) {}
+
+    auto Url::ParseURL(std::string_view url) -> std::error_code {
         auto idx = url.find("://");
         if (idx == std::string::npos) {
-            Error::Logic("URL error", "Missing URL scheme. Use 'http://' or 'https://'");
+            return ErrorCode::kMissingUrlScheme;
         }
 
         scheme_ = url.substr(0, idx);
         if (scheme_ != "http" && scheme_ != "https") {
-            Error::Logic("URL error", "Unsupported URL scheme. Use 'http://' or 'https://'");
+            return ErrorCode::kUnsupportedUrlScheme;
         }
 
         port_ = (scheme_ == "http") ?
@@ -30,18 +54,21 @@ namespace Express::Net {
             return c == '/' || c == '?' || c == '#'; // authority delimiters
         });
 
-        authority_ = std::string {authority_begin, authority_end};
+        authority_.assign(authority_begin, authority_end);
         ProcessAuthority();
 
-        path_ = std::string {authority_end, cend(url)};
+        path_.assign(authority_end, cend(url));
         ProcessPath();
+
+        return {};
     }
 
     auto Url::ProcessAuthority() -> void {
-        host_ = authority_;
+        std::string_view authority {authority_};
+        host_ = authority;
 
-        if (auto host_pos = authority_.find('@'); host_pos != std::string::npos) {
-            auto user_info = authority_.substr(0, host_pos);
+        if (auto host_pos = authority.find('@'); host_pos != std::string::npos) {
+            auto user_info = authority.substr(0, host_pos);
             if (auto pass_pos = user_info.find(':'); pass_pos != std::string::npos) {
                 user_ = user_info.substr(0, pass_pos);
                 password_ = user_info.substr(pass_pos + 1);
@@ -53,7 +80,7 @@ namespace Express::Net {
 
         auto port_pos = host_.find(':');
         if (port_pos != std::string::npos) {
-            port_ = host_.substr(port_pos + 1);
+            port_ = std::string_view {host_}.substr(port_pos + 1);
             host_.resize(port_pos);
         }
     }
@@ -70,8 +97,8 @@ namespace Express::Net {
 
         auto query_pos = path_.find('?');
         if (query_pos != std::string::npos) {
-            query_ = path_.substr(query_pos + 1);
+            query_ = std::string_view {path_}.substr(query_pos + 1);
             path_.resize(query_pos);
         }
     }
-}
\ No newline at end of file
+}
@@ -3,8 +3,10 @@
 
 #pragma once
 
+#include <memory_resource>
 #include <string>
 #include <string_view>
+#include <system_error>
 
 namespace Express::Net {
     static constexpr auto kDefaultPortHTTP = 80;
@@ -12,34 +14,45 @@ namespace Express::Net {
 
     class Url {
         public:
-            explicit Url(std::string_view url);
-
-            [[nodiscard]] auto host() const { return host_; }
-            [[nodiscard]] auto password() const { return password_; }
-            [[nodiscard]] auto path() const { return path_; }
-            [[nodiscard]] auto port() const { return port_; }
-            [[nodiscard]] auto query() const { return query_; }
-            [[nodiscard]] auto scheme() const { return scheme_; }
-            [[nodiscard]] auto source() const { return source_; }
-            [[nodiscard]] auto user() const { return user_; }
+            explicit Url(
+                std::string_view url,
+                std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+            );
+
+            Url(
+                std::string_view url,
+                std::pmr::memory_resource* resource,
+                std::error_code& ec
+            );
+
+            [[nodiscard]] auto host() const -> std::string_view { return host_; }
+            [[nodiscard]] auto password() const -> std::string_view { return password_; }
+            [[nodiscard]] auto path() const -> std::string_view { return path_; }
+            [[nodiscard]] auto port() const -> std::string_view { return port_; }
+            [[nodiscard]] auto query() const -> std::string_view { return query_; }
+            [[nodiscard]] auto scheme() const -> std::string_view { return scheme_; }
+            [[nodiscard]] auto source() const -> std::string_view { return source_; }
+            [[nodiscard]] auto user() const -> std::string_view { return user_; }
 
             [[nodiscard]] auto HasUserInformation() const {
                 return !user_.empty() || !password_.empty();
             }
 
         private:
-            std::string authority_;
-            std::string host_;
-            std::string password_;
-            std::string path_;
-            std::string port_;
-            std::string query_;
-            std::string scheme_;
-            std::string source_;
-            std::string user_;
-
-            auto ParseURL(std::string_view url) -> void;
+            std::pmr::string authority_;
+            std::pmr::string host_;
+            std::pmr::string password_;
+            std::pmr::string path_;
+            std::pmr::string port_;
+            std::pmr::string query_;
+            std::pmr::string scheme_;
+            std::pmr::string source_;
+            std::pmr::string user_;
+
+            explicit Url(std::pmr::memory_resource* resource);
+
+            auto ParseURL(std::string_view url) -> std::error_code;
             auto ProcessAuthority() -> void;
             auto ProcessPath() -> void;
     };
-}
\ No newline at end of file
+}
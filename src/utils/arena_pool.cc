@@ -0,0 +1,128 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "utils/arena_pool.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace Express {
+    /*
+        SpillResource
+    */
+    auto SpillResource::do_allocate(std::size_t bytes, std::size_t alignment) -> void* {
+        bytes_ += bytes;
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    auto SpillResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) -> void {
+        upstream_->deallocate(p, bytes, alignment);
+    }
+
+    auto SpillResource::do_is_equal(const memory_resource& other) const noexcept -> bool {
+        return this == &other;
+    }
+
+    /*
+        ArenaBlock
+    */
+    ArenaBlock::ArenaBlock(std::pmr::memory_resource* upstream, std::size_t size, std::size_t max_size)
+      : upstream_(upstream),
+        size_(size),
+        max_size_(max_size),
+        buffer_(upstream->allocate(size)),
+        spill_(upstream) {
+        monotonic_.emplace(buffer_, size_, &spill_);
+    }
+
+    auto ArenaBlock::Reset() -> void {
+        // Releasing the monotonic resource returns the spilled memory
+        // upstream and rewinds it to the beginning of the initial buffer.
+        monotonic_->release();
+
+        const auto wanted = size_ + spill_.bytes();
+        spill_.Reset();
+
+        // The block grows up to the largest block size. A lease that spills
+        // past it keeps spilling the rest, rather than holding on to its
+        // size for good.
+        if (wanted > size_ && size_ < max_size_) {
+            const auto size = std::min(std::bit_ceil(wanted), max_size_);
+            monotonic_.reset();
+            upstream_->deallocate(buffer_, size_);
+            buffer_ = upstream_->allocate(size);
+            size_ = size;
+            monotonic_.emplace(buffer_, size_, &spill_);
+        }
+    }
+
+    ArenaBlock::~ArenaBlock() {
+        monotonic_.reset();
+        upstream_->deallocate(buffer_, size_);
+    }
+
+    /*
+        Arena
+    */
+    Arena::Arena(Arena&& src) noexcept : pool_(src.pool_), block_(src.block_) {
+        src.block_ = nullptr;
+    }
+
+    auto Arena::resource() const -> std::pmr::memory_resource* {
+        return block_->resource();
+    }
+
+    Arena::~Arena() {
+        if (block_ != nullptr) pool_->Recycle(block_);
+    }
+
+    /*
+        ArenaPool
+    */
+    ArenaPool::ArenaPool(
+        std::pmr::memory_resource* upstream,
+        std::size_t block_size,
+        std::size_t max_idle,
+        std::size_t max_block_size
+    ) : upstream_(upstream),
+        block_size_(block_size),
+        max_idle_(max_idle),
+        max_block_size_(std::max(block_size, max_block_size)),
+        idle_(upstream) {
+        idle_.reserve(max_idle_);
+    }
+
+    auto ArenaPool::Acquire() -> Arena {
+        {
+            std::lock_guard lock {mutex_};
+            if (!idle_.empty()) {
+                auto block = idle_.back();
+                idle_.pop_back();
+                return {this, block};
+            }
+        }
+        std::pmr::polymorphic_allocator<> allocator {upstream_};
+        return {this, allocator.new_object<ArenaBlock>(upstream_, block_size_, max_block_size_)};
+    }
+
+    auto ArenaPool::Recycle(ArenaBlock* block) -> void {
+        block->Reset();
+        {
+            std::lock_guard lock {mutex_};
+            if (idle_.size() < max_idle_) {
+                idle_.push_back(block);
+                return;
+            }
+        }
+        Destroy(block);
+    }
+
+    auto ArenaPool::Destroy(ArenaBlock* block) -> void {
+        std::pmr::polymorphic_allocator<> allocator {upstream_};
+        allocator.delete_object(block);
+    }
+
+    ArenaPool::~ArenaPool() {
+        for (auto block : idle_) Destroy(block);
+    }
+}
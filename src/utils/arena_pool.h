@@ -0,0 +1,132 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace Express {
+    /*
+        Forwards allocations to an upstream resource and keeps track of
+        the number of bytes that were requested from it.
+    */
+    class SpillResource : public std::pmr::memory_resource {
+    public:
+        explicit SpillResource(std::pmr::memory_resource* upstream)
+          : upstream_(upstream) {}
+
+        [[nodiscard]] auto bytes() const { return bytes_; }
+        auto Reset() { bytes_ = 0; }
+
+    private:
+        std::pmr::memory_resource* upstream_;
+        std::size_t bytes_ {0};
+
+        auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override;
+        auto do_deallocate(void* p, std::size_t bytes, std::size_t alignment) -> void override;
+        auto do_is_equal(const memory_resource& other) const noexcept -> bool override;
+    };
+
+    /*
+        A monotonic arena backed by a reusable buffer. Allocations that don't
+        fit in the buffer spill over to the upstream resource. When the arena
+        is reset, the buffer grows to fit the spilled bytes so that the next
+        lease is served without touching the upstream resource, unless it
+        would grow beyond max_size. Those spills are only freed.
+    */
+    class ArenaBlock {
+    public:
+        ArenaBlock(std::pmr::memory_resource* upstream, std::size_t size, std::size_t max_size);
+
+        ArenaBlock(const ArenaBlock&) = delete;
+        auto operator=(const ArenaBlock&) -> ArenaBlock& = delete;
+
+        [[nodiscard]] auto resource() { return &*monotonic_; }
+        [[nodiscard]] auto size() const { return size_; }
+
+        auto Reset() -> void;
+
+        ~ArenaBlock();
+
+    private:
+        std::pmr::memory_resource* upstream_;
+        std::size_t size_;
+        std::size_t max_size_;
+        void* buffer_;
+
+        SpillResource spill_;
+        std::optional<std::pmr::monotonic_buffer_resource> monotonic_;
+    };
+
+    class ArenaPool;
+
+    /*
+        A lease on an arena block. The block is returned to the pool when
+        the lease is destroyed.
+    */
+    class Arena {
+    public:
+        Arena(Arena&& src) noexcept;
+        auto operator=(Arena&& rhs) = delete;
+        Arena(const Arena&) = delete;
+        auto operator=(const Arena&) -> Arena& = delete;
+
+        [[nodiscard]] auto resource() const -> std::pmr::memory_resource*;
+
+        ~Arena();
+
+    private:
+        friend class ArenaPool;
+
+        ArenaPool* pool_;
+        ArenaBlock* block_;
+
+        Arena(ArenaPool* pool, ArenaBlock* block) : pool_(pool), block_(block) {}
+    };
+
+    /*
+        A thread-safe pool of recycled arena blocks. Every block, including
+        its bookkeeping, is allocated from the upstream resource. Blocks
+        grow up to max_block_size, so that one large response doesn't keep
+        its memory in every idle block.
+    */
+    class ArenaPool {
+    public:
+        static constexpr std::size_t kDefaultBlockSize = 16 * 1024;
+        static constexpr std::size_t kDefaultMaxIdle = 64;
+        static constexpr std::size_t kDefaultMaxBlockSize = 256 * 1024;
+
+        explicit ArenaPool(
+            std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+            std::size_t block_size = kDefaultBlockSize,
+            std::size_t max_idle = kDefaultMaxIdle,
+            std::size_t max_block_size = kDefaultMaxBlockSize
+        );
+
+        ArenaPool(const ArenaPool&) = delete;
+        auto operator=(const ArenaPool&) -> ArenaPool& = delete;
+
+        [[nodiscard]] auto Acquire() -> Arena;
+        [[nodiscard]] auto upstream() const { return upstream_; }
+
+        ~ArenaPool();
+
+    private:
+        friend class Arena;
+
+        std::pmr::memory_resource* upstream_;
+        std::size_t block_size_;
+        std::size_t max_idle_;
+        std::size_t max_block_size_;
+
+        std::mutex mutex_;
+        std::pmr::vector<ArenaBlock*> idle_;
+
+        auto Recycle(ArenaBlock* block) -> void;
+        auto Destroy(ArenaBlock* block) -> void;
+    };
+}
@@ -0,0 +1,35 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace Express {
+    constexpr std::uint64_t kFnvOffsetBasis {14695981039346656037ULL};
+
+    /*
+        The 64-bit FNV-1a hash. Unlike std::hash, it's the same in every
+        process, so it can be stored and shared. A previous hash can be
+        passed as the basis to hash several parts.
+    */
+    [[nodiscard]] constexpr auto Fnv1a(std::string_view data, std::uint64_t basis = kFnvOffsetBasis) {
+        auto hash = basis;
+        for (const auto c : data) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /*
+        Mixes the bits of a hash (the finalizer of splitmix64), so that
+        hashes of similar values, like a counter, are spread evenly.
+    */
+    [[nodiscard]] constexpr auto Mix(std::uint64_t hash) {
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+        return hash ^ (hash >> 31);
+    }
+}
@@ -0,0 +1,44 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <system_error>
+
+namespace Express {
+    /*
+        A file mapped into memory for reading and writing. Writes to the
+        mapping reach the file through the page cache, so they survive the
+        process, and Flush() writes them to the disk.
+    */
+    class MappedFile {
+    public:
+        // Opens the file, creating it if needed, and maps its first `size`
+        // bytes. A shorter file is extended with zeros, whose disk space is
+        // allocated before the file is mapped, so that a full disk fails
+        // here rather than on a write to the mapping. The file isn't mapped
+        // if it fails.
+        MappedFile(const std::filesystem::path& path, std::size_t size, std::error_code& ec);
+
+        MappedFile(const MappedFile&) = delete;
+        auto operator=(const MappedFile&) -> MappedFile& = delete;
+
+        [[nodiscard]] auto data() const { return data_; }
+        [[nodiscard]] auto size() const { return size_; }
+
+        auto Flush() const -> void;
+
+        ~MappedFile();
+
+    private:
+        std::byte* data_ {nullptr};
+        std::size_t size_;
+
+        #ifdef _WIN32
+            void* file_ {nullptr};
+            void* mapping_ {nullptr};
+        #endif
+    };
+}
@@ -0,0 +1,82 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "utils/mapped_file.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Express {
+    namespace {
+        /*
+            Extends the file with zeros. Truncating it up would leave a
+            sparse file, and a write to the mapping that then finds the disk
+            full raises SIGBUS, so the blocks are allocated up front. Returns
+            the errno value of a failure.
+        */
+        auto Reserve(int fd, off_t offset, off_t size) -> int {
+            #ifndef __APPLE__
+                const auto result = posix_fallocate(fd, offset, size - offset);
+                // Filesystems that can't allocate blocks have the zeros written instead
+                if (result != EOPNOTSUPP && result != EINVAL) return result;
+            #endif
+
+            static constexpr std::array<char, 64 * 1024> kZeros {};
+            while (offset < size) {
+                const auto length = std::min<off_t>(kZeros.size(), size - offset);
+                const auto written = pwrite(fd, kZeros.data(), static_cast<std::size_t>(length), offset);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    return errno;
+                }
+                offset += written;
+            }
+            return 0;
+        }
+    }
+
+    MappedFile::MappedFile(const std::filesystem::path& path, std::size_t size, std::error_code& ec)
+      : size_(size) {
+        ec.clear();
+        const auto fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            ec = {errno, std::system_category()};
+            return;
+        }
+
+        struct stat status {};
+        auto error = fstat(fd, &status) < 0 ? errno : 0;
+        if (error == 0 && static_cast<std::size_t>(status.st_size) < size) {
+            error = Reserve(fd, status.st_size, static_cast<off_t>(size));
+        }
+        if (error != 0) {
+            close(fd);
+            ec = {error, std::system_category()};
+            return;
+        }
+
+        // The mapping keeps the file open
+        auto* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        error = errno;
+        close(fd);
+        if (data == MAP_FAILED) {
+            ec = {error, std::system_category()};
+            return;
+        }
+        data_ = static_cast<std::byte*>(data);
+    }
+
+    auto MappedFile::Flush() const -> void {
+        if (data_ != nullptr) msync(data_, size_, MS_ASYNC);
+    }
+
+    MappedFile::~MappedFile() {
+        if (data_ != nullptr) munmap(data_, size_);
+    }
+}
@@ -0,0 +1,68 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "utils/mapped_file.h"
+
+#include <cstdint>
+#include <system_error>
+
+#include <windows.h>
+
+namespace Express {
+    namespace {
+        auto LastError() -> std::error_code {
+            return {static_cast<int>(GetLastError()), std::system_category()};
+        }
+    }
+
+    MappedFile::MappedFile(const std::filesystem::path& path, std::size_t size, std::error_code& ec)
+      : size_(size) {
+        ec.clear();
+        file_ = CreateFileW(
+            path.c_str(),
+            GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr,
+            OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr
+        );
+        if (file_ == INVALID_HANDLE_VALUE) {
+            file_ = nullptr;
+            ec = LastError();
+            return;
+        }
+
+        // A mapping larger than the file extends it with zeros, and
+        // allocates their disk space
+        const auto high = static_cast<DWORD>(static_cast<std::uint64_t>(size) >> 32);
+        const auto low = static_cast<DWORD>(size & 0xFFFFFFFF);
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READWRITE, high, low, nullptr);
+        if (!mapping_) {
+            ec = LastError();
+            CloseHandle(file_);
+            file_ = nullptr;
+            return;
+        }
+
+        data_ = static_cast<std::byte*>(MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size));
+        if (!data_) {
+            ec = LastError();
+            CloseHandle(mapping_);
+            CloseHandle(file_);
+            mapping_ = nullptr;
+            file_ = nullptr;
+        }
+    }
+
+    auto MappedFile::Flush() const -> void {
+        if (data_) FlushViewOfFile(data_, size_);
+    }
+
+    MappedFile::~MappedFile() {
+        if (!data_) return;
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+        CloseHandle(file_);
+    }
+}
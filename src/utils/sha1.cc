@@ -0,0 +1,86 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "utils/sha1.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace Express {
+    namespace {
+        auto ProcessBlock(const unsigned char* block, std::array<std::uint32_t, 5>& state) -> void {
+            std::array<std::uint32_t, 80> words {};
+            for (std::size_t i = 0; i < 16; ++i) {
+                words[i] = static_cast<std::uint32_t>(block[i * 4]) << 24 |
+                           static_cast<std::uint32_t>(block[i * 4 + 1]) << 16 |
+                           static_cast<std::uint32_t>(block[i * 4 + 2]) << 8 |
+                           static_cast<std::uint32_t>(block[i * 4 + 3]);
+            }
+            for (std::size_t i = 16; i < 80; ++i) {
+                words[i] = std::rotl(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+            }
+
+            auto [a, b, c, d, e] = state;
+            for (std::size_t i = 0; i < 80; ++i) {
+                std::uint32_t f = 0;
+                std::uint32_t k = 0;
+                if (i < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                } else if (i < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                } else if (i < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                } else {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+
+                const auto temp = std::rotl(a, 5) + f + e + k + words[i];
+                e = d;
+                d = c;
+                c = std::rotl(b, 30);
+                b = a;
+                a = temp;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+        }
+    }
+
+    auto Sha1(std::string_view data) -> std::array<unsigned char, 20> {
+        std::array<std::uint32_t, 5> state {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+        const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+        auto remaining = data.size();
+        for (; remaining >= 64; remaining -= 64, bytes += 64) ProcessBlock(bytes, state);
+
+        // The last block is padded with a 1 bit, zeros, and the length in bits
+        std::array<unsigned char, 128> tail {};
+        std::copy(bytes, bytes + remaining, tail.begin());
+        tail[remaining] = 0x80;
+
+        const auto blocks = remaining < 56 ? 1 : 2;
+        const auto bits = static_cast<std::uint64_t>(data.size()) * 8;
+        for (std::size_t i = 0; i < 8; ++i) {
+            tail[blocks * 64 - 1 - i] = static_cast<unsigned char>(bits >> (i * 8));
+        }
+        for (auto i = 0; i < blocks; ++i) ProcessBlock(tail.data() + i * 64, state);
+
+        std::array<unsigned char, 20> digest {};
+        for (std::size_t i = 0; i < 5; ++i) {
+            digest[i * 4] = static_cast<unsigned char>(state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<unsigned char>(state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<unsigned char>(state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<unsigned char>(state[i]);
+        }
+        return digest;
+    }
+}
@@ -0,0 +1,15 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <array>
+#include <string_view>
+
+namespace Express {
+    /*
+        The SHA-1 digest of the data. SHA-1 isn't collision resistant, and
+        is only here because the WebSocket handshake is defined with it.
+    */
+    [[nodiscard]] auto Sha1(std::string_view data) -> std::array<unsigned char, 20>;
+}
@@ -0,0 +1,41 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace Express {
+    /*
+        A named shared memory object mapped into memory. Processes that open
+        the same name map the same memory. The object starts zeroed, and
+        outlives the processes until it's unlinked.
+    */
+    class SharedMemory {
+    public:
+        // Opens the object, creating it if needed, and maps its first `size`
+        // bytes. A smaller object is extended with zeros.
+        SharedMemory(std::string_view name, std::size_t size);
+
+        SharedMemory(const SharedMemory&) = delete;
+        auto operator=(const SharedMemory&) -> SharedMemory& = delete;
+
+        [[nodiscard]] auto data() const { return data_; }
+        [[nodiscard]] auto size() const { return size_; }
+
+        // Removes the name. Processes that have mapped the object keep it.
+        static auto Unlink(std::string_view name) -> void;
+
+        ~SharedMemory();
+
+    private:
+        std::byte* data_ {nullptr};
+        std::size_t size_;
+
+        #ifdef _WIN32
+            void* mapping_ {nullptr};
+        #endif
+    };
+}
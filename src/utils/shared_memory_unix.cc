@@ -0,0 +1,53 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "utils/shared_memory.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "client/error.h"
+
+namespace Express {
+    namespace {
+        // POSIX names start with a slash
+        auto ObjectName(std::string_view name) {
+            auto object = std::string {name};
+            if (object.empty() || object.front() != '/') object.insert(object.begin(), '/');
+            return object;
+        }
+    }
+
+    SharedMemory::SharedMemory(std::string_view name, std::size_t size) : size_(size) {
+        const auto fd = shm_open(ObjectName(name).c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0) Error::System("Cache error");
+
+        struct stat status {};
+        if (fstat(fd, &status) < 0 ||
+            (static_cast<std::size_t>(status.st_size) < size && ftruncate(fd, static_cast<off_t>(size)) < 0)) {
+            const auto error = errno;
+            close(fd);
+            errno = error;
+            Error::System("Cache error");
+        }
+
+        auto* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const auto error = errno;
+        close(fd);
+        if (data == MAP_FAILED) {
+            errno = error;
+            Error::System("Cache error");
+        }
+        data_ = static_cast<std::byte*>(data);
+    }
+
+    auto SharedMemory::Unlink(std::string_view name) -> void {
+        shm_unlink(ObjectName(name).c_str());
+    }
+
+    SharedMemory::~SharedMemory() {
+        munmap(data_, size_);
+    }
+}
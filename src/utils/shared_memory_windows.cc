@@ -0,0 +1,41 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "utils/shared_memory.h"
+
+#include <cstdint>
+#include <system_error>
+
+#include <windows.h>
+
+namespace Express {
+    namespace {
+        [[noreturn]] auto Throw() -> void {
+            throw std::system_error {static_cast<int>(GetLastError()), std::system_category(), "Cache error"};
+        }
+    }
+
+    SharedMemory::SharedMemory(std::string_view name, std::size_t size) : size_(size) {
+        // A mapping backed by the paging file, which lives while a process has it open
+        const auto object = std::string {"Local\\"}.append(name);
+        const auto high = static_cast<DWORD>(static_cast<std::uint64_t>(size) >> 32);
+        const auto low = static_cast<DWORD>(size & 0xFFFFFFFF);
+        mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, high, low, object.c_str());
+        if (!mapping_) Throw();
+
+        data_ = static_cast<std::byte*>(MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size));
+        if (!data_) {
+            const auto error = GetLastError();
+            CloseHandle(mapping_);
+            SetLastError(error);
+            Throw();
+        }
+    }
+
+    auto SharedMemory::Unlink(std::string_view) -> void {}
+
+    SharedMemory::~SharedMemory() {
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+    }
+}
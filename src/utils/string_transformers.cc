@@ -16,6 +16,14 @@ namespace Express::StringTransformers {
         return str;
     }
 
+    auto EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) noexcept -> bool {
+        if (lhs.size() != rhs.size()) return false;
+        for (std::size_t i = 0; i < lhs.size(); ++i) {
+            if (tolower(lhs[i]) != tolower(rhs[i])) return false;
+        }
+        return true;
+    }
+
     auto TrimLeadingWhiteSpacesInPlace(std::string& str) -> void {
         auto i = 0;
         while (i < static_cast<int>(str.size()) && IsWhiteSpace(str[i])) ++i;
@@ -33,29 +41,40 @@ namespace Express::StringTransformers {
         if (i != static_cast<int>(size(str)) - 1) str.erase(i + 1);
     }
 
-    auto Base64Encoding(std::string_view str) noexcept -> std::string {
+    template <class String>
+    auto Base64EncodingImpl(std::string_view str, String& output) -> void {
+        // The bytes are unsigned, so that binary data (and UTF-8) encodes too
+        const auto* bytes = reinterpret_cast<const unsigned char*>(str.data());
         size_t len = size(str);
         size_t i = 0;
-        std::string output;
-        output.reserve((len + 2) / 3 * 4);
+        output.reserve(output.size() + (len + 2) / 3 * 4);
         while (i < len) {
-            output += chars[str[i] >> 2];
+            output += chars[bytes[i] >> 2];
             if (i + 1 < len) {
-                output += chars[((str[i] & 0x03) << 4) + (str[i + 1] >> 4)];
+                output += chars[((bytes[i] & 0x03) << 4) + (bytes[i + 1] >> 4)];
                 if (i + 2 < len) {
-                    output += chars[((str[i + 1] & 0x0F) << 2) + (str[i + 2] >> 6)];
-                    output += chars[str[i + 2] & 0x3F];
+                    output += chars[((bytes[i + 1] & 0x0F) << 2) + (bytes[i + 2] >> 6)];
+                    output += chars[bytes[i + 2] & 0x3F];
                 } else {
-                    output += chars[(str[i + 1] & 0x0F) << 2];
+                    output += chars[(bytes[i + 1] & 0x0F) << 2];
                     output += '=';
                 }
             } else {
-                output += chars[(str[i] & 0x03) << 4];
+                output += chars[(bytes[i] & 0x03) << 4];
                 output += '=';
                 output += '=';
             }
             i += 3;
         }
+    }
+
+    auto Base64Encoding(std::string_view str) noexcept -> std::string {
+        std::string output;
+        Base64EncodingImpl(str, output);
         return output;
     }
+
+    auto Base64Encoding(std::string_view str, std::pmr::string& output) -> void {
+        Base64EncodingImpl(str, output);
+    }
 }
\ No newline at end of file
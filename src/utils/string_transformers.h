@@ -3,12 +3,15 @@
 
 #pragma once
 
+#include <memory_resource>
 #include <string>
 #include <string_view>
 
 namespace Express::StringTransformers {
     [[nodiscard]] auto StringToLowerCase(std::string str) noexcept -> std::string;
+    [[nodiscard]] auto EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) noexcept -> bool;
     [[nodiscard]] auto Base64Encoding(std::string_view str) noexcept -> std::string;
+    auto Base64Encoding(std::string_view str, std::pmr::string& output) -> void;
 
     auto TrimLeadingWhiteSpacesInPlace(std::string& str) -> void;
     [[nodiscard]] auto TrimLeadingWhiteSpaces(std::string) -> std::string;
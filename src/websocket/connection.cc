@@ -0,0 +1,309 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "websocket/connection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <utility>
+
+#include "express/error_code.h"
+
+namespace Express::Ws {
+    namespace {
+        constexpr std::size_t kReadSize = 16 * 1024;
+
+        // Reported to the server when the client fails the connection
+        constexpr std::uint16_t kProtocolError = 1002;
+        constexpr std::uint16_t kMessageTooBig = 1009;
+        constexpr std::uint16_t kNoStatus = 1005;
+
+        // A masking key for every frame, from a generator that isn't shared
+        // between threads
+        auto NextKey() -> MaskingKey {
+            thread_local std::mt19937 engine {std::random_device {}()};
+            const auto value = engine();
+
+            MaskingKey key {};
+            std::memcpy(key.data(), &value, key.size());
+            return key;
+        }
+
+        auto MakeLimits(std::stop_token stop) -> Limits {
+            Config config;
+            config.stop_token = std::move(stop);
+            return Limits {config};
+        }
+
+        auto AsString(std::span<const unsigned char> data) -> std::string_view {
+            return {reinterpret_cast<const char*>(data.data()), data.size()};
+        }
+
+        auto ClosePayload(std::uint16_t code, std::string_view reason) -> std::string {
+            std::string payload;
+            payload.push_back(static_cast<char>(code >> 8));
+            payload.push_back(static_cast<char>(code & 0xFF));
+            payload.append(reason.substr(0, kMaxControlPayload - 2));
+            return payload;
+        }
+
+        struct WriteGuard {
+            WriteLock& lock;
+
+            ~WriteGuard() { lock.Unlock(); }
+        };
+    }
+
+    auto WriteLock::Awaiter::await_ready() -> bool {
+        std::lock_guard lock {lock_.mutex_};
+        if (lock_.locked_) return false;
+        lock_.locked_ = true;
+        return true;
+    }
+
+    auto WriteLock::Awaiter::await_suspend(std::coroutine_handle<> handle) -> bool {
+        std::lock_guard lock {lock_.mutex_};
+        if (!lock_.locked_) {
+            lock_.locked_ = true;
+            return false;
+        }
+        lock_.waiters_.push_back(handle);
+        return true;
+    }
+
+    auto WriteLock::Unlock() -> void {
+        std::coroutine_handle<> next;
+        {
+            std::lock_guard lock {mutex_};
+            if (waiters_.empty()) {
+                locked_ = false;
+                return;
+            }
+            next = waiters_.front();
+            waiters_.pop_front();
+        }
+
+        // The lock passes to the next coroutine without being released. A
+        // coroutine that unlocks as soon as it's resumed would resume the
+        // next one from within, so queued sends would nest as deep as the
+        // queue, and handoffs made during one are run after it instead.
+        thread_local std::deque<std::coroutine_handle<>>* handoffs = nullptr;
+        if (handoffs) {
+            handoffs->push_back(next);
+            return;
+        }
+
+        std::deque<std::coroutine_handle<>> pending {next};
+        handoffs = &pending;
+        while (!pending.empty()) {
+            const auto handle = pending.front();
+            pending.pop_front();
+            handle.resume();
+        }
+        handoffs = nullptr;
+    }
+
+    Connection::Connection(
+        std::unique_ptr<Net::Socket> socket,
+        std::shared_ptr<Net::EventLoop> loop,
+        WebSocketOptions options,
+        Handshake handshake,
+        Response response,
+        std::stop_token stop
+    ) : socket_(std::move(socket)),
+        loop_(std::move(loop)),
+        options_(std::move(options)),
+        handshake_(std::move(handshake)),
+        response_(std::move(response)),
+        on_stop_(std::move(stop), Stopper {&stop_}),
+        limits_(MakeLimits(stop_.get_token())),
+        reader_(options_.max_message_size) {
+        if (handshake_.deflate) deflate_ = std::make_unique<PerMessageDeflate>(handshake_.parameters);
+    }
+
+    auto Connection::Buffer(std::string_view data) -> void {
+        auto space = reader_.Prepare(data.size());
+        std::copy(data.begin(), data.end(), space.begin());
+        reader_.Commit(data.size());
+    }
+
+    auto Connection::SendAsync(std::string_view data, Opcode opcode) -> Task<std::error_code> {
+        co_await write_lock_.Lock();
+        const WriteGuard guard {write_lock_};
+        if (close_sent_) co_return ErrorCode::kWebSocketClosed;
+
+        // Compressing a message changes its payload, and only its first
+        // frame says that it's compressed
+        std::error_code ec;
+        auto payload = data;
+        auto compressed = false;
+        if (deflate_ && payload.size() >= options_.min_deflate_size) {
+            deflate_->Compress(payload, compressed_, ec);
+            if (ec) co_return ec;
+            payload = compressed_;
+            compressed = true;
+        }
+
+        frames_.clear();
+        const auto frame_size = options_.max_frame_size > 0 ? options_.max_frame_size : payload.size();
+        auto first = true;
+        do {
+            const auto size = std::min(frame_size, payload.size());
+            const auto fin = size == payload.size();
+            WriteFrame(first ? opcode : Opcode::kContinuation, payload.substr(0, size), fin, compressed, NextKey(), frames_);
+            payload.remove_prefix(size);
+            compressed = false;
+            first = false;
+        } while (!payload.empty());
+
+        co_return co_await Express::SendAsync(*socket_, frames_, *loop_, limits_);
+    }
+
+    auto Connection::WriteAsync(Opcode opcode, std::string_view payload) -> Task<std::error_code> {
+        co_await write_lock_.Lock();
+        const WriteGuard guard {write_lock_};
+
+        // Nothing is sent after a close
+        if (close_sent_) co_return ErrorCode::kWebSocketClosed;
+        if (opcode == Opcode::kClose) close_sent_ = true;
+
+        frames_.clear();
+        WriteFrame(opcode, payload, true, false, NextKey(), frames_);
+        co_return co_await Express::SendAsync(*socket_, frames_, *loop_, limits_);
+    }
+
+    auto Connection::PingAsync(std::string_view data) -> Task<std::error_code> {
+        if (data.size() > kMaxControlPayload) co_return ErrorCode::kMessageTooLarge;
+        co_return co_await WriteAsync(Opcode::kPing, data);
+    }
+
+    auto Connection::CloseAsync(std::uint16_t code, std::string reason) -> Task<std::error_code> {
+        co_return co_await WriteAsync(Opcode::kClose, ClosePayload(code, reason));
+    }
+
+    auto Connection::NextFrameAsync(Frame& frame) -> Task<std::error_code> {
+        std::error_code ec;
+        auto pinged = false;
+        while (!reader_.Next(frame, ec)) {
+            if (ec) co_return ec;
+
+            const auto space = reader_.Prepare(kReadSize);
+            const auto size = socket_->RecvSome(space.data(), space.size(), ec);
+            if (ec == std::errc::operation_would_block) {
+                // A connection that's quiet for too long is pinged, and
+                // fails if it stays quiet
+                const Timeout idle {options_.ping_interval};
+                const auto result = co_await loop_->Wait(
+                    socket_->handle(), Net::EventType::kToRead, idle, limits_.stop
+                );
+                if (result == Net::WaitResult::kTimeout) {
+                    if (pinged) co_return ErrorCode::kIdleTimeout;
+                    pinged = true;
+                    ec = co_await WriteAsync(Opcode::kPing, {});
+                    if (ec) co_return ec;
+                    continue;
+                }
+                if (result != Net::WaitResult::kReady) co_return std::make_error_code(std::errc::operation_canceled);
+                continue;
+            }
+            if (ec) co_return ec;
+            if (size == 0) co_return std::make_error_code(std::errc::connection_reset);
+
+            reader_.Commit(size);
+            pinged = false;
+        }
+        co_return ec;
+    }
+
+    auto Connection::FailAsync(std::error_code ec) -> Task<std::error_code> {
+        closed_ = true;
+
+        // The server is told why, when it broke the protocol
+        if (ec == ErrorCode::kWebSocketProtocolError || ec == ErrorCode::kMessageTooLarge) {
+            const auto code = ec == ErrorCode::kMessageTooLarge ? kMessageTooBig : kProtocolError;
+            const auto payload = ClosePayload(code, {});
+            [[maybe_unused]] const auto error = co_await WriteAsync(Opcode::kClose, payload);
+        }
+        co_return ec;
+    }
+
+    auto Connection::ReceiveAsync() -> Task<Expected<WebSocketMessage>> {
+        if (closed_) co_return Unexpected {make_error_code(ErrorCode::kWebSocketClosed)};
+
+        message_.clear();
+        auto assembling = false;
+        auto compressed = false;
+        auto type = MessageType::Text;
+
+        while (true) {
+            Frame frame;
+            auto ec = co_await NextFrameAsync(frame);
+            if (ec) co_return Unexpected {co_await FailAsync(ec)};
+
+            // Servers never mask their frames, and only compress them once
+            // the client agreed to it
+            const auto& header = frame.header;
+            if (header.masked || (header.compressed && (!deflate_ || header.opcode == Opcode::kContinuation))) {
+                co_return Unexpected {co_await FailAsync(ErrorCode::kWebSocketProtocolError)};
+            }
+
+            switch (header.opcode) {
+                case Opcode::kPing:
+                    ec = co_await WriteAsync(Opcode::kPong, AsString(frame.payload));
+                    if (ec && ec != ErrorCode::kWebSocketClosed) co_return Unexpected {co_await FailAsync(ec)};
+                    continue;
+
+                case Opcode::kPong:
+                    continue;
+
+                case Opcode::kClose: {
+                    if (frame.payload.size() == 1) {
+                        co_return Unexpected {co_await FailAsync(ErrorCode::kWebSocketProtocolError)};
+                    }
+
+                    WebSocketMessage message {.type = MessageType::Close, .data = {}, .close_code = kNoStatus};
+                    if (frame.payload.size() >= 2) {
+                        message.close_code = static_cast<std::uint16_t>(frame.payload[0] << 8 | frame.payload[1]);
+                        message.data = AsString(frame.payload.subspan(2));
+                    }
+                    closed_ = true;
+
+                    // The close is echoed, unless it answers the client's
+                    const auto payload = frame.payload.size() >= 2 ? AsString(frame.payload.first(2)) : std::string_view {};
+                    [[maybe_unused]] const auto error = co_await WriteAsync(Opcode::kClose, payload);
+                    co_return message;
+                }
+
+                case Opcode::kContinuation:
+                    if (!assembling) co_return Unexpected {co_await FailAsync(ErrorCode::kWebSocketProtocolError)};
+                    break;
+
+                case Opcode::kText:
+                case Opcode::kBinary:
+                    if (assembling) co_return Unexpected {co_await FailAsync(ErrorCode::kWebSocketProtocolError)};
+                    type = header.opcode == Opcode::kText ? MessageType::Text : MessageType::Binary;
+                    compressed = header.compressed;
+
+                    // A message in a single frame is returned where it was read
+                    if (header.fin && !compressed) {
+                        co_return WebSocketMessage {.type = type, .data = AsString(frame.payload)};
+                    }
+                    assembling = true;
+                    break;
+            }
+
+            if (message_.size() + frame.payload.size() > options_.max_message_size) {
+                co_return Unexpected {co_await FailAsync(ErrorCode::kMessageTooLarge)};
+            }
+            message_.append(AsString(frame.payload));
+            if (!header.fin) continue;
+
+            if (!compressed) co_return WebSocketMessage {.type = type, .data = message_};
+
+            deflate_->Decompress(message_, options_.max_message_size, inflated_, ec);
+            if (ec) co_return Unexpected {co_await FailAsync(ec)};
+            co_return WebSocketMessage {.type = type, .data = inflated_};
+        }
+    }
+}
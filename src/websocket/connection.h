@@ -0,0 +1,130 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "express/expected.h"
+#include "express/response.h"
+#include "express/task.h"
+#include "express/websocket.h"
+
+#include "client/transfer.h"
+#include "net/event_loop.h"
+#include "net/socket.h"
+#include "websocket/deflate.h"
+#include "websocket/frame.h"
+#include "websocket/handshake.h"
+
+namespace Express::Ws {
+    /*
+        Lets one coroutine at a time write to the socket, so the frames of
+        concurrent messages don't interleave. A coroutine that finds it
+        taken waits in line, and Unlock resumes the next one in its place.
+    */
+    class WriteLock {
+    public:
+        class Awaiter {
+        public:
+            explicit Awaiter(WriteLock& lock) : lock_(lock) {}
+
+            auto await_ready() -> bool;
+            auto await_suspend(std::coroutine_handle<> handle) -> bool;
+            auto await_resume() const noexcept {}
+
+        private:
+            WriteLock& lock_;
+        };
+
+        [[nodiscard]] auto Lock() { return Awaiter {*this}; }
+        auto Unlock() -> void;
+
+    private:
+        std::mutex mutex_;
+        bool locked_ {false};
+        std::deque<std::coroutine_handle<>> waiters_;
+    };
+
+    /*
+        An open WebSocket connection, once the handshake is done. The
+        receiving side reads frames into its reader and reassembles
+        fragmented and compressed messages. The sending side masks every
+        frame as it's written, and holds the write lock until it's sent.
+        Pings are answered, and a close is echoed, by the receiving side.
+    */
+    class Connection {
+    public:
+        Connection(
+            std::unique_ptr<Net::Socket> socket,
+            std::shared_ptr<Net::EventLoop> loop,
+            WebSocketOptions options,
+            Handshake handshake,
+            Response response,
+            std::stop_token stop
+        );
+
+        Connection(const Connection&) = delete;
+        auto operator=(const Connection&) -> Connection& = delete;
+
+        // Takes the bytes that arrived with the handshake response
+        auto Buffer(std::string_view data) -> void;
+
+        [[nodiscard]] auto SendAsync(std::string_view data, Opcode opcode) -> Task<std::error_code>;
+        [[nodiscard]] auto ReceiveAsync() -> Task<Expected<WebSocketMessage>>;
+        [[nodiscard]] auto PingAsync(std::string_view data) -> Task<std::error_code>;
+        [[nodiscard]] auto CloseAsync(std::uint16_t code, std::string reason) -> Task<std::error_code>;
+
+        // Cancels the operations that are waiting for the socket
+        auto Stop() -> void { stop_.request_stop(); }
+
+        [[nodiscard]] auto protocol() const -> std::string_view { return handshake_.protocol; }
+        [[nodiscard]] auto compressed() const { return handshake_.deflate; }
+        [[nodiscard]] auto response() const -> const Response& { return response_; }
+
+    private:
+        struct Stopper {
+            std::stop_source* source;
+            auto operator()() const -> void { source->request_stop(); }
+        };
+
+        std::unique_ptr<Net::Socket> socket_;
+        std::shared_ptr<Net::EventLoop> loop_;
+        WebSocketOptions options_;
+        Handshake handshake_;
+        Response response_;
+
+        // A stop requested through the config's token stops the connection too
+        std::stop_source stop_;
+        std::stop_callback<Stopper> on_stop_;
+        Limits limits_;
+
+        // Sending
+        WriteLock write_lock_;
+        std::string frames_;
+        std::string compressed_;
+        std::atomic<bool> close_sent_ {false};
+
+        // Receiving
+        FrameReader reader_;
+        std::string message_;
+        std::string inflated_;
+        bool closed_ {false};
+
+        std::unique_ptr<PerMessageDeflate> deflate_;
+
+        auto NextFrameAsync(Frame& frame) -> Task<std::error_code>;
+        auto WriteAsync(Opcode opcode, std::string_view payload) -> Task<std::error_code>;
+        auto FailAsync(std::error_code ec) -> Task<std::error_code>;
+    };
+}
@@ -0,0 +1,234 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "websocket/deflate.h"
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+
+#ifdef EXPRESS_ZLIB
+    #include <zlib.h>
+#endif
+
+#include "express/error_code.h"
+#include "utils/string_transformers.h"
+
+namespace Express::Ws {
+    namespace {
+        // Every message is flushed to a byte boundary, which ends it with an
+        // empty stored block. The sender drops the block and the receiver
+        // puts it back.
+        constexpr unsigned char kTail[] {0x00, 0x00, 0xFF, 0xFF};
+
+        constexpr std::size_t kChunkSize = 4096;
+
+        auto Trim(std::string_view value) {
+            const auto begin = value.find_first_not_of(" \t");
+            if (begin == std::string_view::npos) return std::string_view {};
+            return value.substr(begin, value.find_last_not_of(" \t") - begin + 1);
+        }
+
+        // The bits of a window size parameter, which may be quoted
+        auto ParseWindowBits(std::string_view value, int& bits) -> bool {
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+                value = value.substr(1, value.size() - 2);
+            }
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), bits);
+            return error == std::errc {} && end == value.data() + value.size() && bits >= 8 && bits <= 15;
+        }
+    }
+
+    auto DeflateSupported() -> bool {
+        #ifdef EXPRESS_ZLIB
+            return true;
+        #else
+            return false;
+        #endif
+    }
+
+    auto ParseExtensions(std::string_view value, bool& deflate, DeflateParameters& parameters) -> std::error_code {
+        using StringTransformers::EqualsIgnoreCase;
+
+        deflate = false;
+        parameters = {};
+        while (!value.empty()) {
+            const auto comma = value.find(',');
+            auto extension = value.substr(0, comma);
+            value = comma == std::string_view::npos ? std::string_view {} : value.substr(comma + 1);
+
+            const auto semicolon = extension.find(';');
+            const auto name = Trim(extension.substr(0, semicolon));
+            if (name.empty()) continue;
+
+            // The server can only accept the extension that was offered, once
+            if (!EqualsIgnoreCase(name, "permessage-deflate") || deflate) return ErrorCode::kHandshakeFailed;
+            deflate = true;
+
+            auto seen = 0u;
+            extension = semicolon == std::string_view::npos ? std::string_view {} : extension.substr(semicolon + 1);
+            while (!extension.empty()) {
+                const auto next = extension.find(';');
+                const auto parameter = extension.substr(0, next);
+                extension = next == std::string_view::npos ? std::string_view {} : extension.substr(next + 1);
+
+                const auto equals = parameter.find('=');
+                const auto key = Trim(parameter.substr(0, equals));
+                const auto argument = equals == std::string_view::npos ?
+                    std::string_view {} : Trim(parameter.substr(equals + 1));
+
+                // Every parameter may appear once
+                auto flag = 0u;
+                if (EqualsIgnoreCase(key, "server_no_context_takeover") && argument.empty()) {
+                    flag = 1;
+                    parameters.server_no_context_takeover = true;
+                } else if (EqualsIgnoreCase(key, "client_no_context_takeover") && argument.empty()) {
+                    flag = 2;
+                    parameters.client_no_context_takeover = true;
+                } else if (EqualsIgnoreCase(key, "server_max_window_bits") &&
+                           ParseWindowBits(argument, parameters.server_max_window_bits)) {
+                    flag = 4;
+                } else if (EqualsIgnoreCase(key, "client_max_window_bits") &&
+                           ParseWindowBits(argument, parameters.client_max_window_bits)) {
+                    flag = 8;
+                } else {
+                    return ErrorCode::kHandshakeFailed;
+                }
+                if ((seen & flag) != 0) return ErrorCode::kHandshakeFailed;
+                seen |= flag;
+            }
+
+            // zlib can't compress with a 256 byte window
+            if (parameters.client_max_window_bits < 9) return ErrorCode::kHandshakeFailed;
+        }
+        return {};
+    }
+
+    #ifdef EXPRESS_ZLIB
+        struct PerMessageDeflate::Streams {
+            z_stream deflater {};
+            z_stream inflater {};
+            bool deflating {false};
+            bool inflating {false};
+
+            ~Streams() {
+                if (deflating) deflateEnd(&deflater);
+                if (inflating) inflateEnd(&inflater);
+            }
+        };
+    #else
+        struct PerMessageDeflate::Streams {};
+    #endif
+
+    PerMessageDeflate::PerMessageDeflate(const DeflateParameters& parameters)
+      : parameters_(parameters), streams_(std::make_unique<Streams>()) {}
+
+    PerMessageDeflate::~PerMessageDeflate() = default;
+
+    auto PerMessageDeflate::Compress(std::string_view message, std::string& output, std::error_code& ec) -> void {
+        ec.clear();
+        output.clear();
+
+        #ifdef EXPRESS_ZLIB
+            // zlib takes the message in one call
+            if (message.size() > std::numeric_limits<uInt>::max()) {
+                ec = ErrorCode::kMessageTooLarge;
+                return;
+            }
+
+            auto& stream = streams_->deflater;
+            if (!streams_->deflating) {
+                const auto bits = parameters_.client_max_window_bits;
+                if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    ec = std::make_error_code(std::errc::not_enough_memory);
+                    return;
+                }
+                streams_->deflating = true;
+            }
+
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(message.data()));
+            stream.avail_in = static_cast<uInt>(message.size());
+
+            // The flush is complete once it leaves room in the output
+            std::size_t written = 0;
+            do {
+                output.resize(written + std::max<std::size_t>(deflateBound(&stream, stream.avail_in), kChunkSize));
+                stream.next_out = reinterpret_cast<Bytef*>(output.data() + written);
+                stream.avail_out = static_cast<uInt>(output.size() - written);
+
+                const auto result = deflate(&stream, Z_SYNC_FLUSH);
+                written = output.size() - stream.avail_out;
+                if (result != Z_OK && result != Z_BUF_ERROR) {
+                    ec = std::make_error_code(std::errc::not_enough_memory);
+                    return;
+                }
+            } while (stream.avail_out == 0);
+
+            output.resize(written >= sizeof(kTail) ? written - sizeof(kTail) : written);
+
+            if (parameters_.client_no_context_takeover) deflateReset(&stream);
+        #else
+            static_cast<void>(message);
+            ec = ErrorCode::kUnsupportedCompression;
+        #endif
+    }
+
+    auto PerMessageDeflate::Decompress(
+        std::string_view payload,
+        std::size_t max_size,
+        std::string& output,
+        std::error_code& ec
+    ) -> void {
+        ec.clear();
+        output.clear();
+
+        #ifdef EXPRESS_ZLIB
+            if (payload.size() > std::numeric_limits<uInt>::max()) {
+                ec = ErrorCode::kMessageTooLarge;
+                return;
+            }
+
+            // A larger window than the server's decodes its messages all the same
+            auto& stream = streams_->inflater;
+            if (!streams_->inflating) {
+                if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+                    ec = std::make_error_code(std::errc::not_enough_memory);
+                    return;
+                }
+                streams_->inflating = true;
+            }
+
+            // One byte past the limit shows that the message is too large
+            const auto limit = std::min(max_size, std::numeric_limits<std::size_t>::max() - 1) + 1;
+            std::size_t written = 0;
+            const auto inflate_all = [&](const unsigned char* data, std::size_t size) -> std::error_code {
+                stream.next_in = const_cast<Bytef*>(data);
+                stream.avail_in = static_cast<uInt>(size);
+                do {
+                    if (written >= limit) return ErrorCode::kMessageTooLarge;
+                    const auto chunk = std::min(std::max(payload.size() * 2, kChunkSize), limit - written);
+                    output.resize(written + chunk);
+                    stream.next_out = reinterpret_cast<Bytef*>(output.data() + written);
+                    stream.avail_out = static_cast<uInt>(chunk);
+
+                    const auto result = inflate(&stream, Z_SYNC_FLUSH);
+                    written = output.size() - stream.avail_out;
+                    if (result == Z_STREAM_END) break;
+                    if (result != Z_OK && result != Z_BUF_ERROR) return ErrorCode::kWebSocketProtocolError;
+                } while (stream.avail_in > 0 || stream.avail_out == 0);
+                return {};
+            };
+
+            ec = inflate_all(reinterpret_cast<const unsigned char*>(payload.data()), payload.size());
+            if (!ec) ec = inflate_all(kTail, sizeof(kTail));
+            if (!ec && written > max_size) ec = ErrorCode::kMessageTooLarge;
+            output.resize(ec ? 0 : written);
+
+            if (ec || parameters_.server_no_context_takeover) inflateReset(&stream);
+        #else
+            static_cast<void>(payload);
+            static_cast<void>(max_size);
+            ec = ErrorCode::kUnsupportedCompression;
+        #endif
+    }
+}
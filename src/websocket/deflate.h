@@ -0,0 +1,69 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace Express::Ws {
+    // The extension offer, which lets the server pick the client's window
+    constexpr std::string_view kDeflateOffer {"permessage-deflate; client_max_window_bits"};
+
+    // Whether the client was built with zlib, which permessage-deflate needs
+    [[nodiscard]] auto DeflateSupported() -> bool;
+
+    // The parameters of permessage-deflate (RFC 7692) the server agreed to
+    struct DeflateParameters {
+        bool server_no_context_takeover {false};
+        bool client_no_context_takeover {false};
+        int server_max_window_bits {15};
+        int client_max_window_bits {15};
+    };
+
+    /*
+        Parses the server's Sec-WebSocket-Extensions header. Sets deflate
+        when the server accepted permessage-deflate, and reports an extension
+        that wasn't offered, or parameters the client can't honour, as
+        ErrorCode::kHandshakeFailed.
+    */
+    auto ParseExtensions(std::string_view value, bool& deflate, DeflateParameters& parameters) -> std::error_code;
+
+    /*
+        Compresses the messages the client sends, and decompresses the ones
+        it receives, with a raw deflate stream in each direction. Unless
+        context takeover was turned off, both streams keep their window from
+        one message to the next, which is where most of the savings on small
+        messages come from.
+    */
+    class PerMessageDeflate {
+    public:
+        explicit PerMessageDeflate(const DeflateParameters& parameters);
+
+        PerMessageDeflate(const PerMessageDeflate&) = delete;
+        auto operator=(const PerMessageDeflate&) -> PerMessageDeflate& = delete;
+
+        // Replaces the output with the compressed payload of the message
+        auto Compress(std::string_view message, std::string& output, std::error_code& ec) -> void;
+
+        // Replaces the output with the message. A message that decompresses
+        // to more than max_size is reported as ErrorCode::kMessageTooLarge.
+        auto Decompress(
+            std::string_view payload,
+            std::size_t max_size,
+            std::string& output,
+            std::error_code& ec
+        ) -> void;
+
+        ~PerMessageDeflate();
+
+    private:
+        struct Streams;
+
+        DeflateParameters parameters_;
+        std::unique_ptr<Streams> streams_;
+    };
+}
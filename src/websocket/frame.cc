@@ -0,0 +1,162 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "websocket/frame.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "express/error_code.h"
+
+namespace Express::Ws {
+    namespace {
+        constexpr unsigned char kFin = 0x80;
+        constexpr unsigned char kRsv1 = 0x40;
+        constexpr unsigned char kReserved = 0x30;
+        constexpr unsigned char kMasked = 0x80;
+
+        auto IsKnown(unsigned char opcode) {
+            return opcode <= 0x2 || (opcode >= 0x8 && opcode <= 0xA);
+        }
+    }
+
+    auto ParseFrameHeader(
+        std::span<const unsigned char> data,
+        FrameHeader& header,
+        std::error_code& ec
+    ) -> bool {
+        ec.clear();
+        if (data.size() < 2) return false;
+
+        const auto opcode = static_cast<unsigned char>(data[0] & 0x0F);
+        if ((data[0] & kReserved) != 0 || !IsKnown(opcode)) {
+            ec = ErrorCode::kWebSocketProtocolError;
+            return false;
+        }
+
+        header.fin = (data[0] & kFin) != 0;
+        header.compressed = (data[0] & kRsv1) != 0;
+        header.opcode = static_cast<Opcode>(opcode);
+        header.masked = (data[1] & kMasked) != 0;
+
+        std::size_t size = 2;
+        std::uint64_t length = data[1] & 0x7F;
+        const auto extended = length == 126 ? 2 : length == 127 ? 8 : 0;
+        if (data.size() < size + extended) return false;
+
+        if (extended > 0) {
+            length = 0;
+            for (auto i = 0; i < extended; ++i) length = length << 8 | data[size++];
+
+            // The most significant bit of a 64-bit length must be zero
+            if (length > std::numeric_limits<std::int64_t>::max()) {
+                ec = ErrorCode::kWebSocketProtocolError;
+                return false;
+            }
+        }
+
+        if (IsControl(header.opcode) &&
+            (!header.fin || header.compressed || length > kMaxControlPayload)) {
+            ec = ErrorCode::kWebSocketProtocolError;
+            return false;
+        }
+
+        if (header.masked) {
+            if (data.size() < size + 4) return false;
+            std::copy_n(data.begin() + static_cast<std::ptrdiff_t>(size), 4, header.key.begin());
+            size += 4;
+        }
+
+        header.payload_size = length;
+        header.size = size;
+        return true;
+    }
+
+    auto WriteFrame(
+        Opcode opcode,
+        std::string_view payload,
+        bool fin,
+        bool compressed,
+        const std::optional<MaskingKey>& key,
+        std::string& output
+    ) -> void {
+        const auto start = output.size();
+        output.resize(start + kMaxHeaderSize + payload.size());
+        auto* out = reinterpret_cast<unsigned char*>(output.data()) + start;
+
+        std::size_t size = 0;
+        out[size++] = static_cast<unsigned char>(
+            (fin ? kFin : 0) | (compressed ? kRsv1 : 0) | static_cast<unsigned char>(opcode)
+        );
+
+        const unsigned char masked = key ? kMasked : 0;
+        const auto length = payload.size();
+        if (length < 126) {
+            out[size++] = static_cast<unsigned char>(masked | length);
+        } else if (length <= 0xFFFF) {
+            out[size++] = masked | 126;
+            out[size++] = static_cast<unsigned char>(length >> 8);
+            out[size++] = static_cast<unsigned char>(length);
+        } else {
+            out[size++] = masked | 127;
+            for (auto shift = 56; shift >= 0; shift -= 8) {
+                out[size++] = static_cast<unsigned char>(static_cast<std::uint64_t>(length) >> shift);
+            }
+        }
+
+        const auto* data = reinterpret_cast<const unsigned char*>(payload.data());
+        if (key) {
+            std::copy(key->begin(), key->end(), out + size);
+            size += key->size();
+            Mask(data, out + size, length, *key);
+        } else if (length > 0) {
+            std::memcpy(out + size, data, length);
+        }
+        output.resize(start + size + length);
+    }
+
+    FrameReader::FrameReader(std::size_t max_frame_size) : max_frame_size_(max_frame_size) {}
+
+    auto FrameReader::Prepare(std::size_t min_size) -> std::span<unsigned char> {
+        // The unread bytes move to the front, and a frame that's larger than
+        // the buffer grows it, once, to fit the whole frame
+        if (begin_ > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+            end_ -= begin_;
+            begin_ = 0;
+        }
+
+        const auto required = std::max(end_ + min_size, pending_);
+        if (buffer_.size() < required) buffer_.resize(std::max(required, buffer_.size() * 2));
+        return std::span {buffer_}.subspan(end_);
+    }
+
+    auto FrameReader::Commit(std::size_t size) -> void {
+        end_ += size;
+    }
+
+    auto FrameReader::Next(Frame& frame, std::error_code& ec) -> bool {
+        const auto available = std::span {buffer_}.subspan(begin_, end_ - begin_);
+        if (!ParseFrameHeader(available, frame.header, ec)) return false;
+
+        if (frame.header.payload_size > max_frame_size_) {
+            ec = ErrorCode::kMessageTooLarge;
+            return false;
+        }
+
+        const auto size = frame.header.size + static_cast<std::size_t>(frame.header.payload_size);
+        if (available.size() < size) {
+            pending_ = size;
+            return false;
+        }
+
+        frame.payload = available.subspan(frame.header.size, static_cast<std::size_t>(frame.header.payload_size));
+        if (frame.header.masked) Mask(frame.payload.data(), frame.payload.size(), frame.header.key);
+
+        begin_ += size;
+        pending_ = 0;
+        if (begin_ == end_) begin_ = end_ = 0;
+        return true;
+    }
+}
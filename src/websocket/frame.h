@@ -0,0 +1,117 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "websocket/mask.h"
+
+namespace Express::Ws {
+    enum class Opcode : unsigned char {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xA
+    };
+
+    // Two bytes, an extended length of up to eight, and a masking key
+    constexpr std::size_t kMaxHeaderSize = 14;
+
+    // Control frames are never fragmented, and carry at most 125 bytes
+    constexpr std::size_t kMaxControlPayload = 125;
+
+    [[nodiscard]] constexpr auto IsControl(Opcode opcode) {
+        return (static_cast<unsigned char>(opcode) & 0x8) != 0;
+    }
+
+    struct FrameHeader {
+        bool fin {true};
+
+        // RSV1, which permessage-deflate sets on the first frame of a
+        // compressed message
+        bool compressed {false};
+
+        Opcode opcode {Opcode::kText};
+        bool masked {false};
+        MaskingKey key {};
+        std::uint64_t payload_size {0};
+
+        // The size of the header itself
+        std::size_t size {0};
+    };
+
+    /*
+        Parses the header at the start of the data. Returns false when more
+        data is needed. Reserved bits and opcodes, and control frames that
+        are fragmented or too large, are reported as
+        ErrorCode::kWebSocketProtocolError.
+    */
+    [[nodiscard]] auto ParseFrameHeader(
+        std::span<const unsigned char> data,
+        FrameHeader& header,
+        std::error_code& ec
+    ) -> bool;
+
+    /*
+        Appends a frame to the output. The payload is masked as it's copied
+        when there's a key, which clients always send, so it's only copied
+        once.
+    */
+    auto WriteFrame(
+        Opcode opcode,
+        std::string_view payload,
+        bool fin,
+        bool compressed,
+        const std::optional<MaskingKey>& key,
+        std::string& output
+    ) -> void;
+
+    struct Frame {
+        FrameHeader header;
+        std::span<unsigned char> payload;
+    };
+
+    /*
+        Reads frames from a buffer that the socket receives into directly.
+        The payload of a frame is unmasked where it is, and a frame is only
+        moved when a part of it is left at the end of the buffer, so that
+        the rest of it fits.
+    */
+    class FrameReader {
+    public:
+        // Larger frames are reported as ErrorCode::kMessageTooLarge
+        explicit FrameReader(std::size_t max_frame_size);
+
+        // Space for at least min_size more bytes. The payloads returned by
+        // Next are only valid until it's called again.
+        [[nodiscard]] auto Prepare(std::size_t min_size) -> std::span<unsigned char>;
+
+        // The number of bytes that were received into the prepared space
+        auto Commit(std::size_t size) -> void;
+
+        // Takes the next frame, if it was received completely
+        [[nodiscard]] auto Next(Frame& frame, std::error_code& ec) -> bool;
+
+        // The bytes received that no frame has taken yet
+        [[nodiscard]] auto buffered() const { return end_ - begin_; }
+
+    private:
+        std::size_t max_frame_size_;
+        std::vector<unsigned char> buffer_;
+        std::size_t begin_ {0};
+        std::size_t end_ {0};
+
+        // The size of the frame that's being received, once its header is
+        std::size_t pending_ {0};
+    };
+}
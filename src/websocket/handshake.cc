@@ -0,0 +1,127 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "websocket/handshake.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+#include "express/error_code.h"
+#include "http/validators.h"
+#include "utils/sha1.h"
+#include "utils/string_transformers.h"
+
+namespace Express::Ws {
+    namespace {
+        constexpr std::string_view kAcceptGuid {"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"};
+
+        auto Find(const Headers& headers, std::string_view key) -> std::string_view {
+            const auto header = std::find_if(headers.begin(), headers.end(), [key](const auto& field) {
+                return field.first == key;
+            });
+            return header == headers.end() ? std::string_view {} : std::string_view {header->second.second};
+        }
+
+        // Whether the comma separated list has the token
+        auto HasToken(std::string_view list, std::string_view token) -> bool {
+            while (!list.empty()) {
+                const auto comma = list.find(',');
+                auto item = list.substr(0, comma);
+                list = comma == std::string_view::npos ? std::string_view {} : list.substr(comma + 1);
+
+                const auto begin = item.find_first_not_of(" \t");
+                if (begin == std::string_view::npos) continue;
+                item = item.substr(begin, item.find_last_not_of(" \t") - begin + 1);
+                if (StringTransformers::EqualsIgnoreCase(item, token)) return true;
+            }
+            return false;
+        }
+    }
+
+    auto MakeKey() -> std::string {
+        thread_local std::mt19937 engine {std::random_device {}()};
+        std::uniform_int_distribution<int> byte {0, 255};
+
+        std::array<char, 16> nonce {};
+        for (auto& value : nonce) value = static_cast<char>(byte(engine));
+        return StringTransformers::Base64Encoding({nonce.data(), nonce.size()});
+    }
+
+    auto AcceptKey(std::string_view key) -> std::string {
+        std::string value {key};
+        value.append(kAcceptGuid);
+        const auto digest = Sha1(value);
+        return StringTransformers::Base64Encoding({reinterpret_cast<const char*>(digest.data()), digest.size()});
+    }
+
+    auto UpgradeUrl(std::string_view url) -> std::string {
+        using StringTransformers::EqualsIgnoreCase;
+
+        if (url.size() >= 5 && EqualsIgnoreCase(url.substr(0, 5), "ws://")) {
+            return std::string {"http://"}.append(url.substr(5));
+        }
+        if (url.size() >= 6 && EqualsIgnoreCase(url.substr(0, 6), "wss://")) {
+            return std::string {"https://"}.append(url.substr(6));
+        }
+        return std::string {url};
+    }
+
+    auto AddUpgradeHeaders(
+        Headers& headers,
+        std::string_view key,
+        const WebSocketOptions& options
+    ) -> std::error_code {
+        std::string protocols;
+        for (const auto& protocol : options.protocols) {
+            if (protocol.empty() || !Http::Validators::IsTokenRange(protocol)) {
+                return ErrorCode::kInvalidHeaderValue;
+            }
+            if (!protocols.empty()) protocols.append(", ");
+            protocols.append(protocol);
+        }
+
+        // The request's Connection header replaces the one the request
+        // builder adds, which would close the connection
+        const auto add = [&headers](const std::string& name, std::string value) {
+            if (!headers.Contains(name)) headers.Add(name, std::move(value));
+        };
+        add("Upgrade", "websocket");
+        add("Connection", "Upgrade");
+        add("Sec-WebSocket-Version", "13");
+        add("Sec-WebSocket-Key", std::string {key});
+        if (!protocols.empty()) add("Sec-WebSocket-Protocol", protocols);
+        if (options.deflate && DeflateSupported()) add("Sec-WebSocket-Extensions", std::string {kDeflateOffer});
+        return {};
+    }
+
+    auto CheckUpgrade(
+        int status_code,
+        const Headers& headers,
+        std::string_view key,
+        const WebSocketOptions& options,
+        Handshake& handshake
+    ) -> std::error_code {
+        using StringTransformers::EqualsIgnoreCase;
+
+        if (status_code != 101 ||
+            !EqualsIgnoreCase(Find(headers, "upgrade"), "websocket") ||
+            !HasToken(Find(headers, "connection"), "upgrade") ||
+            Find(headers, "sec-websocket-accept") != AcceptKey(key)) {
+            return ErrorCode::kHandshakeFailed;
+        }
+
+        const auto protocol = Find(headers, "sec-websocket-protocol");
+        if (!protocol.empty() &&
+            std::find(options.protocols.begin(), options.protocols.end(), protocol) == options.protocols.end()) {
+            return ErrorCode::kHandshakeFailed;
+        }
+        handshake.protocol = protocol;
+
+        if (auto ec = ParseExtensions(Find(headers, "sec-websocket-extensions"), handshake.deflate, handshake.parameters)) {
+            return ec;
+        }
+        if (handshake.deflate && (!options.deflate || !DeflateSupported())) return ErrorCode::kHandshakeFailed;
+        return {};
+    }
+}
@@ -0,0 +1,55 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "express/headers.h"
+#include "express/websocket.h"
+
+#include "websocket/deflate.h"
+
+namespace Express::Ws {
+    // What the server agreed to in its 101 response
+    struct Handshake {
+        std::string protocol;
+        bool deflate {false};
+        DeflateParameters parameters {};
+    };
+
+    // A random Sec-WebSocket-Key
+    [[nodiscard]] auto MakeKey() -> std::string;
+
+    // The Sec-WebSocket-Accept value a server answers the key with
+    [[nodiscard]] auto AcceptKey(std::string_view key) -> std::string;
+
+    /*
+        The URL of the upgrade request. ws and wss URLs are requested as
+        http and https, which the request stack speaks, and other URLs are
+        left as they are.
+    */
+    [[nodiscard]] auto UpgradeUrl(std::string_view url) -> std::string;
+
+    // Adds the headers of the upgrade request, unless the user set them
+    auto AddUpgradeHeaders(
+        Headers& headers,
+        std::string_view key,
+        const WebSocketOptions& options
+    ) -> std::error_code;
+
+    /*
+        Checks that the server switched to the WebSocket protocol, with an
+        accept value for the key, and with a subprotocol and extension that
+        the client offered. Anything else is ErrorCode::kHandshakeFailed.
+    */
+    auto CheckUpgrade(
+        int status_code,
+        const Headers& headers,
+        std::string_view key,
+        const WebSocketOptions& options,
+        Handshake& handshake
+    ) -> std::error_code;
+}
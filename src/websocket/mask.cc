@@ -0,0 +1,76 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "websocket/mask.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define EXPRESS_MASK_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #define EXPRESS_MASK_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace Express::Ws {
+    auto Mask(
+        const unsigned char* src,
+        unsigned char* dst,
+        std::size_t size,
+        const MaskingKey& key,
+        std::size_t offset
+    ) -> void {
+        // The key is rotated so that it starts at src, and then it repeats
+        // every 4 bytes, which lines up with every register width
+        const unsigned char rotated[4] {
+            key[offset % 4], key[(offset + 1) % 4], key[(offset + 2) % 4], key[(offset + 3) % 4]
+        };
+        std::uint32_t word = 0;
+        std::memcpy(&word, rotated, sizeof(word));
+
+        std::size_t i = 0;
+        #if defined(__AVX2__)
+            const auto mask = _mm256_set1_epi32(static_cast<int>(word));
+            for (; i + 32 <= size; i += 32) {
+                const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(block, mask));
+            }
+        #elif defined(EXPRESS_MASK_SSE2)
+            const auto mask = _mm_set1_epi32(static_cast<int>(word));
+            for (; i + 16 <= size; i += 16) {
+                const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(block, mask));
+            }
+        #elif defined(EXPRESS_MASK_NEON)
+            const auto mask = vreinterpretq_u8_u32(vdupq_n_u32(word));
+            for (; i + 16 <= size; i += 16) {
+                vst1q_u8(dst + i, veorq_u8(vld1q_u8(src + i), mask));
+            }
+        #endif
+
+        // What's left, or all of it without vector instructions, is
+        // processed a word at a time
+        const auto wide = static_cast<std::uint64_t>(word) << 32 | word;
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t block = 0;
+            std::memcpy(&block, src + i, sizeof(block));
+            block ^= wide;
+            std::memcpy(dst + i, &block, sizeof(block));
+        }
+        for (; i < size; ++i) dst[i] = src[i] ^ rotated[i % 4];
+    }
+
+    auto MaskBytewise(
+        const unsigned char* src,
+        unsigned char* dst,
+        std::size_t size,
+        const MaskingKey& key,
+        std::size_t offset
+    ) -> void {
+        for (std::size_t i = 0; i < size; ++i) dst[i] = src[i] ^ key[(offset + i) % 4];
+    }
+}
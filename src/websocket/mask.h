@@ -0,0 +1,39 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace Express::Ws {
+    using MaskingKey = std::array<unsigned char, 4>;
+
+    /*
+        XORs the payload with the masking key, which masks it and unmasks it
+        alike. The offset is the position of src in the payload, so a payload
+        can be masked in pieces. Whole vector registers are processed at a
+        time (16 bytes with SSE2 or NEON, 32 with AVX2), and src and dst may
+        be the same buffer.
+    */
+    auto Mask(
+        const unsigned char* src,
+        unsigned char* dst,
+        std::size_t size,
+        const MaskingKey& key,
+        std::size_t offset = 0
+    ) -> void;
+
+    inline auto Mask(unsigned char* data, std::size_t size, const MaskingKey& key, std::size_t offset = 0) -> void {
+        Mask(data, data, size, key, offset);
+    }
+
+    // A byte at a time, for comparison with the vectorized version
+    auto MaskBytewise(
+        const unsigned char* src,
+        unsigned char* dst,
+        std::size_t size,
+        const MaskingKey& key,
+        std::size_t offset = 0
+    ) -> void;
+}
@@ -0,0 +1,135 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/breaker.h"
+
+#include <chrono>
+#include <system_error>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "express/error_code.h"
+
+using namespace std::chrono_literals;
+
+using Express::BreakerState;
+using Express::CircuitBreakers;
+using Admission = CircuitBreakers::Admission;
+using Outcome = CircuitBreakers::Outcome;
+
+class Breaker : public ::testing::Test {
+protected:
+    CircuitBreakers breakers;
+    CircuitBreakers::Clock::time_point now {1h};
+    std::vector<std::pair<BreakerState, BreakerState>> transitions;
+
+    Express::BreakerPolicy policy {
+        .failure_rate = 0.5,
+        .min_requests = 4,
+        .window = 10s,
+        .open_duration = 5s,
+        .probes = 2,
+        .on_state_change = [this](std::string_view, BreakerState from, BreakerState to) {
+            transitions.emplace_back(from, to);
+        }
+    };
+
+    auto Send(Outcome outcome) {
+        const auto admission = breakers.Admit(policy, "host:80", now);
+        if (admission != Admission::kRejected) {
+            breakers.Record(policy, "host:80", admission, outcome, now);
+        }
+        return admission;
+    }
+
+    auto Open() {
+        for (auto i = 0; i < 4; ++i) Send(Outcome::kFailure);
+    }
+};
+
+TEST_F(Breaker, OpensWhenFailureRateIsReached) {
+    Send(Outcome::kSuccess);
+    Send(Outcome::kSuccess);
+    Send(Outcome::kFailure);
+    EXPECT_EQ(breakers.state("host:80"), BreakerState::Closed);
+
+    Send(Outcome::kFailure);
+    EXPECT_EQ(breakers.state("host:80"), BreakerState::Open);
+    EXPECT_EQ(Send(Outcome::kSuccess), Admission::kRejected);
+    EXPECT_EQ(breakers.state("other:80"), BreakerState::Closed);
+
+    ASSERT_EQ(transitions.size(), 1);
+    EXPECT_EQ(transitions[0], std::pair(BreakerState::Closed, BreakerState::Open));
+}
+
+TEST_F(Breaker, ForgetsFailuresOutsideWindow) {
+    Send(Outcome::kFailure);
+    Send(Outcome::kFailure);
+    Send(Outcome::kFailure);
+
+    now += 11s;
+    Send(Outcome::kFailure);
+    Send(Outcome::kSuccess);
+    EXPECT_EQ(breakers.state("host:80"), BreakerState::Closed);
+}
+
+TEST_F(Breaker, ClosesWhenProbesSucceed) {
+    Open();
+    now += 5s;
+
+    EXPECT_EQ(breakers.Admit(policy, "host:80", now), Admission::kProbe);
+    EXPECT_EQ(breakers.Admit(policy, "host:80", now), Admission::kProbe);
+    EXPECT_EQ(breakers.Admit(policy, "host:80", now), Admission::kRejected);
+    EXPECT_EQ(breakers.state("host:80"), BreakerState::HalfOpen);
+
+    breakers.Record(policy, "host:80", Admission::kProbe, Outcome::kSuccess, now);
+    EXPECT_EQ(breakers.state("host:80"), BreakerState::HalfOpen);
+    breakers.Record(policy, "host:80", Admission::kProbe, Outcome::kSuccess, now);
+    EXPECT_EQ(breakers.state("host:80"), BreakerState::Closed);
+
+    ASSERT_EQ(transitions.size(), 3);
+    EXPECT_EQ(transitions[1], std::pair(BreakerState::Open, BreakerState::HalfOpen));
+    EXPECT_EQ(transitions[2], std::pair(BreakerState::HalfOpen, BreakerState::Closed));
+}
+
+TEST_F(Breaker, ReopensWhenProbeFails) {
+    Open();
+    now += 5s;
+
+    EXPECT_EQ(Send(Outcome::kFailure), Admission::kProbe);
+    EXPECT_EQ(breakers.state("host:80"), BreakerState::Open);
+
+    now += 4s;
+    EXPECT_EQ(Send(Outcome::kSuccess), Admission::kRejected);
+}
+
+TEST_F(Breaker, ReleasesProbeWhenOutcomeIsIgnored) {
+    Open();
+    now += 5s;
+
+    EXPECT_EQ(breakers.Admit(policy, "host:80", now), Admission::kProbe);
+    EXPECT_EQ(breakers.Admit(policy, "host:80", now), Admission::kProbe);
+    breakers.Record(policy, "host:80", Admission::kProbe, Outcome::kIgnored, now);
+    EXPECT_EQ(breakers.Admit(policy, "host:80", now), Admission::kProbe);
+}
+
+TEST(BreakerOutcome, CountsServerFailures) {
+    using Express::Classify;
+    using Express::ErrorCode;
+    using Express::Unexpected;
+    const Express::BreakerPolicy policy {.failure_rate = 0.5, .slow_request = 100ms};
+
+    const Express::Response ok {.status_code = 200};
+    const Express::Response unavailable {.status_code = 503};
+
+    EXPECT_EQ(Classify(policy, ok, 10ms), Outcome::kSuccess);
+    EXPECT_EQ(Classify(policy, ok, 200ms), Outcome::kFailure);
+    EXPECT_EQ(Classify(policy, unavailable, 10ms), Outcome::kFailure);
+    EXPECT_EQ(Classify(policy, Unexpected {make_error_code(ErrorCode::kConnectTimeout)}, 10ms), Outcome::kFailure);
+    EXPECT_EQ(Classify(policy, Unexpected {make_error_code(ErrorCode::kQueueFull)}, 10ms), Outcome::kIgnored);
+    EXPECT_EQ(
+        Classify(policy, Unexpected {std::make_error_code(std::errc::operation_canceled)}, 10ms),
+        Outcome::kIgnored
+    );
+}
@@ -0,0 +1,327 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/cache.h"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+#include "express/executor.h"
+
+#include "client/caching.h"
+#include "net/event_loop.h"
+
+using namespace std::chrono_literals;
+
+using Express::CachedResponse;
+using Express::Freshness;
+
+namespace {
+    const auto kNow = std::chrono::system_clock::time_point {1700000000s};
+
+    // "Tue, 14 Nov 2023 22:13:20 GMT" is kNow
+    auto Stored(std::vector<Express::string_pair> headers, std::chrono::seconds age = 0s) {
+        auto response = Express::Response {.status_code = 200, .status_text = "OK", .data = "body"};
+        for (const auto& [name, value] : headers) response.headers.Add(name, value);
+        return CachedResponse {
+            .response = std::move(response),
+            .request_time = kNow - age,
+            .response_time = kNow - age
+        };
+    }
+
+    auto Entry(std::size_t size) {
+        return CachedResponse {.response = {.status_code = 200, .data = std::string(size, 'x')}};
+    }
+
+    class SharedMemoryCache : public Express::MemoryCache {
+    public:
+        using MemoryCache::MemoryCache;
+
+        [[nodiscard]] auto shared() const -> bool override { return true; }
+    };
+
+    // A shared cache whose fill lease is held elsewhere for the first claims
+    class LeasingCache : public SharedMemoryCache {
+    public:
+        using SharedMemoryCache::SharedMemoryCache;
+
+        int busy {0};
+        int claims {0};
+        bool held {false};
+
+        [[nodiscard]] auto ClaimFill(std::string_view) -> bool override {
+            ++claims;
+            if (busy > 0) {
+                --busy;
+                return false;
+            }
+            held = true;
+            return true;
+        }
+
+        auto ReleaseFill(std::string_view) -> void override { held = false; }
+    };
+
+    auto Fetch(const Express::Config& config, auto send) {
+        auto loop = std::make_shared<Express::Net::EventLoop>();
+        return Express::SyncWait(Express::CachedAsync(
+            config, loop, std::make_shared<Express::InlineExecutor>(), std::move(send)
+        ));
+    }
+}
+
+TEST(MemoryCache, EvictsLeastRecentlyUsedEntries) {
+    const auto size = sizeof(CachedResponse) + 100 + 1;
+    Express::MemoryCache cache {size * 2};
+
+    cache.Store("a", Entry(100));
+    cache.Store("b", Entry(100));
+    EXPECT_TRUE(cache.Find("a").has_value());
+
+    cache.Store("c", Entry(100));
+    EXPECT_TRUE(cache.Find("a").has_value());
+    EXPECT_FALSE(cache.Find("b").has_value());
+    EXPECT_TRUE(cache.Find("c").has_value());
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.entries, 2);
+    EXPECT_EQ(stats.bytes, size * 2);
+    EXPECT_EQ(stats.evictions, 1);
+}
+
+TEST(MemoryCache, SkipsEntriesLargerThanCache) {
+    Express::MemoryCache cache {1024};
+
+    cache.Store("a", Entry(10));
+    cache.Store("b", Entry(2048));
+
+    EXPECT_TRUE(cache.Find("a").has_value());
+    EXPECT_FALSE(cache.Find("b").has_value());
+}
+
+TEST(MemoryCache, ReplacesAndRemovesEntries) {
+    Express::MemoryCache cache {4096};
+
+    cache.Store("a", Entry(10));
+    cache.Store("a", Entry(20));
+    EXPECT_EQ(cache.Find("a")->response.data.size(), 20);
+    EXPECT_EQ(cache.stats().entries, 1);
+
+    cache.Remove("a");
+    EXPECT_FALSE(cache.Find("a").has_value());
+    EXPECT_EQ(cache.stats().bytes, 0);
+}
+
+TEST(Caching, AssessesFreshnessFromMaxAge) {
+    const Express::Config config {.url = "http://host"};
+    const auto entry = Stored({{"Cache-Control", "max-age=60, stale-while-revalidate=30"}});
+
+    EXPECT_EQ(Express::Assess(entry, config, kNow + 59s), Freshness::kFresh);
+    EXPECT_EQ(Express::Assess(entry, config, kNow + 80s), Freshness::kStaleWhileRevalidate);
+    EXPECT_EQ(Express::Assess(entry, config, kNow + 91s), Freshness::kStale);
+}
+
+TEST(Caching, AssessesFreshnessFromExpiresAndAge) {
+    const Express::Config config {.url = "http://host"};
+    const auto expires = Stored({
+        {"Date", "Tue, 14 Nov 2023 22:13:20 GMT"},
+        {"Expires", "Tue, 14 Nov 2023 22:14:20 GMT"}
+    });
+    const auto aged = Stored({{"Cache-Control", "max-age=60"}, {"Age", "50"}});
+
+    EXPECT_EQ(Express::Assess(expires, config, kNow + 30s), Freshness::kFresh);
+    EXPECT_EQ(Express::Assess(expires, config, kNow + 60s), Freshness::kStale);
+    EXPECT_EQ(Express::Assess(aged, config, kNow + 5s), Freshness::kFresh);
+    EXPECT_EQ(Express::Assess(aged, config, kNow + 10s), Freshness::kStale);
+}
+
+TEST(Caching, AssessesFreshnessFromOversizedDeltaSeconds) {
+    const Express::Config config {.url = "http://host"};
+    const auto forever = Stored({{"Cache-Control", "max-age=10000000000"}});
+    const auto aged = Stored({{"Cache-Control", "max-age=10000000000"}, {"Age", "99999999999999999999"}});
+
+    EXPECT_EQ(Express::Assess(forever, config, kNow + 24h * 365 * 10), Freshness::kFresh);
+    EXPECT_EQ(Express::Assess(aged, config, kNow), Freshness::kStale);
+}
+
+TEST(Caching, HonoursRequestDirectives) {
+    const auto entry = Stored({{"Cache-Control", "max-age=60"}}, 20s);
+
+    EXPECT_EQ(Express::Assess(entry, {.url = "http://host"}, kNow), Freshness::kFresh);
+    EXPECT_EQ(
+        Express::Assess(entry, {.url = "http://host", .headers = {{{"Cache-Control", "max-age=10"}}}}, kNow),
+        Freshness::kStale
+    );
+    EXPECT_EQ(
+        Express::Assess(entry, {.url = "http://host", .headers = {{{"Cache-Control", "no-cache"}}}}, kNow),
+        Freshness::kStale
+    );
+}
+
+TEST(Caching, ServesStaleResponsesOnError) {
+    const Express::Config config {.url = "http://host"};
+
+    EXPECT_TRUE(Express::IsUsableOnError(Stored({{"Cache-Control", "max-age=60, stale-if-error=60"}}), config, kNow + 100s));
+    EXPECT_FALSE(Express::IsUsableOnError(Stored({{"Cache-Control", "max-age=60, stale-if-error=60"}}), config, kNow + 130s));
+    EXPECT_FALSE(Express::IsUsableOnError(Stored({{"Cache-Control", "max-age=60"}}), config, kNow + 100s));
+    EXPECT_FALSE(Express::IsUsableOnError(
+        Stored({{"Cache-Control", "max-age=60, stale-if-error=60, must-revalidate"}}),
+        config,
+        kNow + 100s
+    ));
+}
+
+TEST(Caching, DecidesWhatIsStorable) {
+    const Express::Config config {.url = "http://host"};
+    auto response = [](int status_code, std::string cache_control) {
+        Express::Response response {.status_code = status_code};
+        if (!cache_control.empty()) response.headers.Add("Cache-Control", cache_control);
+        return response;
+    };
+
+    EXPECT_TRUE(Express::IsStorable(config, response(200, "")));
+    EXPECT_TRUE(Express::IsStorable(config, response(200, "no-cache")));
+    EXPECT_TRUE(Express::IsStorable(config, response(302, "max-age=60")));
+    EXPECT_FALSE(Express::IsStorable(config, response(302, "")));
+    EXPECT_FALSE(Express::IsStorable(config, response(200, "no-store")));
+    EXPECT_FALSE(Express::IsStorable(
+        {.url = "http://host", .headers = {{{"Cache-Control", "no-store"}}}},
+        response(200, "max-age=60")
+    ));
+}
+
+TEST(Caching, MatchesVaryingHeaders) {
+    auto response = Express::Response {.status_code = 200};
+    response.headers.Add("Vary", "Accept, Accept-Language");
+
+    const auto entry = Express::MakeEntry(
+        {.url = "http://host", .headers = {{{"Accept", "application/json"}}}},
+        response,
+        kNow,
+        kNow
+    );
+
+    EXPECT_TRUE(Express::Matches(entry, {.url = "http://host", .headers = {{{"Accept", "application/json"}}}}));
+    EXPECT_FALSE(Express::Matches(entry, {.url = "http://host", .headers = {{{"Accept", "text/html"}}}}));
+    EXPECT_FALSE(Express::Matches(entry, {
+        .url = "http://host",
+        .headers = {{{"Accept", "application/json"}, {"Accept-Language", "en"}}}
+    }));
+}
+
+TEST(Caching, StoresAuthenticatedResponsesOnlyWhenAllowed) {
+    const Express::Config config {.url = "http://host", .auth = {.username = "aladdin", .password = "opensesame"}};
+    auto response = [](std::string cache_control) {
+        Express::Response response {.status_code = 200};
+        response.headers.Add("Cache-Control", cache_control);
+        return response;
+    };
+
+    EXPECT_FALSE(Express::IsStorable(config, response("max-age=60")));
+    EXPECT_FALSE(Express::IsStorable(
+        {.url = "http://host", .headers = {{{"Authorization", "Bearer token"}}}},
+        response("max-age=60")
+    ));
+    EXPECT_TRUE(Express::IsStorable(config, response("public, max-age=60")));
+    EXPECT_TRUE(Express::IsStorable(config, response("s-maxage=60")));
+    EXPECT_TRUE(Express::IsStorable(config, response("max-age=60, must-revalidate")));
+}
+
+TEST(Caching, FollowsSharedCacheRules) {
+    const Express::Config private_cache {.url = "http://host", .cache = std::make_shared<Express::MemoryCache>(1024)};
+    const Express::Config shared_cache {.url = "http://host", .cache = std::make_shared<SharedMemoryCache>(1024)};
+
+    Express::Response response {.status_code = 200};
+    response.headers.Add("Cache-Control", "private, max-age=60");
+    EXPECT_TRUE(Express::IsStorable(private_cache, response));
+    EXPECT_FALSE(Express::IsStorable(shared_cache, response));
+
+    // s-maxage replaces max-age, and the response can't be served stale
+    const auto entry = Stored({{"Cache-Control", "max-age=60, s-maxage=10, stale-while-revalidate=60"}}, 30s);
+    EXPECT_EQ(Express::Assess(entry, private_cache, kNow), Freshness::kFresh);
+    EXPECT_EQ(Express::Assess(entry, shared_cache, kNow), Freshness::kStale);
+}
+
+TEST(Caching, MatchesVaryingCredentials) {
+    auto response = Express::Response {.status_code = 200};
+    response.headers.Add("Vary", "Authorization");
+
+    const Express::Config aladdin {.url = "http://host", .auth = {.username = "aladdin", .password = "opensesame"}};
+    const auto entry = Express::MakeEntry(aladdin, response, kNow, kNow);
+
+    EXPECT_TRUE(Express::Matches(entry, aladdin));
+    EXPECT_FALSE(Express::Matches(entry, {.url = "http://host", .auth = {.username = "jasmine", .password = "rajah"}}));
+    EXPECT_FALSE(Express::Matches(entry, {.url = "http://host"}));
+}
+
+TEST(Caching, RevalidatesWithValidators) {
+    const auto entry = Stored({
+        {"Cache-Control", "no-cache"},
+        {"ETag", "\"v1\""},
+        {"Last-Modified", "Tue, 14 Nov 2023 22:13:20 GMT"}
+    }, 120s);
+
+    auto conditional = Express::MakeConditional({.url = "http://host"}, entry);
+    EXPECT_EQ(conditional.headers.Get("If-None-Match"), "\"v1\"");
+    EXPECT_EQ(conditional.headers.Get("If-Modified-Since"), "Tue, 14 Nov 2023 22:13:20 GMT");
+
+    auto not_modified = Express::Response {.status_code = 304};
+    not_modified.headers.Add("ETag", "\"v2\"");
+    auto refreshed = Express::Refresh(entry, not_modified, kNow, kNow);
+
+    EXPECT_EQ(refreshed.response.status_code, 200);
+    EXPECT_EQ(refreshed.response.data, "body");
+    EXPECT_EQ(refreshed.response.headers.Get("ETag"), "\"v2\"");
+    EXPECT_EQ(refreshed.response_time, kNow);
+}
+
+TEST(Caching, ReleasesFillLeaseWhenFetchThrows) {
+    auto cache = std::make_shared<LeasingCache>(4096);
+
+    auto send = [](const Express::Config&) -> Express::Task<Express::Expected<Express::Response>> {
+        throw std::runtime_error {"send failed"};
+        co_return Express::Response {};
+    };
+    EXPECT_THROW(Fetch({.url = "http://host", .cache = cache}, send), std::runtime_error);
+    EXPECT_EQ(cache->claims, 1);
+    EXPECT_FALSE(cache->held);
+}
+
+TEST(Caching, SkipsFillLeaseForRequestsTheCacheCantServe) {
+    auto cache = std::make_shared<LeasingCache>(4096);
+    cache->busy = 1;
+
+    auto result = Fetch(
+        {.url = "http://host", .headers = {{{"Cache-Control", "no-cache"}}}, .cache = cache},
+        [](const Express::Config&) -> Express::Task<Express::Expected<Express::Response>> {
+            co_return Express::Response {.status_code = 200};
+        }
+    );
+    ASSERT_TRUE(result);
+    EXPECT_EQ(cache->claims, 0);
+}
+
+TEST(Caching, StopsWaitingWhenFillEndsWithoutResponse) {
+    auto cache = std::make_shared<LeasingCache>(4096);
+    cache->busy = 1;
+
+    // The lease was released without a stored response, so the request
+    // doesn't hold off the others while it fetches its own
+    auto holding = true;
+    auto result = Fetch(
+        {.url = "http://host", .cache = cache},
+        [&](const Express::Config&) -> Express::Task<Express::Expected<Express::Response>> {
+            holding = cache->held;
+            co_return Express::Response {.status_code = 200};
+        }
+    );
+    ASSERT_TRUE(result);
+    EXPECT_EQ(cache->claims, 2);
+    EXPECT_FALSE(holding);
+}
@@ -0,0 +1,198 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/coalesce.h"
+
+#include <array>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using Express::Expected;
+using Express::Flight;
+using Express::Response;
+
+namespace {
+    auto Wait(std::shared_ptr<Flight> flight, std::stop_token stop) -> Express::Task<Expected<Response>> {
+        co_return co_await flight->Result(std::move(stop));
+    }
+
+    // Waits for the gate, and then records what the config refers to
+    auto Send(
+        std::shared_ptr<Flight> gate,
+        Express::Config config,
+        std::vector<std::string>& sent
+    ) -> Express::Task<Expected<Response>> {
+        co_await gate->Result({});
+        sent = {
+            std::string {config.routing_key},
+            std::string {config.coalesce.vary.front()},
+            std::to_string(config.retry.status_codes.front())
+        };
+        co_return Response {.status_code = 200};
+    }
+
+    struct Waiters {
+        std::vector<Expected<Response>> results;
+
+        auto Join(std::shared_ptr<Flight> flight, std::stop_token stop = {}) {
+            Express::Detail::Complete(Wait(std::move(flight), std::move(stop)),
+                [this](Expected<Response> result) { results.push_back(std::move(result)); }
+            );
+        }
+    };
+}
+
+TEST(Coalesce, KeysOnMethodUrlAndVaryHeaders) {
+    constexpr std::array<std::string_view, 1> vary {"Accept"};
+    const Express::Config json {
+        .url = "http://host/items",
+        .headers = {{{"Accept", "application/json"}, {"X-Trace", "1"}}},
+        .coalesce = {.enabled = true, .vary = vary}
+    };
+    const Express::Config traced {
+        .url = "http://host/items",
+        .headers = {{{"Accept", "application/json"}, {"X-Trace", "2"}}},
+        .coalesce = {.enabled = true, .vary = vary}
+    };
+    const Express::Config xml {
+        .url = "http://host/items",
+        .headers = {{{"Accept", "application/xml"}}},
+        .coalesce = {.enabled = true, .vary = vary}
+    };
+    const Express::Config head {
+        .url = "http://host/items",
+        .method = Express::Method::Head,
+        .headers = {{{"Accept", "application/json"}}},
+        .coalesce = {.enabled = true, .vary = vary}
+    };
+
+    EXPECT_EQ(Express::CoalesceKey(json), Express::CoalesceKey(traced));
+    EXPECT_NE(Express::CoalesceKey(json), Express::CoalesceKey(xml));
+    EXPECT_NE(Express::CoalesceKey(json), Express::CoalesceKey(head));
+}
+
+TEST(Coalesce, KeysRequestsByCredentials) {
+    const Express::Config aladdin {
+        .url = "http://host/items",
+        .auth = {.username = "aladdin", .password = "opensesame"},
+        .coalesce = {.enabled = true}
+    };
+    const Express::Config jasmine {
+        .url = "http://host/items",
+        .auth = {.username = "jasmine", .password = "rajah"},
+        .coalesce = {.enabled = true}
+    };
+    const Express::Config token {
+        .url = "http://host/items",
+        .headers = {{{"Authorization", "Bearer token"}}},
+        .coalesce = {.enabled = true}
+    };
+    const Express::Config cookie {
+        .url = "http://host/items",
+        .headers = {{{"Cookie", "session=1"}}},
+        .coalesce = {.enabled = true}
+    };
+    const Express::Config anonymous {.url = "http://host/items", .coalesce = {.enabled = true}};
+
+    EXPECT_NE(Express::CoalesceKey(aladdin), Express::CoalesceKey(jasmine));
+    EXPECT_NE(Express::CoalesceKey(aladdin), Express::CoalesceKey(anonymous));
+    EXPECT_NE(Express::CoalesceKey(token), Express::CoalesceKey(anonymous));
+    EXPECT_NE(Express::CoalesceKey(cookie), Express::CoalesceKey(anonymous));
+}
+
+TEST(Coalesce, AppliesToGetAndHeadRequests) {
+    EXPECT_TRUE(Express::IsCoalesced({.url = "http://host", .coalesce = {.enabled = true}}));
+    EXPECT_FALSE(Express::IsCoalesced({.url = "http://host"}));
+    EXPECT_FALSE(Express::IsCoalesced({
+        .url = "http://host",
+        .method = Express::Method::Put,
+        .coalesce = {.enabled = true}
+    }));
+}
+
+TEST(Coalesce, SharesResultBetweenWaiters) {
+    Express::Coalescer coalescer;
+    Waiters waiters;
+
+    auto [flight, leader] = coalescer.Join("key");
+    EXPECT_TRUE(leader);
+    waiters.Join(flight);
+
+    auto [joined, follower] = coalescer.Join("key");
+    EXPECT_EQ(joined, flight);
+    EXPECT_FALSE(follower);
+    waiters.Join(joined);
+
+    coalescer.Land("key", flight, Response {.status_code = 200, .data = "shared"});
+
+    ASSERT_EQ(waiters.results.size(), 2);
+    for (const auto& result : waiters.results) {
+        ASSERT_TRUE(result);
+        EXPECT_EQ(result->data, "shared");
+    }
+    EXPECT_TRUE(coalescer.Join("key").second);
+}
+
+TEST(Coalesce, CancelsFlightOnceEveryWaiterLeaves) {
+    Express::Coalescer coalescer;
+    Waiters waiters;
+    std::stop_source first;
+    std::stop_source second;
+
+    auto flight = coalescer.Join("key").first;
+    waiters.Join(flight, first.get_token());
+    waiters.Join(coalescer.Join("key").first, second.get_token());
+
+    first.request_stop();
+    ASSERT_EQ(waiters.results.size(), 1);
+    EXPECT_EQ(waiters.results[0].error(), std::errc::operation_canceled);
+    EXPECT_FALSE(flight->token().stop_requested());
+
+    second.request_stop();
+    EXPECT_TRUE(flight->token().stop_requested());
+
+    // An abandoned flight isn't joined by new requests
+    EXPECT_TRUE(coalescer.Join("key").second);
+}
+
+TEST(Coalesce, SharedRequestOutlivesTheCallersConfig) {
+    auto coalescer = std::make_shared<Express::Coalescer>();
+    Express::Coalescer gates;
+    const auto gate = gates.Join("gate").first;
+
+    std::string routing_key {"user-1"};
+    std::vector<std::string_view> vary {"Accept"};
+    std::vector<int> status_codes {503};
+    std::vector<std::string> sent;
+    std::vector<Expected<Response>> results;
+
+    Express::Detail::Complete(
+        Express::CoalescedAsync(
+            {
+                .url = "http://host/items",
+                .retry = {.status_codes = status_codes},
+                .coalesce = {.enabled = true, .vary = vary},
+                .routing_key = routing_key
+            },
+            coalescer,
+            [gate, &sent](Express::Config config) { return Send(gate, std::move(config), sent); }
+        ),
+        [&results](Expected<Response> result) { results.push_back(std::move(result)); }
+    );
+
+    // The caller's storage changes while the shared request is in flight
+    routing_key = "user-2";
+    vary.front() = "Cookie";
+    status_codes.front() = 500;
+    gates.Land("gate", gate, Response {.status_code = 200});
+
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_TRUE(results[0]);
+    EXPECT_EQ(sent, (std::vector<std::string> {"user-1", "Accept", "503"}));
+}
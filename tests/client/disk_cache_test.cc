@@ -0,0 +1,200 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/cache.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+    #include <csignal>
+    #include <sys/resource.h>
+#endif
+
+using namespace std::chrono_literals;
+
+using Express::CachedResponse;
+using Express::DiskCache;
+
+namespace {
+    const auto kNow = std::chrono::system_clock::time_point {1700000000s};
+
+    auto Entry(std::string data) {
+        auto entry = CachedResponse {
+            .response = {.status_code = 200, .status_text = "OK", .data = std::move(data)},
+            .request_time = kNow - 1s,
+            .response_time = kNow,
+            .vary = {{"accept", "application/json"}}
+        };
+        entry.response.headers.Add("Cache-Control", "max-age=60");
+        return entry;
+    }
+
+    auto DiskBytes(const std::filesystem::path& directory) {
+        std::size_t bytes {0};
+        for (const auto& file : std::filesystem::directory_iterator {directory}) bytes += file.file_size();
+        return bytes;
+    }
+}
+
+class DiskCacheTest : public ::testing::Test {
+protected:
+    std::filesystem::path directory;
+
+    void SetUp() override {
+        const auto* test = ::testing::UnitTest::GetInstance()->current_test_info();
+        directory = std::filesystem::temp_directory_path() / (std::string {"express-"} + test->name());
+        std::filesystem::remove_all(directory);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+};
+
+TEST_F(DiskCacheTest, PersistsResponsesAcrossInstances) {
+    {
+        DiskCache cache {{.directory = directory}};
+        cache.Store("http://host/a", Entry("first"));
+        cache.Store("http://host/b", Entry("second"));
+        cache.Store("http://host/a", Entry("replaced"));
+        cache.Remove("http://host/b");
+    }
+
+    DiskCache cache {{.directory = directory}};
+    auto entry = cache.Find("http://host/a");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->response.status_code, 200);
+    EXPECT_EQ(entry->response.status_text, "OK");
+    EXPECT_EQ(entry->response.data, "replaced");
+    EXPECT_EQ(entry->response.headers.Get("Cache-Control"), "max-age=60");
+    EXPECT_EQ(entry->request_time, kNow - 1s);
+    EXPECT_EQ(entry->response_time, kNow);
+    ASSERT_EQ(entry->vary.size(), 1);
+    EXPECT_EQ(entry->vary[0].second, "application/json");
+
+    EXPECT_FALSE(cache.Find("http://host/b").has_value());
+    EXPECT_EQ(cache.stats().entries, 1);
+}
+
+TEST_F(DiskCacheTest, RecoversFromDamagedRecords) {
+    const Express::DiskCacheOptions options {.directory = directory, .max_bytes = 65536, .segment_bytes = 16384};
+
+    {
+        DiskCache cache {options};
+        cache.Store("a", Entry("intact"));
+        cache.Store("b", Entry("damaged"));
+    }
+
+    // Damage the body of the last record, like a write that didn't finish
+    const auto path = std::filesystem::directory_iterator {directory}->path();
+    std::string contents;
+    {
+        std::ifstream file {path, std::ios::binary};
+        contents.assign(std::istreambuf_iterator<char> {file}, {});
+    }
+    contents[contents.find("damaged")] = 'X';
+    {
+        std::ofstream file {path, std::ios::binary};
+        file << contents;
+    }
+
+    {
+        DiskCache cache {options};
+        EXPECT_TRUE(cache.Find("a").has_value());
+        EXPECT_FALSE(cache.Find("b").has_value());
+        cache.Store("c", Entry("after"));
+    }
+
+    DiskCache cache {options};
+    EXPECT_TRUE(cache.Find("a").has_value());
+    EXPECT_EQ(cache.Find("c")->response.data, "after");
+}
+
+TEST_F(DiskCacheTest, SkipsResponsesLargerThanMaxObjectSize) {
+    DiskCache cache {{.directory = directory, .max_object_bytes = 1024}};
+
+    cache.Store("a", Entry("small"));
+    cache.Store("a", Entry(std::string(2048, 'x')));
+
+    EXPECT_FALSE(cache.Find("a").has_value());
+}
+
+TEST_F(DiskCacheTest, EvictsOldestSegments) {
+    DiskCache cache {{.directory = directory, .max_bytes = 16384, .segment_bytes = 4096}};
+
+    for (auto i = 0; i < 64; ++i) cache.Store("key-" + std::to_string(i), Entry(std::string(512, 'x')));
+
+    EXPECT_FALSE(cache.Find("key-0").has_value());
+    EXPECT_TRUE(cache.Find("key-63").has_value());
+    EXPECT_GT(cache.stats().evictions, 0);
+    EXPECT_LE(DiskBytes(directory), 16384);
+}
+
+TEST_F(DiskCacheTest, LeavesRoomForTheRecordThatRolledTheSegment) {
+    const Express::DiskCacheOptions options {.directory = directory, .max_bytes = 200000, .segment_bytes = 100000};
+    {
+        DiskCache cache {options};
+
+        // Rolling for the last response compacts the first segment, whose
+        // live response would leave too little room for it
+        cache.Store("a", Entry(std::string(20000, 'a')));
+        cache.Store("a", Entry(std::string(20000, 'b')));
+        cache.Store("d", Entry(std::string(80000, 'd')));
+        cache.Store("c", Entry(std::string(90000, 'c')));
+
+        for (auto i = 0; i < 16; ++i) cache.Store("key-" + std::to_string(i), Entry(std::string(512, 'x')));
+    }
+
+    // A record written past the end of its segment isn't recovered
+    DiskCache cache {options};
+    const auto entry = cache.Find("c");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->response.data, std::string(90000, 'c'));
+    EXPECT_TRUE(cache.Find("key-15").has_value());
+    EXPECT_LE(DiskBytes(directory), 200000);
+}
+
+TEST_F(DiskCacheTest, CompactsReplacedResponses) {
+    DiskCache cache {{.directory = directory, .max_bytes = 16384, .segment_bytes = 4096}};
+
+    cache.Store("stable", Entry("kept"));
+    for (auto i = 0; i < 64; ++i) cache.Store("replaced", Entry(std::string(512, 'x')));
+
+    EXPECT_EQ(cache.Find("stable")->response.data, "kept");
+    EXPECT_EQ(cache.stats().evictions, 0);
+    EXPECT_EQ(cache.stats().entries, 2);
+    EXPECT_LE(DiskBytes(directory), 16384);
+}
+
+#ifndef _WIN32
+TEST_F(DiskCacheTest, SkipsResponsesWhenSegmentCantBeAllocated) {
+    DiskCache cache {{.directory = directory, .max_bytes = 65536, .segment_bytes = 16384}};
+    cache.Store("a", Entry(std::string(512, 'a')));
+
+    // New segments can't be allocated, like on a full disk
+    rlimit previous {};
+    getrlimit(RLIMIT_FSIZE, &previous);
+    const auto handler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit limit {4096, previous.rlim_max};
+    setrlimit(RLIMIT_FSIZE, &limit);
+
+    for (auto i = 0; i < 64; ++i) cache.Store("key-" + std::to_string(i), Entry(std::string(512, 'x')));
+    cache.Store("a", Entry(std::string(16000, 'b')));
+
+    setrlimit(RLIMIT_FSIZE, &previous);
+    std::signal(SIGXFSZ, handler);
+
+    EXPECT_TRUE(cache.Find("key-0").has_value());
+    EXPECT_FALSE(cache.Find("key-63").has_value());
+    EXPECT_FALSE(cache.Find("a").has_value());
+
+    cache.Store("key-63", Entry("stored"));
+    EXPECT_EQ(cache.Find("key-63")->response.data, "stored");
+}
+#endif
@@ -0,0 +1,85 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/error.h"
+
+#include <system_error>
+
+#include <gtest/gtest.h>
+
+#include "express/error_code.h"
+#include "express/exception.h"
+#include "express/expected.h"
+
+using Express::ErrorCode;
+using Express::ErrorCondition;
+
+TEST(ErrorCode, ConvertsToErrorCode) {
+    std::error_code error = ErrorCode::kRecvTimeout;
+
+    EXPECT_EQ(error.category(), Express::ErrorCategory());
+    EXPECT_EQ(error.message(), "Timeout error: Failed to receive data from the server");
+}
+
+TEST(ErrorCode, MatchesErrorConditions) {
+    std::error_code timeout = ErrorCode::kConnectTimeout;
+    EXPECT_EQ(timeout, ErrorCondition::kTimeoutError);
+    EXPECT_EQ(timeout, ErrorCondition::kResponseError);
+    EXPECT_NE(timeout, ErrorCondition::kRequestError);
+
+    std::error_code url = ErrorCode::kMissingUrlScheme;
+    EXPECT_EQ(url, ErrorCondition::kRequestError);
+    EXPECT_NE(url, ErrorCondition::kResponseError);
+
+    std::error_code system = std::make_error_code(std::errc::connection_refused);
+    EXPECT_EQ(system, ErrorCondition::kSystemError);
+    EXPECT_NE(system, ErrorCondition::kTimeoutError);
+}
+
+TEST(Error, ThrowsRequestError) {
+    EXPECT_THROW({
+        try {
+            Express::Error::Throw(ErrorCode::kUnsupportedUrlScheme);
+        } catch (const Express::RequestError& e) {
+            EXPECT_STREQ(
+                e.what(),
+                "URL error: Unsupported URL scheme. Use 'http://' or 'https://'"
+            );
+            throw;
+        }
+    }, Express::RequestError);
+}
+
+TEST(Error, ThrowsResponseErrorWithDetail) {
+    EXPECT_THROW({
+        try {
+            Express::Error::ThrowWithDetail(ErrorCode::kInvalidStatusCode, "32");
+        } catch (const Express::ResponseError& e) {
+            EXPECT_STREQ(e.what(), "Status line error: Invalid status code (32)");
+            throw;
+        }
+    }, Express::ResponseError);
+}
+
+TEST(Error, ThrowsSystemError) {
+    auto error = std::make_error_code(std::errc::connection_refused);
+    EXPECT_THROW({
+        try {
+            Express::Error::Throw(error, "Socket connect error");
+        } catch (const std::system_error& e) {
+            EXPECT_EQ(e.code(), error);
+            throw;
+        }
+    }, std::system_error);
+}
+
+TEST(Expected, HoldsValueOrError) {
+    Express::Expected<int> value {42};
+    EXPECT_TRUE(value.has_value());
+    EXPECT_EQ(*value, 42);
+
+    Express::Expected<int> error {Express::Unexpected {ErrorCode::kSendTimeout}};
+    EXPECT_FALSE(error);
+    EXPECT_EQ(error.error(), ErrorCode::kSendTimeout);
+    EXPECT_EQ(error.value_or(0), 0);
+}
@@ -0,0 +1,52 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/hedge.h"
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+TEST(Hedger, UsesFixedDelay) {
+    Express::Hedger hedger;
+
+    EXPECT_EQ(hedger.Delay({.delay = 20ms}, "host:80"), 20ms);
+    EXPECT_FALSE(hedger.Delay({}, "host:80").has_value());
+}
+
+TEST(Hedger, TracksPercentileOfRecentLatencies) {
+    Express::Hedger hedger;
+    const Express::HedgePolicy policy {.delay = 500ms, .percentile = 0.9};
+
+    for (auto i = 1; i < 16; ++i) hedger.Record("host:80", i * 1ms);
+    EXPECT_EQ(hedger.Delay(policy, "host:80"), 500ms);
+
+    hedger.Record("host:80", 16ms);
+    EXPECT_EQ(hedger.Delay(policy, "host:80"), 15ms);
+    EXPECT_EQ(hedger.Delay(policy, "other:80"), 500ms);
+}
+
+TEST(Hedger, CapsHedgesToBudget) {
+    Express::Hedger hedger;
+    const Express::HedgePolicy policy {.delay = 10ms, .budget = 0.25};
+
+    auto hedges = 0;
+    for (auto i = 0; i < 100; ++i) {
+        hedger.Earn(policy);
+        if (hedger.Spend()) ++hedges;
+    }
+
+    EXPECT_EQ(hedges, 25);
+}
+
+TEST(Hedge, AppliesToIdempotentRequests) {
+    EXPECT_TRUE(Express::IsHedged({.url = "http://host", .hedge = {.delay = 10ms}}));
+    EXPECT_FALSE(Express::IsHedged({.url = "http://host"}));
+    EXPECT_FALSE(Express::IsHedged({
+        .url = "http://host",
+        .method = Express::Method::Post,
+        .hedge = {.delay = 10ms}
+    }));
+}
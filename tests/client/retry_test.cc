@@ -0,0 +1,125 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/retry.h"
+
+#include <chrono>
+#include <memory>
+#include <system_error>
+
+#include <gtest/gtest.h>
+
+#include "express/error_code.h"
+#include "express/executor.h"
+
+using namespace std::chrono_literals;
+
+using Express::ErrorCode;
+using Express::Method;
+
+namespace {
+    auto Failure(std::error_code ec) -> Express::Expected<Express::Response> {
+        return Express::Unexpected {ec};
+    }
+
+    auto Status(int status_code) -> Express::Expected<Express::Response> {
+        return Express::Response {.status_code = status_code};
+    }
+
+    class CountingExecutor : public Express::InlineExecutor {
+    public:
+        int executed {0};
+
+        auto Execute(Express::Work* work) -> void override {
+            ++executed;
+            InlineExecutor::Execute(work);
+        }
+    };
+}
+
+TEST(Retry, RetriesTransientFailuresOfIdempotentRequests) {
+    const Express::Config get {.url = "http://host", .method = Method::Get};
+
+    EXPECT_TRUE(Express::IsRetryable(get, Failure(ErrorCode::kRecvTimeout)));
+    EXPECT_TRUE(Express::IsRetryable(get, Failure(ErrorCode::kIncompleteResponse)));
+    EXPECT_TRUE(Express::IsRetryable(get, Failure(std::make_error_code(std::errc::connection_reset))));
+    EXPECT_TRUE(Express::IsRetryable(get, Status(503)));
+
+    EXPECT_FALSE(Express::IsRetryable(get, Status(200)));
+    EXPECT_FALSE(Express::IsRetryable(get, Status(500)));
+    EXPECT_FALSE(Express::IsRetryable(get, Failure(ErrorCode::kInvalidStatusCode)));
+    EXPECT_FALSE(Express::IsRetryable(get, Failure(ErrorCode::kQueueFull)));
+    EXPECT_FALSE(Express::IsRetryable(get, Failure(std::make_error_code(std::errc::operation_canceled))));
+}
+
+TEST(Retry, RetriesNonIdempotentRequestsOnlyIfNotSent) {
+    const Express::Config post {.url = "http://host", .method = Method::Post};
+
+    EXPECT_TRUE(Express::IsRetryable(post, Failure(ErrorCode::kConnectTimeout)));
+    EXPECT_TRUE(Express::IsRetryable(post, Failure(std::make_error_code(std::errc::connection_refused))));
+
+    EXPECT_FALSE(Express::IsRetryable(post, Failure(ErrorCode::kRecvTimeout)));
+    EXPECT_FALSE(Express::IsRetryable(post, Status(503)));
+}
+
+TEST(Retry, ParsesRetryAfter) {
+    const auto now = std::chrono::system_clock::time_point {std::chrono::seconds {784111767}};
+
+    EXPECT_EQ(Express::ParseRetryAfter("120", now), 120s);
+    EXPECT_EQ(Express::ParseRetryAfter("Sun, 06 Nov 1994 08:49:37 GMT", now), 10s);
+    EXPECT_EQ(Express::ParseRetryAfter("Sun, 06 Nov 1994 08:49:17 GMT", now), 0ms);
+
+    EXPECT_FALSE(Express::ParseRetryAfter("", now).has_value());
+    EXPECT_FALSE(Express::ParseRetryAfter("-1", now).has_value());
+    EXPECT_FALSE(Express::ParseRetryAfter("tomorrow", now).has_value());
+}
+
+TEST(Retry, PicksDelaysWithinBounds) {
+    const Express::RetryPolicy policy {.base_delay = 10ms, .max_delay = 100ms};
+
+    auto delay = policy.base_delay;
+    for (auto i = 0; i < 100; ++i) {
+        const auto previous = delay;
+        delay = Express::NextDelay(policy, previous);
+        EXPECT_GE(delay, policy.base_delay);
+        EXPECT_LE(delay, std::min(previous * 3, policy.max_delay));
+    }
+}
+
+TEST(Retry, RetriesResponsesWithoutRetryAfter) {
+    auto retrier = std::make_shared<Express::Retrier>();
+    auto loop = std::make_shared<Express::Net::EventLoop>();
+    auto executor = std::make_shared<CountingExecutor>();
+    auto attempts = 0;
+
+    auto result = Express::SyncWait(Express::RetryAsync(
+        {.url = "http://host", .retry = {.max_retries = 2, .base_delay = 1ms}},
+        retrier,
+        loop,
+        executor,
+        [&attempts](const Express::Config&) -> Express::Task<Express::Expected<Express::Response>> {
+            co_return Status(++attempts == 1 ? 503 : 200);
+        }
+    ));
+
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->status_code, 200);
+    EXPECT_EQ(attempts, 2);
+
+    // The retry left the I/O thread before it started
+    EXPECT_EQ(executor->executed, 1);
+}
+
+TEST(Retrier, CapsRetriesToBudget) {
+    Express::Retrier retrier;
+    const Express::RetryPolicy policy {.budget = 0.1};
+
+    auto retries = 0;
+    for (auto i = 0; i < 100; ++i) {
+        retrier.Earn(policy);
+        if (retrier.Spend()) ++retries;
+    }
+
+    // The initial burst, and one retry for every ten requests after it
+    EXPECT_EQ(retries, 19);
+}
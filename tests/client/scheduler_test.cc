@@ -0,0 +1,159 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "client/scheduler.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "express/error_code.h"
+#include "express/task.h"
+
+using namespace std::chrono_literals;
+
+using Express::Priority;
+
+namespace {
+    auto Admit(
+        Express::Scheduler& scheduler,
+        Priority priority,
+        std::chrono::milliseconds timeout,
+        std::stop_token stop
+    ) -> Express::Task<Express::Expected<Express::Slot>> {
+        co_return co_await scheduler.Admit(priority, Express::Timeout {timeout}, stop);
+    }
+
+    /*
+        Records the order in which requests are admitted, and holds the
+        slots of admitted requests until they're released by the test.
+    */
+    struct Requests {
+        Express::Scheduler scheduler;
+        std::vector<std::string> admitted;
+        std::vector<std::error_code> errors;
+        std::deque<Express::Slot> slots;
+
+        explicit Requests(const Express::SchedulerOptions& options)
+          : scheduler(std::make_shared<Express::InlineExecutor>(), options) {}
+
+        auto Submit(
+            std::string name,
+            Priority priority,
+            std::chrono::milliseconds timeout = 0ms,
+            std::stop_token stop = {}
+        ) {
+            Express::Detail::Complete(Admit(scheduler, priority, timeout, stop),
+                [this, name](Express::Expected<Express::Slot> result) {
+                    if (!result) {
+                        errors.push_back(result.error());
+                        return;
+                    }
+                    admitted.push_back(name);
+                    slots.push_back(std::move(*result));
+                }
+            );
+        }
+
+        // The slot is released after it's removed, since releasing it may
+        // admit another request
+        auto ReleaseFirst() {
+            auto slot = std::move(slots.front());
+            slots.pop_front();
+        }
+    };
+}
+
+TEST(Scheduler, AdmitsRequestsUpToTheLimit) {
+    Requests requests {{.max_active_requests = 2}};
+
+    requests.Submit("a", Priority::Normal);
+    requests.Submit("b", Priority::Normal);
+    requests.Submit("c", Priority::Normal);
+
+    EXPECT_EQ(requests.admitted, (std::vector<std::string> {"a", "b"}));
+    EXPECT_EQ(requests.scheduler.active(), 2);
+    EXPECT_EQ(requests.scheduler.queued(), 1);
+
+    requests.ReleaseFirst();
+
+    EXPECT_EQ(requests.admitted, (std::vector<std::string> {"a", "b", "c"}));
+    EXPECT_EQ(requests.scheduler.active(), 2);
+    EXPECT_EQ(requests.scheduler.queued(), 0);
+
+    requests.slots.clear();
+    EXPECT_EQ(requests.scheduler.active(), 0);
+}
+
+TEST(Scheduler, AdmitsByPriorityThenDeadline) {
+    Requests requests {{.max_active_requests = 1}};
+
+    requests.Submit("running", Priority::Normal);
+    requests.Submit("background", Priority::Background);
+    requests.Submit("normal", Priority::Normal);
+    requests.Submit("late interactive", Priority::Interactive, 10s);
+    requests.Submit("interactive", Priority::Interactive);
+    requests.Submit("early interactive", Priority::Interactive, 5s);
+
+    for (auto i = 0; i < 5; ++i) requests.ReleaseFirst();
+
+    EXPECT_EQ(requests.admitted, (std::vector<std::string> {
+        "running",
+        "early interactive",
+        "late interactive",
+        "interactive",
+        "normal",
+        "background"
+    }));
+}
+
+TEST(Scheduler, RejectsRequestsWhenQueueIsFull) {
+    Requests requests {{.max_active_requests = 1, .max_queue_depth = 1}};
+
+    requests.Submit("a", Priority::Normal);
+    requests.Submit("b", Priority::Normal);
+    requests.Submit("c", Priority::Interactive);
+
+    ASSERT_EQ(requests.errors.size(), 1);
+    EXPECT_EQ(requests.errors[0], Express::ErrorCode::kQueueFull);
+    EXPECT_EQ(requests.scheduler.queued(), 1);
+}
+
+TEST(Scheduler, DropsRequestsThatExpireWhileQueued) {
+    Requests requests {{.max_active_requests = 1}};
+
+    requests.Submit("a", Priority::Normal);
+    requests.Submit("b", Priority::Normal, 1ms);
+    requests.Submit("c", Priority::Normal);
+
+    std::this_thread::sleep_for(5ms);
+    requests.ReleaseFirst();
+
+    EXPECT_EQ(requests.admitted, (std::vector<std::string> {"a", "c"}));
+    ASSERT_EQ(requests.errors.size(), 1);
+    EXPECT_EQ(requests.errors[0], Express::ErrorCode::kQueueTimeout);
+    EXPECT_EQ(requests.errors[0], Express::ErrorCondition::kTimeoutError);
+}
+
+TEST(Scheduler, RemovesCancelledRequestsFromQueue) {
+    Requests requests {{.max_active_requests = 1}};
+    std::stop_source source;
+
+    requests.Submit("a", Priority::Normal);
+    requests.Submit("b", Priority::Normal, 0ms, source.get_token());
+    requests.Submit("c", Priority::Normal);
+    source.request_stop();
+
+    ASSERT_EQ(requests.errors.size(), 1);
+    EXPECT_EQ(requests.errors[0], std::errc::operation_canceled);
+    EXPECT_EQ(requests.scheduler.queued(), 1);
+
+    requests.ReleaseFirst();
+    EXPECT_EQ(requests.admitted, (std::vector<std::string> {"a", "c"}));
+}
@@ -0,0 +1,127 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+using Express::CachedResponse;
+using Express::SharedCache;
+using Express::SharedCacheOptions;
+
+namespace {
+    auto Entry(std::string data) {
+        return CachedResponse {.response = {.status_code = 200, .status_text = "OK", .data = std::move(data)}};
+    }
+}
+
+class SharedCacheTest : public ::testing::Test {
+protected:
+    SharedCacheOptions options;
+
+    void SetUp() override {
+        const auto* test = ::testing::UnitTest::GetInstance()->current_test_info();
+        options = {.name = std::string {"express-"} + test->name(), .max_bytes = 1 << 20, .slot_bytes = 1024};
+        SharedCache::Unlink(options.name);
+    }
+
+    void TearDown() override {
+        SharedCache::Unlink(options.name);
+    }
+};
+
+TEST_F(SharedCacheTest, SharesResponsesBetweenMappings) {
+    SharedCache first {options};
+    SharedCache second {options};
+
+    first.Store("http://host/a", Entry("shared"));
+    EXPECT_EQ(second.Find("http://host/a")->response.data, "shared");
+
+    second.Store("http://host/a", Entry("replaced"));
+    EXPECT_EQ(first.Find("http://host/a")->response.data, "replaced");
+    EXPECT_EQ(first.stats().entries, 1);
+
+    second.Remove("http://host/a");
+    EXPECT_FALSE(first.Find("http://host/a").has_value());
+}
+
+TEST_F(SharedCacheTest, RejectsDifferentOptions) {
+    SharedCache cache {options};
+
+    auto different = options;
+    different.slot_bytes = 2048;
+    EXPECT_THROW(SharedCache {different}, std::system_error);
+}
+
+TEST_F(SharedCacheTest, SkipsResponsesLargerThanSlot) {
+    SharedCache cache {options};
+
+    cache.Store("a", Entry("small"));
+    cache.Store("a", Entry(std::string(2048, 'x')));
+
+    EXPECT_FALSE(cache.Find("a").has_value());
+}
+
+TEST_F(SharedCacheTest, ReplacesOldestResponseInFullSet) {
+    // The smallest cache is a single set of four slots
+    options.max_bytes = 0;
+    SharedCache cache {options};
+
+    for (auto i = 0; i < 5; ++i) cache.Store("key-" + std::to_string(i), Entry("body"));
+
+    EXPECT_FALSE(cache.Find("key-0").has_value());
+    EXPECT_TRUE(cache.Find("key-4").has_value());
+    EXPECT_EQ(cache.stats().entries, 4);
+    EXPECT_EQ(cache.stats().evictions, 1);
+}
+
+TEST_F(SharedCacheTest, ClaimsFillOnce) {
+    options.fill_timeout = 50ms;
+    SharedCache first {options};
+    SharedCache second {options};
+
+    EXPECT_TRUE(first.ClaimFill("a"));
+    EXPECT_FALSE(second.ClaimFill("a"));
+    EXPECT_TRUE(second.ClaimFill("b"));
+
+    first.ReleaseFill("a");
+    EXPECT_TRUE(second.ClaimFill("a"));
+
+    // A process that stopped while fetching holds the lease until it expires
+    std::this_thread::sleep_for(100ms);
+    EXPECT_TRUE(first.ClaimFill("a"));
+}
+
+TEST_F(SharedCacheTest, ReadsConsistentResponsesWhileWritten) {
+    SharedCache writer {options};
+    SharedCache reader {options};
+    std::atomic<bool> done {false};
+    std::atomic<int> torn {0};
+
+    std::vector<std::thread> readers;
+    for (auto i = 0; i < 2; ++i) {
+        readers.emplace_back([&] {
+            while (!done) {
+                const auto entry = reader.Find("a");
+                if (!entry) continue;
+                const auto& data = entry->response.data;
+                if (data.find_first_not_of(data.front()) != std::string::npos) ++torn;
+            }
+        });
+    }
+
+    for (auto i = 0; i < 2000; ++i) writer.Store("a", Entry(std::string(512, i % 2 ? 'a' : 'b')));
+    done = true;
+    for (auto& thread : readers) thread.join();
+
+    EXPECT_EQ(torn, 0);
+}
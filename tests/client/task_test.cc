@@ -0,0 +1,70 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/task.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+    auto Value(int value) -> Express::Task<int> {
+        co_return value;
+    }
+
+    auto Sum(int lhs, int rhs) -> Express::Task<int> {
+        co_return co_await Value(lhs) + co_await Value(rhs);
+    }
+
+    auto Fail(std::string message) -> Express::Task<int> {
+        throw std::runtime_error(message);
+        co_return 0;
+    }
+
+    auto Nothing(bool& called) -> Express::Task<void> {
+        called = true;
+        co_return;
+    }
+}
+
+TEST(Task, DoesNotStartUntilAwaited) {
+    auto called = false;
+    auto task = Nothing(called);
+
+    EXPECT_FALSE(called);
+    Express::SyncWait(std::move(task));
+    EXPECT_TRUE(called);
+}
+
+TEST(Task, ReturnsValueOfNestedTasks) {
+    EXPECT_EQ(Express::SyncWait(Sum(2, 3)), 5);
+}
+
+TEST(Task, PropagatesExceptions) {
+    EXPECT_THROW(Express::SyncWait(Fail("error")), std::runtime_error);
+}
+
+TEST(Task, WhenAllReturnsResultsInOrder) {
+    std::vector<Express::Task<int>> tasks;
+    for (auto i = 0; i < 4; ++i) tasks.emplace_back(Value(i));
+
+    auto results = Express::SyncWait(Express::WhenAll(std::move(tasks)));
+
+    EXPECT_EQ(results, (std::vector<int> {0, 1, 2, 3}));
+}
+
+TEST(Task, WhenAllPropagatesExceptions) {
+    std::vector<Express::Task<int>> tasks;
+    tasks.emplace_back(Value(1));
+    tasks.emplace_back(Fail("error"));
+
+    EXPECT_THROW(Express::SyncWait(Express::WhenAll(std::move(tasks))), std::runtime_error);
+}
+
+TEST(Task, WhenAllCompletesWithNoTasks) {
+    auto results = Express::SyncWait(Express::WhenAll(std::vector<Express::Task<int>> {}));
+
+    EXPECT_TRUE(results.empty());
+}
@@ -0,0 +1,92 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "express/task.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+    struct Job : Express::Work {
+        std::atomic<int>& counter;
+
+        explicit Job(std::atomic<int>& counter)
+          : Work([](auto* work) { ++static_cast<Job*>(work)->counter; }),
+            counter(counter) {}
+    };
+
+    struct Blocker : Express::Work {
+        std::shared_future<void> release;
+
+        explicit Blocker(std::shared_future<void> release)
+          : Work([](auto* work) { static_cast<Blocker*>(work)->release.wait(); }),
+            release(std::move(release)) {}
+    };
+}
+
+TEST(ThreadPool, RunsAllSubmittedWork) {
+    std::atomic<int> counter {0};
+    std::vector<Job> jobs(1000, Job {counter});
+    {
+        Express::ThreadPool pool {4};
+        for (auto& job : jobs) pool.Execute(&job);
+    }
+
+    EXPECT_EQ(counter, 1000);
+}
+
+TEST(ThreadPool, BlocksSubmitterWhenQueuesAreFull) {
+    std::promise<void> release;
+    Blocker blocker {release.get_future().share()};
+    std::atomic<int> counter {0};
+    Job first {counter};
+    Job second {counter};
+
+    Express::ThreadPool pool {1, 1};
+    pool.Execute(&blocker);
+    std::this_thread::sleep_for(10ms);
+    pool.Execute(&first);
+
+    // The only worker is busy and its queue is full
+    auto submitted = std::async(std::launch::async, [&] { pool.Execute(&second); });
+    EXPECT_EQ(submitted.wait_for(50ms), std::future_status::timeout);
+
+    release.set_value();
+    submitted.get();
+}
+
+TEST(ThreadPool, RunsNestedWorkWhenQueueIsFull) {
+    Express::ThreadPool pool {1, 1};
+
+    auto Nested = [](Express::ThreadPool& pool) -> Express::Task<int> {
+        auto total = 0;
+        for (auto i = 0; i < 10; ++i) {
+            co_await Express::Schedule(pool);
+            ++total;
+        }
+        co_return total;
+    };
+
+    EXPECT_EQ(Express::SyncWait(Nested(pool)), 10);
+}
+
+TEST(ThreadPool, ResumesCoroutinesOnWorkers) {
+    Express::ThreadPool pool {2};
+
+    auto ThreadId = [](Express::ThreadPool& pool) -> Express::Task<std::thread::id> {
+        co_await Express::Schedule(pool);
+        co_return std::this_thread::get_id();
+    };
+
+    EXPECT_NE(Express::SyncWait(ThreadId(pool)), std::this_thread::get_id());
+}
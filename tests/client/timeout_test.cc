@@ -42,4 +42,14 @@ TEST(Timeout, Expires) {
 
     std::this_thread::sleep_for(5ms);
     EXPECT_EQ(timeout.Get(), 0);
-}
\ No newline at end of file
+}
+
+TEST(Timeout, IsExpired) {
+    Express::Timeout timeout {20ms};
+    EXPECT_FALSE(timeout.expired());
+
+    std::this_thread::sleep_for(21ms);
+    EXPECT_TRUE(timeout.expired());
+
+    EXPECT_FALSE(Express::Timeout {0ms}.expired());
+}
@@ -0,0 +1,246 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "express/upstream.h"
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+using Express::Balancing;
+using Express::Upstream;
+
+namespace {
+    constexpr std::array<std::string_view, 3> kAddresses {
+        "127.0.0.1:5001", "127.0.0.2:5002", "127.0.0.3:5003"
+    };
+
+    const auto kSuccess = Express::Expected<Express::Response> {Express::Response {.status_code = 200}};
+    const auto kFailure = Express::Expected<Express::Response> {
+        Express::Unexpected {std::make_error_code(std::errc::connection_refused)}
+    };
+}
+
+class UpstreamTest : public ::testing::Test {
+protected:
+    Upstream::Clock::time_point now {1h};
+
+    // Picks a member and records the outcome right away
+    auto Send(Upstream& upstream, const Express::Expected<Express::Response>& result, std::chrono::nanoseconds latency = 1ms) {
+        const auto member = upstream.Pick(now);
+        upstream.Record(member, result, latency, now);
+        return member;
+    }
+};
+
+TEST_F(UpstreamTest, ResolvesAddresses) {
+    const std::array<std::string_view, 2> addresses {"127.0.0.1:8080", "[::1]:8081"};
+    const Upstream upstream {addresses};
+
+    const auto members = upstream.members(now);
+    ASSERT_EQ(members.size(), 2);
+    EXPECT_EQ(members[0].address, "127.0.0.1:8080");
+    EXPECT_EQ(members[1].address, "[::1]:8081");
+
+    std::error_code ec;
+    const Upstream empty {{}, {}, ec};
+    EXPECT_TRUE(ec);
+}
+
+TEST_F(UpstreamTest, TakesMembersInTurn) {
+    Upstream upstream {kAddresses};
+
+    std::vector<std::size_t> picked;
+    for (auto i = 0; i < 6; ++i) picked.push_back(Send(upstream, kSuccess));
+
+    EXPECT_EQ(picked, (std::vector<std::size_t> {0, 1, 2, 0, 1, 2}));
+}
+
+TEST_F(UpstreamTest, TakesMemberWithFewestRequests) {
+    Upstream upstream {kAddresses, {.balancing = Balancing::LeastRequests}};
+
+    const auto first = upstream.Pick(now);
+    const auto second = upstream.Pick(now);
+    EXPECT_NE(first, second);
+
+    // The third member is idle, and the first one completes its request
+    const auto third = upstream.Pick(now);
+    upstream.Record(first, kSuccess, 1ms, now);
+    EXPECT_NE(third, second);
+    EXPECT_EQ(upstream.Pick(now), first);
+    EXPECT_EQ(upstream.members(now)[second].outstanding, 1);
+}
+
+TEST_F(UpstreamTest, PrefersFasterMembers) {
+    Upstream upstream {kAddresses, {.balancing = Balancing::PeakEwma}};
+
+    // Every member gets a latency sample
+    for (std::size_t member = 0; member < kAddresses.size(); ++member) {
+        EXPECT_TRUE(upstream.Reuse(member, now));
+        upstream.Record(member, kSuccess, member == 1 ? 1ms : 100ms, now);
+    }
+
+    std::array<int, 3> counts {};
+    for (auto i = 0; i < 300; ++i) ++counts[Send(upstream, kSuccess, 1ms)];
+
+    // The slower members are only picked when they're compared to each other
+    EXPECT_GT(counts[1], 150);
+    EXPECT_EQ(upstream.members(now)[1].latency, 1ms);
+    EXPECT_EQ(upstream.members(now)[0].latency, 100ms);
+}
+
+TEST_F(UpstreamTest, EjectsMembersThatKeepFailing) {
+    Upstream upstream {kAddresses, {.outliers = {.consecutive_failures = 2, .ejection = 10s}}};
+
+    EXPECT_TRUE(upstream.Reuse(0, now));
+    upstream.Record(0, kFailure, 1ms, now);
+    EXPECT_TRUE(upstream.Reuse(0, now));
+    upstream.Record(0, kFailure, 1ms, now);
+    EXPECT_TRUE(upstream.members(now)[0].ejected);
+    EXPECT_FALSE(upstream.Reuse(0, now));
+
+    for (auto i = 0; i < 6; ++i) EXPECT_NE(Send(upstream, kSuccess), 0);
+
+    // The member returns once its ejection ends
+    now += 10s;
+    EXPECT_TRUE(upstream.Reuse(0, now));
+    upstream.Record(0, kSuccess, 1ms, now);
+}
+
+TEST_F(UpstreamTest, EjectsFewerMembersThanLimit) {
+    Upstream upstream {kAddresses, {.outliers = {.consecutive_failures = 1, .max_ejected = 0.5}}};
+
+    for (std::size_t member = 0; member < kAddresses.size(); ++member) {
+        EXPECT_TRUE(upstream.Reuse(member, now));
+        upstream.Record(member, kFailure, 1ms, now);
+    }
+
+    auto ejected = 0;
+    for (const auto& member : upstream.members(now)) ejected += member.ejected;
+    EXPECT_EQ(ejected, 1);
+}
+
+TEST_F(UpstreamTest, EjectsLongerEveryTimeInARow) {
+    Upstream upstream {kAddresses, {.outliers = {.consecutive_failures = 1, .ejection = 10s}}};
+
+    EXPECT_TRUE(upstream.Reuse(0, now));
+    upstream.Record(0, kFailure, 1ms, now);
+    now += 10s;
+
+    EXPECT_TRUE(upstream.Reuse(0, now));
+    upstream.Record(0, kFailure, 1ms, now);
+    now += 10s;
+    EXPECT_FALSE(upstream.Reuse(0, now));
+    now += 10s;
+    EXPECT_TRUE(upstream.Reuse(0, now));
+}
+
+TEST_F(UpstreamTest, CountsSlowRequestsAsFailures) {
+    Upstream upstream {kAddresses, {.outliers = {.consecutive_failures = 1, .slow_request = 50ms}}};
+
+    EXPECT_TRUE(upstream.Reuse(2, now));
+    upstream.Record(2, kSuccess, 100ms, now);
+    EXPECT_TRUE(upstream.members(now)[2].ejected);
+}
+
+class UpstreamHashing : public UpstreamTest, public ::testing::WithParamInterface<Balancing> {
+protected:
+    static constexpr auto kKeys = 20000;
+
+    // The address each key is routed to
+    auto Route(Upstream& upstream) {
+        const auto members = upstream.members(now);
+        std::vector<std::string> routes;
+        for (auto i = 0; i < kKeys; ++i) {
+            routes.push_back(members[Send(upstream, kSuccess, 1ms, "key-" + std::to_string(i))].address);
+        }
+        return routes;
+    }
+
+    auto Send(
+        Upstream& upstream,
+        const Express::Expected<Express::Response>& result,
+        std::chrono::nanoseconds latency,
+        std::string_view key
+    ) -> std::size_t {
+        const auto member = upstream.Pick(key, now);
+        upstream.Record(member, result, latency, now);
+        return member;
+    }
+};
+
+TEST_P(UpstreamHashing, RoutesSameKeyToSameMember) {
+    Upstream upstream {kAddresses, {.balancing = GetParam(), .table_size = 1009}};
+
+    const auto member = upstream.Pick("user-42", now);
+    for (auto i = 0; i < 10; ++i) EXPECT_EQ(Send(upstream, kSuccess, 1ms, "user-42"), member);
+}
+
+TEST_P(UpstreamHashing, SpreadsKeysEvenly) {
+    Upstream upstream {kAddresses, {.balancing = GetParam()}};
+
+    std::array<int, 3> counts {};
+    for (auto i = 0; i < kKeys; ++i) ++counts[Send(upstream, kSuccess, 1ms, "key-" + std::to_string(i))];
+
+    for (const auto count : counts) {
+        EXPECT_GT(count, kKeys / 3 * 0.8);
+        EXPECT_LT(count, kKeys / 3 * 1.2);
+    }
+}
+
+TEST_P(UpstreamHashing, MovesFewKeysWhenMembersChange) {
+    constexpr std::array<std::string_view, 4> kMore {"127.0.0.1:5001", "127.0.0.2:5002", "127.0.0.3:5003", "127.0.0.4:5004"};
+    Upstream before {kAddresses, {.balancing = GetParam()}};
+    Upstream after {kMore, {.balancing = GetParam()}};
+
+    const auto routes_before = Route(before);
+    const auto routes_after = Route(after);
+
+    // Ideally, only the keys of the new member move
+    auto moved = 0;
+    for (auto i = 0; i < kKeys; ++i) {
+        if (routes_before[i] == routes_after[i]) continue;
+        ++moved;
+    }
+    EXPECT_GT(moved, kKeys / 4 * 0.8);
+    EXPECT_LT(moved, kKeys / 4 * 1.3);
+}
+
+TEST_P(UpstreamHashing, SkipsEjectedMembers) {
+    Upstream upstream {kAddresses, {.balancing = GetParam(), .outliers = {.consecutive_failures = 1}}};
+    const auto routes = Route(upstream);
+
+    EXPECT_TRUE(upstream.Reuse(0, now));
+    upstream.Record(0, kFailure, 1ms, now);
+    ASSERT_TRUE(upstream.members(now)[0].ejected);
+
+    // The keys of the ejected member move, and the ring keeps every other
+    // key where it was. A Maglev table moves a few more.
+    const auto ejected = upstream.members(now)[0].address;
+    const auto rerouted = Route(upstream);
+
+    auto moved = 0;
+    for (auto i = 0; i < kKeys; ++i) {
+        EXPECT_NE(rerouted[i], ejected);
+        if (routes[i] != ejected && rerouted[i] != routes[i]) ++moved;
+    }
+    if (GetParam() == Balancing::RingHash) {
+        EXPECT_EQ(moved, 0);
+    } else {
+        EXPECT_LT(moved, kKeys / 50);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Policies,
+    UpstreamHashing,
+    ::testing::Values(Balancing::RingHash, Balancing::Maglev),
+    [](const auto& info) { return info.param == Balancing::RingHash ? "RingHash" : "Maglev"; }
+);
@@ -0,0 +1,54 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "http/cache_control.h"
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+TEST(CacheControl, ParsesDirectives) {
+    const auto directives = Express::Http::ParseCacheControl(
+        "public, Max-Age=60, stale-while-revalidate=\"30\", stale-if-error=600, must-revalidate"
+    );
+
+    EXPECT_EQ(directives.max_age, 60s);
+    EXPECT_FALSE(directives.s_maxage.has_value());
+    EXPECT_TRUE(directives.is_public);
+    EXPECT_EQ(directives.stale_while_revalidate, 30s);
+    EXPECT_EQ(directives.stale_if_error, 600s);
+    EXPECT_TRUE(directives.must_revalidate);
+    EXPECT_FALSE(directives.no_cache);
+    EXPECT_FALSE(directives.no_store);
+}
+
+TEST(CacheControl, ParsesFlags) {
+    const auto directives = Express::Http::ParseCacheControl("no-cache,no-store");
+
+    EXPECT_TRUE(directives.no_cache);
+    EXPECT_TRUE(directives.no_store);
+    EXPECT_FALSE(directives.max_age.has_value());
+}
+
+TEST(CacheControl, ParsesSharedMaxAge) {
+    const auto directives = Express::Http::ParseCacheControl("max-age=60, s-maxage=600");
+
+    EXPECT_EQ(directives.max_age, 60s);
+    EXPECT_EQ(directives.s_maxage, 600s);
+    EXPECT_FALSE(directives.is_public);
+    EXPECT_FALSE(directives.is_private);
+    EXPECT_TRUE(Express::Http::ParseCacheControl("private=\"Set-Cookie\", max-age=60").is_private);
+}
+
+TEST(CacheControl, TreatsInvalidMaxAgeAsStale) {
+    EXPECT_EQ(Express::Http::ParseCacheControl("max-age=soon").max_age, 0s);
+    EXPECT_FALSE(Express::Http::ParseCacheControl("").max_age.has_value());
+}
+
+TEST(CacheControl, CapsLargeDeltaSeconds) {
+    const auto directives = Express::Http::ParseCacheControl("max-age=10000000000, stale-if-error=99999999999999999999");
+    EXPECT_EQ(directives.max_age, 2147483648s);
+    EXPECT_EQ(directives.stale_if_error, 2147483648s);
+}
@@ -0,0 +1,290 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "http/content_decoder.h"
+
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#ifdef EXPRESS_ZLIB
+    #include <zlib.h>
+#endif
+
+#include "express/dictionaries.h"
+#include "express/error_code.h"
+
+namespace {
+    #ifdef EXPRESS_ZLIB
+        constexpr int kGzip {MAX_WBITS + 16};
+        constexpr int kZlib {MAX_WBITS};
+        constexpr int kRawDeflate {-MAX_WBITS};
+
+        auto Compress(const std::string& data, int window_bits) {
+            z_stream stream {};
+            deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+
+            std::string output(deflateBound(&stream, data.size()), '\0');
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+            stream.avail_in = static_cast<uInt>(data.size());
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            deflate(&stream, Z_FINISH);
+            output.resize(stream.total_out);
+            deflateEnd(&stream);
+            return output;
+        }
+
+        auto Body() {
+            std::string body;
+            for (auto i = 0; i < 4096; ++i) body += R"({"id":)" + std::to_string(i) + R"(,"name":"item"},)";
+            return body;
+        }
+    #endif
+
+    // "Hello World! Hello World! Hello World!", compressed with brotli and zstd
+    constexpr std::string_view kHelloBrotli {
+        "\x1b\x25\x00\x00\x24\x41\x42\x90\x52\x91\x64\xa8\xc9\xe6\x5b\x1d\x6b\x9c\x18\xbc\x00", 21
+    };
+    constexpr std::string_view kHelloZstd {
+        "\x28\xb5\x2f\xfd\x20\x26\x9d\x00\x00\x68\x48\x65\x6c\x6c\x6f\x20\x57\x6f\x72\x6c\x64\x21\x20\x01"
+        "\x00\xb0\xcc\x2f", 28
+    };
+
+    // A user, compressed with zstd against a dictionary of a user's usual
+    // fields to 36 bytes (88 bytes without it)
+    constexpr std::string_view kUserDictionary {
+        R"({"id":0,"name":"","email":"@example.com","roles":["reader","writer"],"active":true})"
+    };
+    constexpr std::string_view kUser {
+        R"({"id":42,"name":"Fred","email":"fred@example.com","roles":["reader","writer"],"active":true})"
+    };
+    constexpr std::string_view kUserZstd {
+        "\x28\xb5\x2f\xfd\x20\x5c\xdd\x00\x00\x80\x7b\x22\x69\x64\x22\x3a\x34\x32\x46\x72\x65\x64\x66\x72"
+        "\x65\x64\x03\x10\x06\xfd\x0e\xd9\x22\xb9\x34\x2e", 36
+    };
+
+    // Counts what's allocated through it, and what's still outstanding
+    struct CountingResource : std::pmr::memory_resource {
+        std::size_t allocations {0};
+        std::size_t bytes {0};
+
+        auto do_allocate(std::size_t size, std::size_t alignment) -> void* override {
+            ++allocations;
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+
+        auto do_deallocate(void* address, std::size_t size, std::size_t alignment) -> void override {
+            bytes -= size;
+            std::pmr::new_delete_resource()->deallocate(address, size, alignment);
+        }
+
+        auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override {
+            return this == &other;
+        }
+    };
+
+    auto Supports(std::string_view coding) {
+        return Express::Http::AcceptEncoding().find(coding) != std::string_view::npos;
+    }
+
+    // Feeds the encoded body in parts of the given size
+    auto Decode(
+        std::string_view coding,
+        std::string_view encoded,
+        std::size_t part,
+        std::error_code& ec,
+        std::shared_ptr<const Express::Http::Dictionary> dictionary = nullptr,
+        std::size_t max_size = std::numeric_limits<std::size_t>::max()
+    ) {
+        auto decoder = Express::Http::MakeContentDecoder(
+            coding, std::pmr::get_default_resource(), dictionary, max_size
+        );
+        EXPECT_NE(decoder, nullptr);
+        if (decoder == nullptr) return std::string {};
+
+        std::string output;
+        for (std::size_t i = 0; i < encoded.size() && !ec; i += part) {
+            decoder->Decode(encoded.substr(i, part), output, ec);
+        }
+        if (!ec) decoder->Finish(ec);
+        return output;
+    }
+}
+
+#ifdef EXPRESS_ZLIB
+TEST(ContentDecoder, DecodesGzip) {
+    const auto body = Body();
+    const auto encoded = Compress(body, kGzip);
+
+    std::error_code ec;
+    EXPECT_EQ(Decode("gzip", encoded, encoded.size(), ec), body);
+    EXPECT_FALSE(ec);
+}
+
+TEST(ContentDecoder, DecodesGzipInParts) {
+    const auto body = Body();
+    const auto encoded = Compress(body, kGzip);
+
+    std::error_code ec;
+    EXPECT_EQ(Decode("gzip", encoded, 7, ec), body);
+    EXPECT_FALSE(ec);
+}
+
+TEST(ContentDecoder, DecodesConcatenatedGzipMembers) {
+    const auto encoded = Compress("Hello ", kGzip) + Compress("World", kGzip);
+
+    std::error_code ec;
+    EXPECT_EQ(Decode("x-gzip", encoded, 3, ec), "Hello World");
+    EXPECT_FALSE(ec);
+}
+
+TEST(ContentDecoder, DecodesDeflateWithAndWithoutZlibWrapper) {
+    const auto body = Body();
+
+    std::error_code ec;
+    EXPECT_EQ(Decode("deflate", Compress(body, kZlib), 512, ec), body);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(Decode(" Deflate ", Compress(body, kRawDeflate), 512, ec), body);
+    EXPECT_FALSE(ec);
+}
+#endif
+
+TEST(ContentDecoder, DecodesBrotli) {
+    if (!Supports("br")) GTEST_SKIP() << "Built without brotli";
+
+    std::error_code ec;
+    EXPECT_EQ(Decode("br", kHelloBrotli, 1, ec), "Hello World! Hello World! Hello World!");
+    EXPECT_FALSE(ec);
+
+    Decode("br", kHelloBrotli.substr(0, 10), 10, ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kInvalidContentEncoding);
+}
+
+TEST(ContentDecoder, DecodesZstd) {
+    if (!Supports("zstd")) GTEST_SKIP() << "Built without zstd";
+
+    std::error_code ec;
+    EXPECT_EQ(Decode("zstd", kHelloZstd, 1, ec), "Hello World! Hello World! Hello World!");
+    EXPECT_FALSE(ec);
+
+    Decode("zstd", kHelloZstd.substr(0, 10), 10, ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kInvalidContentEncoding);
+}
+
+TEST(ContentDecoder, LimitsBrotliAndZstdBodies) {
+    for (const auto& [coding, encoded] : {std::pair {"br", kHelloBrotli}, std::pair {"zstd", kHelloZstd}}) {
+        if (!Supports(coding)) continue;
+
+        std::error_code ec;
+        EXPECT_EQ(Decode(coding, encoded, 1, ec, nullptr, 38).size(), 38) << coding;
+        EXPECT_FALSE(ec) << coding;
+        Decode(coding, encoded, 1, ec, nullptr, 12);
+        EXPECT_EQ(ec, Express::ErrorCode::kDecodedBodyTooLarge) << coding;
+    }
+}
+
+TEST(ContentDecoder, DecodesZstdWithSharedDictionary) {
+    if (!Supports("zstd")) GTEST_SKIP() << "Built without zstd";
+
+    Express::Dictionaries dictionaries;
+    dictionaries.Add("users-v1", std::string {kUserDictionary});
+
+    std::error_code ec;
+    EXPECT_EQ(Decode("zstd", kUserZstd, 5, ec, dictionaries.Find("users-v1")), kUser);
+    EXPECT_FALSE(ec);
+
+    Decode("zstd", kUserZstd, 5, ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kInvalidContentEncoding);
+}
+
+TEST(ContentDecoder, AllocatesZstdStateFromTheResource) {
+    if (!Supports("zstd")) GTEST_SKIP() << "Built without zstd";
+
+    CountingResource resource;
+    {
+        auto decoder = Express::Http::MakeContentDecoder("zstd", &resource);
+        ASSERT_NE(decoder, nullptr);
+
+        std::string output;
+        std::error_code ec;
+        decoder->Decode(kHelloZstd, output, ec);
+        EXPECT_FALSE(ec);
+    }
+
+    // The decoder itself, and at least its context
+    EXPECT_GE(resource.allocations, 2);
+    EXPECT_EQ(resource.bytes, 0);
+}
+
+TEST(ContentDecoder, RejectsZstdWindowsLargerThan8MiB) {
+    if (!Supports("zstd")) GTEST_SKIP() << "Built without zstd";
+
+    // Empty frames with an 8 MiB and a 16 MiB window
+    constexpr std::string_view kWindow8MiB {"\x28\xb5\x2f\xfd\x00\x68\x01\x00\x00", 9};
+    constexpr std::string_view kWindow16MiB {"\x28\xb5\x2f\xfd\x00\x70\x01\x00\x00", 9};
+
+    std::error_code ec;
+    EXPECT_EQ(Decode("zstd", kWindow8MiB, kWindow8MiB.size(), ec), "");
+    EXPECT_FALSE(ec);
+
+    Decode("zstd", kWindow16MiB, kWindow16MiB.size(), ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kInvalidContentEncoding);
+}
+
+#ifdef EXPRESS_ZLIB
+TEST(ContentDecoder, ReportsTruncatedBody) {
+    auto encoded = Compress(Body(), kGzip);
+    encoded.resize(encoded.size() / 2);
+
+    std::error_code ec;
+    Decode("gzip", encoded, encoded.size(), ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kInvalidContentEncoding);
+}
+
+TEST(ContentDecoder, ReportsCorruptBody) {
+    std::error_code ec;
+    Decode("gzip", "this is not gzip", 16, ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kInvalidContentEncoding);
+}
+
+TEST(ContentDecoder, DecodesBodiesUpToTheMaximumSize) {
+    const auto body = Body();
+    const auto encoded = Compress(body, kGzip);
+
+    std::error_code ec;
+    EXPECT_EQ(Decode("gzip", encoded, 512, ec, nullptr, body.size()), body);
+    EXPECT_FALSE(ec);
+    Decode("gzip", encoded, 512, ec, nullptr, body.size() - 1);
+    EXPECT_EQ(ec, Express::ErrorCode::kDecodedBodyTooLarge);
+}
+
+TEST(ContentDecoder, StopsExpandingBodiesPastTheMaximumSize) {
+    // 64 MiB of zeros compress to about a thousandth of that
+    const auto encoded = Compress(std::string(64 * 1024 * 1024, '\0'), kGzip);
+    ASSERT_LT(encoded.size(), 1024 * 1024);
+
+    auto decoder = Express::Http::MakeContentDecoder(
+        "gzip", std::pmr::get_default_resource(), nullptr, 1024 * 1024
+    );
+    std::string output;
+    std::error_code ec;
+    decoder->Decode(encoded, output, ec);
+
+    EXPECT_EQ(ec, Express::ErrorCode::kDecodedBodyTooLarge);
+    EXPECT_LE(output.capacity(), 2 * 1024 * 1024);
+}
+#endif
+
+TEST(ContentDecoder, IgnoresUnsupportedCodings) {
+    auto* resource = std::pmr::get_default_resource();
+    EXPECT_EQ(Express::Http::MakeContentDecoder("identity", resource), nullptr);
+    EXPECT_EQ(Express::Http::MakeContentDecoder("gzip, br", resource), nullptr);
+}
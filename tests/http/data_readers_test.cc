@@ -98,6 +98,23 @@ TEST(ChunkedTransfer, ReadsBodyInStream) {
     EXPECT_EQ(response.data, "Mozilla Developer Network");
 }
 
+TEST(ChunkedTransfer, ReadsTrailersThatArriveLater) {
+    Express::Response response;
+    response.headers.Add("Transfer-Encoding", "chunked");
+
+    Express::Http::ChunkedTransfer reader(response);
+
+    reader.Feed("5\r\nHello\r\n0\r\n");
+    EXPECT_FALSE(reader.done_reading_data());
+
+    reader.Feed("Checksum: 1234\r\n");
+    EXPECT_FALSE(reader.done_reading_data());
+
+    reader.Feed("\r\n");
+    EXPECT_TRUE(reader.done_reading_data());
+    EXPECT_EQ(response.data, "Hello");
+}
+
 TEST(ChunkedTransfer, ThrowsErrorIfMissingDelimiter) {
     Express::Response response;
     response.headers.Add("Transfer-Encoding", "chunked");
@@ -0,0 +1,132 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "http/event_parser.h"
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "express/error_code.h"
+
+using namespace std::chrono_literals;
+using namespace std::string_view_literals;
+
+using Express::Http::EventParser;
+
+namespace {
+    struct Received {
+        std::string type;
+        std::string data;
+        std::string id;
+
+        auto operator==(const Received&) const -> bool = default;
+    };
+
+    // Feeds the chunks one after the other, and collects the events
+    auto Parse(EventParser& parser, const std::vector<std::string_view>& chunks) {
+        std::vector<Received> events;
+        for (const auto chunk : chunks) {
+            std::error_code ec;
+            parser.Feed(chunk, [&](const Express::Event& event) {
+                events.push_back({std::string {event.type}, std::string {event.data}, std::string {event.id}});
+            }, ec);
+            EXPECT_FALSE(ec);
+        }
+        return events;
+    }
+
+    constexpr std::string_view kStream {
+        "\xEF\xBB\xBF: a comment\n"
+        "data: first\n\n"
+        "event: update\r\n"
+        "data: line one\r\n"
+        "data:line two\r\n"
+        "id: 42\r\n\r\n"
+        "data\r"
+        "retry: 2500\r\r"
+    };
+
+    const std::vector<Received> kEvents {
+        {"message", "first", ""},
+        {"update", "line one\nline two", "42"},
+        {"message", "", "42"}
+    };
+}
+
+TEST(EventParser, ParsesFields) {
+    EventParser parser {1024};
+    EXPECT_EQ(Parse(parser, {kStream}), kEvents);
+    EXPECT_EQ(parser.last_event_id(), "42");
+    EXPECT_EQ(parser.retry(), 2500ms);
+}
+
+TEST(EventParser, ParsesStreamInChunksOfAnySize) {
+    for (std::size_t size = 1; size < kStream.size(); ++size) {
+        std::vector<std::string_view> chunks;
+        for (std::size_t offset = 0; offset < kStream.size(); offset += size) {
+            chunks.push_back(kStream.substr(offset, size));
+        }
+
+        EventParser parser {1024};
+        EXPECT_EQ(Parse(parser, chunks), kEvents) << "chunks of " << size;
+    }
+}
+
+TEST(EventParser, IgnoresInvalidFields) {
+    EventParser parser {1024};
+    const auto events = Parse(parser, {"retry: soon\nid: a\0b\nunknown: x\ndata: kept\n\n"sv});
+
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0].data, "kept");
+    EXPECT_EQ(events[0].id, "");
+    EXPECT_FALSE(parser.retry().has_value());
+}
+
+TEST(EventParser, IgnoresIdsThatCantBeSentAsHeaders) {
+    EventParser parser {1024, "7"};
+    const auto events = Parse(parser, {"id: a\x01b\ndata: kept\n\n"sv});
+
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0].id, "7");
+    EXPECT_EQ(parser.last_event_id(), "7");
+}
+
+TEST(EventParser, KeepsIdOfEventsWithoutData) {
+    EventParser parser {1024, "7"};
+    EXPECT_EQ(parser.last_event_id(), "7");
+
+    EXPECT_TRUE(Parse(parser, {"id: 8\nevent: skipped\n\n"}).empty());
+    EXPECT_EQ(parser.last_event_id(), "8");
+
+    const auto events = Parse(parser, {"data: next\n\n"});
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0], (Received {"message", "next", "8"}));
+}
+
+TEST(EventParser, DropsIncompleteEventOnReset) {
+    EventParser parser {1024};
+    EXPECT_TRUE(Parse(parser, {"data: partial\nid: 9\ndata: unfin"}).empty());
+
+    parser.Reset();
+    EXPECT_EQ(parser.last_event_id(), "");
+
+    const auto events = Parse(parser, {"data: whole\n\n"});
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0], (Received {"message", "whole", ""}));
+}
+
+TEST(EventParser, ReportsEventsLargerThanTheLimit) {
+    std::error_code ec;
+    EventParser lines {16};
+    lines.Feed("data: a line that never ends", {}, ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kEventTooLarge);
+
+    EventParser events {16};
+    events.Feed("data: 01234567\ndata: 01234567\n", {}, ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kEventTooLarge);
+}
@@ -3,12 +3,55 @@
 
 #include "http/response_parser.h"
 
+#include <memory_resource>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <system_error>
 
 #include <gtest/gtest.h>
 
+#ifdef EXPRESS_ZLIB
+    #include <zlib.h>
+#endif
+
+#include "express/error_code.h"
 #include "express/exception.h"
 
+namespace {
+    #ifdef EXPRESS_ZLIB
+        auto Compress(const std::string& data, int window_bits, std::string_view dictionary = {}) {
+            z_stream stream {};
+            deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+            if (!dictionary.empty()) {
+                deflateSetDictionary(
+                    &stream,
+                    reinterpret_cast<const Bytef*>(dictionary.data()),
+                    static_cast<uInt>(dictionary.size())
+                );
+            }
+
+            std::string output(deflateBound(&stream, data.size()), '\0');
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+            stream.avail_in = static_cast<uInt>(data.size());
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            deflate(&stream, Z_FINISH);
+            output.resize(stream.total_out);
+            deflateEnd(&stream);
+            return output;
+        }
+
+        auto Gzip(const std::string& data) {
+            return Compress(data, MAX_WBITS + 16);
+        }
+    #endif
+
+    auto Feed(Express::Http::ResponseParser& parser, std::string input, std::error_code& ec) {
+        parser.Feed(reinterpret_cast<unsigned char*>(input.data()), input.size(), ec);
+    }
+}
+
 struct ResponseParser : public ::testing::Test {
     [[no_unique_address]] Express::Http::ResponseParser parser{};
 };
@@ -110,6 +153,21 @@ TEST_F(ResponseParser, ParsesResponseWithEmptyBody) {
     EXPECT_EQ(response.data, "");
 }
 
+TEST_F(ResponseParser, ParsesNotModifiedResponseWithoutBody) {
+    unsigned char input[] {
+        "HTTP/1.1 304 Not Modified\r\n"
+        "ETag: \"v1\"\r\n"
+        "Content-Length: 12\r\n"
+        "\r\n"
+    };
+
+    parser.Feed(input, sizeof(input) - 1);
+
+    EXPECT_TRUE(parser.done_reading_data());
+    EXPECT_EQ(parser.response().status_code, 304);
+    EXPECT_EQ(parser.response().data, "");
+}
+
 TEST_F(ResponseParser, ThrowsErrorIfFetchingIncompleteResponse) {
     unsigned char input[] {
         "HTTP/1.0 200 OK\r\n"
@@ -198,4 +256,213 @@ TEST_F(ResponseParser, ThrowsErrorIfUnsupportedTransferEncoding) {
             throw;
         }
     }, Express::ResponseError);
-}
\ No newline at end of file
+}
+TEST_F(ResponseParser, ReportsErrorCodeIfMalformedStatusLine) {
+    unsigned char input[] {
+        "HTTP/2.0 200 OK\r\n"
+        "Content-Length: 12\r\n"
+        "\r\n"
+        "Hello World!"
+    };
+
+    std::error_code ec;
+    parser.Feed(input, sizeof(input), ec);
+
+    EXPECT_EQ(ec, Express::ErrorCode::kUnsupportedVersion);
+}
+
+TEST_F(ResponseParser, ReportsErrorCodeIfIncompleteResponse) {
+    unsigned char input[] {
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 20\r\n"
+        "\r\n"
+        "Missing data"
+    };
+
+    std::error_code ec;
+    parser.Feed(input, sizeof(input), ec);
+    ASSERT_FALSE(ec);
+
+    auto response = std::move(parser).response(ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kIncompleteResponse);
+}
+
+TEST_F(ResponseParser, SkipsInterimResponses) {
+    std::error_code ec;
+    Feed(parser, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 103 Early Hints\r\n", ec);
+    EXPECT_FALSE(ec);
+    EXPECT_TRUE(parser.continued());
+    EXPECT_FALSE(parser.headers_complete());
+
+    Feed(parser, "Link: </style.css>; rel=preload\r\n\r\nHTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nOK", ec);
+    EXPECT_FALSE(ec);
+    EXPECT_TRUE(parser.headers_complete());
+    EXPECT_TRUE(parser.done_reading_data());
+
+    auto response = std::move(parser).response(ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_FALSE(response.headers.Contains("link"));
+    EXPECT_EQ(response.data, "OK");
+}
+
+TEST_F(ResponseParser, ReportsFinalResponseWithoutContinue) {
+    std::error_code ec;
+    Feed(parser, "HTTP/1.1 413 Payload Too Large\r\nContent-Length: 0\r\n\r\n", ec);
+    EXPECT_FALSE(ec);
+    EXPECT_FALSE(parser.continued());
+    EXPECT_TRUE(parser.headers_complete());
+}
+
+TEST_F(ResponseParser, KeepsBytesAfterSwitchingProtocols) {
+    // The frame after the 101 isn't a body, whatever the headers say
+    std::error_code ec;
+    Feed(parser, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                 "Connection: Upgrade\r\n\r\n\x81\x05Hello", ec);
+    EXPECT_FALSE(ec);
+    EXPECT_TRUE(parser.done_reading_data());
+    EXPECT_EQ(parser.unread(), "\x81\x05Hello");
+
+    auto response = std::move(parser).response(ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(response.status_code, 101);
+    EXPECT_EQ(response.data, "");
+}
+
+TEST(ResponseParserKeepAlive, ReportsWhetherConnectionCanBeReused) {
+    auto keep_alive = [](std::string input) {
+        Express::Http::ResponseParser parser;
+        std::error_code ec;
+        parser.Feed(reinterpret_cast<unsigned char*>(input.data()), input.size(), ec);
+        EXPECT_FALSE(ec);
+        return parser.keep_alive();
+    };
+
+    EXPECT_TRUE(keep_alive("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nOK"));
+    EXPECT_TRUE(keep_alive("HTTP/1.0 200 OK\r\nConnection: Keep-Alive\r\nContent-Length: 2\r\n\r\nOK"));
+    EXPECT_FALSE(keep_alive("HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\nOK"));
+    EXPECT_FALSE(keep_alive("HTTP/1.0 200 OK\r\nContent-Length: 2\r\n\r\nOK"));
+    EXPECT_FALSE(keep_alive("HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nOK"));
+    EXPECT_FALSE(keep_alive("HTTP/1.1 200 OK\r\n\r\nOK"));
+}
+
+// The bodies are compressed with zlib
+#ifdef EXPRESS_ZLIB
+TEST(ResponseParserDecoding, DecodesChunkedGzipBody) {
+    const std::string body(10000, 'x');
+    const auto encoded = Gzip(body);
+    const auto half = encoded.size() / 2;
+
+    std::ostringstream input;
+    input << "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n\r\n";
+    input << std::hex << half << "\r\n" << encoded.substr(0, half) << "\r\n";
+    input << std::hex << encoded.size() - half << "\r\n" << encoded.substr(half) << "\r\n0\r\n\r\n";
+
+    Express::Http::ResponseParser parser {std::pmr::get_default_resource(), Express::Http::Decoding::kDecode};
+    std::error_code ec;
+    Feed(parser, input.str(), ec);
+    ASSERT_FALSE(ec);
+
+    auto response = std::move(parser).response(ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(response.data, body);
+    EXPECT_FALSE(response.headers.Contains("content-encoding"));
+}
+
+TEST(ResponseParserDecoding, DecodesBodyWithContentLength) {
+    const std::string body {"Hello World!"};
+    const auto encoded = Gzip(body);
+
+    Express::Http::ResponseParser parser {std::pmr::get_default_resource(), Express::Http::Decoding::kDecode};
+    std::error_code ec;
+    Feed(parser, "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\nContent-Length: " +
+                 std::to_string(encoded.size()) + "\r\n\r\n", ec);
+    for (auto byte : encoded) Feed(parser, std::string(1, byte), ec);
+    ASSERT_FALSE(ec);
+
+    EXPECT_TRUE(parser.keep_alive());
+    auto response = std::move(parser).response(ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(response.data, body);
+    EXPECT_FALSE(response.headers.Contains("content-length"));
+}
+
+TEST(ResponseParserDecoding, LimitsTheDecodedBody) {
+    const auto encoded = Gzip(std::string(10000, 'x'));
+    const auto half = encoded.size() / 2;
+
+    Express::Http::ResponseParser parser {
+        std::pmr::get_default_resource(), Express::Http::Decoding::kDecode, nullptr, 9999
+    };
+    std::error_code ec;
+    Feed(parser, "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\n\r\n" + encoded.substr(0, half), ec);
+    ASSERT_FALSE(ec);
+    Feed(parser, encoded.substr(half), ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kDecodedBodyTooLarge);
+}
+
+TEST(ResponseParserDecoding, KeepsBodyWhenNotDecoding) {
+    const auto encoded = Gzip("Hello World!");
+
+    Express::Http::ResponseParser parser;
+    std::error_code ec;
+    Feed(parser, "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\nContent-Length: " +
+                 std::to_string(encoded.size()) + "\r\n\r\n" + encoded, ec);
+
+    auto response = std::move(parser).response(ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(response.data, encoded);
+    EXPECT_EQ(response.headers.Get("content-encoding"), "gzip");
+}
+
+TEST(ResponseParserDecoding, ReportsTruncatedBody) {
+    const auto encoded = Gzip(std::string(10000, 'x'));
+
+    Express::Http::ResponseParser parser {std::pmr::get_default_resource(), Express::Http::Decoding::kDecode};
+    std::error_code ec;
+    Feed(parser, "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\n\r\n" + encoded.substr(0, 20), ec);
+    ASSERT_FALSE(ec);
+
+    auto response = std::move(parser).response(ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kInvalidContentEncoding);
+}
+
+TEST(ResponseParserDecoding, KeepsBodyCompressedWithUnknownDictionary) {
+    const auto encoded = Gzip("Hello World!");
+    Express::Dictionaries dictionaries;
+    dictionaries.Add("known", "Hello");
+
+    Express::Http::ResponseParser parser {
+        std::pmr::get_default_resource(), Express::Http::Decoding::kDecode, &dictionaries
+    };
+    std::error_code ec;
+    Feed(parser, "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\nDictionary-ID: \"unknown\"\r\n"
+                 "Content-Length: " + std::to_string(encoded.size()) + "\r\n\r\n" + encoded, ec);
+
+    auto response = std::move(parser).response(ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(response.data, encoded);
+    EXPECT_EQ(response.headers.Get("dictionary-id"), "\"unknown\"");
+}
+
+TEST(ResponseParserDecoding, DecodesBodyWithSharedDictionary) {
+    const std::string dictionary {R"({"id":0,"name":"","email":"@example.com","active":true})"};
+    const std::string body {R"({"id":42,"name":"Fred","email":"fred@example.com","active":true})"};
+    const auto encoded = Compress(body, MAX_WBITS, dictionary);
+
+    Express::Dictionaries dictionaries;
+    dictionaries.Add("users-v1", dictionary);
+
+    Express::Http::ResponseParser parser {
+        std::pmr::get_default_resource(), Express::Http::Decoding::kDecode, &dictionaries
+    };
+    std::error_code ec;
+    Feed(parser, "HTTP/1.1 200 OK\r\nContent-Encoding: deflate\r\nDictionary-ID: users-v1\r\n"
+                 "Content-Length: " + std::to_string(encoded.size()) + "\r\n\r\n" + encoded, ec);
+
+    auto response = std::move(parser).response(ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(response.data, body);
+    EXPECT_FALSE(response.headers.Contains("dictionary-id"));
+}
+#endif
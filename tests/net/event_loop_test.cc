@@ -0,0 +1,117 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "net/event_loop.h"
+
+#include <chrono>
+#include <future>
+#include <optional>
+#include <stop_token>
+
+#include <gtest/gtest.h>
+
+#include "express/task.h"
+
+#include "client/timeout.h"
+#include "net/socket.h"
+
+#if defined(_WIN32)
+    #include "net/winsock.h"
+#endif
+
+using namespace std::chrono_literals;
+
+class EventLoop: public ::testing::Test {
+#if defined(_WIN32)
+    Express::Net::WinSock winsock;
+#endif
+};
+
+namespace {
+    struct Operation : Express::Net::WaitOperation {
+        std::promise<Express::Net::WaitResult> promise;
+
+        Operation(Express::Net::SOCKET fd, Express::Net::EventType event, const Express::Timeout& timeout) {
+            this->fd = fd;
+            this->event = event;
+            this->has_deadline = timeout.has_timeout();
+            this->deadline = timeout.expiry();
+            this->complete = [](auto* operation, auto result) {
+                static_cast<Operation*>(operation)->promise.set_value(result);
+            };
+        }
+    };
+
+    auto Sleep(
+        Express::Net::EventLoop& loop,
+        Express::Timeout timeout,
+        std::stop_token stop = {}
+    ) -> Express::Task<Express::Net::WaitResult> {
+        co_return co_await loop.Sleep(timeout, stop);
+    }
+}
+
+TEST_F(EventLoop, CompletesWhenSocketIsReady) {
+    Express::Net::Socket socket {{"127.0.0.1", "5000"}};
+    socket.Connect(Express::Timeout {0s});
+
+    Express::Net::EventLoop loop;
+    Operation operation {socket.handle(), Express::Net::EventType::kToWrite, Express::Timeout {1s}};
+    loop.Submit(&operation);
+
+    EXPECT_EQ(operation.promise.get_future().get(), Express::Net::WaitResult::kReady);
+}
+
+TEST_F(EventLoop, CompletesWhenTimeoutExpires) {
+    Express::Net::Socket socket {{"127.0.0.1", "5000"}};
+    socket.Connect(Express::Timeout {0s});
+
+    // Nothing was sent, so there's nothing to read
+    Express::Net::EventLoop loop;
+    Operation operation {socket.handle(), Express::Net::EventType::kToRead, Express::Timeout {10ms}};
+    loop.Submit(&operation);
+
+    EXPECT_EQ(operation.promise.get_future().get(), Express::Net::WaitResult::kTimeout);
+}
+
+TEST_F(EventLoop, AbortsPendingOperationsWhenDestroyed) {
+    Express::Net::Socket socket {{"127.0.0.1", "5000"}};
+    socket.Connect(Express::Timeout {0s});
+
+    std::optional<Express::Net::EventLoop> loop {std::in_place};
+    Operation operation {socket.handle(), Express::Net::EventType::kToRead, Express::Timeout {0s}};
+    auto future = operation.promise.get_future();
+    loop->Submit(&operation);
+    loop.reset();
+
+    EXPECT_EQ(future.get(), Express::Net::WaitResult::kAborted);
+}
+
+TEST_F(EventLoop, CompletesWhenOperationIsCancelled) {
+    Express::Net::Socket socket {{"127.0.0.1", "5000"}};
+    socket.Connect(Express::Timeout {0s});
+
+    Express::Net::EventLoop loop;
+    Operation operation {socket.handle(), Express::Net::EventType::kToRead, Express::Timeout {0s}};
+    loop.Submit(&operation);
+    loop.Cancel(&operation);
+
+    EXPECT_EQ(operation.promise.get_future().get(), Express::Net::WaitResult::kCancelled);
+}
+
+TEST_F(EventLoop, SleepsUntilTimeoutExpires) {
+    Express::Net::EventLoop loop;
+    const auto start = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(Express::SyncWait(Sleep(loop, Express::Timeout {10ms})), Express::Net::WaitResult::kTimeout);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 10ms);
+}
+
+TEST_F(EventLoop, WakesSleepWhenStopIsRequested) {
+    Express::Net::EventLoop loop;
+    std::stop_source source;
+    source.request_stop();
+
+    auto result = Express::SyncWait(Sleep(loop, Express::Timeout {10s}, source.get_token()));
+    EXPECT_EQ(result, Express::Net::WaitResult::kCancelled);
+}
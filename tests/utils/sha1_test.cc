@@ -0,0 +1,37 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "utils/sha1.h"
+
+#include <cstdio>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+    auto Hex(std::string_view data) {
+        std::string output;
+        for (const auto byte : Express::Sha1(data)) {
+            char digits[3];
+            std::snprintf(digits, sizeof(digits), "%02x", byte);
+            output.append(digits);
+        }
+        return output;
+    }
+}
+
+TEST(Sha1, HashesTestVectors) {
+    EXPECT_EQ(Hex(""), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    EXPECT_EQ(Hex("abc"), "a9993e364706816aba3e25717850c26c9cd0d89d");
+    EXPECT_EQ(
+        Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+        "84983e441c3bd26ebaae4aa1f95129e5e54670f1"
+    );
+}
+
+TEST(Sha1, HashesDataAcrossBlocks) {
+    // 55 and 56 bytes are the last sizes whose padding fits in one block or not
+    EXPECT_EQ(Hex(std::string(55, 'a')), "c1c8bbdc22796e28c0e15163d20899b65621d65a");
+    EXPECT_EQ(Hex(std::string(56, 'a')), "c2db330f6083854c99d4b5bfb6e8f29f201be699");
+    EXPECT_EQ(Hex(std::string(1'000'000, 'a')), "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+}
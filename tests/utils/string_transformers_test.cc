@@ -78,4 +78,12 @@ TEST(StringTransformers, Base64Encoding) {
     EXPECT_EQ(Base64Encoding("abcd"), "YWJjZA==");
     EXPECT_EQ(Base64Encoding("open:sesame"), "b3BlbjpzZXNhbWU=");
     EXPECT_EQ(Base64Encoding("aladdin:opensesame"), "YWxhZGRpbjpvcGVuc2VzYW1l");
-}
\ No newline at end of file
+    EXPECT_EQ(Base64Encoding("\xff\xfe\x80"), "//6A");
+}
+
+TEST(StringTransformers, EqualsIgnoreCase) {
+    EXPECT_TRUE(EqualsIgnoreCase("Content-Length", "content-length"));
+    EXPECT_TRUE(EqualsIgnoreCase("", ""));
+    EXPECT_FALSE(EqualsIgnoreCase("Content-Length", "content-lengt"));
+    EXPECT_FALSE(EqualsIgnoreCase("Content-Type", "content-length"));
+}
@@ -0,0 +1,122 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "websocket/deflate.h"
+
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <gtest/gtest.h>
+
+#include "express/error_code.h"
+
+using namespace Express::Ws;
+
+namespace {
+    auto Message(int items) {
+        std::string message;
+        for (auto i = 0; i < items; ++i) message.append(R"({"id":)").append(std::to_string(i)).append("},");
+        return message;
+    }
+}
+
+TEST(Deflate, ParsesExtensions) {
+    bool deflate = false;
+    DeflateParameters parameters;
+
+    EXPECT_FALSE(ParseExtensions("", deflate, parameters));
+    EXPECT_FALSE(deflate);
+
+    EXPECT_FALSE(ParseExtensions(
+        "permessage-deflate; client_no_context_takeover; client_max_window_bits=\"10\"", deflate, parameters
+    ));
+    EXPECT_TRUE(deflate);
+    EXPECT_TRUE(parameters.client_no_context_takeover);
+    EXPECT_FALSE(parameters.server_no_context_takeover);
+    EXPECT_EQ(parameters.client_max_window_bits, 10);
+    EXPECT_EQ(parameters.server_max_window_bits, 15);
+}
+
+TEST(Deflate, RejectsExtensionsThatWerentOffered) {
+    bool deflate = false;
+    DeflateParameters parameters;
+
+    for (const auto value : {
+        "x-webkit-deflate-frame",
+        "permessage-deflate, permessage-deflate",
+        "permessage-deflate; unknown",
+        "permessage-deflate; server_no_context_takeover; server_no_context_takeover",
+        "permessage-deflate; client_max_window_bits=16",
+        "permessage-deflate; client_max_window_bits=8",
+    }) {
+        EXPECT_EQ(ParseExtensions(value, deflate, parameters), Express::ErrorCode::kHandshakeFailed) << value;
+    }
+}
+
+TEST(Deflate, CompressesWithContextTakeover) {
+    if (!DeflateSupported()) GTEST_SKIP() << "Built without zlib";
+
+    PerMessageDeflate client {{}};
+    PerMessageDeflate server {{}};
+    const auto message = Message(200);
+
+    // The second copy refers to the first one's window
+    std::string first;
+    std::string second;
+    std::string output;
+    std::error_code ec;
+    client.Compress(message, first, ec);
+    ASSERT_FALSE(ec);
+    client.Compress(message, second, ec);
+    ASSERT_FALSE(ec);
+    EXPECT_LT(first.size(), message.size());
+    EXPECT_LT(second.size(), first.size());
+    EXPECT_FALSE(first.ends_with(std::string_view {"\x00\x00\xff\xff", 4}));
+
+    server.Decompress(first, message.size(), output, ec);
+    ASSERT_FALSE(ec);
+    EXPECT_EQ(output, message);
+    server.Decompress(second, message.size(), output, ec);
+    ASSERT_FALSE(ec);
+    EXPECT_EQ(output, message);
+}
+
+TEST(Deflate, CompressesWithoutContextTakeover) {
+    if (!DeflateSupported()) GTEST_SKIP() << "Built without zlib";
+
+    PerMessageDeflate client {{.client_no_context_takeover = true}};
+    PerMessageDeflate server {{.server_no_context_takeover = true}};
+    const auto message = Message(200);
+
+    std::string first;
+    std::string second;
+    std::string output;
+    std::error_code ec;
+    client.Compress(message, first, ec);
+    client.Compress(message, second, ec);
+    EXPECT_EQ(first, second);
+
+    // Every message decompresses on its own
+    server.Decompress(second, message.size(), output, ec);
+    ASSERT_FALSE(ec);
+    EXPECT_EQ(output, message);
+}
+
+TEST(Deflate, RejectsMessagesLargerThanMaximum) {
+    if (!DeflateSupported()) GTEST_SKIP() << "Built without zlib";
+
+    PerMessageDeflate client {{}};
+    PerMessageDeflate server {{}};
+    const auto message = Message(1000);
+
+    std::string compressed;
+    std::string output;
+    std::error_code ec;
+    client.Compress(message, compressed, ec);
+    server.Decompress(compressed, message.size() - 1, output, ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kMessageTooLarge);
+
+    server.Decompress("not deflate", 1000, output, ec);
+    EXPECT_EQ(ec, Express::ErrorCode::kWebSocketProtocolError);
+}
@@ -0,0 +1,127 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "websocket/frame.h"
+
+#include <algorithm>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <gtest/gtest.h>
+
+#include "express/error_code.h"
+
+using namespace std::string_view_literals;
+
+using namespace Express::Ws;
+
+namespace {
+    auto Bytes(std::string_view data) {
+        return std::span {reinterpret_cast<const unsigned char*>(data.data()), data.size()};
+    }
+
+    auto AsString(std::span<const unsigned char> data) {
+        return std::string {reinterpret_cast<const char*>(data.data()), data.size()};
+    }
+
+    // Receives the data into the reader in chunks of the size
+    auto Receive(FrameReader& reader, std::string_view data, std::size_t chunk) {
+        while (!data.empty()) {
+            const auto size = std::min(chunk, data.size());
+            auto space = reader.Prepare(size);
+            std::copy_n(data.begin(), size, space.begin());
+            reader.Commit(size);
+            data.remove_prefix(size);
+        }
+    }
+}
+
+TEST(Frame, WritesUnmaskedFrames) {
+    // The examples of RFC 6455, section 5.7
+    std::string output;
+    WriteFrame(Opcode::kText, "Hello", true, false, {}, output);
+    EXPECT_EQ(output, "\x81\x05Hello"sv);
+
+    output.clear();
+    WriteFrame(Opcode::kText, "Hel", false, false, {}, output);
+    WriteFrame(Opcode::kContinuation, "lo", true, false, {}, output);
+    EXPECT_EQ(output, "\x01\x03Hel\x80\x02lo"sv);
+}
+
+TEST(Frame, WritesMaskedFrames) {
+    std::string output;
+    WriteFrame(Opcode::kText, "Hello", true, false, MaskingKey {0x37, 0xFA, 0x21, 0x3D}, output);
+    EXPECT_EQ(output, "\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58"sv);
+}
+
+TEST(Frame, WritesExtendedLengths) {
+    std::string output;
+    WriteFrame(Opcode::kBinary, std::string(256, 'a'), true, true, {}, output);
+    EXPECT_EQ(output.substr(0, 4), "\xc2\x7e\x01\x00"sv);
+    EXPECT_EQ(output.size(), 4 + 256);
+
+    output.clear();
+    WriteFrame(Opcode::kBinary, std::string(65536, 'a'), true, false, {}, output);
+    EXPECT_EQ(output.substr(0, 10), "\x82\x7f\x00\x00\x00\x00\x00\x01\x00\x00"sv);
+    EXPECT_EQ(output.size(), 10 + 65536);
+}
+
+TEST(Frame, RejectsMalformedHeaders) {
+    FrameHeader header;
+    std::error_code ec;
+
+    // A reserved bit, a reserved opcode, a fragmented ping and a large close
+    for (const auto data : {"\xa1\x00"sv, "\x83\x00"sv, "\x09\x00"sv, "\x88\x7e\x00\x7e"sv}) {
+        EXPECT_FALSE(ParseFrameHeader(Bytes(data), header, ec));
+        EXPECT_EQ(ec, Express::ErrorCode::kWebSocketProtocolError);
+    }
+
+    // A header that hasn't arrived yet
+    EXPECT_FALSE(ParseFrameHeader(Bytes("\x82\x7e\x01"sv), header, ec));
+    EXPECT_FALSE(ec);
+}
+
+TEST(Frame, ReadsFramesInChunks) {
+    std::string data;
+    WriteFrame(Opcode::kText, "first", true, false, MaskingKey {1, 2, 3, 4}, data);
+    WriteFrame(Opcode::kPing, "", true, false, {}, data);
+    WriteFrame(Opcode::kBinary, std::string(70'000, 'x'), true, false, {}, data);
+
+    for (const std::size_t chunk : {1, 7, 4096, 1 << 20}) {
+        FrameReader reader {1 << 20};
+        Receive(reader, data, chunk);
+
+        Frame frame;
+        std::error_code ec;
+        ASSERT_TRUE(reader.Next(frame, ec));
+        EXPECT_EQ(frame.header.opcode, Opcode::kText);
+        EXPECT_TRUE(frame.header.masked);
+        EXPECT_EQ(AsString(frame.payload), "first");
+
+        ASSERT_TRUE(reader.Next(frame, ec));
+        EXPECT_EQ(frame.header.opcode, Opcode::kPing);
+        EXPECT_TRUE(frame.payload.empty());
+
+        ASSERT_TRUE(reader.Next(frame, ec));
+        EXPECT_EQ(frame.payload.size(), 70'000);
+        EXPECT_EQ(reader.buffered(), 0);
+        EXPECT_FALSE(reader.Next(frame, ec));
+        EXPECT_FALSE(ec);
+    }
+}
+
+TEST(Frame, RejectsFramesLargerThanMaximum) {
+    std::string data;
+    WriteFrame(Opcode::kBinary, std::string(100, 'x'), true, false, {}, data);
+
+    // The frame is rejected as soon as its header arrives
+    FrameReader reader {99};
+    Receive(reader, data.substr(0, 2), 2);
+
+    Frame frame;
+    std::error_code ec;
+    EXPECT_FALSE(reader.Next(frame, ec));
+    EXPECT_EQ(ec, Express::ErrorCode::kMessageTooLarge);
+}
@@ -0,0 +1,94 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "websocket/handshake.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "express/error_code.h"
+
+using namespace Express::Ws;
+
+namespace {
+    // The example of RFC 6455, section 1.3
+    constexpr auto kKey = "dGhlIHNhbXBsZSBub25jZQ==";
+    constexpr auto kAccept = "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=";
+
+    auto Upgrade() {
+        return Express::Headers {{
+            {"Upgrade", "websocket"},
+            {"Connection", "keep-alive, Upgrade"},
+            {"Sec-WebSocket-Accept", kAccept},
+        }};
+    }
+}
+
+TEST(Handshake, AcceptsKeys) {
+    EXPECT_EQ(AcceptKey(kKey), kAccept);
+
+    // Keys are 16 random bytes
+    const auto key = MakeKey();
+    EXPECT_EQ(key.size(), 24);
+    EXPECT_NE(key, MakeKey());
+}
+
+TEST(Handshake, MapsWebSocketUrls) {
+    EXPECT_EQ(UpgradeUrl("ws://example.com/chat"), "http://example.com/chat");
+    EXPECT_EQ(UpgradeUrl("WSS://example.com:8443"), "https://example.com:8443");
+    EXPECT_EQ(UpgradeUrl("http://example.com"), "http://example.com");
+}
+
+TEST(Handshake, AddsUpgradeHeaders) {
+    Express::Headers headers;
+    EXPECT_FALSE(AddUpgradeHeaders(headers, kKey, {.protocols = {"chat.v2", "chat.v1"}, .deflate = true}));
+    EXPECT_EQ(headers.Get("upgrade"), "websocket");
+    EXPECT_EQ(headers.Get("connection"), "Upgrade");
+    EXPECT_EQ(headers.Get("sec-websocket-version"), "13");
+    EXPECT_EQ(headers.Get("sec-websocket-key"), kKey);
+    EXPECT_EQ(headers.Get("sec-websocket-protocol"), "chat.v2, chat.v1");
+    EXPECT_EQ(headers.Contains("sec-websocket-extensions"), DeflateSupported());
+    if (DeflateSupported()) EXPECT_EQ(headers.Get("sec-websocket-extensions"), kDeflateOffer);
+
+    EXPECT_EQ(AddUpgradeHeaders(headers, kKey, {.protocols = {"chat v2"}}), Express::ErrorCode::kInvalidHeaderValue);
+}
+
+TEST(Handshake, ChecksUpgrade) {
+    Handshake handshake;
+    EXPECT_FALSE(CheckUpgrade(101, Upgrade(), kKey, {}, handshake));
+    EXPECT_EQ(handshake.protocol, "");
+    EXPECT_FALSE(handshake.deflate);
+
+    auto headers = Upgrade();
+    headers.Add("Sec-WebSocket-Protocol", "chat.v1");
+    headers.Add("Sec-WebSocket-Extensions", "permessage-deflate; server_no_context_takeover");
+    const auto ec = CheckUpgrade(101, headers, kKey, {.protocols = {"chat.v1"}, .deflate = true}, handshake);
+
+    // Without zlib the extension was never offered
+    if (!DeflateSupported()) {
+        EXPECT_EQ(ec, Express::ErrorCode::kHandshakeFailed);
+        return;
+    }
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(handshake.protocol, "chat.v1");
+    EXPECT_TRUE(handshake.deflate);
+    EXPECT_TRUE(handshake.parameters.server_no_context_takeover);
+}
+
+TEST(Handshake, RejectsFailedUpgrade) {
+    using Express::ErrorCode;
+    Handshake handshake;
+
+    EXPECT_EQ(CheckUpgrade(200, Upgrade(), kKey, {}, handshake), ErrorCode::kHandshakeFailed);
+    EXPECT_EQ(CheckUpgrade(101, Upgrade(), "another key", {}, handshake), ErrorCode::kHandshakeFailed);
+
+    // A subprotocol or an extension that wasn't offered
+    auto headers = Upgrade();
+    headers.Add("Sec-WebSocket-Protocol", "chat.v3");
+    EXPECT_EQ(CheckUpgrade(101, headers, kKey, {.protocols = {"chat.v1"}}, handshake), ErrorCode::kHandshakeFailed);
+
+    headers = Upgrade();
+    headers.Add("Sec-WebSocket-Extensions", "permessage-deflate");
+    EXPECT_EQ(CheckUpgrade(101, headers, kKey, {}, handshake), ErrorCode::kHandshakeFailed);
+}
@@ -0,0 +1,64 @@
+// Copyright 2023 Betamark Pty Ltd. All rights reserved.
+// Author: Shlomi Nissan (shlomi@betamark.com)
+
+#include "websocket/mask.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using Express::Ws::Mask;
+using Express::Ws::MaskBytewise;
+using Express::Ws::MaskingKey;
+
+namespace {
+    auto Payload(std::size_t size) {
+        std::vector<unsigned char> payload(size);
+        for (std::size_t i = 0; i < size; ++i) payload[i] = static_cast<unsigned char>(i * 7 + 3);
+        return payload;
+    }
+}
+
+TEST(Mask, MatchesBytewiseMasking) {
+    const MaskingKey key {0x37, 0xFA, 0x21, 0x3D};
+
+    // Sizes around every register width, so the vector loops, the word
+    // loop and the tail all run
+    for (std::size_t size = 0; size < 100; ++size) {
+        const auto payload = Payload(size);
+        std::vector<unsigned char> expected(size);
+        std::vector<unsigned char> masked(size);
+        MaskBytewise(payload.data(), expected.data(), size, key);
+        Mask(payload.data(), masked.data(), size, key);
+        EXPECT_EQ(masked, expected) << size;
+    }
+}
+
+TEST(Mask, UnmasksInPlace) {
+    const MaskingKey key {0x01, 0x80, 0xFF, 0x7E};
+    const auto payload = Payload(1000);
+
+    auto data = payload;
+    Mask(data.data(), data.size(), key);
+    EXPECT_NE(data, payload);
+    Mask(data.data(), data.size(), key);
+    EXPECT_EQ(data, payload);
+}
+
+TEST(Mask, MasksPayloadInPieces) {
+    // A piece that starts at an offset continues with the key where the
+    // previous one stopped
+    const MaskingKey key {0x12, 0x34, 0x56, 0x78};
+    const auto payload = Payload(301);
+
+    std::vector<unsigned char> expected(payload.size());
+    MaskBytewise(payload.data(), expected.data(), payload.size(), key);
+
+    auto pieces = payload;
+    for (std::size_t offset = 0; offset < pieces.size(); offset += 37) {
+        const auto size = std::min<std::size_t>(37, pieces.size() - offset);
+        Mask(pieces.data() + offset, size, key, offset);
+    }
+    EXPECT_EQ(pieces, expected);
+}
@@ -0,0 +1,130 @@
+"""A forward proxy stand-in for the client tests.
+
+Forwards absolute-form requests to the origin server, and opens CONNECT
+tunnels to ports 5000 and 5002. Credentials, when a request has them,
+must be proxy:secret. GET /stats reports the connections and tunnels the
+proxy has accepted, so tests can tell whether connections were reused.
+"""
+
+import base64
+import http.client
+import json
+import select
+import socket
+import threading
+import urllib.parse
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+CREDENTIALS = "Basic " + base64.b64encode(b"proxy:secret").decode()
+ALLOWED_PORTS = {5000, 5002}
+HOP_BY_HOP = {"connection", "keep-alive", "proxy-authorization", "proxy-connection", "te", "upgrade"}
+
+lock = threading.Lock()
+stats = {"connections": 0, "tunnels": 0}
+
+
+class ProxyHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, *args):
+        pass
+
+    def setup(self):
+        super().setup()
+        with lock:
+            stats["connections"] += 1
+
+    def reply(self, code, body, headers=()):
+        data = body.encode()
+        self.send_response(code)
+        self.send_header("Content-Length", str(len(data)))
+        for name, value in headers:
+            self.send_header(name, value)
+        self.end_headers()
+        self.wfile.write(data)
+
+    def authorized(self):
+        credentials = self.headers.get("Proxy-Authorization")
+        if credentials is None or credentials == CREDENTIALS:
+            return True
+        self.reply(407, "Proxy Authentication Required", [("Proxy-Authenticate", 'Basic realm="proxy"')])
+        return False
+
+    def forward(self):
+        if not self.path.startswith("http://"):
+            if self.path == "/stats":
+                with lock:
+                    return self.reply(200, json.dumps(stats), [("Content-Type", "application/json")])
+            return self.reply(400, "Bad Request")
+
+        length = int(self.headers.get("Content-Length", "0"))
+        body = self.rfile.read(length) if length else None
+        if not self.authorized():
+            return
+
+        url = urllib.parse.urlsplit(self.path)
+        target = url.path + ("?" + url.query if url.query else "")
+        headers = {k: v for k, v in self.headers.items() if k.lower() not in HOP_BY_HOP}
+
+        origin = http.client.HTTPConnection(url.hostname, url.port or 80, timeout=10)
+        try:
+            origin.request(self.command, target or "/", body=body, headers=headers)
+            response = origin.getresponse()
+            data = response.read()
+        except OSError:
+            return self.reply(502, "Bad Gateway")
+        finally:
+            origin.close()
+
+        self.send_response(response.status, response.reason)
+        for name, value in response.getheaders():
+            if name.lower() not in HOP_BY_HOP and name.lower() not in ("content-length", "date", "server", "transfer-encoding"):
+                self.send_header(name, value)
+        self.send_header("Content-Length", str(len(data)))
+        self.send_header("Via", "1.1 mock-proxy")
+        self.end_headers()
+        self.wfile.write(data)
+
+    do_GET = do_HEAD = do_POST = do_PUT = do_PATCH = do_DELETE = do_OPTIONS = forward
+
+    def do_CONNECT(self):
+        if not self.authorized():
+            return
+
+        host, _, port = self.path.rpartition(":")
+        if not port.isdigit() or int(port) not in ALLOWED_PORTS:
+            return self.reply(403, "Forbidden")
+
+        try:
+            origin = socket.create_connection((host, int(port)), timeout=10)
+        except OSError:
+            return self.reply(502, "Bad Gateway")
+
+        with lock:
+            stats["tunnels"] += 1
+        self.send_response(200, "Connection Established")
+        self.end_headers()
+        self.wfile.flush()
+
+        # Relays the bytes both ways until either side closes
+        client = self.connection
+        try:
+            while True:
+                readable, _, _ = select.select([client, origin], [], [], 30)
+                if not readable:
+                    break
+                for source in readable:
+                    data = source.recv(65536)
+                    if not data:
+                        raise ConnectionResetError
+                    (origin if source is client else client).sendall(data)
+        except OSError:
+            pass
+        finally:
+            origin.close()
+            self.close_connection = True
+
+
+if __name__ == "__main__":
+    ThreadingHTTPServer.daemon_threads = True
+    ThreadingHTTPServer(("127.0.0.1", 5001), ProxyHandler).serve_forever()
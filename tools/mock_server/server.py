@@ -1,7 +1,12 @@
 ## Copyright 2023 Betamark Pty Ltd. All rights reserved.
 ## Author: Shlomi Nissan (shlomi@betamark.com)
 
-from flask import Flask, request, cli
+import functools
+import gzip
+import time
+import zlib
+
+from flask import Flask, Response, request, cli
 from flask_httpauth import HTTPBasicAuth
 from werkzeug.security import generate_password_hash, check_password_hash
 
@@ -19,6 +24,108 @@ def process_get_request():
 def process_get_with_auth():
     return f'Hello {auth.current_user().capitalize()}!'
 
+# The first request for every id is slow, later requests are fast
+hedged_ids = set()
+
+@app.route('/hedge', methods=['GET'])
+def process_hedged_request():
+    request_id = request.args.get('id')
+    if request_id not in hedged_ids:
+        hedged_ids.add(request_id)
+        time.sleep(1)
+    return 'Hello World!'
+
+# The first request for every id fails, later requests succeed
+flaky_ids = set()
+
+@app.route('/flaky', methods=['GET'])
+def process_flaky_request():
+    request_id = request.args.get('id')
+    if request_id not in flaky_ids:
+        flaky_ids.add(request_id)
+        return 'Service Unavailable', 503, {'Retry-After': '0'}
+    return 'Hello World!'
+
+# Slowly counts the requests for every id
+hits = {}
+
+@app.route('/hits', methods=['GET'])
+def process_hits_request():
+    request_id = request.args.get('id')
+    hits[request_id] = hits.get(request_id, 0) + 1
+    count = hits[request_id]
+    time.sleep(0.3)
+    return str(count)
+
+# Fresh for a minute, and slow enough for concurrent requests to overlap
+@app.route('/cached', methods=['GET'])
+def process_cached_request():
+    request_id = request.args.get('id')
+    hits[request_id] = hits.get(request_id, 0) + 1
+    time.sleep(0.2)
+    return str(hits[request_id]), 200, {'Cache-Control': 'max-age=60'}
+
+# Revalidated on every use
+@app.route('/validated', methods=['GET'])
+def process_validated_request():
+    if request.headers.get('If-None-Match') == '"v1"':
+        return '', 304, {'ETag': '"v1"'}
+    request_id = request.args.get('id')
+    hits[request_id] = hits.get(request_id, 0) + 1
+    return str(hits[request_id]), 200, {'Cache-Control': 'no-cache', 'ETag': '"v1"'}
+
+@app.route('/trickle', methods=['GET'])
+def process_trickle_request():
+    def generate():
+        for i in range(4):
+            if i: time.sleep(0.3)
+            yield 'x'
+    return Response(generate(), mimetype='text/html')
+
+# A Server-Sent Events stream that sends `count` events and closes. Event
+# IDs go on from the Last-Event-ID the client resumes with.
+def event_stream(last_id, count):
+    yield 'retry: 10\n: connected\n\n'
+    for i in range(last_id + 1, last_id + count + 1):
+        time.sleep(0.01)
+        yield f'event: tick\r\ndata: tick {i}\r\ndata: of {count}\r\nid: {i}\r\n\r\n'
+
+@app.route('/events', methods=['GET'])
+def process_events_request():
+    if request.args.get('status'):
+        return '', int(request.args.get('status'))
+    last_id = int(request.headers.get('Last-Event-ID', '0'))
+    count = int(request.args.get('count', '3'))
+    return Response(event_stream(last_id, count), mimetype='text/event-stream')
+
+# A JSON array of about `size` bytes, compressed when the client accepts
+# it. Bodies are cached so that benchmarks measure the client.
+@functools.lru_cache(maxsize=16)
+def json_body(size, coding):
+    items = []
+    length = 1
+    while length < size:
+        i = len(items)
+        items.append(f'{{"id":{i},"name":"item-{i}","tags":["red","green"]}}')
+        length += len(items[-1]) + 1
+    body = ('[' + ','.join(items) + ']').encode()
+    if coding == 'gzip':
+        return gzip.compress(body)
+    if coding == 'deflate':
+        return zlib.compress(body)
+    return body
+
+@app.route('/json', methods=['GET'])
+def process_json_request():
+    size = int(request.args.get('size', 1024))
+    headers = {'Content-Type': 'application/json', 'Vary': 'Accept-Encoding'}
+    for coding in request.headers.get('Accept-Encoding', '').split(','):
+        coding = coding.strip()
+        if coding in ('gzip', 'deflate'):
+            headers['Content-Encoding'] = coding
+            return json_body(size, coding), 200, headers
+    return json_body(size, None), 200, headers
+
 # POST
 
 @app.route('/', methods=['POST'])
@@ -27,6 +134,18 @@ def process_post_request():
     last_name = request.form.get('lastName')
     return f'Hello {first_name} {last_name}!'
 
+# Returns the body it received, decoded
+@app.route('/echo', methods=['POST'])
+def process_echo_request():
+    body = request.get_data()
+    if request.headers.get('Content-Encoding') == 'gzip':
+        body = gzip.decompress(body)
+    return body, 200, {'Content-Type': 'application/octet-stream'}
+
+@app.route('/reject', methods=['POST'])
+def process_reject_request():
+    return 'Payload Too Large', 413, {'Connection': 'close'}
+
 @app.route('/slow', methods=['POST'])
 def process_slow_post_request():
     time.sleep(1) 
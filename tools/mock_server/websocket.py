@@ -0,0 +1,192 @@
+"""A WebSocket server stand-in for the client tests, on port 5002.
+
+/echo sends every message back, compressed when the client negotiated
+permessage-deflate. With ?ping=<data> it pings the client first and
+reports the pong as "pong:<data>", and with ?fragments=<n> it greets the
+client with a message split into n frames, with a ping between them.
+/quiet answers pings and reports the third one, unless ?answer=0, when
+it never answers. /close closes the connection with 1001, /masked sends
+a masked frame, which servers must not, and /reject refuses the upgrade.
+Subprotocols are picked from chat.v2 and chat.v1.
+"""
+
+import base64
+import hashlib
+import os
+import socketserver
+import struct
+import urllib.parse
+import zlib
+
+GUID = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+PROTOCOLS = ["chat.v2", "chat.v1"]
+TAIL = b"\x00\x00\xff\xff"
+
+
+class Closed(Exception):
+    pass
+
+
+class WebSocketHandler(socketserver.StreamRequestHandler):
+    def read_exactly(self, size):
+        data = self.rfile.read(size)
+        if len(data) < size:
+            raise Closed()
+        return data
+
+    def handshake(self):
+        request_line = self.rfile.readline().decode().strip()
+        headers = {}
+        while True:
+            line = self.rfile.readline().decode()
+            if line in ("\r\n", "\n", ""):
+                break
+            name, _, value = line.partition(":")
+            headers[name.strip().lower()] = value.strip()
+
+        path = request_line.split(" ")[1]
+        url = urllib.parse.urlsplit(path)
+        key = headers.get("sec-websocket-key", "")
+        if url.path == "/reject" or headers.get("upgrade", "").lower() != "websocket" or not key:
+            self.wfile.write(b"HTTP/1.1 403 Forbidden\r\nContent-Length: 9\r\nConnection: close\r\n\r\nForbidden")
+            return None
+
+        accept = base64.b64encode(hashlib.sha1(key.encode() + GUID).digest()).decode()
+        response = [
+            "HTTP/1.1 101 Switching Protocols",
+            "Upgrade: websocket",
+            "Connection: Upgrade",
+            f"Sec-WebSocket-Accept: {accept}",
+        ]
+
+        offered = [p.strip() for p in headers.get("sec-websocket-protocol", "").split(",") if p.strip()]
+        for protocol in PROTOCOLS:
+            if protocol in offered:
+                response.append(f"Sec-WebSocket-Protocol: {protocol}")
+                break
+
+        self.deflate = "permessage-deflate" in headers.get("sec-websocket-extensions", "")
+        if self.deflate:
+            response.append("Sec-WebSocket-Extensions: permessage-deflate")
+            self.compressor = zlib.compressobj(wbits=-15)
+            self.decompressor = zlib.decompressobj(wbits=-15)
+
+        self.wfile.write(("\r\n".join(response) + "\r\n\r\n").encode())
+        return url
+
+    def send_frame(self, opcode, payload, fin=True, rsv1=False, masked=False):
+        first = (0x80 if fin else 0) | (0x40 if rsv1 else 0) | opcode
+        mask_bit = 0x80 if masked else 0
+        if len(payload) < 126:
+            header = struct.pack("!BB", first, mask_bit | len(payload))
+        elif len(payload) <= 0xFFFF:
+            header = struct.pack("!BBH", first, mask_bit | 126, len(payload))
+        else:
+            header = struct.pack("!BBQ", first, mask_bit | 127, len(payload))
+        if masked:
+            key = os.urandom(4)
+            header += key
+            payload = bytes(b ^ key[i % 4] for i, b in enumerate(payload))
+        self.wfile.write(header + payload)
+
+    def send_message(self, opcode, payload):
+        if self.deflate:
+            compressed = self.compressor.compress(payload) + self.compressor.flush(zlib.Z_SYNC_FLUSH)
+            return self.send_frame(opcode, compressed[:-4], rsv1=True)
+        self.send_frame(opcode, payload)
+
+    def read_frame(self):
+        first, second = self.read_exactly(2)
+        length = second & 0x7F
+        if length == 126:
+            length = struct.unpack("!H", self.read_exactly(2))[0]
+        elif length == 127:
+            length = struct.unpack("!Q", self.read_exactly(8))[0]
+        key = self.read_exactly(4) if second & 0x80 else None
+        payload = self.read_exactly(length)
+        if key:
+            payload = bytes(b ^ key[i % 4] for i, b in enumerate(payload))
+        return bool(first & 0x80), bool(first & 0x40), first & 0x0F, payload
+
+    # Reads a whole message, and answers the control frames before it
+    def read_message(self, on_ping=None):
+        opcode = None
+        compressed = False
+        data = b""
+        while True:
+            fin, rsv1, frame_opcode, payload = self.read_frame()
+            if frame_opcode == 0x8:
+                self.send_frame(0x8, payload[:2])
+                raise Closed()
+            if frame_opcode == 0x9:
+                if on_ping is None or on_ping(payload):
+                    self.send_frame(0xA, payload)
+                continue
+            if frame_opcode == 0xA:
+                return 0xA, payload
+            if frame_opcode != 0x0:
+                opcode = frame_opcode
+                compressed = rsv1
+            data += payload
+            if fin:
+                break
+        if compressed:
+            data = self.decompressor.decompress(data + TAIL)
+        return opcode, data
+
+    def handle(self):
+        url = self.handshake()
+        if url is None:
+            return
+        query = urllib.parse.parse_qs(url.query)
+
+        try:
+            if url.path == "/close":
+                self.send_frame(0x8, struct.pack("!H", 1001) + b"going away")
+                self.read_message()
+            elif url.path == "/masked":
+                self.send_frame(0x1, b"masked", masked=True)
+                self.read_message()
+            elif url.path == "/quiet":
+                answer = query.get("answer", ["1"])[0] != "0"
+                pings = []
+
+                def on_ping(payload):
+                    pings.append(payload)
+                    if answer and len(pings) == 3:
+                        self.send_message(0x1, b"pinged 3 times")
+                    return answer
+
+                while True:
+                    self.read_message(on_ping)
+            else:
+                if "ping" in query:
+                    self.send_frame(0x9, query["ping"][0].encode())
+                    opcode, payload = self.read_message()
+                    if opcode == 0xA:
+                        self.send_message(0x1, b"pong:" + payload)
+                if "fragments" in query:
+                    message = b"a message that arrives in pieces"
+                    count = int(query["fragments"][0])
+                    size = -(-len(message) // count)
+                    pieces = [message[i:i + size] for i in range(0, len(message), size)]
+                    for i, piece in enumerate(pieces):
+                        self.send_frame(0x1 if i == 0 else 0x0, piece, fin=i == len(pieces) - 1)
+                        if i == 0:
+                            self.send_frame(0x9, b"between")
+                while True:
+                    opcode, payload = self.read_message()
+                    if opcode != 0xA:
+                        self.send_message(opcode, payload)
+        except (Closed, ConnectionError):
+            pass
+
+
+class Server(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+if __name__ == "__main__":
+    with Server(("127.0.0.1", 5002), WebSocketHandler) as server:
+        server.serve_forever()